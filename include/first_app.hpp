@@ -1,11 +1,15 @@
 #pragma once
 
+#include "lve_bindless_textures.hpp"
 #include "lve_descriptors.hpp"
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
 #include "lve_renderer.hpp"
 #include "lve_window.hpp"
 #include "lve_texture.hpp"
+#include "lve_texture_streamer.hpp"
+#include "lve_thread_pool.hpp"
+#include "lve_virtual_texture.hpp"
 
 // std
 #include <memory>
@@ -16,6 +20,8 @@ class FirstApp {
  public:
   static constexpr int WIDTH = 800;
   static constexpr int HEIGHT = 600;
+  static constexpr VkDeviceSize TEXTURE_BUDGET_BYTES = 64 * 1024 * 1024;
+  static constexpr float FRAME_STATS_INTERVAL = 5.f;  // seconds between frame stats reports
 
   FirstApp();
   ~FirstApp();
@@ -30,10 +36,17 @@ class FirstApp {
 
   LveWindow lveWindow{WIDTH, HEIGHT, "Vulkan Tutorial"};
   LveDevice lveDevice{lveWindow};
-  LveRenderer lveRenderer{lveWindow, lveDevice};
-
-  std::unique_ptr<LveDescriptorPool> globalPool{};
-  std::unique_ptr<LveDescriptorPool> materialPool{};
+  LveThreadPool threadPool{};  // asset decoding and draw recording
+  // one recording lane per worker plus the main thread
+  LveRenderer lveRenderer{
+      lveWindow, lveDevice, LveSwapChainConfig::fromEnvironment(), threadPool.threadCount() + 1};
+
+  LveDescriptorLayoutCache layoutCache{};
+  std::unique_ptr<LveDescriptorAllocator> descriptorAllocator{};  // sets that live for the whole run
+  std::unique_ptr<LveDescriptorSetCache> descriptorSetCache{};
+  std::unique_ptr<LveBindlessTextures> bindlessTextures{};
+  std::unique_ptr<LveTextureStreamer> textureStreamer{};  // destroyed before the table it uses
+  std::shared_ptr<LveVirtualTexture> virtualTexture{};  // only when textures/test.lvt was cooked
   LveGameObject::Map gameObjects;
 
 	std::shared_ptr<LveTexture> defaultTexture_;
@@ -0,0 +1,25 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+// Single block decoders, each writes a 4x4 block of RGBA8 texels (64 bytes, row major).
+// SNORM variants write two's complement bytes, to be uploaded as VK_FORMAT_R8G8B8A8_SNORM.
+void decodeBC1Block(const uint8_t *block, uint8_t *out, bool allowTransparent);
+void decodeBC3Block(const uint8_t *block, uint8_t *out);
+void decodeBC4Block(const uint8_t *block, uint8_t *out, bool isSigned);
+void decodeBC5Block(const uint8_t *block, uint8_t *out, bool isSigned);
+void decodeBC7Block(const uint8_t *block, uint8_t *out);
+
+// CPU fallback for devices without textureCompressionBC. Decodes a whole level of BC1/3/4/5/7
+// blocks into tightly packed 4 byte texels, see decodedTextureFormat() for the matching format.
+std::vector<uint8_t> decodeBlockCompressedImage(
+    VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height);
+
+}  // namespace lve
@@ -0,0 +1,55 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+class LveThreadPool;
+
+enum class BcQuality {
+  Fast,    // bounding box endpoints, no refinement
+  Normal,  // principal axis endpoints with least squares refinement
+  High,    // Normal plus a local search around the quantized endpoints
+};
+
+struct BcEncodeStats {
+  uint64_t texels{0};
+  uint32_t channels{0};  // channels the format stores, the ones PSNR is measured over
+  double squaredError{0.0};
+  double seconds{0.0};
+
+  // peak signal to noise ratio in dB against the source, infinite for a lossless encode
+  double psnr() const;
+  double megapixelsPerSecond() const;
+  BcEncodeStats &operator+=(const BcEncodeStats &other);
+};
+
+// Single block encoders, texels is a 4x4 block of RGBA8 texels (64 bytes, row major)
+void encodeBC1Block(const uint8_t *texels, uint8_t *out, BcQuality quality);
+void encodeBC3Block(const uint8_t *texels, uint8_t *out, BcQuality quality);
+void encodeBC4Block(const uint8_t *texels, uint8_t *out, BcQuality quality);
+void encodeBC5Block(const uint8_t *texels, uint8_t *out, BcQuality quality);
+// BC7 is written in mode 6, one RGBA subset with 4 bit indices
+void encodeBC7Block(const uint8_t *texels, uint8_t *out, BcQuality quality);
+
+// Encodes one level of tightly packed RGBA8 texels into BC1/3/4/5/7 (UNORM or SRGB, the colour
+// space only matters to the sampler). Block rows are spread across the pool when one is given.
+// Stats are filled by decoding the result again and comparing it with the source.
+std::vector<uint8_t> encodeBlockCompressedImage(
+    VkFormat format,
+    const uint8_t *pixels,
+    uint32_t width,
+    uint32_t height,
+    BcQuality quality,
+    LveThreadPool *pool = nullptr,
+    BcEncodeStats *stats = nullptr);
+
+// name of the index selection kernel compiled in, "AVX2", "SSE2" or "scalar"
+const char *bcEncoderKernelName();
+
+}  // namespace lve
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+#include "lve_texture.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+
+// One global array of combined image samplers that every material indexes into. The set is bound
+// once per pass and draws pick their texture with the slot passed in the push constants, so any
+// number of textures can be used without per-object descriptor sets.
+class LveBindlessTextures {
+ public:
+  static constexpr uint32_t DEFAULT_CAPACITY = 4096;
+  // slot of the default texture, used by materials without a texture of their own
+  static constexpr uint32_t DEFAULT_SLOT = 0;
+
+  // capacity is clamped to the device's update-after-bind limits
+  LveBindlessTextures(
+      LveDevice &device,
+      std::shared_ptr<LveTexture> defaultTexture,
+      uint32_t capacity = DEFAULT_CAPACITY);
+  ~LveBindlessTextures();
+
+  LveBindlessTextures(const LveBindlessTextures &) = delete;
+  LveBindlessTextures &operator=(const LveBindlessTextures &) = delete;
+
+  // Returns the texture's slot, registering it on first use. The table keeps the texture alive
+  // until it is unregistered. A texture lives in at most one table.
+  uint32_t registerTexture(std::shared_ptr<LveTexture> texture);
+  // Frees the texture's slot for reuse. No command buffer still in flight may sample it.
+  void unregisterTexture(LveTexture &texture);
+
+  // Moves a registered texture whose image view changed to a fresh slot and returns the old one.
+  // Frames in flight keep sampling the previous view through the old slot, which must be handed
+  // to releaseSlot once they have finished.
+  uint32_t rebindTexture(LveTexture &texture);
+  void releaseSlot(uint32_t slot);
+
+  VkDescriptorSetLayout getDescriptorSetLayout() const {
+    return setLayout->getDescriptorSetLayout();
+  }
+  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+  uint32_t capacity() const { return capacity_; }
+  uint32_t size() const { return registeredCount; }
+
+ private:
+  uint32_t allocateSlot();
+  void writeSlot(uint32_t slot, const LveTexture &texture);
+
+  LveDevice &lveDevice;
+  uint32_t capacity_;
+  std::unique_ptr<LveDescriptorSetLayout> setLayout;
+  std::unique_ptr<LveDescriptorPool> pool;
+  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+
+  std::vector<std::shared_ptr<LveTexture>> textures;  // indexed by slot
+  std::vector<uint32_t> freeSlots;
+  uint32_t registeredCount{0};
+};
+
+}  // namespace lve
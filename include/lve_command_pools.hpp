@@ -0,0 +1,47 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <vector>
+
+namespace lve {
+
+// Transient command pools, one per frame slot and recording lane. A lane is whatever records on
+// one thread at a time, e.g. one chunk of a parallelFor; its pool needs no locking because no
+// other thread touches it. Command buffers handed out for a frame slot stay valid until reset is
+// called for that slot again, which resets the pools in bulk and makes their buffers available
+// for reuse instead of freeing them.
+class LveFrameCommandPools {
+ public:
+  LveFrameCommandPools(LveDevice &device, int framesInFlight, uint32_t laneCount);
+  ~LveFrameCommandPools();
+
+  LveFrameCommandPools(const LveFrameCommandPools &) = delete;
+  LveFrameCommandPools &operator=(const LveFrameCommandPools &) = delete;
+
+  // once the frame slot's previous submission has finished, e.g. after its fence was waited on
+  void reset(int frameIndex);
+  // A command buffer in the initial state, only to be recorded by the thread owning the lane.
+  // Allocates only when the slot needs more buffers than it ever did before.
+  VkCommandBuffer allocate(int frameIndex, uint32_t lane, VkCommandBufferLevel level);
+
+  uint32_t laneCount() const { return laneCount_; }
+
+ private:
+  struct LanePool {
+    VkCommandPool commandPool{VK_NULL_HANDLE};
+    std::vector<VkCommandBuffer> primary;
+    std::vector<VkCommandBuffer> secondary;
+    size_t primaryUsed{0};
+    size_t secondaryUsed{0};
+  };
+
+  LanePool &lanePool(int frameIndex, uint32_t lane);
+
+  LveDevice &lveDevice;
+  uint32_t laneCount_;
+  std::vector<LanePool> pools;  // laneCount_ per frame slot
+};
+
+}  // namespace lve
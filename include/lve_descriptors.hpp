@@ -3,12 +3,17 @@
 #include "lve_device.hpp"
 
 // std
+#include <cstdint>
+#include <deque>
 #include <memory>
 #include <unordered_map>
 #include <vector>
 
 namespace lve {
 
+class LveDescriptorLayoutCache;
+class LveDescriptorUpdateBatch;
+
 class LveDescriptorSetLayout {
  public:
   class Builder {
@@ -20,15 +25,27 @@ class LveDescriptorSetLayout {
         VkDescriptorType descriptorType,
         VkShaderStageFlags stageFlags,
         uint32_t count = 1);
+    // descriptor indexing flags (partially bound, update after bind, ...) for one binding
+    Builder &setBindingFlags(uint32_t binding, VkDescriptorBindingFlagsEXT flags);
+    Builder &setLayoutFlags(VkDescriptorSetLayoutCreateFlags flags);
     std::unique_ptr<LveDescriptorSetLayout> build() const;
+    // shares the layout with every identical builder that went through the same cache
+    std::shared_ptr<LveDescriptorSetLayout> build(LveDescriptorLayoutCache &cache) const;
 
    private:
+    friend class LveDescriptorLayoutCache;
+
     LveDevice &lveDevice;
     std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings{};
+    std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> bindingFlags{};
+    VkDescriptorSetLayoutCreateFlags layoutFlags = 0;
   };
 
   LveDescriptorSetLayout(
-      LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+      LveDevice &lveDevice,
+      std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+      const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> &bindingFlags = {},
+      VkDescriptorSetLayoutCreateFlags layoutFlags = 0);
   ~LveDescriptorSetLayout();
   LveDescriptorSetLayout(const LveDescriptorSetLayout &) = delete;
   LveDescriptorSetLayout &operator=(const LveDescriptorSetLayout &) = delete;
@@ -41,6 +58,8 @@ class LveDescriptorSetLayout {
   std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings;
 
   friend class LveDescriptorWriter;
+  friend class LveDescriptorAllocator;
+  friend class LveDescriptorSetCache;
 };
 
 class LveDescriptorPool {
@@ -70,8 +89,17 @@ class LveDescriptorPool {
   LveDescriptorPool(const LveDescriptorPool &) = delete;
   LveDescriptorPool &operator=(const LveDescriptorPool &) = delete;
 
+  // variableDescriptorCount sizes the layout's variable count binding, if it has one
   bool allocateDescriptor(
-      const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const;
+      const VkDescriptorSetLayout descriptorSetLayout,
+      VkDescriptorSet &descriptor,
+      uint32_t variableDescriptorCount = 0) const;
+  // same, but hands back the result so a full pool (VK_ERROR_OUT_OF_POOL_MEMORY or
+  // VK_ERROR_FRAGMENTED_POOL) can be told apart from other failures
+  VkResult tryAllocateDescriptor(
+      const VkDescriptorSetLayout descriptorSetLayout,
+      VkDescriptorSet &descriptor,
+      uint32_t variableDescriptorCount = 0) const;
 
   void freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const;
 
@@ -84,20 +112,159 @@ class LveDescriptorPool {
   friend class LveDescriptorWriter;
 };
 
+// Hands out descriptor sets without fixed pool sizes. Every layout gets its own list of pools
+// sized from the layout's bindings; when the current one runs out a new pool twice as large is
+// added, up to MAX_SETS_PER_POOL sets. resetPools recycles all pools at once, which is how
+// transient per frame sets are freed. The layouts must stay alive while the allocator uses them.
+// Not thread safe.
+class LveDescriptorAllocator {
+ public:
+  static constexpr uint32_t DEFAULT_SETS_PER_POOL = 16;
+  static constexpr uint32_t MAX_SETS_PER_POOL = 4096;
+
+  LveDescriptorAllocator(
+      LveDevice &lveDevice,
+      uint32_t initialSetsPerPool = DEFAULT_SETS_PER_POOL,
+      VkDescriptorPoolCreateFlags poolFlags = 0);
+  LveDescriptorAllocator(const LveDescriptorAllocator &) = delete;
+  LveDescriptorAllocator &operator=(const LveDescriptorAllocator &) = delete;
+
+  // false only when a fresh pool cannot hold the set either
+  bool allocateDescriptor(
+      const LveDescriptorSetLayout &setLayout,
+      VkDescriptorSet &descriptor,
+      uint32_t variableDescriptorCount = 0);
+
+  // every set allocated so far becomes invalid, the pools are kept for the next allocations
+  void resetPools();
+
+ private:
+  struct LayoutPools {
+    std::vector<VkDescriptorPoolSize> setSizes;                // descriptors one set needs, per type
+    std::vector<std::unique_ptr<LveDescriptorPool>> usedPools;  // the last one is allocated from
+    std::vector<std::unique_ptr<LveDescriptorPool>> freePools;
+    uint32_t nextSetsPerPool;
+  };
+
+  LayoutPools &getLayoutPools(const LveDescriptorSetLayout &setLayout);
+  void nextPool(LayoutPools &layoutPools);
+
+  LveDevice &lveDevice;
+  uint32_t initialSetsPerPool;
+  VkDescriptorPoolCreateFlags poolFlags;
+  std::unordered_map<VkDescriptorSetLayout, LayoutPools> layouts;
+};
+
+// std::vector<uint64_t> keys of the layout and set caches
+struct LveDescriptorKeyHash {
+  size_t operator()(const std::vector<uint64_t> &key) const;
+};
+
+// One layout per distinct set of bindings, keyed by the bindings, their flags and the layout
+// flags. Layouts stay alive as long as the cache or anyone holding them.
+class LveDescriptorLayoutCache {
+ public:
+  LveDescriptorLayoutCache() = default;
+  LveDescriptorLayoutCache(const LveDescriptorLayoutCache &) = delete;
+  LveDescriptorLayoutCache &operator=(const LveDescriptorLayoutCache &) = delete;
+
+  std::shared_ptr<LveDescriptorSetLayout> getLayout(const LveDescriptorSetLayout::Builder &builder);
+
+  size_t size() const { return layouts.size(); }
+
+ private:
+  std::unordered_map<std::vector<uint64_t>, std::shared_ptr<LveDescriptorSetLayout>,
+                     LveDescriptorKeyHash>
+      layouts;
+};
+
+// Collects descriptor writes for any number of sets and applies them with a single
+// vkUpdateDescriptorSets. The buffer and image infos are copied, so they need not outlive add.
+// Whatever is still pending is flushed on destruction.
+class LveDescriptorUpdateBatch {
+ public:
+  explicit LveDescriptorUpdateBatch(LveDevice &lveDevice) : lveDevice{lveDevice} {}
+  ~LveDescriptorUpdateBatch();
+  LveDescriptorUpdateBatch(const LveDescriptorUpdateBatch &) = delete;
+  LveDescriptorUpdateBatch &operator=(const LveDescriptorUpdateBatch &) = delete;
+
+  void add(VkDescriptorSet set, const std::vector<VkWriteDescriptorSet> &setWrites);
+  void flush();
+
+  size_t pendingWrites() const { return writes.size(); }
+
+ private:
+  LveDevice &lveDevice;
+  std::vector<VkWriteDescriptorSet> writes;
+  // deques keep the addresses the pending writes point at stable
+  std::deque<VkDescriptorBufferInfo> bufferInfos;
+  std::deque<VkDescriptorImageInfo> imageInfos;
+};
+
 class LveDescriptorWriter {
  public:
   LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorPool &pool);
+  LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorAllocator &allocator);
+  // without a pool, for LveDescriptorSetCache which allocates itself
+  explicit LveDescriptorWriter(LveDescriptorSetLayout &setLayout);
 
   LveDescriptorWriter &writeBuffer(uint32_t binding, VkDescriptorBufferInfo *bufferInfo);
-  LveDescriptorWriter &writeImage(uint32_t binding, VkDescriptorImageInfo *imageInfo);
+  LveDescriptorWriter &writeImage(
+      uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement = 0);
 
   bool build(VkDescriptorSet &set);
   void overwrite(VkDescriptorSet &set);
+  // allocate now, write with the batch's next flush
+  bool build(VkDescriptorSet &set, LveDescriptorUpdateBatch &batch);
+  void overwrite(VkDescriptorSet &set, LveDescriptorUpdateBatch &batch);
 
  private:
+  bool allocate(VkDescriptorSet &set);
+
+  friend class LveDescriptorSetCache;
+
   LveDescriptorSetLayout &setLayout;
-  LveDescriptorPool &pool;
+  LveDescriptorPool *pool{nullptr};  // one of the two
+  LveDescriptorAllocator *allocator{nullptr};
   std::vector<VkWriteDescriptorSet> writes;
 };
 
+// Hands out one set per distinct layout and bound resources (buffers with their ranges, samplers,
+// views and layouts), so objects that bind the same things share a set. Sets come from the given
+// allocator; clear the cache whenever that allocator is reset. Writes must be given in the same
+// order to match. Entries are keyed by raw handles, so release a buffer or view before destroying
+// it, or a later resource given the same handle would match the stale set.
+class LveDescriptorSetCache {
+ public:
+  explicit LveDescriptorSetCache(LveDescriptorAllocator &allocator) : allocator{allocator} {}
+  LveDescriptorSetCache(const LveDescriptorSetCache &) = delete;
+  LveDescriptorSetCache &operator=(const LveDescriptorSetCache &) = delete;
+
+  // the writes of a new set go to the batch when given, otherwise they are applied right away
+  bool getDescriptor(
+      const LveDescriptorWriter &writer,
+      VkDescriptorSet &set,
+      LveDescriptorUpdateBatch *batch = nullptr);
+  void clear() { sets.clear(); }
+  // Forgets the sets that refer to the resource. They are not freed, they go back with the
+  // allocator's next reset.
+  void releaseBuffer(VkBuffer buffer);
+  void releaseImageView(VkImageView imageView);
+
+  size_t size() const { return sets.size(); }
+  uint64_t hits() const { return hits_; }
+
+ private:
+  struct Entry {
+    VkDescriptorSet set;
+    std::vector<uint64_t> resources;  // buffer and view handles the set refers to
+  };
+
+  void release(uint64_t resource);
+
+  LveDescriptorAllocator &allocator;
+  std::unordered_map<std::vector<uint64_t>, Entry, LveDescriptorKeyHash> sets;
+  uint64_t hits_{0};
+};
+
 }  // namespace lve
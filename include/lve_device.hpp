@@ -1,13 +1,17 @@
 #pragma once
 
+#include "lve_sampler_cache.hpp"
 #include "lve_window.hpp"
 
 // std lib headers
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+    class LvePipelineRegistry;
+
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR capabilities;
         std::vector<VkSurfaceFormatKHR> formats;
@@ -22,6 +26,20 @@ namespace lve {
         bool isComplete() { return graphicsFamilyHasValue && presentFamilyHasValue; }
     };
 
+    // Entry points of VK_EXT_extended_dynamic_state, of the depth bias enable of
+    // VK_EXT_extended_dynamic_state2 and of the polygon mode of VK_EXT_extended_dynamic_state3.
+    // Null when the device lacks them, see LveDynamicStateTracker.
+    struct ExtendedDynamicStateFunctions {
+        PFN_vkCmdSetCullModeEXT cmdSetCullMode = nullptr;
+        PFN_vkCmdSetFrontFaceEXT cmdSetFrontFace = nullptr;
+        PFN_vkCmdSetPrimitiveTopologyEXT cmdSetPrimitiveTopology = nullptr;
+        PFN_vkCmdSetDepthTestEnableEXT cmdSetDepthTestEnable = nullptr;
+        PFN_vkCmdSetDepthWriteEnableEXT cmdSetDepthWriteEnable = nullptr;
+        PFN_vkCmdSetDepthCompareOpEXT cmdSetDepthCompareOp = nullptr;
+        PFN_vkCmdSetDepthBiasEnableEXT cmdSetDepthBiasEnable = nullptr;
+        PFN_vkCmdSetPolygonModeEXT cmdSetPolygonMode = nullptr;
+    };
+
     class LveDevice {
     public:
 #ifdef NDEBUG
@@ -44,6 +62,10 @@ namespace lve {
         VkSurfaceKHR surface() { return surface_; }
         VkQueue graphicsQueue() { return graphicsQueue_; }
         VkQueue presentQueue() { return presentQueue_; }
+        // shared, reference counted samplers, see LveSamplerCache
+        LveSamplerCache& samplerCache() { return *samplerCache_; }
+        // shared pipelines and shader modules, see LvePipelineRegistry
+        LvePipelineRegistry& pipelineRegistry() { return *pipelineRegistry_; }
 
         SwapChainSupportDetails getSwapChainSupport() { return querySwapChainSupport(physicalDevice); }
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -63,6 +85,8 @@ namespace lve {
         void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void copyBufferToImage(
             VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
+        void copyBufferToImage(
+            VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy>& regions);
 
         void createImageWithInfo(
             const VkImageCreateInfo& imageInfo,
@@ -73,15 +97,46 @@ namespace lve {
             vkDestroyImage(device_, image, nullptr);
             vkFreeMemory(device_, imageMemory, nullptr);
         }
-        VkImageView createImageView(VkImage image, VkImageViewType viewType, VkFormat format);
+        VkImageView createImageView(VkImage image, VkImageViewType viewType, VkFormat format,
+                                    uint32_t layerCount = 1, uint32_t mipLevels = 1);
         void createImage(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format,
                          VkImageTiling tiling, VkImageUsageFlags usage,
                          VkMemoryPropertyFlags properties, VkImage& image,
-                         VkDeviceMemory& imageMemory, uint32_t flags = 0);
+                         VkDeviceMemory& imageMemory, uint32_t flags = 0,
+                         uint32_t mipLevels = 1);
         void transitionImageLayout(VkImage image, VkFormat format,
                                    VkImageLayout oldLayout,
                                    VkImageLayout newLayout,
-                                   uint32_t layerCount = 1);
+                                   uint32_t layerCount = 1,
+                                   uint32_t mipLevels = 1);
+        VkFormatProperties getFormatProperties(VkFormat format);
+        bool supportsTextureCompressionBC() const { return enabledFeatures.textureCompressionBC == VK_TRUE; }
+        // most textures one update-after-bind sampler array can hold, see LveBindlessTextures
+        uint32_t maxBindlessTextures() const { return maxBindlessTextures_; }
+        // VK_KHR_push_descriptor is optional, see LvePushDescriptorSet
+        bool supportsPushDescriptors() const { return vkCmdPushDescriptorSetWithTemplateKHR_ != nullptr; }
+        uint32_t maxPushDescriptors() const { return maxPushDescriptors_; }
+        void cmdPushDescriptorSetWithTemplate(VkCommandBuffer commandBuffer,
+                                              VkDescriptorUpdateTemplate updateTemplate,
+                                              VkPipelineLayout layout, uint32_t set,
+                                              const void* data) {
+            vkCmdPushDescriptorSetWithTemplateKHR_(commandBuffer, updateTemplate, layout, set, data);
+        }
+
+        // VK_EXT_graphics_pipeline_library with fast linking is optional, see LvePipelineRegistry
+        bool supportsGraphicsPipelineLibrary() const { return graphicsPipelineLibrary_; }
+        const ExtendedDynamicStateFunctions& extendedDynamicState() const { return dynamicStateFunctions_; }
+        // VK_KHR_dynamic_rendering is optional, see LveRenderingPass
+        bool supportsDynamicRendering() const { return vkCmdBeginRenderingKHR_ != nullptr; }
+        void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfoKHR* renderingInfo) {
+            vkCmdBeginRenderingKHR_(commandBuffer, renderingInfo);
+        }
+        void cmdEndRendering(VkCommandBuffer commandBuffer) { vkCmdEndRenderingKHR_(commandBuffer); }
+        // VK_KHR_present_id and VK_KHR_present_wait are optional, see LveSwapChainConfig::latencyBudgetMs
+        bool supportsPresentWait() const { return vkWaitForPresentKHR_ != nullptr; }
+        VkResult waitForPresent(VkSwapchainKHR swapchain, uint64_t presentId, uint64_t timeoutNs) {
+            return vkWaitForPresentKHR_(device_, swapchain, presentId, timeoutNs);
+        }
 
         VkPhysicalDeviceProperties properties;
 
@@ -101,6 +156,8 @@ namespace lve {
         void populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
         void hasGflwRequiredInstanceExtensions();
         bool checkDeviceExtensionSupport(VkPhysicalDevice device);
+        bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
+        bool checkDescriptorIndexingSupport(VkPhysicalDevice device);
         SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 
         VkInstance instance;
@@ -113,9 +170,21 @@ namespace lve {
         VkSurfaceKHR surface_;
         VkQueue graphicsQueue_;
         VkQueue presentQueue_;
+        std::unique_ptr<LveSamplerCache> samplerCache_;
+        std::unique_ptr<LvePipelineRegistry> pipelineRegistry_;
+        VkPhysicalDeviceFeatures enabledFeatures{};
+        uint32_t maxBindlessTextures_{0};
+        uint32_t maxPushDescriptors_{0};
+        PFN_vkCmdPushDescriptorSetWithTemplateKHR vkCmdPushDescriptorSetWithTemplateKHR_{nullptr};
+        bool graphicsPipelineLibrary_{false};
+        ExtendedDynamicStateFunctions dynamicStateFunctions_{};
+        PFN_vkCmdBeginRenderingKHR vkCmdBeginRenderingKHR_{nullptr};
+        PFN_vkCmdEndRenderingKHR vkCmdEndRenderingKHR_{nullptr};
+        PFN_vkWaitForPresentKHR vkWaitForPresentKHR_{nullptr};
 
         const std::vector<const char*> validationLayers = { "VK_LAYER_KHRONOS_validation" };
-        const std::vector<const char*> deviceExtensions = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+        const std::vector<const char*> deviceExtensions = {
+            VK_KHR_SWAPCHAIN_EXTENSION_NAME, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME };
     };
 
 }  // namespace lve
\ No newline at end of file
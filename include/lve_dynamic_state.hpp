@@ -0,0 +1,51 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+
+namespace lve {
+
+// The fixed function state pipelines made with LvePipeline::enableExtendedDynamicState take from
+// the command buffer. The defaults match LvePipeline::defaultPipelineConfigInfo.
+struct LveRasterState {
+  VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+  VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+  VkCullModeFlags cullMode = VK_CULL_MODE_NONE;
+  VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+  VkBool32 depthBiasEnable = VK_FALSE;
+  VkBool32 depthTestEnable = VK_TRUE;
+  VkBool32 depthWriteEnable = VK_TRUE;
+  VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+  // bakes the state into a config, for devices that cannot set it dynamically
+  void applyTo(PipelineConfigInfo &configInfo) const;
+};
+
+// Binds pipelines and sets their dynamic LveRasterState on one command buffer, recording only
+// what changed since the last draw. State the device cannot set dynamically is left to the
+// pipeline, so on such devices a pipeline has to be built with the state it is drawn with.
+class LveDynamicStateTracker {
+ public:
+  LveDynamicStateTracker(LveDevice &device, VkCommandBuffer commandBuffer);
+
+  LveDynamicStateTracker(const LveDynamicStateTracker &) = delete;
+  LveDynamicStateTracker &operator=(const LveDynamicStateTracker &) = delete;
+
+  VkCommandBuffer getCommandBuffer() const { return commandBuffer; }
+
+  // skips rebinding the bound pipeline; a pipeline without extended dynamic state overwrites the
+  // tracked state
+  void bindPipeline(LvePipeline &pipeline);
+  void setRasterState(const LveRasterState &state);
+  // forget everything, e.g. after state was recorded without the tracker
+  void invalidate();
+
+ private:
+  const ExtendedDynamicStateFunctions &functions;
+  VkCommandBuffer commandBuffer;
+  VkPipeline boundPipeline{VK_NULL_HANDLE};
+  LveRasterState current{};
+  bool currentValid{false};
+};
+
+}  // namespace lve
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "lve_camera.hpp"
+#include "lve_dynamic_state.hpp"
+#include "lve_push_descriptor.hpp"
 
 //lib
 #include <vulkan/vulkan.h>
@@ -28,8 +30,9 @@ namespace lve{
     float frameTime;
     VkCommandBuffer commandBuffer;
     LveCamera &camera;
-    VkDescriptorSet globalDescriptorSet;
+    LvePushDescriptorSet &globalDescriptor;  // set 0, bind with globalDescriptor.bind
     LveGameObject::Map &gameObjects;
+    LveDynamicStateTracker &dynamicState;  // bind pipelines for commandBuffer through this
   };
   
 } // namespace lve
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+// std
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Where one frame's wall time went, in milliseconds. LveSwapChain fills in its waits and calls,
+// LveRenderer the recording and the frame as a whole.
+struct LveFrameTimings {
+  double frameMs = 0.0;           // end of the previous endFrame to the end of this one
+  double recordMs = 0.0;          // beginFrame returning to endFrame ending the command buffer
+  double presentWaitMs = 0.0;     // vkWaitForPresentKHR, see LveSwapChainConfig::latencyBudgetMs
+  double frameFenceWaitMs = 0.0;  // the frame slot's previous submission, before acquiring
+  double acquireMs = 0.0;         // vkAcquireNextImageKHR
+  double imageFenceWaitMs = 0.0;  // the frame that last rendered the acquired image
+  double submitMs = 0.0;          // vkQueueSubmit
+  double presentMs = 0.0;         // vkQueuePresentKHR
+};
+
+// Histograms of the last WINDOW_FRAMES frames' timings, to tell in the field whether frames are
+// limited by recording on the CPU, by the GPU or by presentation. Percentiles are read from
+// BUCKET_MS wide buckets, so they are accurate to a bucket; times beyond the last bucket report
+// the window's maximum.
+class LveFrameStats {
+ public:
+  enum Metric {
+    FRAME,
+    RECORD,
+    PRESENT_WAIT,
+    FRAME_FENCE_WAIT,
+    ACQUIRE,
+    IMAGE_FENCE_WAIT,
+    SUBMIT,
+    PRESENT,
+    METRIC_COUNT
+  };
+
+  enum class Bottleneck { Unknown, Cpu, Gpu, Present };
+
+  struct Summary {
+    uint32_t samples = 0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+  };
+
+  static constexpr uint32_t WINDOW_FRAMES = 600;
+  static constexpr double BUCKET_MS = 0.1;
+  static constexpr uint32_t BUCKET_COUNT = 1000;
+  // a frame taking this many times the window's median frame time is a stutter
+  static constexpr double STUTTER_FACTOR = 2.0;
+  // the median is not trusted before the window holds this many frames
+  static constexpr uint32_t MIN_STUTTER_FRAMES = 30;
+  // waits below this share of the frame time count as the CPU keeping the GPU and display busy
+  static constexpr double WAIT_BOUND_SHARE = 0.1;
+
+  LveFrameStats();
+
+  void add(const LveFrameTimings &timings);
+  void reset();
+
+  Summary summary(Metric metric) const;
+  // frames added since the last reset, including those that left the window
+  uint64_t frameCount() const { return frames; }
+  uint64_t stutterCount() const { return stutters; }
+  uint32_t recentStutterCount() const { return recentStutters; }
+  // The larger of the GPU waits (the fences) and the present waits (pacing, acquire and present)
+  // over the window, or Cpu when both are small. Under FIFO a steady display rate shows up as
+  // waiting on the GPU too, so read Gpu together with the frame time against the refresh rate.
+  Bottleneck bottleneck() const;
+  const LveFrameTimings &last() const;
+  // one line: frame time percentiles, stutters and the bottleneck
+  std::string report() const;
+
+  static const char *metricName(Metric metric);
+  static const char *bottleneckName(Bottleneck bottleneck);
+
+ private:
+  static double value(const LveFrameTimings &timings, Metric metric);
+  static uint32_t bucket(double ms);
+  double percentile(Metric metric, double fraction, double maxMs) const;
+
+  std::vector<LveFrameTimings> window;  // ring, oldest at head once full
+  std::vector<bool> stuttered;          // per window entry
+  uint32_t head{0};
+  std::array<std::vector<uint32_t>, METRIC_COUNT> histograms;
+  uint64_t frames{0};
+  uint64_t stutters{0};
+  uint32_t recentStutters{0};
+};
+
+}  // namespace lve
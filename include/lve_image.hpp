@@ -0,0 +1,46 @@
+#pragma once
+
+#include "lve_mipmap.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+class LveThreadPool;
+
+// true for .qoi files, everything else goes through stb_image
+bool isQoiFile(const std::string &filepath);
+
+// filepath with its extension swapped for the given one (".qoi", ".ktx2"), or an empty string when
+// no such file exists
+std::string existingSibling(const std::string &filepath, const std::string &extension);
+// the <name>.qoi written next to an image by the qoi_textures target when there is one, since it
+// decodes several times faster than the PNG; the path as given otherwise
+std::string resolveImageFile(const std::string &filepath);
+
+// Reads only the file header, so staging memory can be sized before anything is decoded
+void probeImage(const std::string &filepath, uint32_t &width, uint32_t &height);
+
+// Decodes a PNG / JPG / ... or QOI file to tightly packed RGBA8 in dst, which must hold
+// width * height * 4 bytes of the size probeImage reported. flipVertically returns the rows
+// bottom up, the order LveTexture uploads them in. Safe to call from several threads at once,
+// the flip is applied per call instead of through stb_image's global setting.
+void decodeImageRGBA8(
+    const std::string &filepath, bool flipVertically, uint8_t *dst, uint32_t width, uint32_t height);
+
+// Decodes every file back to back into dst (image i at i * width * height * 4), concurrently when
+// a pool is given. All of them must be width x height.
+void decodeImagesRGBA8(
+    const std::vector<std::string> &filepaths,
+    bool flipVertically,
+    uint8_t *dst,
+    uint32_t width,
+    uint32_t height,
+    LveThreadPool *pool = nullptr);
+
+ImageMipLevel loadImageRGBA8(const std::string &filepath, bool flipVertically);
+
+}  // namespace lve
@@ -0,0 +1,58 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+namespace lve {
+
+// Format and layout helpers shared by the barriers of LveRenderGraph and LveRenderingPass
+
+inline bool isDepthFormat(VkFormat format) {
+  return format == VK_FORMAT_D16_UNORM || format == VK_FORMAT_X8_D24_UNORM_PACK32 ||
+         format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM_S8_UINT ||
+         format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+inline bool hasStencilComponent(VkFormat format) {
+  return format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+         format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+// the aspects a barrier on the whole image has to name
+inline VkImageAspectFlags barrierAspect(VkFormat format) {
+  if (!isDepthFormat(format)) return VK_IMAGE_ASPECT_COLOR_BIT;
+  // layout transitions of a combined format have to cover both aspects
+  return hasStencilComponent(format) ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT
+                                     : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+// The stage and access of whoever uses an image next in the layout it is left in. Layouts without
+// a known next use wait for everything, which is correct if slow.
+inline void nextUse(VkImageLayout layout, VkPipelineStageFlags &stage, VkAccessFlags &access) {
+  switch (layout) {
+    case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+      // presentation waits on a semaphore, which makes the writes available
+      stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+      access = 0;
+      return;
+    case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+      stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+      access = VK_ACCESS_TRANSFER_READ_BIT;
+      return;
+    case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+      stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      access = VK_ACCESS_SHADER_READ_BIT;
+      return;
+    case VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL:
+      stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT |
+              VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+      return;
+    default:
+      stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+      access = VK_ACCESS_MEMORY_READ_BIT;
+      return;
+  }
+}
+
+}  // namespace lve
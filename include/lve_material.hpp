@@ -2,29 +2,37 @@
 #include <memory>
 #include <vulkan/vulkan.h>
 #include "lve_texture.hpp"
-#include "lve_descriptors.hpp"
+#include "lve_bindless_textures.hpp"
+#include "lve_virtual_texture.hpp"
 
 namespace lve {
 class LveMaterial {
  public:
   LveMaterial::LveMaterial() {}
-  bool buildDescriptor(LveDescriptorSetLayout& layout,
-                       LveDescriptorPool& pool) {
-    if (!baseTex_) return false;
-    auto imageInfo = baseTex_->descriptorInfo();
-    return LveDescriptorWriter(layout, pool)
-        .writeImage(0, &imageInfo)
-        .build(descriptorSet);
+  void registerTextures(LveBindlessTextures& textures) {
+    if (!baseTex_) return;
+    textures.registerTexture(baseTex_);
   }
 
 	void SetColor(const glm::vec4& color) { color_ = color; }
   const glm::vec4& GetColor() const { return color_; }
 
-  VkDescriptorSet getDescriptorSet() const { return descriptorSet; }
+  // read per draw, the slot changes when the texture streamer swaps mips. Materials without a
+  // registered texture sample the table's default slot.
+  uint32_t getTextureIndex() const {
+    if (!baseTex_ || baseTex_->getBindlessSlot() == LveTexture::NO_BINDLESS_SLOT) {
+      return LveBindlessTextures::DEFAULT_SLOT;
+    }
+    return baseTex_->getBindlessSlot();
+  }
 	void SetTexture(std::shared_ptr<LveTexture> tex){baseTex_ = tex;}
+	const std::shared_ptr<LveTexture>& GetTexture() const { return baseTex_; }
+	// sampled instead of the base texture when set
+	void SetVirtualTexture(std::shared_ptr<LveVirtualTexture> tex) { virtualTex_ = tex; }
+	const std::shared_ptr<LveVirtualTexture>& GetVirtualTexture() const { return virtualTex_; }
  private:
-  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
 	std::shared_ptr<LveTexture> baseTex_;
+	std::shared_ptr<LveVirtualTexture> virtualTex_;
 	glm::vec4 color_{1.f,1.f,1.f,1.f};
 };
 }  // namespace lve
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+
+// std
+#include <cstdint>
+#include <vector>
+
+namespace lve {
+
+struct ImageMipLevel {
+  uint32_t width;
+  uint32_t height;
+  std::vector<uint8_t> pixels;  // tightly packed RGBA8
+};
+
+// number of levels in a full chain down to 1x1
+uint32_t calculateMipLevels(uint32_t width, uint32_t height);
+
+// 2x2 box filter of one RGBA8 level into the next one. sRGB data is averaged in linear space.
+// Along odd source dimensions each output texel takes three source texels with weights that cover
+// every source texel equally, so the last row / column is not dropped.
+void downsampleRGBA8(
+    const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, uint8_t *dst, bool srgb);
+
+// Builds levels 1..N-1 of the chain on the CPU, used when the device cannot blit the format
+std::vector<ImageMipLevel> generateMipChainRGBA8(
+    const uint8_t *pixels, uint32_t width, uint32_t height, bool srgb);
+
+}  // namespace lve
@@ -58,9 +58,19 @@ public:
   void bind(VkCommandBuffer commandBuffer);
   void draw(VkCommandBuffer commandBuffer);
 
+  // model space bounding sphere
+  const glm::vec3 &getBoundingCenter() const { return boundingCenter; }
+  float getBoundingRadius() const { return boundingRadius; }
+  // average UV units per model space unit over the surface, lets the texture streamer estimate
+  // how many texels an object puts on screen
+  float getUvDensity() const { return uvDensity; }
+  // false when every vertex is white, the shader can then skip the vertex color
+  bool hasVertexColors() const { return vertexColors; }
+
 private:
   void createVertexBuffers(const std::vector<Vertex> &vertices);
   void createIndexBuffers(const std::vector<uint32_t> &indices);
+  void computeBounds(const Builder &builder);
 
   LveDevice &lveDevice;
 
@@ -70,5 +80,10 @@ private:
   bool hasIndexBuffer = false;
   std::unique_ptr<LveBuffer> indexBuffer;
   uint32_t indexCount;
+
+  glm::vec3 boundingCenter{0.f};
+  float boundingRadius{0.f};
+  float uvDensity{0.f};
+  bool vertexColors{false};
 };
 }  // namespace lve
\ No newline at end of file
@@ -8,6 +8,19 @@
 
 namespace lve {
 
+  // Values for the specialization constants of one shader stage. Every constant takes 4 bytes,
+  // which covers int, uint, float and bool (as VkBool32).
+  struct LveSpecializationConstants {
+    std::vector<VkSpecializationMapEntry> mapEntries;
+    std::vector<uint32_t> data;
+
+    // replaces the value if constantID was set before
+    void set(uint32_t constantID, uint32_t value);
+    bool empty() const { return mapEntries.empty(); }
+    // points into this object
+    VkSpecializationInfo info() const;
+  };
+
   struct PipelineConfigInfo {
     PipelineConfigInfo() = default;
     PipelineConfigInfo(const PipelineConfigInfo&) = delete;
@@ -27,6 +40,25 @@ namespace lve {
     VkPipelineLayout pipelineLayout = nullptr;
     VkRenderPass renderPass = nullptr;
     uint32_t subpass = 0;
+    // with dynamic rendering (VK_KHR_dynamic_rendering) renderPass stays null and the pipeline
+    // is made for attachments of these formats instead, see LveRenderTargetFormat
+    std::vector<VkFormat> colorAttachmentFormats;
+    VkFormat depthAttachmentFormat = VK_FORMAT_UNDEFINED;
+    // constants the shaders are specialized with, empty for none
+    LveSpecializationConstants vertSpecialization;
+    LveSpecializationConstants fragSpecialization;
+  };
+
+  // What the pipelines of a pass draw into: a render pass and subpass on the classic path, or
+  // with dynamic rendering (renderPass null) the formats of the attachments. Render systems take
+  // one of these instead of a VkRenderPass so they work on either path.
+  struct LveRenderTargetFormat {
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    uint32_t subpass = 0;
+    std::vector<VkFormat> colorFormats;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+
+    void applyTo(PipelineConfigInfo& configInfo) const;
   };
 
   class LvePipeline {
@@ -36,29 +68,77 @@ namespace lve {
       const std::string& vertFilepath,
       const std::string& fragFilepath,
       const PipelineConfigInfo& configInfo);
+    // modules stay owned by the caller and may be destroyed once this returns,
+    // see LvePipelineRegistry. Safe to call from any thread.
+    LvePipeline(
+      LveDevice& device,
+      VkShaderModule vertShaderModule,
+      VkShaderModule fragShaderModule,
+      const PipelineConfigInfo& configInfo,
+      VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    // One part of a graphics pipeline library (VK_EXT_graphics_pipeline_library), made from the
+    // fields of configInfo that belong to the part. The pre-rasterization and fragment shader
+    // parts take their stage's shader module, the other parts ignore it.
+    LvePipeline(
+      LveDevice& device,
+      VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+      VkShaderModule shaderModule,
+      const PipelineConfigInfo& configInfo,
+      VkPipelineCache pipelineCache = VK_NULL_HANDLE);
+    // Links the four library parts into a complete pipeline. The link is quick unless
+    // linkTimeOptimization is set, which takes about as long as a monolithic compile and gives
+    // the same code.
+    LvePipeline(
+      LveDevice& device,
+      const std::vector<VkPipeline>& libraries,
+      const PipelineConfigInfo& configInfo,
+      bool linkTimeOptimization,
+      VkPipelineCache pipelineCache = VK_NULL_HANDLE);
     ~LvePipeline();
 
     LvePipeline(const LvePipeline&) = delete;
     LvePipeline& operator=(const LvePipeline&) = delete;
 
     void bind(VkCommandBuffer commandBuffer);
+    VkPipeline getPipeline() const { return graphicsPipeline; }
+    // cull mode, depth test and the rest of LveRasterState come from the command buffer
+    bool usesExtendedDynamicState() const { return extendedDynamicState; }
 
     static void defaultPipelineConfigInfo(PipelineConfigInfo& configInfo);
     static void enableAlphaBlending(PipelineConfigInfo& configInfo);
+    // Makes the LveRasterState the device can set per draw dynamic, so pipelines that only
+    // differ there become one. The config's values are still used where the device cannot.
+    static void enableExtendedDynamicState(PipelineConfigInfo& configInfo, const LveDevice& device);
+    static bool hasDynamicState(const PipelineConfigInfo& configInfo, VkDynamicState state);
 
   private:
+    friend class LvePipelineRegistry;
+
     static std::vector<char> readFile(const std::string& filepath);
+    // the attachment formats of a config without a render pass, points into configInfo
+    static VkPipelineRenderingCreateInfoKHR renderingCreateInfo(const PipelineConfigInfo& configInfo);
 
     void createGraphicsPipeline(
-      const std::string& vertFilepath,
-      const std::string& fragFilepath,
-      const PipelineConfigInfo& configInfo);
+      VkShaderModule vertShaderModule,
+      VkShaderModule fragShaderModule,
+      const PipelineConfigInfo& configInfo,
+      VkPipelineCache pipelineCache);
+
+    void createPipelineLibrary(
+      VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+      VkShaderModule shaderModule,
+      const PipelineConfigInfo& configInfo,
+      VkPipelineCache pipelineCache);
+    void linkPipelineLibraries(
+      const std::vector<VkPipeline>& libraries,
+      const PipelineConfigInfo& configInfo,
+      bool linkTimeOptimization,
+      VkPipelineCache pipelineCache);
 
     void createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule);
 
     LveDevice& lveDevice;
     VkPipeline graphicsPipeline;
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
+    bool extendedDynamicState{false};
   };
 }  // namespace lve
\ No newline at end of file
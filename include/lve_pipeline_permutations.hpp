@@ -0,0 +1,63 @@
+#pragma once
+
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+namespace lve {
+
+// Pipelines of one shader pair that only differ in their specialization constants. A permutation
+// is a set of feature bits the caller defines, the configure function turns it into the full
+// pipeline state including the constants. Permutations are requested from the registry on first
+// use; until theirs has compiled, draws use the full permutation, which has to handle every case.
+class LvePipelinePermutations {
+ public:
+  // fills a default constructed config for the given permutation
+  using ConfigureFn = std::function<void(uint32_t permutation, PipelineConfigInfo &configInfo)>;
+
+  // requests the full permutation right away
+  LvePipelinePermutations(
+      LvePipelineRegistry &registry,
+      std::string vertFilepath,
+      std::string fragFilepath,
+      uint32_t fullPermutation,
+      ConfigureFn configure,
+      LveThreadPool *threadPool = nullptr);  // compiles the permutations there
+  ~LvePipelinePermutations();
+
+  LvePipelinePermutations(const LvePipelinePermutations &) = delete;
+  LvePipelinePermutations &operator=(const LvePipelinePermutations &) = delete;
+
+  // requests a permutation ahead of its first draw
+  void prepare(uint32_t permutation);
+  // the pipeline to draw the permutation with, nullptr while the full one is still compiling.
+  // Safe to call from several recording threads.
+  LvePipeline *get(uint32_t permutation);
+  // blocks until every requested permutation is compiled, see LvePipelineHandle::wait
+  void wait() const;
+
+  size_t size() const;
+
+ private:
+  // callers hold mutex
+  const LvePipelineHandle &request(uint32_t permutation);
+
+  LvePipelineRegistry &registry;
+  std::string vertFilepath;
+  std::string fragFilepath;
+  uint32_t fullPermutation;
+  ConfigureFn configure;
+  LveThreadPool *threadPool;
+
+  mutable std::mutex mutex;
+  std::unordered_map<uint32_t, LvePipelineHandle> handles;
+};
+
+}  // namespace lve
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+// A pipeline that may still be compiling on a worker thread. Copies share the pipeline, which is
+// destroyed with the last of them.
+class LvePipelineHandle {
+ public:
+  LvePipelineHandle() = default;
+
+  bool ready() const;
+  // the optimized pipeline once linked, else the compiled one, else the fallback's (again
+  // optimized first), else nullptr; rethrows a failed compile
+  LvePipeline *get() const;
+  // blocks until the compile is over, e.g. before destroying the layout or render pass it is made
+  // for; never throws
+  void wait() const;
+
+  // a pipeline that is ready to draw with meanwhile, it must use the same pipeline layout
+  void setFallback(const LvePipelineHandle &fallbackHandle) { fallback = fallbackHandle.slot; }
+
+ private:
+  friend class LvePipelineRegistry;
+
+  struct Slot {
+    std::shared_future<std::shared_ptr<LvePipeline>> pipeline;
+    // pipelines linked from libraries: the link time optimized build, finished in the background
+    std::shared_future<std::shared_ptr<LvePipeline>> optimized;
+    std::vector<std::shared_ptr<Slot>> libraries;  // kept for the pipelines sharing them
+  };
+
+  std::shared_ptr<Slot> slot;
+  std::shared_ptr<Slot> fallback;
+};
+
+// Shares pipelines between everyone asking for the same shaders and state. A pipeline is keyed
+// on every field of its PipelineConfigInfo plus the content hashes of its shaders, so identical
+// .spv files under different names count as one shader. The registry only holds weak references:
+// a pipeline lives as long as its users, who must drop it before destroying the pipeline layout
+// or render pass it was made for. Shader modules are kept between pipeline creations and freed
+// with releaseShaderModules once the pipelines are built. Compiles given a thread pool run there
+// against one VkPipelineCache, so startup and new variants never stall the frame. The cache is
+// read from cacheFilepath at startup, if this device and driver wrote it, and saved back there
+// on destruction, so later runs mostly skip the driver's compiles.
+//
+// With VK_EXT_graphics_pipeline_library a pipeline is linked from four library parts (vertex
+// input, pre-rasterization, fragment shader, fragment output), each keyed on its own share of
+// the config, so variants that only differ in one part compile just that part. The quick link
+// is drawn with until the link time optimized one is done; without a thread pool only the
+// optimized one is made. Devices without the extension get monolithic pipelines. Safe to use
+// from several threads.
+class LvePipelineRegistry {
+ public:
+  struct Stats {
+    uint32_t pipelinesCreated;
+    uint32_t pipelinesPending;  // still compiling
+    uint32_t pipelineHits;  // requests answered with an existing pipeline
+    uint32_t librariesCreated;  // graphics pipeline library parts
+    uint32_t shaderModules;  // alive right now
+    uint32_t shaderFilesRead;
+  };
+
+  explicit LvePipelineRegistry(
+      LveDevice &lveDevice, const std::string &cacheFilepath = "pipeline_cache.bin");
+  // waits for the compiles still running, then saves the pipeline cache
+  ~LvePipelineRegistry();
+
+  LvePipelineRegistry(const LvePipelineRegistry &) = delete;
+  LvePipelineRegistry &operator=(const LvePipelineRegistry &) = delete;
+
+  // compiles on the pool when one is given, otherwise before returning
+  LvePipelineHandle requestPipeline(
+      const std::string &vertFilepath,
+      const std::string &fragFilepath,
+      const PipelineConfigInfo &configInfo,
+      LveThreadPool *threadPool = nullptr);
+
+  // Created pipelines do not need their modules, new ones re-read the files as needed. With
+  // compiles still running the modules go once the last of them is done.
+  void releaseShaderModules();
+
+  Stats getStats() const;
+
+ private:
+  struct KeyHash {
+    size_t operator()(const std::vector<uint64_t> &key) const;
+  };
+
+  struct ShaderFile {
+    uint64_t contentHash;
+    std::vector<char> code;  // dropped together with the modules
+  };
+
+  // callers hold mutex
+  const ShaderFile &getShaderFile(const std::string &filepath);
+  VkShaderModule getShaderModule(const std::string &filepath);
+  void destroyShaderModules();
+  void finishCompile();
+  // best effort, a cache that cannot be written is rebuilt next run
+  void savePipelineCache() const;
+  // runs compile on the pool and counts it in pendingCompiles
+  template <typename F>
+  std::shared_future<std::shared_ptr<LvePipeline>> submitCompile(
+      LveThreadPool &threadPool, F compile);
+  void linkPipeline(
+      LvePipelineHandle::Slot &slot,
+      uint64_t vertHash,
+      VkShaderModule vertShaderModule,
+      uint64_t fragHash,
+      VkShaderModule fragShaderModule,
+      const PipelineConfigInfo &configInfo,
+      LveThreadPool *threadPool);
+  std::shared_ptr<LvePipelineHandle::Slot> getLibrary(
+      VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+      const std::vector<uint64_t> &key,
+      VkShaderModule shaderModule,
+      const std::shared_ptr<PipelineConfigInfo> &config,
+      LveThreadPool *threadPool);
+
+  LveDevice &lveDevice;
+  std::string cacheFilepath;
+  VkPipelineCache pipelineCache{VK_NULL_HANDLE};  // internally synchronized, shared by all compiles
+  mutable std::mutex mutex;
+  std::condition_variable compileDone;
+  std::unordered_map<std::string, ShaderFile> shaderFiles;
+  std::unordered_map<uint64_t, VkShaderModule> shaderModules;  // by content hash
+  // complete pipelines and library parts
+  std::unordered_map<std::vector<uint64_t>, std::weak_ptr<LvePipelineHandle::Slot>, KeyHash>
+      pipelines;
+  uint32_t pendingCompiles{0};
+  bool releaseModulesWhenIdle{false};
+  uint32_t pipelinesCreated{0};
+  uint32_t pipelineHits{0};
+  uint32_t librariesCreated{0};
+  uint32_t shaderFilesRead{0};
+};
+
+}  // namespace lve
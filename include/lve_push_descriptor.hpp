@@ -0,0 +1,86 @@
+#pragma once
+
+#include "lve_descriptors.hpp"
+#include "lve_device.hpp"
+
+// std
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace lve {
+
+// One descriptor of an LvePushDescriptorSet, the binding's type decides which member is read.
+union LveDescriptorResource {
+  VkDescriptorBufferInfo buffer;
+  VkDescriptorImageInfo image;
+
+  static LveDescriptorResource fromBuffer(const VkDescriptorBufferInfo &info) {
+    LveDescriptorResource resource{};
+    resource.buffer = info;
+    return resource;
+  }
+  static LveDescriptorResource fromImage(const VkDescriptorImageInfo &info) {
+    LveDescriptorResource resource{};
+    resource.image = info;
+    return resource;
+  }
+};
+
+// A set of per frame or per draw resources with one descriptor per binding. With
+// VK_KHR_push_descriptor the resources are pushed into the command buffer through a descriptor
+// update template, so no set is allocated or written. Without it every distinct combination of
+// resources gets a set from the set cache once and binding is a lookup.
+class LvePushDescriptorSet {
+ public:
+  // binding i has bindingTypes[i], buffers (not dynamic) or images
+  LvePushDescriptorSet(
+      LveDevice &lveDevice,
+      const std::vector<VkDescriptorType> &bindingTypes,
+      VkShaderStageFlags stageFlags,
+      LveDescriptorLayoutCache &layoutCache,
+      LveDescriptorSetCache &setCache);
+  ~LvePushDescriptorSet();
+
+  LvePushDescriptorSet(const LvePushDescriptorSet &) = delete;
+  LvePushDescriptorSet &operator=(const LvePushDescriptorSet &) = delete;
+
+  VkDescriptorSetLayout getDescriptorSetLayout() const {
+    return setLayout->getDescriptorSetLayout();
+  }
+  bool usesPushDescriptors() const { return usePushDescriptors; }
+
+  // resources[i] goes to binding i; call before recording the draws that bind them
+  void setResources(const std::vector<LveDescriptorResource> &newResources);
+  // pipelineLayout must have been created with getDescriptorSetLayout() at setIndex. Safe to call
+  // from several recording threads.
+  void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex);
+  // Destroys the update templates made for pipelineLayout. Owners of a layout that was bound call
+  // this before destroying it, a later layout may be given the same handle.
+  void releasePipelineLayout(VkPipelineLayout pipelineLayout);
+
+ private:
+  struct Template {
+    VkPipelineLayout pipelineLayout;
+    uint32_t setIndex;
+    VkDescriptorUpdateTemplate updateTemplate;
+  };
+
+  // push templates are tied to the pipeline layout, one is made per layout on first use and kept
+  // until releasePipelineLayout
+  VkDescriptorUpdateTemplate getTemplate(VkPipelineLayout pipelineLayout, uint32_t setIndex);
+
+  LveDevice &lveDevice;
+  LveDescriptorSetCache &setCache;
+  std::shared_ptr<LveDescriptorSetLayout> setLayout;
+  std::vector<VkDescriptorType> bindingTypes;
+  bool usePushDescriptors;
+
+  std::vector<LveDescriptorResource> resources;
+  VkDescriptorSet descriptorSet{VK_NULL_HANDLE};  // fallback only
+
+  std::mutex templateMutex;
+  std::vector<Template> templates;
+};
+
+}  // namespace lve
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "lve_mipmap.hpp"
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Quite OK Image format (qoiformat.org), lossless and several times faster to decode than PNG.
+// The header channel count is informational, pixels are always RGBA8 in memory.
+struct QoiHeader {
+  uint32_t width{0};
+  uint32_t height{0};
+  uint8_t channels{4};    // 3 = RGB, 4 = RGBA
+  uint8_t colorspace{0};  // 0 = sRGB with linear alpha, 1 = all channels linear
+};
+
+// reads and validates just the 14 byte header
+QoiHeader readQoiHeader(const uint8_t *data, size_t size);
+// flipVertically returns the rows bottom up, the order LveTexture uploads them in
+ImageMipLevel decodeQoi(const uint8_t *data, size_t size, bool flipVertically, QoiHeader *header = nullptr);
+// decodes into dst, which must hold width * height * 4 bytes for the size in the header
+void decodeQoiInto(const uint8_t *data, size_t size, bool flipVertically, uint8_t *dst);
+std::vector<uint8_t> encodeQoi(const uint8_t *pixels, const QoiHeader &header);
+
+ImageMipLevel loadQoi(const std::string &filepath, bool flipVertically);
+// returns the size of the written file
+size_t saveQoi(const std::string &filepath, const uint8_t *pixels, const QoiHeader &header);
+
+}  // namespace lve
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_secondary_commands.hpp"
+
+// std
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// A frame described as passes that read and write virtual images. compile() culls the passes
+// whose results nothing uses, plans the layout transitions and pipeline barriers between the
+// remaining ones in declaration order, and creates the graph's own (transient) images, letting
+// images whose passes do not overlap share memory. execute() then only records: barriers, pass
+// begin and end, and each pass's record function in between.
+//
+// Raster passes (those with attachments) render with VK_KHR_dynamic_rendering when the device
+// has it, otherwise through a render pass and framebuffer the graph creates. Pipelines drawn in a
+// pass are made for getTargetFormat(pass), which is valid as soon as the pass's attachments are
+// declared.
+class LveRenderGraph {
+ public:
+  using ResourceHandle = uint32_t;
+  using PassHandle = uint32_t;
+  // inheritance is what secondary command buffers recorded in a raster pass continue
+  using RecordFn =
+      std::function<void(FrameInfo &frameInfo, const LveSecondaryInheritance &inheritance)>;
+
+  // framesInFlight is the renderer's runtime count (LveRenderer::getFramesInFlight), images and
+  // framebuffers replaced by a recompile live until that many more frames have begun
+  LveRenderGraph(LveDevice &device, uint32_t framesInFlight);
+  ~LveRenderGraph();
+
+  LveRenderGraph(const LveRenderGraph &) = delete;
+  LveRenderGraph &operator=(const LveRenderGraph &) = delete;
+
+  // An image owned outside the graph and bound every frame with bindImage, like the swap chain
+  // image. It enters the frame in initialLayout (UNDEFINED drops its contents) and is left in
+  // finalLayout. Its contents are always kept, passes writing it are never culled.
+  ResourceHandle importImage(
+      const std::string &name, VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout);
+  // An image the graph creates, extentScale times the compiled extent. Its contents only live
+  // from the first to the last pass using it within a frame.
+  ResourceHandle createImage(const std::string &name, VkFormat format, float extentScale = 1.0f);
+
+  // Passes run in the order they are added. Every image may be used once per pass.
+  PassHandle addPass(const std::string &name, RecordFn record = nullptr);
+  void setRecord(PassHandle pass, RecordFn record);
+  // the record function may then only execute secondary command buffers, see LveSecondaryCommands
+  void setSecondaryContents(PassHandle pass);
+  // passes with effects outside the graph's images, like readbacks, are never culled
+  void setSideEffects(PassHandle pass);
+  void writeColor(PassHandle pass, ResourceHandle image);  // on top of the previous contents
+  void clearColor(PassHandle pass, ResourceHandle image, VkClearColorValue clearValue);
+  void writeDepth(PassHandle pass, ResourceHandle image);
+  void clearDepth(PassHandle pass, ResourceHandle image, VkClearDepthStencilValue clearValue);
+  // depth test against the image without writing it
+  void readDepth(PassHandle pass, ResourceHandle image);
+  // sampled by the pass's fragment shaders, see getImageView
+  void readTexture(PassHandle pass, ResourceHandle image);
+
+  // Does nothing unless a declaration or the extent changed since the last call. Recompiling does
+  // not wait for the device: the old images and framebuffers are destroyed once the frames in
+  // flight that use them have finished.
+  void compile(VkExtent2D extent);
+  // The imported image to use this frame. A new generation, e.g. after the swap chain was
+  // recreated, retires the framebuffers made for the old views the same way; the old views have
+  // to stay alive just as long.
+  void bindImage(ResourceHandle image, VkImage vkImage, VkImageView view, uint32_t generation = 0);
+  void execute(FrameInfo &frameInfo);
+
+  LveRenderTargetFormat getTargetFormat(PassHandle pass);
+  // after compile; null for culled transient images
+  VkImageView getImageView(ResourceHandle image) const;
+  bool isCulled(PassHandle pass) const;
+
+ private:
+  enum class Access { ColorWrite, DepthWrite, DepthRead, Texture };
+
+  struct Use {
+    ResourceHandle resource;
+    Access access;
+    bool clear;
+    VkClearValue clearValue;
+    // compiled
+    VkAttachmentLoadOp loadOp;
+    VkAttachmentStoreOp storeOp;
+  };
+
+  struct PlannedBarrier {
+    ResourceHandle resource;
+    VkImageLayout oldLayout;
+    VkImageLayout newLayout;
+    VkAccessFlags srcAccess;
+    VkAccessFlags dstAccess;
+  };
+
+  struct BarrierBatch {
+    std::vector<PlannedBarrier> barriers;
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+  };
+
+  struct Pass {
+    std::string name;
+    RecordFn record;
+    std::vector<Use> uses;
+    bool secondaryContents = false;
+    bool sideEffects = false;
+    // compiled
+    bool culled = false;
+    BarrierBatch barriers;  // recorded before the pass begins
+    VkExtent2D extent{0, 0};
+    VkRenderPass renderPass = VK_NULL_HANDLE;  // without dynamic rendering
+    std::map<std::vector<VkImageView>, VkFramebuffer> framebuffers;
+  };
+
+  struct Resource {
+    std::string name;
+    VkFormat format;
+    bool imported;
+    VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    float extentScale = 1.0f;
+    // bound or created
+    VkImage image = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    uint32_t generation = 0;
+    // compiled
+    VkExtent2D extent{0, 0};
+    int firstPass = -1;  // live passes in execution order
+    int lastPass = -1;
+    uint32_t memoryBlock = 0;
+    VkPipelineStageFlags lastStages = 0;  // of the frame's last use
+    VkAccessFlags lastWrites = 0;
+  };
+
+  // objects of earlier compiles and image generations, destroyed once no frame in flight uses them
+  struct Retired {
+    std::vector<VkFramebuffer> framebuffers;
+    std::vector<VkImageView> views;
+    std::vector<VkImage> images;
+    std::vector<VkDeviceMemory> memory;
+    uint64_t frame;  // executes before the retirement
+  };
+
+  // memory shared by transient images whose lifetimes do not overlap
+  struct MemoryBlock {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize size = 0;
+    uint32_t memoryTypeIndex = 0;
+    std::vector<ResourceHandle> residents;
+  };
+
+  // layout, stages and access of a use, write or not
+  static void describe(
+      Access access, VkImageLayout &layout, VkPipelineStageFlags &stages, VkAccessFlags &accessMask);
+  static bool isWrite(Access access) { return access == Access::ColorWrite || access == Access::DepthWrite; }
+  // colour attachments in declaration order, then depth
+  static std::vector<const Use *> attachments(const Pass &pass);
+
+  void addUse(PassHandle pass, ResourceHandle image, Access access, bool clear, VkClearValue clearValue);
+  void cullPasses();
+  void computeLifetimes();
+  void createTransientImages();
+  void planBarriers();
+  void retireTransientImages();
+  void retireFramebuffers();
+  void releaseRetired(bool all);
+  VkRenderPass getRenderPass(const Pass &pass);
+  VkFramebuffer getFramebuffer(Pass &pass);
+  LveSecondaryInheritance beginPass(Pass &pass, VkCommandBuffer commandBuffer);
+  void endPass(const Pass &pass, VkCommandBuffer commandBuffer);
+  void recordBarriers(const BarrierBatch &batch, VkCommandBuffer commandBuffer);
+
+  LveDevice &lveDevice;
+  uint32_t framesInFlight;
+  std::vector<Resource> resources;
+  std::vector<Pass> passes;
+  std::vector<PassHandle> order;  // live passes
+  std::vector<MemoryBlock> memoryBlocks;
+  BarrierBatch finalBarriers;  // imported images to their final layouts
+  // by attachment formats, load and store ops, kept across compiles so pipelines stay valid
+  std::map<std::vector<uint32_t>, VkRenderPass> renderPasses;
+  std::vector<Retired> retired;
+  uint64_t frameCounter{0};  // executes
+  VkExtent2D compiledExtent{0, 0};
+  bool dirty = true;
+};
+
+}  // namespace lve
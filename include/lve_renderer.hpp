@@ -1,52 +1,103 @@
 #pragma once
 
+#include "lve_command_pools.hpp"
 #include "lve_device.hpp"
+#include "lve_frame_stats.hpp"
 #include "lve_swap_chain.hpp"
 #include "lve_window.hpp"
 
 // std
 #include <cassert>
+#include <chrono>
 #include <memory>
 #include <vector>
 
 namespace lve {
 class LveRenderer {
  public:
-  LveRenderer(LveWindow &window, LveDevice &device);
+  // recordingLanes is how many threads may record secondary command buffers for one frame at
+  // once, see LveFrameCommandPools
+  LveRenderer(
+      LveWindow &window,
+      LveDevice &device,
+      const LveSwapChainConfig &config = {},
+      uint32_t recordingLanes = 1);
   ~LveRenderer();
 
   LveRenderer(const LveRenderer &) = delete;
   LveRenderer &operator=(const LveRenderer &) = delete;
 
-  VkRenderPass getSwapChainRenderPass() const { return lveSwapChain->getRenderPass(); }
   float getAspectRatio() const {return lveSwapChain->extentAspectRatio();}
+  VkExtent2D getSwapChainExtent() const { return lveSwapChain->getSwapChainExtent(); }
+  VkFormat getSwapChainImageFormat() const { return lveSwapChain->getSwapChainImageFormat(); }
+  VkFormat getSwapChainDepthFormat() const { return lveSwapChain->getSwapChainDepthFormat(); }
+  // the image acquired for the current frame, e.g. to import into a render graph
+  VkImage getSwapChainImage() const {
+    assert(isFrameStarted && "Cannot get swap chain image when frame not in progress");
+    return lveSwapChain->getImage(currentImageIndex);
+  }
+  VkImageView getSwapChainImageView() const {
+    assert(isFrameStarted && "Cannot get swap chain image when frame not in progress");
+    return lveSwapChain->getImageView(currentImageIndex);
+  }
+  // changes whenever the swap chain and its images are recreated
+  uint32_t getSwapChainGeneration() const { return swapChainGeneration; }
   bool isFrameInProgress() const { return isFrameStarted; }
+  // size of every per frame resource array, frame indices run below it
+  int getFramesInFlight() const { return swapChainConfig.framesInFlight; }
 
   VkCommandBuffer getCurrentCommandBuffer() const {
     assert(isFrameStarted && "Cannot get command buffer when frame not in progress");
-    return commandBuffers[currentFrameIndex];
+    return currentCommandBuffer;
   }
 
+  // per frame waits, recording and frame times of the recent frames, kept across swap chain
+  // recreation
+  const LveFrameStats &getFrameStats() const { return frameStats; }
+  LveFrameStats &getFrameStats() { return frameStats; }
+
   int getFrameIndex() const {
     assert(isFrameStarted && "Cannot get frame index when frame not in progress");
     return currentFrameIndex;
   }
 
+  // pools for this frame's extra command buffers, reset by beginFrame
+  LveFrameCommandPools &getFrameCommandPools() { return framePools; }
+  // An extra command buffer of the current frame, for a pass or a recording thread. Secondary
+  // buffers are executed by the caller. Primary ones are submitted by endFrame ahead of the
+  // frame's own buffer in allocation order, have to be ended by then and are only handed out to
+  // the thread running the frame (lane 0).
+  VkCommandBuffer allocateCommandBuffer(VkCommandBufferLevel level, uint32_t lane = 0);
+
   VkCommandBuffer beginFrame();
   void endFrame();
-  void beginSwapChainRenderPass(VkCommandBuffer commandBuffer);
-  void endSwapChainRenderPass(VkCommandBuffer commandBuffer);
 
  private:
-  void createCommandBuffers();
-  void freeCommandBuffers();
+  // previous swap chains, destroyed once no frame in flight can use their images
+  struct RetiredSwapChain {
+    std::shared_ptr<LveSwapChain> swapChain;
+    uint64_t frame;
+  };
+
   void recreateSwapChain();
+  void releaseRetiredSwapChains(bool all);
 
   LveWindow& lveWindow;
   LveDevice& lveDevice;
+  LveSwapChainConfig swapChainConfig;
   std::unique_ptr<LveSwapChain> lveSwapChain;
-  std::vector<VkCommandBuffer> commandBuffers;
+  std::vector<RetiredSwapChain> retiredSwapChains;
+  uint64_t frameCounter{0};  // frames begun
+  LveFrameCommandPools framePools;  // every command buffer the renderer records, per frame slot
+  VkCommandBuffer currentCommandBuffer{VK_NULL_HANDLE};
+  std::vector<VkCommandBuffer> passCommandBuffers;  // extra primaries of the current frame
+
+  LveFrameStats frameStats;
+  std::chrono::steady_clock::time_point recordStart;
+  std::chrono::steady_clock::time_point lastFrameEnd;
+  bool hasFrameEnd{false};  // the first frame has no previous one to time against
 
+  uint32_t swapChainGeneration{0};
   uint32_t currentImageIndex{0};
   int currentFrameIndex{0};
   bool isFrameStarted{false};
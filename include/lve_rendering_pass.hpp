@@ -0,0 +1,55 @@
+#pragma once
+
+#include "lve_device.hpp"
+
+// std
+#include <vector>
+
+namespace lve {
+
+// One attachment of an LveRenderingPass. Its previous contents are dropped and it is cleared to
+// clearValue when the pass begins.
+struct LveRenderingAttachment {
+  VkImage image = VK_NULL_HANDLE;
+  VkImageView view = VK_NULL_HANDLE;
+  VkFormat format = VK_FORMAT_UNDEFINED;
+  VkClearValue clearValue{};
+  // false for attachments only the pass itself reads, like most depth buffers
+  bool store = true;
+  // where end() leaves the image: PRESENT_SRC_KHR, TRANSFER_SRC_OPTIMAL, SHADER_READ_ONLY_OPTIMAL,
+  // or the attachment layout to keep it as it is
+  VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+// A pass recorded with VK_KHR_dynamic_rendering, which draws straight into image views: there is
+// no VkRenderPass or VkFramebuffer to create up front, or to recreate when the images change.
+// begin() moves the attachments into attachment layouts and sets the viewport and scissor to the
+// whole extent, end() moves them on to their final layouts, which a render pass did through its
+// attachment descriptions and subpass dependencies. Pipelines drawn in the pass are made for the
+// attachments' formats, see LveRenderTargetFormat.
+class LveRenderingPass {
+ public:
+  explicit LveRenderingPass(LveDevice &device) : lveDevice{device} {}
+
+  LveRenderingPass(const LveRenderingPass &) = delete;
+  LveRenderingPass &operator=(const LveRenderingPass &) = delete;
+
+  // depthAttachment may be null. With VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR
+  // in flags the viewport and scissor are left to the secondary command buffers.
+  void begin(
+      VkCommandBuffer commandBuffer,
+      VkExtent2D extent,
+      const std::vector<LveRenderingAttachment> &colorAttachments,
+      const LveRenderingAttachment *depthAttachment,
+      VkRenderingFlagsKHR flags = 0);
+  void end(VkCommandBuffer commandBuffer);
+
+ private:
+  LveDevice &lveDevice;
+  std::vector<LveRenderingAttachment> colors;
+  LveRenderingAttachment depth{};
+  bool hasDepth{false};
+  bool inProgress{false};
+};
+
+}  // namespace lve
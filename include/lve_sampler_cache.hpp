@@ -0,0 +1,73 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+
+namespace lve {
+
+// Everything a VkSamplerCreateInfo without a pNext chain describes, equal keys give
+// interchangeable samplers. The defaults are those of a plain 2D texture.
+struct LveSamplerKey {
+  VkSamplerCreateFlags flags{0};
+  VkFilter magFilter{VK_FILTER_LINEAR};
+  VkFilter minFilter{VK_FILTER_LINEAR};
+  VkSamplerMipmapMode mipmapMode{VK_SAMPLER_MIPMAP_MODE_LINEAR};
+  VkSamplerAddressMode addressModeU{VK_SAMPLER_ADDRESS_MODE_REPEAT};
+  VkSamplerAddressMode addressModeV{VK_SAMPLER_ADDRESS_MODE_REPEAT};
+  VkSamplerAddressMode addressModeW{VK_SAMPLER_ADDRESS_MODE_REPEAT};
+  float mipLodBias{0.0f};
+  VkBool32 anisotropyEnable{VK_FALSE};
+  float maxAnisotropy{1.0f};
+  VkBool32 compareEnable{VK_FALSE};
+  VkCompareOp compareOp{VK_COMPARE_OP_ALWAYS};
+  float minLod{0.0f};
+  float maxLod{VK_LOD_CLAMP_NONE};
+  VkBorderColor borderColor{VK_BORDER_COLOR_INT_OPAQUE_BLACK};
+  VkBool32 unnormalizedCoordinates{VK_FALSE};
+
+  static LveSamplerKey fromCreateInfo(const VkSamplerCreateInfo &info);
+  VkSamplerCreateInfo createInfo() const;
+
+  bool operator==(const LveSamplerKey &other) const;
+  bool operator!=(const LveSamplerKey &other) const { return !(*this == other); }
+};
+
+struct LveSamplerKeyHash {
+  size_t operator()(const LveSamplerKey &key) const;
+};
+
+// One sampler per distinct key, shared by every texture that asks for it. acquire and release
+// count the users and the sampler is destroyed with its last one. Safe to use from several
+// threads.
+class LveSamplerCache {
+ public:
+  explicit LveSamplerCache(VkDevice device);
+  // destroys the samplers still held, must run before the device is destroyed
+  ~LveSamplerCache();
+
+  LveSamplerCache(const LveSamplerCache &) = delete;
+  LveSamplerCache &operator=(const LveSamplerCache &) = delete;
+
+  VkSampler acquire(const LveSamplerKey &key);
+  void release(const LveSamplerKey &key);
+
+  // distinct samplers alive right now
+  size_t size() const;
+
+ private:
+  struct Entry {
+    VkSampler sampler;
+    uint32_t users;
+  };
+
+  VkDevice device;
+  mutable std::mutex mutex;
+  std::unordered_map<LveSamplerKey, Entry, LveSamplerKeyHash> samplers;
+};
+
+}  // namespace lve
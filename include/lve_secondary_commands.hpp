@@ -0,0 +1,61 @@
+#pragma once
+
+#include "lve_command_pools.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_pipeline.hpp"
+
+// std
+#include <functional>
+#include <vector>
+
+namespace lve {
+
+// What secondary command buffers recorded inside a pass continue: its render pass, subpass and
+// framebuffer, or with dynamic rendering (renderPass null) its attachment formats.
+struct LveSecondaryInheritance {
+  LveRenderTargetFormat targetFormat;
+  VkFramebuffer framebuffer = VK_NULL_HANDLE;  // optional, lets the driver know it up front
+  VkExtent2D extent{0, 0};  // every buffer starts with viewport and scissor covering it
+};
+
+// The secondary command buffers of one pass instance, recorded on any number of threads and
+// executed in the order their slots were reserved, whichever thread finished first. The pass
+// has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS (or the dynamic rendering
+// equivalent), after which everything it draws has to go through here.
+class LveSecondaryCommands {
+ public:
+  using RecordFn = std::function<void(FrameInfo &frameInfo)>;
+
+  LveSecondaryCommands(
+      LveDevice &device,
+      LveFrameCommandPools &pools,
+      int frameIndex,
+      const LveSecondaryInheritance &inheritance);
+
+  LveSecondaryCommands(const LveSecondaryCommands &) = delete;
+  LveSecondaryCommands &operator=(const LveSecondaryCommands &) = delete;
+
+  // Reserves count buffers at the end of the execution order and returns the first slot. Not
+  // thread safe, reserve before handing the slots to workers.
+  uint32_t reserve(uint32_t count);
+  // Records fn into the buffer of a reserved slot, with a copy of frameInfo whose commandBuffer
+  // and dynamicState point at that buffer. Buffers of different lanes may be recorded at the same
+  // time, see LveFrameCommandPools.
+  void record(uint32_t slot, uint32_t lane, const FrameInfo &frameInfo, const RecordFn &fn);
+  // reserve(1) and record it on lane 0, from the thread that owns lane 0
+  void record(const FrameInfo &frameInfo, const RecordFn &fn);
+  // once every reserved slot was recorded: runs the buffers in slot order
+  void execute(VkCommandBuffer primaryCommandBuffer);
+
+  uint32_t laneCount() const { return pools.laneCount(); }
+
+ private:
+  LveDevice &lveDevice;
+  LveFrameCommandPools &pools;
+  int frameIndex;
+  LveSecondaryInheritance inheritance;
+  std::vector<VkCommandBuffer> slots;  // null until recorded
+};
+
+}  // namespace lve
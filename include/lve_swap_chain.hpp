@@ -1,34 +1,69 @@
 #pragma once
 
 #include "lve_device.hpp"
+#include "lve_frame_stats.hpp"
 
 // vulkan headers
 #include <vulkan/vulkan.h>
 
 // std lib headers
+#include <chrono>
 #include <memory>
 #include <string>
 #include <vector>
 
 namespace lve {
 
+  // How many frames the CPU may record ahead of the GPU and how they reach the screen, trading
+  // latency for throughput. Fixed for the lifetime of an LveRenderer.
+  struct LveSwapChainConfig {
+    static constexpr int MIN_FRAMES_IN_FLIGHT = 1;
+    static constexpr int MAX_FRAMES_IN_FLIGHT = 4;
+
+    int framesInFlight = 2;
+    // the first mode the surface supports is used, FIFO when none is
+    std::vector<VkPresentModeKHR> presentModes{ VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR };
+    // With VK_KHR_present_wait, a new frame starts only once so few frames are queued for display
+    // that the newest would be on screen within this many milliseconds. 0 turns the pacing off,
+    // as does a device without the extension.
+    float latencyBudgetMs = 0.0f;
+
+    // Defaults overridden by LVE_FRAMES_IN_FLIGHT (1 to 4), LVE_PRESENT_MODES (a comma separated
+    // preference list of fifo, fifo_relaxed, mailbox and immediate) and LVE_LATENCY_BUDGET_MS,
+    // so deployments can be tuned without a rebuild.
+    static LveSwapChainConfig fromEnvironment();
+  };
+
   class LveSwapChain {
   public:
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
-    LveSwapChain(LveDevice& deviceRef, VkExtent2D windowExtent);
+    // upper bound of LveSwapChainConfig::framesInFlight, for resources that are not sized at
+    // runtime
+    static constexpr int MAX_FRAMES_IN_FLIGHT = LveSwapChainConfig::MAX_FRAMES_IN_FLIGHT;
+    // vkWaitForPresentKHR gives up after this, so a present that never completes (a minimized
+    // window, for one) cannot stall the frame loop
+    static constexpr uint64_t PRESENT_WAIT_TIMEOUT_NS = 100000000;
+
+    LveSwapChain(LveDevice& deviceRef, VkExtent2D windowExtent, const LveSwapChainConfig& config);
+    // Replaces previous, which may still have frames in flight: the new swap chain takes over its
+    // frame fences and semaphores, previous has to stay alive until those frames finished.
     LveSwapChain(
-      LveDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<LveSwapChain> previous);
+      LveDevice& deviceRef,
+      VkExtent2D windowExtent,
+      const LveSwapChainConfig& config,
+      std::shared_ptr<LveSwapChain> previous);
     ~LveSwapChain();
 
     LveSwapChain(const LveSwapChain&) = delete;
     LveSwapChain& operator=(const LveSwapChain&) = delete;
 
-    VkFramebuffer getFrameBuffer(int index) { return swapChainFramebuffers[index]; }
-    VkRenderPass getRenderPass() { return renderPass; }
+    VkImage getImage(int index) { return swapChainImages[index]; }
     VkImageView getImageView(int index) { return swapChainImageViews[index]; }
     size_t imageCount() { return swapChainImages.size(); }
+    int framesInFlight() const { return config.framesInFlight; }
+    VkPresentModeKHR getPresentMode() const { return presentMode; }
     VkFormat getSwapChainImageFormat() { return swapChainImageFormat; }
+    // for depth buffers drawn together with the images, the swap chain has none itself
+    VkFormat getSwapChainDepthFormat() { return swapChainDepthFormat; }
     VkExtent2D getSwapChainExtent() { return swapChainExtent; }
     uint32_t width() { return swapChainExtent.width; }
     uint32_t height() { return swapChainExtent.height; }
@@ -39,7 +74,13 @@ namespace lve {
     VkFormat findDepthFormat();
 
     VkResult acquireNextImage(uint32_t* imageIndex);
-    VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+    // buffers run in order, the last one is expected to leave the image ready to present
+    VkResult submitCommandBuffers(
+      const VkCommandBuffer* buffers, uint32_t bufferCount, uint32_t* imageIndex);
+
+    // the waits and calls of the last acquireNextImage and submitCommandBuffers; the renderer adds
+    // the rest of the frame
+    const LveFrameTimings& getFrameTimings() const { return frameTimings; }
 
     bool compareSwapFormats(const LveSwapChain &swapChain) const {
       return swapChain.swapChainDepthFormat == swapChainDepthFormat &&
@@ -50,10 +91,10 @@ namespace lve {
     void init();
     void createSwapChain();
     void createImageViews();
-    void createDepthResources();
-    void createRenderPass();
-    void createFramebuffers();
     void createSyncObjects();
+    void takeSyncObjects(LveSwapChain& previous);
+    // the present wait pacing of LveSwapChainConfig::latencyBudgetMs
+    void waitForPresentLatency();
 
     // Helper functions
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -66,17 +107,13 @@ namespace lve {
     VkFormat swapChainDepthFormat;
     VkExtent2D swapChainExtent;
 
-    std::vector<VkFramebuffer> swapChainFramebuffers;
-    VkRenderPass renderPass;
-
-    std::vector<VkImage> depthImages;
-    std::vector<VkDeviceMemory> depthImageMemorys;
-    std::vector<VkImageView> depthImageViews;
     std::vector<VkImage> swapChainImages;
     std::vector<VkImageView> swapChainImageViews;
 
     LveDevice& device;
     VkExtent2D windowExtent;
+    LveSwapChainConfig config;
+    VkPresentModeKHR presentMode;
 
     VkSwapchainKHR swapChain;
     std::shared_ptr<LveSwapChain> oldSwapChain;
@@ -86,6 +123,15 @@ namespace lve {
     std::vector<VkFence> inFlightFences;
     std::vector<VkFence> imagesInFlight;
     size_t currentFrame = 0;
+
+    // present ids count from 1 per swap chain, 0 means none
+    bool presentPacing = false;
+    uint64_t presentCount = 0;
+    uint64_t lastWaitedPresent = 0;
+    std::chrono::steady_clock::time_point lastWaitedTime;
+    double displayIntervalNs = 0.0;  // running estimate of the time between presents
+
+    LveFrameTimings frameTimings{};
   };
 
 }  // namespace lve
@@ -1,16 +1,55 @@
 #pragma once
 #include "lve_device.hpp"
+#include "lve_sampler_cache.hpp"
+#include "lve_texture_data.hpp"
+#include "lve_thread_pool.hpp"
+#include <array>
+#include <functional>
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace lve {
 class LveTexture {
 public:
-    LveTexture(LveDevice& device, const std::string& filepath);
-		LveTexture(LveDevice& device, const std::array<std::string, 6>& faces); // cubemap
+    static constexpr uint32_t NO_BINDLESS_SLOT = UINT32_MAX;
+
+    // what replaceImage hands back, to be destroyed once no frame in flight samples it
+    struct ImageResources {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkImageView view;
+    };
+
+    // the pool, when given, decodes cubemap faces and builds CPU mips concurrently
+    LveTexture(LveDevice& device, const std::string& filepath, LveThreadPool* threadPool = nullptr);
+		LveTexture(LveDevice& device, const std::array<std::string, 6>& faces,
+		           LveThreadPool* threadPool = nullptr); // cubemap
+    LveTexture(LveDevice& device, TextureData data, LveThreadPool* threadPool = nullptr);
+    // Image without content that copies write later, e.g. the virtual texture atlas. It starts in
+    // SHADER_READ_ONLY layout and is sampled with clamp to edge and the given filter.
+    LveTexture(LveDevice& device, uint32_t width, uint32_t height, VkFormat format,
+               uint32_t mipLevels, VkFilter filter);
     ~LveTexture();
 
+    // Decodes every file concurrently on the pool, the uploads then run one by one on this thread
+    // since they share the device's command pool.
+    static std::vector<std::shared_ptr<LveTexture>> loadTextures(
+        LveDevice& device, const std::vector<std::string>& filepaths, LveThreadPool& threadPool);
+
+    VkImage getImage() const { return textureImage; }
     VkImageView getImageView() const { return textureImageView; }
     VkSampler getSampler() const { return textureSampler; }
+    const LveSamplerKey& getSamplerKey() const { return samplerKey_; }
+    uint32_t getMipLevels() const { return mipLevels_; }
+    uint32_t getLayerCount() const { return layerCount_; }
+    VkFormat getFormat() const { return textureFormat_; }
+    // slot in LveBindlessTextures, NO_BINDLESS_SLOT until the texture is registered
+    uint32_t getBindlessSlot() const { return bindlessSlot_; }
+
+    // Takes over an image in SHADER_READ_ONLY layout with the same format and layers, e.g. one
+    // holding more or fewer mips from LveTextureStreamer. The sampler is kept.
+    ImageResources replaceImage(VkImage image, VkDeviceMemory memory, uint32_t mipLevels);
 
 		VkDescriptorImageInfo descriptorInfo() const {
 			return VkDescriptorImageInfo{
@@ -23,6 +62,17 @@ public:
 private:
     void createTextureImage(const std::string& filepath);
 		void createCubemapImage(const std::array<std::string, 6>& faces);
+    void createTextureFromData(TextureData data);
+    void uploadImage(uint32_t layerCount, uint32_t width, uint32_t height, VkImageCreateFlags flags,
+                     const std::function<void(uint8_t*)>& writeLevel0);
+    void createImageFromStaging(VkBuffer stagingBuffer, const std::vector<VkBufferImageCopy>& regions,
+                                uint32_t width, uint32_t height, VkImageCreateFlags flags,
+                                bool blitMipmaps);
+    VkBufferImageCopy bufferImageCopy(VkDeviceSize offset, uint32_t mipLevel, uint32_t width,
+                                      uint32_t height) const;
+    bool supportsSampledFormat(VkFormat format);
+    bool supportsLinearBlit(VkFormat format);
+    void generateMipmaps(int32_t texWidth, int32_t texHeight);
     void createTextureImageView();
     void createTextureSampler();
 
@@ -30,8 +80,18 @@ private:
     VkImage textureImage;
     VkDeviceMemory textureImageMemory;
     VkImageView textureImageView;
-    VkSampler textureSampler;
+    VkSampler textureSampler{VK_NULL_HANDLE};  // owned by the device's sampler cache
+    LveSamplerKey samplerKey_{};
 
+    VkFormat textureFormat_{VK_FORMAT_R8G8B8A8_SRGB};
+    uint32_t mipLevels_{1};
+    uint32_t layerCount_{1};
 		bool isCubemap_{false};   // 新增
+    bool clampToEdge_{false};
+    VkFilter filter_{VK_FILTER_LINEAR};
+    LveThreadPool* threadPool_{nullptr};  // only used while loading
+    uint32_t bindlessSlot_{NO_BINDLESS_SLOT};
+
+    friend class LveBindlessTextures;
 };
-}
\ No newline at end of file
+}
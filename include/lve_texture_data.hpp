@@ -0,0 +1,51 @@
+#pragma once
+
+// vulkan headers
+#include <vulkan/vulkan.h>
+
+// std
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// CPU side copy of a texture with its whole mip chain, as read from a KTX2 / DDS container
+struct TextureData {
+  VkFormat format{VK_FORMAT_UNDEFINED};
+  uint32_t width{0};
+  uint32_t height{0};
+  uint32_t layerCount{1};  // 6 for cubemaps, faces in +X -X +Y -Y +Z -Z order
+  bool isCubemap{false};
+  // level-major: levels[i] holds every layer of mip level i back to back
+  std::vector<std::vector<uint8_t>> levels;
+
+  uint32_t mipLevels() const { return static_cast<uint32_t>(levels.size()); }
+};
+
+bool isBlockCompressedFormat(VkFormat format);
+// bytes per 4x4 block for BC formats, bytes per texel otherwise
+uint32_t formatBlockSize(VkFormat format);
+VkDeviceSize formatLevelSize(VkFormat format, uint32_t width, uint32_t height);
+// uncompressed format used when a BC format has to be decoded on the CPU
+VkFormat decodedTextureFormat(VkFormat format);
+
+// true for file extensions handled by loadTextureData instead of stb_image
+bool isTextureContainerFile(const std::string &filepath);
+// The best version of an image on disk: the cooked <name>.ktx2 next to it (cook_textures target),
+// then its <name>.qoi (qoi_textures target), then the path as given
+std::string resolveTextureFile(const std::string &filepath);
+TextureData loadTextureData(const std::string &filepath);
+// Any texture file: containers keep their levels, images decode to a single bottom up RGBA8 sRGB
+// level. Safe to call from several threads.
+TextureData loadTextureFile(const std::string &filepath);
+// Levels come back bottom up: KTXorientation "rd" (also the default) flips uncompressed rows,
+// block compressed data has to be stored "ru".
+TextureData loadKtx2(const std::string &filepath);
+TextureData loadDds(const std::string &filepath);
+
+// Writes a KTX2 file without supercompression that loadKtx2 reads back. Level rows are written
+// as given, the KTXorientation key marks them bottom up like the flipped stb_image path.
+void saveKtx2(const std::string &filepath, const TextureData &texture);
+
+}  // namespace lve
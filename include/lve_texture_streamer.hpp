@@ -0,0 +1,136 @@
+#pragma once
+
+#include "lve_bindless_textures.hpp"
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_texture.hpp"
+#include "lve_texture_data.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+struct TextureStreamingStats {
+  VkDeviceSize budgetBytes{0};
+  VkDeviceSize residentBytes{0};   // levels the textures currently sample from
+  VkDeviceSize requestedBytes{0};  // levels the objects on screen asked for in the last update
+  VkDeviceSize pendingBytes{0};    // images still being uploaded
+  uint32_t textureCount{0};
+  uint32_t pendingUploads{0};
+  uint64_t streamedIn{0};  // finished uploads that raised a texture's resolution
+  uint64_t evicted{0};     // finished uploads that dropped levels to stay within the budget
+};
+
+// Keeps 2D textures partially resident under a fixed memory budget. Every texture starts with only
+// its small mips on the GPU. Each frame the streamer estimates the level each object needs from
+// its on-screen UV density and uploads higher levels asynchronously. When that would exceed the
+// budget, levels are dropped from the least recently used textures first. A new image only uploads
+// the levels that were not resident, the rest are copied from the current image on the GPU, so
+// dropping levels uploads nothing. A finished upload replaces the texture's image and moves it to a
+// fresh bindless slot. The old image is destroyed once the frames in flight are done with it, so
+// nothing waits for the device to go idle. The CPU keeps only the levels that can be missing on the
+// GPU, and for textures loaded from files only until they are all resident; they are read again
+// on the pool when they are needed after an eviction.
+class LveTextureStreamer {
+ public:
+  // levels of at most this size are always resident
+  static constexpr uint32_t MIN_RESIDENT_SIZE = 64;
+  static constexpr uint32_t MAX_UPLOADS_IN_FLIGHT = 4;
+
+  // framesInFlight is the renderer's runtime count, it decides when replaced images are unused
+  LveTextureStreamer(
+      LveDevice &device,
+      LveBindlessTextures &bindlessTextures,
+      uint32_t framesInFlight,
+      VkDeviceSize budgetBytes,
+      LveThreadPool *threadPool = nullptr);
+  // the device must be idle, like for every other resource
+  ~LveTextureStreamer();
+
+  LveTextureStreamer(const LveTextureStreamer &) = delete;
+  LveTextureStreamer &operator=(const LveTextureStreamer &) = delete;
+
+  // Reads the files, or their cooked KTX2 when there is one (decoded and mipmapped on the pool when there is one) and uploads only their
+  // small mips. The textures come back registered in the bindless table.
+  std::vector<std::shared_ptr<LveTexture>> loadTextures(const std::vector<std::string> &filepaths);
+  std::shared_ptr<LveTexture> addTexture(TextureData data);
+
+  // Once per frame after beginFrame and before any draw is recorded: finishes uploads, works out
+  // the levels the objects need and starts new uploads or evictions.
+  void update(FrameInfo &frameInfo, VkExtent2D extent);
+
+  void setBudget(VkDeviceSize budgetBytes) { budgetBytes_ = budgetBytes; }
+  TextureStreamingStats getStats() const;
+
+ private:
+  struct Upload {
+    uint32_t baseLevel;
+    VkImage image;
+    VkDeviceMemory memory;
+    VkBuffer stagingBuffer{VK_NULL_HANDLE};  // none when every level comes from the current image
+    VkDeviceMemory stagingMemory{VK_NULL_HANDLE};
+    VkCommandBuffer commandBuffer;
+    VkFence fence;
+  };
+
+  struct StreamedTexture {
+    std::shared_ptr<LveTexture> texture;
+    std::string filepath;  // empty for addTexture, whose levels then stay on the CPU
+    // format and size of the whole texture; levels holds 0..minResidentBase-1 while sourceLoaded
+    TextureData source;
+    std::vector<VkDeviceSize> levelBytes;  // every level, whether its data is on the CPU or not
+    bool sourceLoaded{true};
+    std::future<TextureData> reload;  // the file read again, see startReload
+    uint32_t residentBase;      // first level on the GPU
+    uint32_t minResidentBase;   // levels from here on never leave
+    uint32_t requestedBase;     // what the objects asked for in the last update
+    uint64_t lastUsedFrame{0};
+    std::unique_ptr<Upload> upload;
+
+    uint32_t mipLevels() const { return static_cast<uint32_t>(levelBytes.size()); }
+  };
+
+  // previous images and slots, destroyed once no frame in flight can sample them
+  struct Retired {
+    LveTexture::ImageResources resources;
+    uint32_t slot;
+    uint64_t frame;
+  };
+
+  void prepareSource(TextureData &data) const;
+  std::shared_ptr<LveTexture> addPrepared(TextureData data, const std::string &filepath);
+  uint32_t neededBaseLevel(const StreamedTexture &streamed, LveGameObject &obj, const LveCamera &camera,
+                           VkExtent2D extent) const;
+  VkDeviceSize bytesFrom(const StreamedTexture &streamed, uint32_t baseLevel) const;
+  VkDeviceSize committedBytes(const StreamedTexture &streamed) const;
+  void startReload(StreamedTexture &streamed);
+  void finishReload(StreamedTexture &streamed);
+  void startUpload(StreamedTexture &streamed, uint32_t baseLevel);
+  void finishUpload(StreamedTexture &streamed);
+  void destroyStaging(Upload &upload);
+  void releaseRetired(bool all);
+
+  LveDevice &lveDevice;
+  LveBindlessTextures &bindlessTextures;
+  LveThreadPool *threadPool;
+  uint32_t framesInFlight;
+  VkDeviceSize budgetBytes_;
+  VkCommandPool commandPool;  // uploads only, the device's pool is left to one-off commands
+
+  std::vector<std::unique_ptr<StreamedTexture>> textures;
+  std::unordered_map<const LveTexture *, StreamedTexture *> byTexture;
+  std::vector<Retired> retired;
+  uint64_t frameCounter{0};
+  uint32_t uploadsInFlight{0};
+  VkDeviceSize requestedBytes{0};
+  uint64_t streamedIn{0};
+  uint64_t evicted{0};
+};
+
+}  // namespace lve
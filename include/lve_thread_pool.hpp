@@ -0,0 +1,55 @@
+#pragma once
+
+// std
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lve {
+
+class LveThreadPool {
+ public:
+  // threadCount 0 picks one worker per hardware thread minus the calling thread
+  explicit LveThreadPool(uint32_t threadCount = 0);
+  ~LveThreadPool();
+
+  LveThreadPool(const LveThreadPool &) = delete;
+  LveThreadPool &operator=(const LveThreadPool &) = delete;
+
+  template <typename F>
+  auto submit(F &&task) -> std::future<decltype(std::declval<std::decay_t<F> &>()())> {
+    using Result = decltype(std::declval<std::decay_t<F> &>()());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    auto future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+  }
+
+  // Runs fn(begin, end) over [0, count) in chunks of at most grainSize. The calling thread takes
+  // part and only returns once every chunk is done, so it is safe to call from a worker. The first
+  // exception thrown by a chunk is rethrown here, the remaining chunks still run.
+  void parallelFor(
+      uint32_t count, const std::function<void(uint32_t, uint32_t)> &fn, uint32_t grainSize = 1);
+
+  uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()); }
+
+ private:
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> tasks;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping = false;
+};
+
+}  // namespace lve
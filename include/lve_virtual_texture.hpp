@@ -0,0 +1,129 @@
+#pragma once
+
+#include "lve_bindless_textures.hpp"
+#include "lve_device.hpp"
+#include "lve_texture.hpp"
+#include "lve_thread_pool.hpp"
+#include "lve_virtual_texture_file.hpp"
+
+// std
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace lve {
+
+struct VirtualTextureStats {
+  uint32_t physicalPages{0};
+  uint32_t residentPages{0};
+  uint32_t pendingLoads{0};
+  uint64_t pagesUploaded{0};
+  uint64_t pagesEvicted{0};
+};
+
+// The virtual texture fields of the object push constants, in the order simple_shader.frag and
+// vt_feedback.frag declare them. indirectionSlot is the bindless slot + 1, so 0 means none.
+struct VirtualTextureShaderParams {
+  uint32_t indirectionSlot{0};
+  uint32_t atlasSlot{0};
+  float width{0.f};  // of the virtual texture in texels
+  float height{0.f};
+  float borderSize{0.f};
+  float pageSize{0.f};
+};
+
+// Software virtual texturing on plain sampled images, no sparse binding. The pages a feedback
+// pass reports are read from a tiled .lvt file on the thread pool and copied into a fixed atlas
+// of physical pages. An indirection texture with one texel per virtual page and level points at
+// the atlas page holding it, or at its finest resident ancestor, so every lookup finds something.
+// The single page top level never leaves the atlas. Both images live in the bindless table.
+class LveVirtualTexture {
+ public:
+  static constexpr uint32_t DEFAULT_ATLAS_PAGES = 16;  // per side
+  static constexpr uint32_t MAX_PENDING_LOADS = 64;
+  static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+
+  // framesInFlight is the renderer's runtime count, one staging buffer is kept per frame slot
+  LveVirtualTexture(
+      LveDevice &device,
+      LveBindlessTextures &bindlessTextures,
+      uint32_t framesInFlight,
+      const std::string &filepath,
+      LveThreadPool &threadPool,
+      uint32_t atlasPages = DEFAULT_ATLAS_PAGES);
+  // the device must be idle, like for every other resource
+  ~LveVirtualTexture();
+
+  LveVirtualTexture(const LveVirtualTexture &) = delete;
+  LveVirtualTexture &operator=(const LveVirtualTexture &) = delete;
+
+  // Takes the page ids read back from one feedback pass: pages in use are kept, missing ones and
+  // their missing ancestors start loading, coarse levels first.
+  void requestPages(const std::vector<uint32_t> &pageIds);
+
+  // Once per frame before any pass samples the texture: copies finished pages into the atlas and
+  // rewrites the indirection texture in the frame's command buffer. The barriers order the copies
+  // after earlier frames' reads, so pages can be replaced while those are still in flight.
+  void recordUpdates(VkCommandBuffer commandBuffer, int frameIndex);
+
+  // what the simple and feedback shaders sample the virtual texture with
+  VirtualTextureShaderParams getShaderParams() const;
+
+  const VirtualTextureInfo &getInfo() const { return file.info(); }
+  VirtualTextureStats getStats() const;
+
+ private:
+  static constexpr uint32_t NO_PAGE = UINT32_MAX;
+
+  struct PhysicalPage {
+    uint32_t virtualPage{NO_PAGE};
+    uint64_t lastUsed{0};  // requestPages call that last saw it
+    bool pinned{false};
+  };
+
+  struct FrameStaging {
+    VkBuffer buffer{VK_NULL_HANDLE};
+    VkDeviceMemory memory{VK_NULL_HANDLE};
+    uint8_t *mapped{nullptr};
+  };
+
+  void createStaging(FrameStaging &frame);
+  void startLoad(uint32_t virtualPage);
+  uint32_t allocatePhysicalPage();
+  void buildIndirection();
+  void recordCopies(
+      VkCommandBuffer commandBuffer,
+      VkBuffer stagingBuffer,
+      const std::vector<VkBufferImageCopy> &atlasRegions,
+      VkDeviceSize indirectionOffset);
+  VkBufferImageCopy atlasRegion(VkDeviceSize bufferOffset, uint32_t physicalPage) const;
+
+  LveDevice &lveDevice;
+  LveThreadPool &threadPool;
+  LveVirtualTextureFile file;
+  uint32_t atlasPages;
+
+  std::shared_ptr<LveTexture> atlas;
+  std::shared_ptr<LveTexture> indirection;
+  uint32_t indirectionWidth;   // pages of level 0 rounded up to a power of two, so the image's
+  uint32_t indirectionHeight;  // mip chain has room for every level of the virtual texture
+  std::vector<VkDeviceSize> indirectionLevelOffsets;  // levels back to back, RGBA8
+  std::vector<uint8_t> indirectionTexels;
+  bool indirectionDirty{false};
+
+  std::vector<uint32_t> pageTable;  // virtual page -> physical page or NO_PAGE
+  std::vector<PhysicalPage> physicalPages;
+  std::vector<uint32_t> freePhysicalPages;
+  std::unordered_map<uint32_t, std::future<std::vector<uint8_t>>> loading;
+  // one per frame slot, made on the slot's first use since the renderer picks how many there are
+  std::vector<FrameStaging> staging;
+  VkDeviceSize stagingSize{0};
+
+  uint64_t requestCounter{0};
+  uint64_t pagesUploaded{0};
+  uint64_t pagesEvicted{0};
+};
+
+}  // namespace lve
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lve_thread_pool.hpp"
+
+// std
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace lve {
+
+// Page layout of a virtual texture. Level i is max(width >> i, 1) x max(height >> i, 1) texels cut
+// into pageSize x pageSize pages, the last row and column may be partial. Every page is stored
+// as a tile with borderSize extra texels on each side so bilinear filtering in the atlas never
+// reads a neighbouring page. The chain stops at the first level that fits in one page.
+struct VirtualTextureInfo {
+  uint32_t width{0};
+  uint32_t height{0};
+  uint32_t pageSize{128};
+  uint32_t borderSize{4};
+  uint32_t mipLevels{1};
+  bool srgb{true};
+
+  uint32_t tileSize() const { return pageSize + 2 * borderSize; }
+  uint32_t levelWidth(uint32_t level) const;
+  uint32_t levelHeight(uint32_t level) const;
+  uint32_t pagesX(uint32_t level) const;
+  uint32_t pagesY(uint32_t level) const;
+  // pages of every level, numbered level by level and row by row
+  uint32_t pageCount() const;
+  uint32_t pageIndex(uint32_t level, uint32_t x, uint32_t y) const;
+};
+
+// Page ids as written by shaders/vt_feedback.frag: level in the top 4 bits, then 14 bits of y and
+// 14 bits of x. VIRTUAL_PAGE_NONE marks pixels without a virtual texture.
+constexpr uint32_t VIRTUAL_PAGE_NONE = 0xffffffff;
+constexpr uint32_t VIRTUAL_MAX_LEVELS = 15;
+constexpr uint32_t VIRTUAL_MAX_PAGES = 1 << 14;  // per side
+
+inline uint32_t packVirtualPageId(uint32_t level, uint32_t x, uint32_t y) {
+  return level << 28 | y << 14 | x;
+}
+inline uint32_t virtualPageLevel(uint32_t id) { return id >> 28; }
+inline uint32_t virtualPageX(uint32_t id) { return id & (VIRTUAL_MAX_PAGES - 1); }
+inline uint32_t virtualPageY(uint32_t id) { return (id >> 14) & (VIRTUAL_MAX_PAGES - 1); }
+
+VirtualTextureInfo makeVirtualTextureInfo(
+    uint32_t width, uint32_t height, uint32_t pageSize, uint32_t borderSize, bool srgb);
+
+// Cuts an RGBA8 image (rows bottom up like every other texture) and its mip chain into tiles and
+// writes them as a .lvt file, each tile QOI compressed. Tile borders wrap around the level like
+// the repeat sampler does. Returns the file size.
+size_t saveVirtualTexture(
+    const std::string &filepath,
+    const uint8_t *pixels,
+    const VirtualTextureInfo &info,
+    LveThreadPool *threadPool = nullptr);
+
+// Reads single tiles out of a .lvt file without loading the rest of it.
+class LveVirtualTextureFile {
+ public:
+  explicit LveVirtualTextureFile(const std::string &filepath);
+
+  LveVirtualTextureFile(const LveVirtualTextureFile &) = delete;
+  LveVirtualTextureFile &operator=(const LveVirtualTextureFile &) = delete;
+
+  const VirtualTextureInfo &info() const { return info_; }
+
+  // Decodes one tile of tileSize x tileSize RGBA8 texels into dst. Safe to call from several
+  // threads, only the file read itself is serialised.
+  void readPage(uint32_t pageIndex, uint8_t *dst);
+
+ private:
+  std::string filepath_;
+  std::ifstream file;
+  std::mutex fileMutex;
+  VirtualTextureInfo info_{};
+  std::vector<uint64_t> pageOffsets;  // pageCount + 1 entries, page i spans [i, i + 1)
+};
+
+}  // namespace lve
@@ -5,6 +5,8 @@
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_thread_pool.hpp"
 
 // std
 #include <memory>
@@ -14,7 +16,10 @@ namespace lve {
 class PointLightSystem {
  public:
   PointLightSystem(
-      LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout);
+      LveDevice &device,
+      const LveRenderTargetFormat &targetFormat,
+      LvePushDescriptorSet &globalDescriptor,
+      LveThreadPool *threadPool = nullptr);  // compiles the pipeline there
   ~PointLightSystem();
 
   PointLightSystem(const PointLightSystem &) = delete;
@@ -25,11 +30,12 @@ class PointLightSystem {
 
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipeline(const LveRenderTargetFormat &targetFormat, LveThreadPool *threadPool);
 
   LveDevice &lveDevice;
+  LvePushDescriptorSet &globalDescriptor;
 
-  std::unique_ptr<LvePipeline> lvePipeline;
+  LvePipelineHandle lvePipeline;  // from the device's pipeline registry, may still be compiling
   VkPipelineLayout pipelineLayout;
   float accumulatedTime{0.0f};
 };
@@ -5,35 +5,109 @@
 #include "lve_frame_info.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_permutations.hpp"
+#include "lve_secondary_commands.hpp"
+#include "lve_thread_pool.hpp"
 
 // std
+#include <functional>
 #include <memory>
 #include <vector>
 
 namespace lve {
+
+// The Push block of simple_shader.vert / .frag, also pushed by VirtualTextureFeedbackSystem whose
+// vertex stage is simple_shader.vert. The normal matrix is derived in the vertex shader rather
+// than pushed, which keeps the block well inside the guaranteed 128 bytes.
+struct SimplePushConstantData {
+  glm::mat4 modelMatrix{1.f};
+  uint32_t textureIndex{LveBindlessTextures::DEFAULT_SLOT};  // the material's bindless slot
+  VirtualTextureShaderParams virtualTexture{};
+};
+static_assert(sizeof(SimplePushConstantData) <= 128, "push constants beyond the guaranteed size");
+
 class SimpleRenderSystem {
  public:
   SimpleRenderSystem(LveDevice &device,
-                     VkRenderPass renderPass,
-                     VkDescriptorSetLayout globalSetLayout,
-                     VkDescriptorSetLayout materialSetLayout,
-                     VkDescriptorSet defaultMaterialSet);
+                     const LveRenderTargetFormat &targetFormat,
+                     LvePushDescriptorSet &globalDescriptor,
+                     VkDescriptorSetLayout textureSetLayout,
+                     VkDescriptorSet textureSet,
+                     LveThreadPool *threadPool = nullptr);  // compiles the pipeline and records there
   ~SimpleRenderSystem();
 
   SimpleRenderSystem(const SimpleRenderSystem &) = delete;
   SimpleRenderSystem &operator=(const SimpleRenderSystem &) = delete;
 
-  void renderGameObjects(FrameInfo &frameInfo);
+  // Off never draws the prepass, On always does once its pipelines compiled, Auto only while the
+  // estimated overdraw is high enough to pay for drawing the opaque geometry twice
+  enum class DepthPrepassMode { Off, On, Auto };
+  // LVE_DEPTH_PREPASS=off|on|auto, auto when unset
+  static DepthPrepassMode depthPrepassModeFromEnvironment();
+
+  // Compiles the depth only pipeline for a prepass rendering into prepassTargetFormat, which has
+  // to fill the depth buffer renderGameObjects then tests against
+  void enableDepthPrepass(const LveRenderTargetFormat &prepassTargetFormat, DepthPrepassMode mode);
+
+  // Builds the frame's sorted draw list and decides whether the prepass runs; call once per frame
+  // before renderDepthPrepass and renderGameObjects.
+  void collectDraws(FrameInfo &frameInfo);
+  // Writes the depth of the draws, front to back. Does nothing while usesDepthPrepass() is false.
+  void renderDepthPrepass(FrameInfo &frameInfo, LveSecondaryCommands *secondaryCommands = nullptr);
+  // Without secondaryCommands the draws go straight into frameInfo.commandBuffer. With them the
+  // sorted draw list is split into up to laneCount() chunks, recorded on the thread pool and
+  // executed in draw order. After a prepass only the visible fragments are shaded (depth EQUAL,
+  // no depth writes).
+  void renderGameObjects(FrameInfo &frameInfo, LveSecondaryCommands *secondaryCommands = nullptr);
+
+  bool usesDepthPrepass() const { return prepassActive; }
+  // summed screen coverage of the opaque draws' bounding spheres, 1 is one full screen
+  float getEstimatedOverdraw() const { return estimatedOverdraw; }
 
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout,
-                            VkDescriptorSetLayout materialSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+                            VkDescriptorSetLayout textureSetLayout);
+  void configurePermutation(
+      const LveRenderTargetFormat &targetFormat, uint32_t permutation, PipelineConfigInfo &pipelineConfig);
+  void createPipeline(const LveRenderTargetFormat &targetFormat, LveThreadPool *threadPool);
+  void createDepthPipeline(const LveRenderTargetFormat &prepassTargetFormat);
+  // splits draws into chunks like renderGameObjects describes; record fills [begin, end) of them
+  void recordChunked(
+      FrameInfo &frameInfo,
+      LveSecondaryCommands *secondaryCommands,
+      const std::function<void(FrameInfo &, uint32_t, uint32_t)> &record);
+  // draws[begin, end) with the sets bound, into frameInfo.commandBuffer
+  void recordDraws(FrameInfo &frameInfo, uint32_t begin, uint32_t end);
+  // the draws at depthOrder[begin, end), depth only
+  void recordDepthDraws(FrameInfo &frameInfo, uint32_t begin, uint32_t end);
+  bool depthPrepassReady() const;
+
+  struct Draw {
+    uint32_t permutation;  // without the light bucket, that is the same for the whole frame
+    float viewDepth;       // of the bounding sphere's center
+    LveGameObject *gameObject;
+    LvePipeline *pipeline = nullptr;  // resolved by collectDraws, with the light bucket
+  };
 
   LveDevice &lveDevice;
+  LvePushDescriptorSet &globalDescriptor;
+  LveRenderTargetFormat mainTargetFormat;
 
-  std::unique_ptr<LvePipeline> lvePipeline;
+  // simple_shader variants per material and light count, may still be compiling
+  std::unique_ptr<LvePipelinePermutations> pipelines;
   VkPipelineLayout pipelineLayout;
-	VkDescriptorSet defaultMaterialSet_{VK_NULL_HANDLE};
+	VkDescriptorSet textureSet_{VK_NULL_HANDLE};  // bindless texture table, bound once per pass
+  LveThreadPool *threadPool_{nullptr};
+  std::vector<Draw> draws;  // reused between frames
+  std::vector<uint32_t> depthOrder;  // indices into draws, front to back
+
+  DepthPrepassMode prepassMode{DepthPrepassMode::Off};
+  LvePipelineHandle depthPipeline;
+  // the main pass with depth EQUAL and no depth writes baked in, on devices that cannot set them
+  // dynamically
+  std::unique_ptr<LvePipelinePermutations> equalPipelines;
+  float estimatedOverdraw{0.f};
+  bool prepassWanted{false};  // by the mode and the overdraw, with hysteresis
+  bool prepassActive{false};  // and the pipelines are compiled
 };
 }  // namespace lve
@@ -4,6 +4,8 @@
 #include "lve_device.hpp"
 #include "lve_game_object.hpp"
 #include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_thread_pool.hpp"
 #include "lve_frame_info.hpp"
 
 // std
@@ -14,10 +16,11 @@ namespace lve {
 
 class SkyboxRenderSystem {
  public:
-  SkyboxRenderSystem(LveDevice& device, VkRenderPass renderPass,
-                     VkDescriptorSetLayout globalSetLayout,
+  SkyboxRenderSystem(LveDevice& device, const LveRenderTargetFormat& targetFormat,
+                     LvePushDescriptorSet& globalDescriptor,
                      VkDescriptorSetLayout cubemapSetLayout,
-										 VkDescriptorSet skyboxSet);
+										 VkDescriptorSet skyboxSet,
+                     LveThreadPool* threadPool = nullptr);  // compiles the pipeline there
   ~SkyboxRenderSystem();
 
   SkyboxRenderSystem(const SkyboxRenderSystem&) = delete;
@@ -27,11 +30,12 @@ class SkyboxRenderSystem {
 
  private:
   void createPipelineLayout(VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout cubemapSetLayout);
-  void createPipeline(VkRenderPass renderPass);
+  void createPipeline(const LveRenderTargetFormat& targetFormat, LveThreadPool* threadPool);
 
   LveDevice& lveDevice;
+  LvePushDescriptorSet& globalDescriptor;
 
-  std::unique_ptr<LvePipeline> lvePipeline;
+  LvePipelineHandle lvePipeline;  // from the device's pipeline registry, may still be compiling
   VkPipelineLayout pipelineLayout;
 	VkDescriptorSet skyboxSet_{VK_NULL_HANDLE}; // 新增
 };
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "lve_device.hpp"
+#include "lve_frame_info.hpp"
+#include "lve_game_object.hpp"
+#include "lve_pipeline.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_rendering_pass.hpp"
+#include "lve_thread_pool.hpp"
+#include "lve_virtual_texture.hpp"
+
+// std
+#include <memory>
+#include <vector>
+
+namespace lve {
+// Renders the scene at a fraction of the frame size into an R32_UINT target holding the virtual
+// texture page each pixel needs, then copies it to a host visible buffer. The buffer is read the
+// next time the same frame slot comes round, after beginFrame has waited for it, so the readback
+// never stalls. The requests go to the virtual texture.
+// The pass is recorded before LveRenderGraph executes rather than as one of its passes: its colour
+// target has to be copied to the readback buffer right after the pass, and the graph only knows
+// raster passes with attachment and sampled uses, not transfer reads. Nothing in the graph reads
+// its output either, so there is no dependency for the graph to order or cull.
+class VirtualTextureFeedbackSystem {
+ public:
+  static constexpr uint32_t FEEDBACK_SCALE = 4;  // matches FEEDBACK_LOD_BIAS in vt_feedback.frag
+
+  // framesInFlight is the renderer's runtime count, one target is kept per frame slot
+  VirtualTextureFeedbackSystem(LveDevice &device,
+                               LveVirtualTexture &virtualTexture,
+                               uint32_t framesInFlight,
+                               LvePushDescriptorSet &globalDescriptor,
+                               VkDescriptorSetLayout textureSetLayout,
+                               VkDescriptorSet textureSet,
+                               LveThreadPool *threadPool = nullptr);  // compiles the pipeline there
+  ~VirtualTextureFeedbackSystem();
+
+  VirtualTextureFeedbackSystem(const VirtualTextureFeedbackSystem &) = delete;
+  VirtualTextureFeedbackSystem &operator=(const VirtualTextureFeedbackSystem &) = delete;
+
+  // Outside any render pass: hands the readback of this frame slot's last use to the virtual
+  // texture and records a new feedback pass for a frame of the given size.
+  void render(FrameInfo &frameInfo, VkExtent2D extent);
+
+ private:
+  struct FeedbackTarget {
+    VkExtent2D extent{0, 0};
+    VkImage colorImage{VK_NULL_HANDLE};
+    VkDeviceMemory colorMemory{VK_NULL_HANDLE};
+    VkImageView colorView{VK_NULL_HANDLE};
+    VkImage depthImage{VK_NULL_HANDLE};
+    VkDeviceMemory depthMemory{VK_NULL_HANDLE};
+    VkImageView depthView{VK_NULL_HANDLE};
+    VkFramebuffer framebuffer{VK_NULL_HANDLE};  // classic path only
+    VkBuffer readbackBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory readbackMemory{VK_NULL_HANDLE};
+    uint32_t *readback{nullptr};
+    bool hasResults{false};
+  };
+
+  void createRenderPass();
+  void createPipelineLayout(VkDescriptorSetLayout globalSetLayout,
+                            VkDescriptorSetLayout textureSetLayout);
+  void createPipeline(LveThreadPool *threadPool);
+  void createTarget(FeedbackTarget &target, VkExtent2D extent);
+  void destroyTarget(FeedbackTarget &target);
+  void collectRequests(FeedbackTarget &target);
+
+  LveDevice &lveDevice;
+  LveVirtualTexture &virtualTexture;
+  LvePushDescriptorSet &globalDescriptor;
+
+  VkFormat depthFormat;
+  VkRenderPass renderPass{VK_NULL_HANDLE};  // null when the device renders dynamically
+  LveRenderingPass feedbackPass;
+  LvePipelineHandle lvePipeline;  // from the device's pipeline registry, may still be compiling
+  VkPipelineLayout pipelineLayout;
+  VkDescriptorSet textureSet_{VK_NULL_HANDLE};
+  std::vector<FeedbackTarget> targets;  // one per frame slot
+  std::vector<uint32_t> pageIds;
+};
+}  // namespace lve
@@ -0,0 +1,4 @@
+#version 450
+
+// depth only, there are no colour attachments to write
+void main() {}
@@ -0,0 +1,22 @@
+#version 450
+
+// Depth prepass: only the position is read. gl_Position is computed exactly like in
+// simple_shader.vert, both invariant, so the main pass can test with EQUAL.
+layout(location = 0) in vec3 position;
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+  mat4 projection;
+  mat4 view;
+} ubo;
+
+// the start of simple_shader.vert's block, the prepass only pushes the model matrix
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+} push;
+
+invariant gl_Position;
+
+void main() {
+  vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
+  gl_Position = ubo.projection * ubo.view * positionWorld;
+}
@@ -1,4 +1,5 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout (location = 0) in vec3 fragColor;
 layout (location = 1) in vec3 fragPosWorld;
@@ -21,13 +22,56 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   int numLights;
 } ubo;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+// Permutation constants, set per pipeline by SimpleRenderSystem. MAX_LIGHT_COUNT is the light
+// count bucket, a bound the compiler can unroll against; the defaults are the full permutation.
+layout(constant_id = 0) const int MAX_LIGHT_COUNT = 10;
+layout(constant_id = 1) const bool TEXTURED = true;
+layout(constant_id = 2) const bool VERTEX_COLOR = true;
 
+// bindless texture table, see LveBindlessTextures
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// same block as simple_shader.vert, vtIndirection > 0 selects the virtual texture
 layout(push_constant) uniform Push {
   mat4 modelMatrix;
-  mat4 normalMatrix;
+  uint textureIndex;
+  // LveVirtualTexture::getShaderParams, vtIndirection is the bindless slot + 1 and 0 without one
+  uint vtIndirection;
+  uint vtAtlas;
+  float vtWidth;
+  float vtHeight;
+  float vtBorderSize;
+  float vtPageSize;
 } push;
 
+// Virtual texture lookup. The indirection texel of the wanted page names the atlas page holding it
+// or a coarser ancestor.
+vec4 sampleVirtualTexture(vec2 uv) {
+  uint indirectionIndex = push.vtIndirection - 1u;
+  uint atlasIndex = push.vtAtlas;
+  vec2 size = vec2(push.vtWidth, push.vtHeight);
+  float borderSize = push.vtBorderSize;
+  float pageSize = push.vtPageSize;
+
+  // the level a regular mipmapped texture would pick for this footprint
+  vec2 texel = uv * size;
+  vec2 dx = dFdx(texel);
+  vec2 dy = dFdy(texel);
+  float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+  int maxLevel = textureQueryLevels(textures[indirectionIndex]) - 1;
+  int level = clamp(int(floor(lod)), 0, maxLevel);
+
+  vec2 wrapped = fract(uv);
+  vec2 levelSize = max(floor(size / exp2(float(level))), vec2(1.0));
+  ivec2 page = ivec2(wrapped * levelSize / pageSize);
+  vec3 entry = floor(texelFetch(textures[indirectionIndex], page, level).rgb * 255.0 + 0.5);
+
+  vec2 mappedSize = max(floor(size / exp2(entry.b)), vec2(1.0));
+  vec2 inPage = mod(wrapped * mappedSize, pageSize);
+  vec2 atlasTexel = entry.rg * (pageSize + 2.0 * borderSize) + borderSize + inPage;
+  return textureLod(textures[atlasIndex], atlasTexel / vec2(textureSize(textures[atlasIndex], 0)), 0.0);
+}
+
 void main() {
   vec3 diffuseLight = ubo.ambientLightColor.xyz * ubo.ambientLightColor.w;
   vec3 specularLight = vec3(0.0);
@@ -36,7 +80,8 @@ void main() {
   vec3 cameraPositionWorld = ubo.inverseView[3].xyz;
   vec3 viewDirection = normalize(cameraPositionWorld - fragPosWorld);
 
-  for(int i = 0; i < ubo.numLights; i++) {
+  for(int i = 0; i < MAX_LIGHT_COUNT; i++) {
+    if (i >= ubo.numLights) break;
     PointLight light = ubo.pointLights[i];
     vec3 directionToLight = light.position.xyz - fragPosWorld ;
     vec3 lightColor = light.color.xyz * light.color.w;
@@ -55,8 +100,13 @@ void main() {
     specularLight += intensity * blinnTerm;
   }
 	//outColor = vec4(diffuseLight * fragColor + specularLight * fragColor, 1.0);
-	vec4 texColor = texture(texSampler, fragUV);
-  vec3 base = fragColor * texColor.rgb;     // 顶点色与纹理色混合 (可按需调整)
+	vec4 texColor = vec4(1.0);
+	if (TEXTURED) {
+	  texColor = push.vtIndirection > 0u ? sampleVirtualTexture(fragUV)
+	                                     : texture(textures[push.textureIndex], fragUV);
+	}
+  vec3 vertexColor = VERTEX_COLOR ? fragColor : vec3(1.0);
+  vec3 base = vertexColor * texColor.rgb;     // 顶点色与纹理色混合 (可按需调整)
   vec3 lighting = diffuseLight * base + specularLight * base;
   outColor = vec4(lighting, texColor.a);
 }
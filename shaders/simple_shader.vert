@@ -24,15 +24,28 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
   int numLights;
 } ubo;
 
+// SimplePushConstantData
 layout(push_constant) uniform Push {
   mat4 modelMatrix;
-  mat4 normalMatrix;
+  uint textureIndex;
+  // LveVirtualTexture::getShaderParams, vtIndirection is the bindless slot + 1 and 0 without one
+  uint vtIndirection;
+  uint vtAtlas;
+  float vtWidth;
+  float vtHeight;
+  float vtBorderSize;
+  float vtPageSize;
 } push;
 
+// the depth prepass (depth_only.vert) has to produce the exact same depth for EQUAL tests
+invariant gl_Position;
+
 void main() {
   vec4 positionWorld = push.modelMatrix * vec4(position, 1.0);
   gl_Position = ubo.projection * ubo.view * positionWorld;
-  fragNormalWorld = normalize(mat3(push.normalMatrix) * normal);
+  // derived here rather than pushed, which leaves room in the block for the texture slots
+  mat3 normalMatrix = transpose(inverse(mat3(push.modelMatrix)));
+  fragNormalWorld = normalize(normalMatrix * normal);
   fragPosWorld = positionWorld.xyz;
   fragColor = color;
 	fragUV = uv;
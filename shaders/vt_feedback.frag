@@ -0,0 +1,51 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout (location = 3) in vec2 fragUV;
+
+// page id, see packVirtualPageId in lve_virtual_texture_file.hpp
+layout (location = 0) out uint outPage;
+
+// bindless texture table, see LveBindlessTextures
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+// same block as simple_shader.frag
+layout(push_constant) uniform Push {
+  mat4 modelMatrix;
+  uint textureIndex;
+  // LveVirtualTexture::getShaderParams, vtIndirection is the bindless slot + 1 and 0 without one
+  uint vtIndirection;
+  uint vtAtlas;
+  float vtWidth;
+  float vtHeight;
+  float vtBorderSize;
+  float vtPageSize;
+} push;
+
+// the target is a quarter of the frame size (VirtualTextureFeedbackSystem::FEEDBACK_SCALE), so
+// the footprint is four times that of the main pass
+const float FEEDBACK_LOD_BIAS = -2.0;
+const uint PAGE_NONE = 0xffffffffu;
+
+void main() {
+  // objects without the virtual texture still write, they hide what is behind them
+  if (push.vtIndirection == 0u) {
+    outPage = PAGE_NONE;
+    return;
+  }
+  uint indirectionIndex = push.vtIndirection - 1u;
+  vec2 size = vec2(push.vtWidth, push.vtHeight);
+  float pageSize = push.vtPageSize;
+
+  // same level choice as sampleVirtualTexture in simple_shader.frag
+  vec2 texel = fragUV * size;
+  vec2 dx = dFdx(texel);
+  vec2 dy = dFdy(texel);
+  float lod = 0.5 * log2(max(dot(dx, dx), dot(dy, dy))) + FEEDBACK_LOD_BIAS;
+  int maxLevel = textureQueryLevels(textures[indirectionIndex]) - 1;
+  int level = clamp(int(floor(lod)), 0, maxLevel);
+
+  vec2 levelSize = max(floor(size / exp2(float(level))), vec2(1.0));
+  uvec2 page = uvec2(fract(fragUV) * levelSize / pageSize);
+  outPage = uint(level) << 28 | page.y << 14 | page.x;
+}
@@ -3,9 +3,12 @@
 #include "keyboard_movement.hpp"
 #include "lve_camera.hpp"
 #include "lve_buffer.hpp"
+#include "lve_pipeline_registry.hpp"
+#include "lve_render_graph.hpp"
 #include "systems/simple_render_system.hpp"
 #include "systems/point_light_system.hpp"
 #include "systems/skybox_system.hpp"
+#include "systems/virtual_texture_feedback_system.hpp"
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -16,22 +19,31 @@
 #include <array>
 #include <chrono>
 #include <cassert>
+#include <fstream>
+#include <iostream>
 #include <stdexcept>
 
 #define LIGHT_DIRECTION glm::vec3(1.0, -3.0, -1.0);
 
 namespace lve {
   FirstApp::FirstApp() {
-    globalPool = LveDescriptorPool::Builder(lveDevice)
-      .setMaxSets(2)
-      .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-      .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-      .build();
-
-		materialPool = LveDescriptorPool::Builder(lveDevice)
-		.setMaxSets(64)
-		.addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, LveSwapChain::MAX_FRAMES_IN_FLIGHT)
-		.build();
+    //descriptor set 按 layout 分池, 池满时自动新建更大的池, 不需要手动估算池大小
+    descriptorAllocator = std::make_unique<LveDescriptorAllocator>(lveDevice);
+    //内容相同的 set 只分配一次
+    descriptorSetCache = std::make_unique<LveDescriptorSetCache>(*descriptorAllocator);
+
+		//全局 bindless 纹理表, slot 0 是默认纹理; 流式加载的纹理开始只有小 mip 常驻
+		defaultTexture_ = std::make_shared<LveTexture>(lveDevice, "textures/white.png", &threadPool);
+		bindlessTextures = std::make_unique<LveBindlessTextures>(lveDevice, defaultTexture_);
+		textureStreamer = std::make_unique<LveTextureStreamer>(
+			lveDevice, *bindlessTextures, static_cast<uint32_t>(lveRenderer.getFramesInFlight()),
+			TEXTURE_BUDGET_BYTES, &threadPool);
+		//虚拟纹理: cook_textures 目标生成 textures/test.lvt, 没有时地板只用默认贴图
+		if (std::ifstream{"textures/test.lvt"}.good()) {
+			virtualTexture = std::make_shared<LveVirtualTexture>(
+				lveDevice, *bindlessTextures, static_cast<uint32_t>(lveRenderer.getFramesInFlight()),
+				"textures/test.lvt", threadPool);
+		}
 
 		loadGameObjects();
   }
@@ -39,7 +51,7 @@ namespace lve {
   FirstApp::~FirstApp() {}
 
   void FirstApp::run() {
-    std::vector<std::unique_ptr<LveBuffer>> uboBuffers(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
+    std::vector<std::unique_ptr<LveBuffer>> uboBuffers(lveRenderer.getFramesInFlight());
     for (int i = 0; i < uboBuffers.size(); i++) {
       uboBuffers[i] = std::make_unique<LveBuffer>(
         lveDevice,
@@ -49,74 +61,131 @@ namespace lve {
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
         uboBuffers[i]->map();
     }
-		//set 0
-    auto globalSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
-      .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_ALL_GRAPHICS)
-      .build();
+		//set 0: 每帧的 UBO, 支持 VK_KHR_push_descriptor 时直接 push 进 command buffer
+    LvePushDescriptorSet globalDescriptor{
+        lveDevice, {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER}, VK_SHADER_STAGE_ALL_GRAPHICS,
+        layoutCache, *descriptorSetCache};
+    std::vector<std::vector<LveDescriptorResource>> globalResources(uboBuffers.size());
+    for (int i = 0; i < uboBuffers.size(); i++) {
+      globalResources[i] = {LveDescriptorResource::fromBuffer(uboBuffers[i]->descriptorInfo())};
+    }
 
-		//set 1
-		auto materialSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
+		//set 1: 天空盒 cubemap
+		auto cubemapSetLayout = LveDescriptorSetLayout::Builder(lveDevice)
 			.addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT)
-      .build();
+      .build(layoutCache);
 
+		//set 1: 全局 bindless 纹理表
 		for (auto& kv : gameObjects) {
 		auto& obj = kv.second;
 			if (obj.material) {
-				obj.material->buildDescriptor(*materialSetLayout, *materialPool);
+				obj.material->registerTextures(*bindlessTextures);
 			}
 		}
+		//所有 set 的写入攒到一起, 一次 vkUpdateDescriptorSets
+		LveDescriptorUpdateBatch descriptorUpdates{lveDevice};
 		//up -y, right x , forward z
 		VkDescriptorSet skyboxSet{VK_NULL_HANDLE};
 		{
-			// +X -X +Y -Y +Z -Z 的图片文件
-			std::array<std::string, 6> faces = {
-				"textures/skybox/Outer_space_x_pos.png",  // +X
-				"textures/skybox/Outer_space_x_neg.png",   // -X
-				"textures/skybox/bottom.png",    // +Y
-				"textures/skybox/top.png", // -Y
-				"textures/skybox/Outer_space_z_pos.png",  // +Z
-				"textures/skybox/Outer_space_z_neg.png"    // -Z
-			};
-			skyboxTexture_ = std::make_shared<LveTexture>(lveDevice, faces); // 保持生命周期
+			//cook_textures 目标把六个面烘焙成 textures/skybox.ktx2 (BC7 cubemap, 带 mip), 没有时读各面的图片
+			if (std::ifstream{"textures/skybox.ktx2"}.good()) {
+				skyboxTexture_ = std::make_shared<LveTexture>(lveDevice, "textures/skybox.ktx2", &threadPool); // 保持生命周期
+			} else {
+				// +X -X +Y -Y +Z -Z 的图片文件
+				std::array<std::string, 6> faces = {
+					"textures/skybox/Outer_space_x_pos.png",  // +X
+					"textures/skybox/Outer_space_x_neg.png",   // -X
+					"textures/skybox/bottom.png",    // +Y
+					"textures/skybox/top.png", // -Y
+					"textures/skybox/Outer_space_z_pos.png",  // +Z
+					"textures/skybox/Outer_space_z_neg.png"    // -Z
+				};
+				skyboxTexture_ = std::make_shared<LveTexture>(lveDevice, faces, &threadPool); // 保持生命周期
+			}
 			auto imgInfo = skyboxTexture_->descriptorInfo();
-			LveDescriptorWriter(*materialSetLayout, *materialPool)
-				.writeImage(0, &imgInfo)
-				.build(skyboxSet);
+			descriptorSetCache->getDescriptor(
+				LveDescriptorWriter(*cubemapSetLayout).writeImage(0, &imgInfo),
+				skyboxSet, &descriptorUpdates);
 		}
-
-		// 构建一个默认材质集
-		VkDescriptorSet defaultMaterialSet{VK_NULL_HANDLE};
-		auto defaultTex = std::make_shared<LveTexture>(lveDevice, "textures/white.png");
-		auto imgInfo = defaultTex->descriptorInfo();
-		LveDescriptorWriter(*materialSetLayout, *materialPool)
-			.writeImage(0, &imgInfo)
-			.build(defaultMaterialSet);
-		defaultTexture_ = defaultTex;
-
-    std::vector<VkDescriptorSet> globalDescriptorSets(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-    for(int i = 0; i < globalDescriptorSets.size(); i++){
-      auto bufferInfo = uboBuffers[i]->descriptorInfo();
-      LveDescriptorWriter(*globalSetLayout, *globalPool)
-      .writeBuffer(0, &bufferInfo)
-      .build(globalDescriptorSets[i]);
+    descriptorUpdates.flush();
+
+    //render graph: 交换链图像从外部导入, 深度是图内的临时图像; 只在配置或分辨率变化时重新编译
+    LveRenderGraph renderGraph{lveDevice, static_cast<uint32_t>(lveRenderer.getFramesInFlight())};
+    auto backbuffer = renderGraph.importImage(
+        "backbuffer", lveRenderer.getSwapChainImageFormat(),
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    auto sceneDepth = renderGraph.createImage("depth", lveRenderer.getSwapChainDepthFormat());
+    //深度预pass: 先只写不透明物体的深度, 主 pass 再以 EQUAL 测试, 每个像素只着色一次
+    auto prepassMode = SimpleRenderSystem::depthPrepassModeFromEnvironment();
+    LveRenderGraph::PassHandle depthPrepass = 0;
+    if (prepassMode != SimpleRenderSystem::DepthPrepassMode::Off) {
+      depthPrepass = renderGraph.addPass("depth prepass");
+      renderGraph.clearDepth(depthPrepass, sceneDepth, {1.0f, 0});
+      renderGraph.setSecondaryContents(depthPrepass);
     }
+    auto mainPass = renderGraph.addPass("main");
+    renderGraph.clearColor(mainPass, backbuffer, {{0.01f, 0.01f, 0.01f, 1.0f}});
+    if (prepassMode != SimpleRenderSystem::DepthPrepassMode::Off) {
+      renderGraph.writeDepth(mainPass, sceneDepth);
+    } else {
+      renderGraph.clearDepth(mainPass, sceneDepth, {1.0f, 0});
+    }
+    renderGraph.setSecondaryContents(mainPass);
+    LveRenderTargetFormat mainTargetFormat = renderGraph.getTargetFormat(mainPass);
 
     SkyboxRenderSystem skyboxRenderSystem{
-        lveDevice, lveRenderer.getSwapChainRenderPass(),
-        globalSetLayout->getDescriptorSetLayout(),
-        materialSetLayout->getDescriptorSetLayout(),
-        skyboxSet
+        lveDevice, mainTargetFormat,
+        globalDescriptor,
+        cubemapSetLayout->getDescriptorSetLayout(),
+        skyboxSet,
+        &threadPool
     };
 
     SimpleRenderSystem simpleRenderSystem{
-        lveDevice, lveRenderer.getSwapChainRenderPass(),
-        globalSetLayout->getDescriptorSetLayout(),
-        materialSetLayout->getDescriptorSetLayout(),
-				defaultMaterialSet};
+        lveDevice, mainTargetFormat,
+        globalDescriptor,
+        bindlessTextures->getDescriptorSetLayout(),
+				bindlessTextures->getDescriptorSet(),
+        &threadPool};
+    if (prepassMode != SimpleRenderSystem::DepthPrepassMode::Off) {
+      simpleRenderSystem.enableDepthPrepass(renderGraph.getTargetFormat(depthPrepass), prepassMode);
+      //auto 模式下估计的 overdraw 不够高时这个 pass 只清深度
+      renderGraph.setRecord(depthPrepass, [&](FrameInfo& frameInfo, const LveSecondaryInheritance& inheritance) {
+        LveSecondaryCommands secondaryCommands{
+          lveDevice, lveRenderer.getFrameCommandPools(), frameInfo.frameIndex, inheritance};
+        simpleRenderSystem.renderDepthPrepass(frameInfo, &secondaryCommands);
+        secondaryCommands.execute(frameInfo.commandBuffer);
+      });
+    }
+
+    //按页请求虚拟纹理的 feedback pass, 1/4 分辨率
+    std::unique_ptr<VirtualTextureFeedbackSystem> feedbackSystem;
+    if (virtualTexture) {
+      feedbackSystem = std::make_unique<VirtualTextureFeedbackSystem>(
+          lveDevice, *virtualTexture, static_cast<uint32_t>(lveRenderer.getFramesInFlight()),
+          globalDescriptor,
+          bindlessTextures->getDescriptorSetLayout(),
+          bindlessTextures->getDescriptorSet(),
+          &threadPool);
+    }
 
     PointLightSystem pointLightSystem{
-        lveDevice, lveRenderer.getSwapChainRenderPass(),
-        globalSetLayout->getDescriptorSetLayout()};
+        lveDevice, mainTargetFormat,
+        globalDescriptor,
+        &threadPool};
+
+    //pass 里的内容都录进 secondary command buffer, 物体分块在线程池上并行录制, 按预留顺序执行
+    renderGraph.setRecord(mainPass, [&](FrameInfo& frameInfo, const LveSecondaryInheritance& inheritance) {
+      LveSecondaryCommands secondaryCommands{
+        lveDevice, lveRenderer.getFrameCommandPools(), frameInfo.frameIndex, inheritance};
+      secondaryCommands.record(frameInfo, [&](FrameInfo& info) { skyboxRenderSystem.renderSkybox(info); });
+      simpleRenderSystem.renderGameObjects(frameInfo, &secondaryCommands);
+      secondaryCommands.record(frameInfo, [&](FrameInfo& info) { pointLightSystem.render(info); });
+      secondaryCommands.execute(frameInfo.commandBuffer);
+    });
+    //pipeline 在线程池里并行编译, 编译完之前对应的系统跳过绘制; 全部编译完后释放 shader module
+    //(SimpleRenderSystem 已在构造时请求全部 permutation, 之后录制时不会再读取 shader 文件)
+    lveDevice.pipelineRegistry().releaseShaderModules();
     LveCamera camera{};
 
     auto viewObject = LveGameObject::CreateGameObject();
@@ -124,6 +193,8 @@ namespace lve {
     KeyboardMovementController cameraController{};
 
     auto currentTime = std::chrono::high_resolution_clock::now();
+    //每隔几秒输出帧时间分位数、卡顿次数以及瓶颈在 CPU / GPU / 呈现
+    float statsElapsed = 0.f;
 
     while (!lveWindow.shouldClose()) {
       glfwPollEvents();
@@ -135,6 +206,11 @@ namespace lve {
       auto newTime = std::chrono::high_resolution_clock::now();
       float frameTime = std::chrono::duration<float, std::chrono::seconds::period>(newTime - currentTime).count();
       currentTime = newTime;
+      statsElapsed += frameTime;
+      if (statsElapsed >= FRAME_STATS_INTERVAL && lveRenderer.getFrameStats().frameCount() > 0) {
+        std::cout << lveRenderer.getFrameStats().report() << std::endl;
+        statsElapsed = 0.f;
+      }
 
       //frameTime = std::min(frameTime, MAX_FRAME_TIME);
 
@@ -146,14 +222,24 @@ namespace lve {
       camera.setPerspectiveProjection(glm::radians(50.0f), aspect, 0.1f, 1000.f);
       if (auto commandBuffer = lveRenderer.beginFrame()) {
         int frameIndex = lveRenderer.getFrameIndex();
+        globalDescriptor.setResources(globalResources[frameIndex]);
+        LveDynamicStateTracker dynamicState{lveDevice, commandBuffer};
         FrameInfo frameInfo{
           frameIndex,
           frameTime,
           commandBuffer,
           camera,
-          globalDescriptorSets[frameIndex],
-          gameObjects
+          globalDescriptor,
+          gameObjects,
+          dynamicState
         };
+        //按屏幕上需要的精度调入/换出纹理 mip, 必须在录制绘制之前
+        textureStreamer->update(frameInfo, lveWindow.getExtent());
+        //虚拟纹理: 先把读回的页上传到 atlas, 再录制这一帧的 feedback pass
+        if (virtualTexture) {
+          virtualTexture->recordUpdates(commandBuffer, frameIndex);
+          feedbackSystem->render(frameInfo, lveWindow.getExtent());
+        }
         //update
         GlobalUbo ubo{};
         ubo.projection = camera.getProjectionMatrix();
@@ -163,23 +249,27 @@ namespace lve {
         uboBuffers[frameIndex]->writeToBuffer(&ubo);
         uboBuffers[frameIndex]->flush();
         //render
-        lveRenderer.beginSwapChainRenderPass(commandBuffer);
-
-        skyboxRenderSystem.renderSkybox(frameInfo);
-        simpleRenderSystem.renderGameObjects(frameInfo);
-        pointLightSystem.render(frameInfo);
-
-        lveRenderer.endSwapChainRenderPass(commandBuffer);
+        simpleRenderSystem.collectDraws(frameInfo);
+        renderGraph.compile(lveRenderer.getSwapChainExtent());
+        renderGraph.bindImage(
+          backbuffer, lveRenderer.getSwapChainImage(), lveRenderer.getSwapChainImageView(),
+          lveRenderer.getSwapChainGeneration());
+        renderGraph.execute(frameInfo);
         lveRenderer.endFrame();
       }
     }
 
     vkDeviceWaitIdle(lveDevice.device());
+    //缓存按句柄查找, UBO 销毁前先移除引用它们的 set
+    for (auto& uboBuffer : uboBuffers) {
+      descriptorSetCache->releaseBuffer(uboBuffer->getBuffer());
+    }
   }
 
   void FirstApp::loadGameObjects() {
-		auto texA = std::make_shared<LveTexture>(lveDevice, "textures/test.png");
-		auto texB = std::make_shared<LveTexture>(lveDevice, "textures/black.png");
+		auto textures = textureStreamer->loadTextures({"textures/test.png", "textures/black.png"});
+		auto texA = textures[0];
+		auto texB = textures[1];
 		auto blackmtl = std::make_shared<LveMaterial>();
 		auto mtlB = std::make_shared<LveMaterial>();
 		mtlB->SetTexture(texA);
@@ -227,6 +317,11 @@ namespace lve {
     lveModel = LveModel::createModelFromFile(lveDevice, "models/quad.obj");
     auto quad_floor = LveGameObject::CreateGameObject();
     quad_floor.model = lveModel;
+    if (virtualTexture) {
+      auto floorMaterial = std::make_shared<LveMaterial>();
+      floorMaterial->SetVirtualTexture(virtualTexture);
+      quad_floor.material = floorMaterial;
+    }
     quad_floor.transform.translation = {.5f, .5f, 0};
     quad_floor.transform.scale = {3.f, 1.5f, 3.f};
     gameObjects.emplace(quad_floor.GetId(), std::move(quad_floor));
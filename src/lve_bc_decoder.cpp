@@ -0,0 +1,368 @@
+#include "lve_bc_decoder.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+// bit i set when texel i belongs to the second subset
+const uint16_t BC7_PARTITIONS_2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80,
+    0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000, 0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310,
+    0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c, 0xaaaa,
+    0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc,
+    0x6996, 0xc33c, 0x9966, 0x0660, 0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6,
+    0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22};
+
+const uint8_t BC7_PARTITIONS_3[64][16] = {
+    {0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 1, 2, 2, 2, 2}, {0, 0, 0, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 2, 0, 0, 1, 2, 2, 1, 1, 2, 2, 1, 1}, {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 1, 0, 1, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 2, 2},
+    {0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1, 1, 1, 1, 1}, {0, 0, 1, 1, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1},
+    {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2}, {0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2},
+    {0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2, 0, 1, 1, 2}, {0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2, 0, 1, 2, 2},
+    {0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2, 1, 2, 2, 2}, {0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0, 2, 2, 2, 0},
+    {0, 0, 0, 1, 0, 0, 1, 1, 0, 1, 1, 2, 1, 1, 2, 2}, {0, 1, 1, 1, 0, 0, 1, 1, 2, 0, 0, 1, 2, 2, 0, 0},
+    {0, 0, 0, 0, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2}, {0, 0, 2, 2, 0, 0, 2, 2, 0, 0, 2, 2, 1, 1, 1, 1},
+    {0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2, 0, 2, 2, 2}, {0, 0, 0, 1, 0, 0, 0, 1, 2, 2, 2, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2}, {0, 0, 0, 0, 1, 1, 0, 0, 2, 2, 1, 0, 2, 2, 1, 0},
+    {0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1, 0, 0, 0, 0}, {0, 0, 1, 2, 0, 0, 1, 2, 1, 1, 2, 2, 2, 2, 2, 2},
+    {0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1, 0, 1, 1, 0}, {0, 0, 0, 0, 0, 1, 1, 0, 1, 2, 2, 1, 1, 2, 2, 1},
+    {0, 0, 2, 2, 1, 1, 0, 2, 1, 1, 0, 2, 0, 0, 2, 2}, {0, 1, 1, 0, 0, 1, 1, 0, 2, 0, 0, 2, 2, 2, 2, 2},
+    {0, 0, 1, 1, 0, 1, 2, 2, 0, 1, 2, 2, 0, 0, 1, 1}, {0, 0, 0, 0, 2, 0, 0, 0, 2, 2, 1, 1, 2, 2, 2, 1},
+    {0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 2, 2, 2}, {0, 2, 2, 2, 0, 0, 2, 2, 0, 0, 1, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 0, 0, 1, 2, 0, 0, 2, 2, 0, 2, 2, 2}, {0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0, 0, 1, 2, 0},
+    {0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0}, {0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2, 0},
+    {0, 1, 2, 0, 2, 0, 1, 2, 1, 2, 0, 1, 0, 1, 2, 0}, {0, 0, 1, 1, 2, 2, 0, 0, 1, 1, 2, 2, 0, 0, 1, 1},
+    {0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 0, 0, 0, 0, 1, 1}, {0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2},
+    {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1}, {0, 0, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2, 1, 1, 2, 2},
+    {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 2, 2, 0, 0, 1, 1}, {0, 2, 2, 0, 1, 2, 2, 1, 0, 2, 2, 0, 1, 2, 2, 1},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 0, 1, 0, 1}, {0, 0, 0, 0, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1, 2, 1},
+    {0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 2, 2, 2, 2}, {0, 2, 2, 2, 0, 1, 1, 1, 0, 2, 2, 2, 0, 1, 1, 1},
+    {0, 0, 0, 2, 1, 1, 1, 2, 0, 0, 0, 2, 1, 1, 1, 2}, {0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 2, 2, 2, 0, 1, 1, 1, 0, 1, 1, 1, 0, 2, 2, 2}, {0, 0, 0, 2, 1, 1, 1, 2, 1, 1, 1, 2, 0, 0, 0, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2, 2, 1, 1, 2},
+    {0, 1, 1, 0, 0, 1, 1, 0, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 0, 2, 2, 0, 0, 1, 1, 0, 0, 1, 1, 0, 0, 2, 2},
+    {0, 0, 2, 2, 1, 1, 2, 2, 1, 1, 2, 2, 0, 0, 2, 2}, {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 1, 1, 2},
+    {0, 0, 0, 2, 0, 0, 0, 1, 0, 0, 0, 2, 0, 0, 0, 1}, {0, 2, 2, 2, 1, 2, 2, 2, 0, 2, 2, 2, 1, 2, 2, 2},
+    {0, 1, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2}, {0, 1, 1, 1, 2, 0, 1, 1, 2, 2, 0, 1, 2, 2, 2, 0}};
+
+// index of the anchor texel of the second (and third) subset, texel 0 anchors the first one
+const uint8_t BC7_ANCHOR_2[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 2,  8,  2,  2,  8,
+    8,  15, 2,  8,  2,  2,  8,  8,  2,  2,  15, 15, 6,  8,  2,  8,  15, 15, 2,  8,  2,  2,
+    2,  15, 15, 6,  6,  2,  6,  8,  15, 15, 2,  2,  15, 15, 15, 15, 15, 2,  2,  15};
+
+const uint8_t BC7_ANCHOR_3A[64] = {
+    3,  3,  15, 15, 8,  3,  15, 15, 8,  8,  6,  6,  6,  5,  3,  3,  3,  3,  8,  15, 3,  3,
+    6,  10, 5,  8,  8,  6,  8,  5,  15, 15, 8,  15, 3,  5,  6,  10, 8,  15, 15, 3,  15, 5,
+    15, 15, 15, 15, 3,  15, 5,  5,  5,  8,  5,  10, 5,  10, 8,  13, 15, 12, 3,  3};
+
+const uint8_t BC7_ANCHOR_3B[64] = {
+    15, 8,  8,  3,  15, 15, 3,  8,  15, 15, 15, 15, 15, 15, 15, 8,  15, 8,  15, 3,  15, 8,
+    15, 8,  3,  15, 6,  10, 15, 15, 10, 8,  15, 3,  15, 10, 10, 8,  9,  10, 6,  15, 8,  15,
+    3,  6,  6,  8,  15, 3,  15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 3,  15, 15, 8};
+
+const uint8_t BC7_WEIGHTS_2[4] = {0, 21, 43, 64};
+const uint8_t BC7_WEIGHTS_3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+const uint8_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct Bc7ModeInfo {
+  uint8_t subsets;
+  uint8_t partitionBits;
+  uint8_t rotationBits;
+  uint8_t indexSelectionBits;
+  uint8_t colorBits;
+  uint8_t alphaBits;
+  uint8_t endpointPBits;
+  uint8_t sharedPBits;
+  uint8_t indexBits;
+  uint8_t indexBits2;
+};
+
+const Bc7ModeInfo BC7_MODES[8] = {
+    {3, 4, 0, 0, 4, 0, 1, 0, 3, 0},
+    {2, 6, 0, 0, 6, 0, 0, 1, 3, 0},
+    {3, 6, 0, 0, 5, 0, 0, 0, 2, 0},
+    {2, 6, 0, 0, 7, 0, 1, 0, 2, 0},
+    {1, 0, 2, 1, 5, 6, 0, 0, 2, 3},
+    {1, 0, 2, 0, 7, 8, 0, 0, 2, 2},
+    {1, 0, 0, 0, 7, 7, 1, 0, 4, 0},
+    {2, 6, 0, 0, 5, 5, 1, 0, 2, 0}};
+
+class BitReader {
+ public:
+  explicit BitReader(const uint8_t *data) : data{data} {}
+
+  uint32_t read(uint32_t count) {
+    uint32_t value = 0;
+    for (uint32_t i = 0; i < count; i++, position++) {
+      value |= static_cast<uint32_t>((data[position >> 3] >> (position & 7)) & 1) << i;
+    }
+    return value;
+  }
+
+ private:
+  const uint8_t *data;
+  uint32_t position = 0;
+};
+
+inline uint8_t interpolate(uint8_t e0, uint8_t e1, uint8_t weight) {
+  return static_cast<uint8_t>(((64 - weight) * e0 + weight * e1 + 32) >> 6);
+}
+
+const uint8_t *weightsFor(uint32_t indexBits) {
+  return indexBits == 2 ? BC7_WEIGHTS_2 : indexBits == 3 ? BC7_WEIGHTS_3 : BC7_WEIGHTS_4;
+}
+
+inline uint8_t expandBits(uint32_t value, uint32_t bits) {
+  value <<= 8 - bits;
+  return static_cast<uint8_t>(value | (value >> bits));
+}
+
+void decodeColor565(uint16_t packed, uint8_t *rgb) {
+  rgb[0] = static_cast<uint8_t>(((packed >> 11) & 31) * 255 / 31);
+  rgb[1] = static_cast<uint8_t>(((packed >> 5) & 63) * 255 / 63);
+  rgb[2] = static_cast<uint8_t>((packed & 31) * 255 / 31);
+}
+
+// BC3/BC4/BC5 share this 8 byte block, writes texels with the given stride
+void decodeAlphaBlock(const uint8_t *block, uint8_t *out, size_t stride, bool isSigned) {
+  int palette[8];
+  int a0 = isSigned ? std::max<int>(static_cast<int8_t>(block[0]), -127) : block[0];
+  int a1 = isSigned ? std::max<int>(static_cast<int8_t>(block[1]), -127) : block[1];
+  palette[0] = a0;
+  palette[1] = a1;
+  if (a0 > a1) {
+    for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+  } else {
+    for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+    palette[6] = isSigned ? -127 : 0;
+    palette[7] = isSigned ? 127 : 255;
+  }
+
+  uint64_t indices = 0;
+  for (int i = 0; i < 6; i++) indices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+  for (int i = 0; i < 16; i++) {
+    int value = palette[(indices >> (3 * i)) & 7];
+    out[i * stride] = static_cast<uint8_t>(isSigned ? static_cast<int8_t>(value) : value);
+  }
+}
+
+}  // namespace
+
+void decodeBC1Block(const uint8_t *block, uint8_t *out, bool allowTransparent) {
+  uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+  uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+  uint8_t palette[4][4];
+  decodeColor565(c0, palette[0]);
+  decodeColor565(c1, palette[1]);
+  palette[0][3] = palette[1][3] = palette[2][3] = palette[3][3] = 255;
+  for (int c = 0; c < 3; c++) {
+    if (c0 > c1) {
+      palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+      palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+    } else {
+      palette[2][c] = static_cast<uint8_t>((palette[0][c] + palette[1][c]) / 2);
+      palette[3][c] = 0;
+    }
+  }
+  if (c0 <= c1 && allowTransparent) palette[3][3] = 0;
+
+  uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+  for (int i = 0; i < 16; i++) {
+    memcpy(out + 4 * i, palette[(indices >> (2 * i)) & 3], 4);
+  }
+}
+
+void decodeBC3Block(const uint8_t *block, uint8_t *out) {
+  // the colour half of a BC3 block always uses four colours
+  uint16_t c0 = static_cast<uint16_t>(block[8] | (block[9] << 8));
+  uint16_t c1 = static_cast<uint16_t>(block[10] | (block[11] << 8));
+  uint8_t palette[4][3];
+  decodeColor565(c0, palette[0]);
+  decodeColor565(c1, palette[1]);
+  for (int c = 0; c < 3; c++) {
+    palette[2][c] = static_cast<uint8_t>((2 * palette[0][c] + palette[1][c]) / 3);
+    palette[3][c] = static_cast<uint8_t>((palette[0][c] + 2 * palette[1][c]) / 3);
+  }
+  uint32_t indices =
+      block[12] | (block[13] << 8) | (block[14] << 16) | (static_cast<uint32_t>(block[15]) << 24);
+  for (int i = 0; i < 16; i++) {
+    memcpy(out + 4 * i, palette[(indices >> (2 * i)) & 3], 3);
+  }
+  decodeAlphaBlock(block, out + 3, 4, false);
+}
+
+void decodeBC4Block(const uint8_t *block, uint8_t *out, bool isSigned) {
+  decodeAlphaBlock(block, out, 4, isSigned);
+  for (int i = 0; i < 16; i++) {
+    out[4 * i + 1] = out[4 * i + 2] = 0;
+    out[4 * i + 3] = isSigned ? 127 : 255;
+  }
+}
+
+void decodeBC5Block(const uint8_t *block, uint8_t *out, bool isSigned) {
+  decodeAlphaBlock(block, out, 4, isSigned);
+  decodeAlphaBlock(block + 8, out + 1, 4, isSigned);
+  for (int i = 0; i < 16; i++) {
+    out[4 * i + 2] = 0;
+    out[4 * i + 3] = isSigned ? 127 : 255;
+  }
+}
+
+void decodeBC7Block(const uint8_t *block, uint8_t *out) {
+  uint32_t mode = 0;
+  while (mode < 8 && !(block[0] & (1 << mode))) mode++;
+  if (mode == 8) {
+    // reserved mode, the spec decodes it to transparent black
+    memset(out, 0, 64);
+    return;
+  }
+
+  const Bc7ModeInfo &info = BC7_MODES[mode];
+  BitReader bits{block};
+  bits.read(mode + 1);
+  uint32_t partition = bits.read(info.partitionBits);
+  uint32_t rotation = bits.read(info.rotationBits);
+  uint32_t indexSelection = bits.read(info.indexSelectionBits);
+
+  uint8_t endpoints[6][4] = {};
+  uint32_t endpointCount = info.subsets * 2u;
+  for (uint32_t c = 0; c < 3; c++) {
+    for (uint32_t e = 0; e < endpointCount; e++) endpoints[e][c] = static_cast<uint8_t>(bits.read(info.colorBits));
+  }
+  for (uint32_t e = 0; e < endpointCount; e++) {
+    endpoints[e][3] = static_cast<uint8_t>(info.alphaBits ? bits.read(info.alphaBits) : 255);
+  }
+
+  uint32_t colorBits = info.colorBits;
+  uint32_t alphaBits = info.alphaBits;
+  if (info.endpointPBits || info.sharedPBits) {
+    uint32_t pBits[6];
+    if (info.endpointPBits) {
+      for (uint32_t e = 0; e < endpointCount; e++) pBits[e] = bits.read(1);
+    } else {
+      for (uint32_t s = 0; s < info.subsets; s++) pBits[2 * s] = pBits[2 * s + 1] = bits.read(1);
+    }
+    for (uint32_t e = 0; e < endpointCount; e++) {
+      for (uint32_t c = 0; c < 3; c++) endpoints[e][c] = static_cast<uint8_t>((endpoints[e][c] << 1) | pBits[e]);
+      if (alphaBits) endpoints[e][3] = static_cast<uint8_t>((endpoints[e][3] << 1) | pBits[e]);
+    }
+    colorBits++;
+    if (alphaBits) alphaBits++;
+  }
+  for (uint32_t e = 0; e < endpointCount; e++) {
+    for (uint32_t c = 0; c < 3; c++) endpoints[e][c] = expandBits(endpoints[e][c], colorBits);
+    if (alphaBits) endpoints[e][3] = expandBits(endpoints[e][3], alphaBits);
+  }
+
+  auto subsetOf = [&](uint32_t texel) -> uint32_t {
+    if (info.subsets == 2) return (BC7_PARTITIONS_2[partition] >> texel) & 1;
+    if (info.subsets == 3) return BC7_PARTITIONS_3[partition][texel];
+    return 0;
+  };
+  auto isAnchor = [&](uint32_t texel) {
+    if (texel == 0) return true;
+    if (info.subsets == 2) return texel == BC7_ANCHOR_2[partition];
+    if (info.subsets == 3) return texel == BC7_ANCHOR_3A[partition] || texel == BC7_ANCHOR_3B[partition];
+    return false;
+  };
+
+  uint32_t indices[16];
+  uint32_t indices2[16] = {};
+  for (uint32_t i = 0; i < 16; i++) indices[i] = bits.read(isAnchor(i) ? info.indexBits - 1 : info.indexBits);
+  if (info.indexBits2) {
+    for (uint32_t i = 0; i < 16; i++) indices2[i] = bits.read(i == 0 ? info.indexBits2 - 1 : info.indexBits2);
+  }
+
+  for (uint32_t i = 0; i < 16; i++) {
+    uint32_t subset = subsetOf(i);
+    const uint8_t *e0 = endpoints[2 * subset];
+    const uint8_t *e1 = endpoints[2 * subset + 1];
+    uint8_t *texel = out + 4 * i;
+
+    uint32_t colorIndexBits = info.indexBits;
+    uint32_t colorIndex = indices[i];
+    uint32_t alphaIndexBits = info.indexBits;
+    uint32_t alphaIndex = indices[i];
+    if (info.indexBits2) {
+      alphaIndexBits = info.indexBits2;
+      alphaIndex = indices2[i];
+      if (indexSelection) {
+        std::swap(colorIndexBits, alphaIndexBits);
+        std::swap(colorIndex, alphaIndex);
+      }
+    }
+    const uint8_t *colorWeights = weightsFor(colorIndexBits);
+    for (uint32_t c = 0; c < 3; c++) texel[c] = interpolate(e0[c], e1[c], colorWeights[colorIndex]);
+    texel[3] = interpolate(e0[3], e1[3], weightsFor(alphaIndexBits)[alphaIndex]);
+
+    if (rotation) std::swap(texel[3], texel[rotation - 1]);
+  }
+}
+
+std::vector<uint8_t> decodeBlockCompressedImage(
+    VkFormat format, const uint8_t *blocks, uint32_t width, uint32_t height) {
+  uint32_t blocksX = (width + 3) / 4;
+  uint32_t blocksY = (height + 3) / 4;
+  size_t blockSize = 16;
+  if (format == VK_FORMAT_BC1_RGB_UNORM_BLOCK || format == VK_FORMAT_BC1_RGB_SRGB_BLOCK ||
+      format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK ||
+      format == VK_FORMAT_BC4_UNORM_BLOCK || format == VK_FORMAT_BC4_SNORM_BLOCK) {
+    blockSize = 8;
+  }
+
+  std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+  uint8_t texels[64];
+  for (uint32_t by = 0; by < blocksY; by++) {
+    for (uint32_t bx = 0; bx < blocksX; bx++) {
+      const uint8_t *block = blocks + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+      switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+          decodeBC1Block(block, texels, false);
+          break;
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+          decodeBC1Block(block, texels, true);
+          break;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+          decodeBC3Block(block, texels);
+          break;
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+          decodeBC4Block(block, texels, format == VK_FORMAT_BC4_SNORM_BLOCK);
+          break;
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+          decodeBC5Block(block, texels, format == VK_FORMAT_BC5_SNORM_BLOCK);
+          break;
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+          decodeBC7Block(block, texels);
+          break;
+        default:
+          throw std::runtime_error("unsupported block compressed format!");
+      }
+
+      // copy the block, clipping texels past the edge of non multiple-of-4 levels
+      for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+        uint32_t rowTexels = std::min(4u, width - bx * 4);
+        memcpy(
+            pixels.data() + ((static_cast<size_t>(by) * 4 + y) * width + bx * 4) * 4,
+            texels + y * 16,
+            rowTexels * 4);
+      }
+    }
+  }
+  return pixels;
+}
+
+}  // namespace lve
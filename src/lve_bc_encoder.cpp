@@ -0,0 +1,687 @@
+#include "lve_bc_encoder.hpp"
+
+#include "lve_bc_decoder.hpp"
+#include "lve_texture_data.hpp"
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#define LVE_BC_AVX2 1
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_BC_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+const float RGB_WEIGHTS[4] = {1.f, 1.f, 1.f, 0.f};
+const float RGBA_WEIGHTS[4] = {1.f, 1.f, 1.f, 1.f};
+
+// position of each index between the two endpoints, in the order the formats number them
+const float COLOR_INDEX_WEIGHTS[4] = {0.f, 1.f, 1.f / 3.f, 2.f / 3.f};
+const float ALPHA_INDEX_WEIGHTS[8] = {
+    0.f, 1.f, 1.f / 7.f, 2.f / 7.f, 3.f / 7.f, 4.f / 7.f, 5.f / 7.f, 6.f / 7.f};
+const uint8_t BC7_WEIGHTS_4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+const float BC7_INDEX_WEIGHTS[16] = {
+    0 / 64.f,  4 / 64.f,  9 / 64.f,  13 / 64.f, 17 / 64.f, 21 / 64.f, 26 / 64.f, 30 / 64.f,
+    34 / 64.f, 38 / 64.f, 43 / 64.f, 47 / 64.f, 51 / 64.f, 55 / 64.f, 60 / 64.f, 64 / 64.f};
+
+// distance between neighbouring quantized endpoint values, in 8 bit units
+const float COLOR_STEPS[4] = {255.f / 31.f, 255.f / 63.f, 255.f / 31.f, 0.f};
+const float ALPHA_STEPS[4] = {1.f, 1.f, 1.f, 1.f};
+const float BC7_STEPS[4] = {2.f, 2.f, 2.f, 2.f};
+
+// structure of arrays copy of a block so the kernels load 4 or 8 texels of a channel at once
+struct BlockTexels {
+  alignas(32) float channel[4][16];
+};
+
+BlockTexels loadBlock(const uint8_t *texels) {
+  BlockTexels block;
+  for (int i = 0; i < 16; i++) {
+    for (int c = 0; c < 4; c++) block.channel[c][i] = texels[4 * i + c];
+  }
+  return block;
+}
+
+inline float clampUnit(float value) { return std::min(std::max(value, 0.f), 255.f); }
+
+inline int quantizeChannel(float value, int maxValue) {
+  return std::min(std::max(static_cast<int>(value * maxValue / 255.f + .5f), 0), maxValue);
+}
+
+// Picks the closest palette entry for every texel and returns the summed weighted squared error.
+// Channels with a zero weight are skipped entirely.
+float selectIndices(
+    const BlockTexels &block,
+    const float (*palette)[4],
+    int paletteSize,
+    const float *weights,
+    uint8_t *indices) {
+  int active[4];
+  int activeCount = 0;
+  for (int c = 0; c < 4; c++) {
+    if (weights[c] > 0.f) active[activeCount++] = c;
+  }
+
+  float error = 0.f;
+#if defined(LVE_BC_AVX2)
+  for (int t = 0; t < 16; t += 8) {
+    __m256 best = _mm256_set1_ps(std::numeric_limits<float>::max());
+    __m256 bestIndex = _mm256_setzero_ps();
+    for (int p = 0; p < paletteSize; p++) {
+      __m256 distance = _mm256_setzero_ps();
+      for (int i = 0; i < activeCount; i++) {
+        int c = active[i];
+        __m256 diff =
+            _mm256_sub_ps(_mm256_load_ps(block.channel[c] + t), _mm256_set1_ps(palette[p][c]));
+        distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_mul_ps(diff, diff), _mm256_set1_ps(weights[c])));
+      }
+      __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+      best = _mm256_min_ps(distance, best);
+      bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps(static_cast<float>(p)), closer);
+    }
+    alignas(32) float lanes[8];
+    alignas(32) float laneErrors[8];
+    _mm256_store_ps(lanes, bestIndex);
+    _mm256_store_ps(laneErrors, best);
+    for (int i = 0; i < 8; i++) {
+      indices[t + i] = static_cast<uint8_t>(lanes[i]);
+      error += laneErrors[i];
+    }
+  }
+#elif defined(LVE_BC_SSE2)
+  for (int t = 0; t < 16; t += 4) {
+    __m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128 bestIndex = _mm_setzero_ps();
+    for (int p = 0; p < paletteSize; p++) {
+      __m128 distance = _mm_setzero_ps();
+      for (int i = 0; i < activeCount; i++) {
+        int c = active[i];
+        __m128 diff = _mm_sub_ps(_mm_load_ps(block.channel[c] + t), _mm_set1_ps(palette[p][c]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(_mm_mul_ps(diff, diff), _mm_set1_ps(weights[c])));
+      }
+      __m128 closer = _mm_cmplt_ps(distance, best);
+      best = _mm_min_ps(distance, best);
+      bestIndex = _mm_or_ps(
+          _mm_and_ps(closer, _mm_set1_ps(static_cast<float>(p))), _mm_andnot_ps(closer, bestIndex));
+    }
+    alignas(16) float lanes[4];
+    alignas(16) float laneErrors[4];
+    _mm_store_ps(lanes, bestIndex);
+    _mm_store_ps(laneErrors, best);
+    for (int i = 0; i < 4; i++) {
+      indices[t + i] = static_cast<uint8_t>(lanes[i]);
+      error += laneErrors[i];
+    }
+  }
+#else
+  for (int t = 0; t < 16; t++) {
+    float best = std::numeric_limits<float>::max();
+    for (int p = 0; p < paletteSize; p++) {
+      float distance = 0.f;
+      for (int i = 0; i < activeCount; i++) {
+        int c = active[i];
+        float diff = block.channel[c][t] - palette[p][c];
+        distance += diff * diff * weights[c];
+      }
+      if (distance < best) {
+        best = distance;
+        indices[t] = static_cast<uint8_t>(p);
+      }
+    }
+    error += best;
+  }
+#endif
+  return error;
+}
+
+void boundingBoxEndpoints(const BlockTexels &block, const float *weights, float *e0, float *e1) {
+  float mean[4];
+  int widest = 0;
+  for (int c = 0; c < 4; c++) {
+    const float *values = block.channel[c];
+    e0[c] = *std::min_element(values, values + 16);
+    e1[c] = *std::max_element(values, values + 16);
+    mean[c] = 0.f;
+    for (int i = 0; i < 16; i++) mean[c] += values[i] / 16.f;
+    if (weights[c] > 0.f && e1[c] - e0[c] > e1[widest] - e0[widest]) widest = c;
+  }
+
+  for (int c = 0; c < 4; c++) {
+    // pull the corners in a little, the extremes are usually outliers
+    float inset = (e1[c] - e0[c]) / 16.f;
+    e0[c] += inset;
+    e1[c] -= inset;
+
+    // the box diagonal only follows the data when every channel rises with the widest one
+    float covariance = 0.f;
+    for (int i = 0; i < 16; i++) {
+      covariance += (block.channel[c][i] - mean[c]) * (block.channel[widest][i] - mean[widest]);
+    }
+    if (covariance < 0.f) std::swap(e0[c], e1[c]);
+  }
+}
+
+// endpoints at the extremes of the block projected onto its principal axis
+void principalAxisEndpoints(const BlockTexels &block, const float *weights, float *e0, float *e1) {
+  float mean[4] = {};
+  for (int c = 0; c < 4; c++) {
+    for (int i = 0; i < 16; i++) mean[c] += block.channel[c][i] / 16.f;
+  }
+
+  float covariance[4][4] = {};
+  for (int c = 0; c < 4; c++) {
+    for (int d = c; d < 4; d++) {
+      float sum = 0.f;
+      for (int i = 0; i < 16; i++) {
+        sum += (block.channel[c][i] - mean[c]) * (block.channel[d][i] - mean[d]);
+      }
+      covariance[c][d] = covariance[d][c] = sum * weights[c] * weights[d];
+    }
+  }
+
+  // power iteration, seeded with the row of the channel that varies the most
+  int seed = 0;
+  for (int c = 1; c < 4; c++) {
+    if (covariance[c][c] > covariance[seed][seed]) seed = c;
+  }
+  float axis[4];
+  memcpy(axis, covariance[seed], sizeof(axis));
+  float length = 0.f;
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {};
+    for (int c = 0; c < 4; c++) {
+      for (int d = 0; d < 4; d++) next[c] += covariance[c][d] * axis[d];
+    }
+    length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2] + next[3] * next[3]);
+    if (length < 1e-6f) break;
+    for (int c = 0; c < 4; c++) axis[c] = next[c] / length;
+  }
+
+  if (length < 1e-6f) {
+    // flat block, a single colour reproduces it
+    for (int c = 0; c < 4; c++) e0[c] = e1[c] = mean[c];
+    return;
+  }
+
+  float minT = std::numeric_limits<float>::max();
+  float maxT = -std::numeric_limits<float>::max();
+  for (int i = 0; i < 16; i++) {
+    float t = 0.f;
+    for (int c = 0; c < 4; c++) t += (block.channel[c][i] - mean[c]) * axis[c];
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+  for (int c = 0; c < 4; c++) {
+    e0[c] = clampUnit(mean[c] + axis[c] * minT);
+    e1[c] = clampUnit(mean[c] + axis[c] * maxT);
+  }
+}
+
+// Solves for the pair of endpoints that best reproduces the block with the chosen indices.
+// Returns false when every texel picked the same weight and the system is singular.
+bool leastSquaresEndpoints(
+    const BlockTexels &block,
+    const uint8_t *indices,
+    const float *indexWeights,
+    const float *weights,
+    float *e0,
+    float *e1) {
+  float aa = 0.f, ab = 0.f, bb = 0.f;
+  float ax[4] = {}, bx[4] = {};
+  for (int i = 0; i < 16; i++) {
+    float b = indexWeights[indices[i]];
+    float a = 1.f - b;
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+    for (int c = 0; c < 4; c++) {
+      ax[c] += a * block.channel[c][i];
+      bx[c] += b * block.channel[c][i];
+    }
+  }
+  float determinant = aa * bb - ab * ab;
+  if (std::fabs(determinant) < 1e-6f) return false;
+  for (int c = 0; c < 4; c++) {
+    if (weights[c] == 0.f) continue;
+    e0[c] = clampUnit((bb * ax[c] - ab * bx[c]) / determinant);
+    e1[c] = clampUnit((aa * bx[c] - ab * ax[c]) / determinant);
+  }
+  return true;
+}
+
+// BC1 / BC3 colour endpoints as RGB565, palette as the four colour mode decodes it
+struct Color565Codec {
+  static int paletteSize() { return 4; }
+  static const float *indexWeights() { return COLOR_INDEX_WEIGHTS; }
+  static const float *steps() { return COLOR_STEPS; }
+
+  void quantize(const float *e0, const float *e1) {
+    const float *endpoint[2] = {e0, e1};
+    int rgb[2][3];
+    for (int e = 0; e < 2; e++) {
+      int r = quantizeChannel(endpoint[e][0], 31);
+      int g = quantizeChannel(endpoint[e][1], 63);
+      int b = quantizeChannel(endpoint[e][2], 31);
+      endpoints[e] = static_cast<uint16_t>((r << 11) | (g << 5) | b);
+      rgb[e][0] = r * 255 / 31;
+      rgb[e][1] = g * 255 / 63;
+      rgb[e][2] = b * 255 / 31;
+    }
+    for (int c = 0; c < 3; c++) {
+      palette[0][c] = static_cast<float>(rgb[0][c]);
+      palette[1][c] = static_cast<float>(rgb[1][c]);
+      palette[2][c] = static_cast<float>((2 * rgb[0][c] + rgb[1][c]) / 3);
+      palette[3][c] = static_cast<float>((rgb[0][c] + 2 * rgb[1][c]) / 3);
+    }
+    for (int p = 0; p < 4; p++) palette[p][3] = 255.f;
+  }
+
+  uint16_t endpoints[2];
+  float palette[4][4];
+};
+
+// BC3 alpha / BC4 / BC5 channel endpoints, palette as the eight value mode decodes it
+struct Alpha8Codec {
+  static int paletteSize() { return 8; }
+  static const float *indexWeights() { return ALPHA_INDEX_WEIGHTS; }
+  static const float *steps() { return ALPHA_STEPS; }
+
+  explicit Alpha8Codec(int channel) : channel{channel} {}
+
+  void quantize(const float *e0, const float *e1) {
+    int a0 = quantizeChannel(e0[channel], 255);
+    int a1 = quantizeChannel(e1[channel], 255);
+    endpoints[0] = static_cast<uint8_t>(a0);
+    endpoints[1] = static_cast<uint8_t>(a1);
+    memset(palette, 0, sizeof(palette));
+    palette[0][channel] = static_cast<float>(a0);
+    palette[1][channel] = static_cast<float>(a1);
+    for (int i = 1; i < 7; i++) {
+      palette[i + 1][channel] = static_cast<float>(((7 - i) * a0 + i * a1) / 7);
+    }
+  }
+
+  int channel;
+  uint8_t endpoints[2];
+  float palette[8][4];
+};
+
+// BC7 mode 6, RGBA endpoints of 7 bits plus a shared low bit per endpoint
+struct Bc7Mode6Codec {
+  static int paletteSize() { return 16; }
+  static const float *indexWeights() { return BC7_INDEX_WEIGHTS; }
+  static const float *steps() { return BC7_STEPS; }
+
+  void quantize(const float *e0, const float *e1) {
+    const float *endpoint[2] = {e0, e1};
+    for (int e = 0; e < 2; e++) {
+      float bestError = std::numeric_limits<float>::max();
+      for (int pbit = 0; pbit < 2; pbit++) {
+        if (forcedPbits >= 0 && pbit != ((forcedPbits >> e) & 1)) continue;
+        float error = 0.f;
+        uint8_t values[4];
+        for (int c = 0; c < 4; c++) {
+          int value = std::min(std::max(static_cast<int>((endpoint[e][c] - pbit) / 2.f + .5f), 0), 127);
+          values[c] = static_cast<uint8_t>(value);
+          float diff = endpoint[e][c] - static_cast<float>(2 * value + pbit);
+          error += diff * diff;
+        }
+        if (error < bestError) {
+          bestError = error;
+          memcpy(endpoints[e], values, 4);
+          pbits[e] = static_cast<uint8_t>(pbit);
+        }
+      }
+    }
+
+    for (int p = 0; p < 16; p++) {
+      int weight = BC7_WEIGHTS_4[p];
+      for (int c = 0; c < 4; c++) {
+        int v0 = (endpoints[0][c] << 1) | pbits[0];
+        int v1 = (endpoints[1][c] << 1) | pbits[1];
+        palette[p][c] = static_cast<float>(((64 - weight) * v0 + weight * v1 + 32) >> 6);
+      }
+    }
+  }
+
+  int forcedPbits = -1;  // bit e forces the low bit of endpoint e, -1 picks the closer one
+  uint8_t endpoints[2][4];
+  uint8_t pbits[2];
+  float palette[16][4];
+};
+
+// Finds endpoints for the codec and leaves its quantized state and the matching indices behind.
+// The unquantized endpoints that produced them are returned in e0 / e1.
+template <typename Codec>
+float encodeEndpoints(
+    const BlockTexels &block,
+    const float *weights,
+    BcQuality quality,
+    Codec &codec,
+    uint8_t *indices,
+    float *e0,
+    float *e1) {
+  if (quality == BcQuality::Fast) {
+    boundingBoxEndpoints(block, weights, e0, e1);
+  } else {
+    principalAxisEndpoints(block, weights, e0, e1);
+  }
+  codec.quantize(e0, e1);
+  float bestError = selectIndices(block, codec.palette, Codec::paletteSize(), weights, indices);
+  if (quality == BcQuality::Fast || bestError == 0.f) return bestError;
+
+  Codec candidate = codec;
+  uint8_t candidateIndices[16];
+  auto tryEndpoints = [&](const float *c0, const float *c1) {
+    candidate.quantize(c0, c1);
+    float error =
+        selectIndices(block, candidate.palette, Codec::paletteSize(), weights, candidateIndices);
+    if (error >= bestError) return false;
+    bestError = error;
+    codec = candidate;
+    memcpy(indices, candidateIndices, 16);
+    memcpy(e0, c0, 4 * sizeof(float));
+    memcpy(e1, c1, 4 * sizeof(float));
+    return true;
+  };
+
+  int iterations = quality == BcQuality::High ? 4 : 2;
+  for (int iteration = 0; iteration < iterations && bestError > 0.f; iteration++) {
+    float r0[4], r1[4];
+    memcpy(r0, e0, sizeof(r0));
+    memcpy(r1, e1, sizeof(r1));
+    if (!leastSquaresEndpoints(block, indices, Codec::indexWeights(), weights, r0, r1)) break;
+    if (!tryEndpoints(r0, r1)) break;
+  }
+
+  if (quality == BcQuality::High) {
+    // greedy search one quantization step either side of every endpoint channel
+    for (int pass = 0; pass < 2 && bestError > 0.f; pass++) {
+      bool improved = false;
+      for (int e = 0; e < 2; e++) {
+        for (int c = 0; c < 4; c++) {
+          if (weights[c] == 0.f) continue;
+          for (float direction : {-1.f, 1.f}) {
+            float c0[4], c1[4];
+            memcpy(c0, e0, sizeof(c0));
+            memcpy(c1, e1, sizeof(c1));
+            float *moved = e == 0 ? c0 : c1;
+            moved[c] = clampUnit(moved[c] + direction * Codec::steps()[c]);
+            improved |= tryEndpoints(c0, c1);
+          }
+        }
+      }
+      if (!improved) break;
+    }
+  }
+  return bestError;
+}
+
+void writeColorBlock(const Color565Codec &codec, const uint8_t *indices, uint8_t *out) {
+  // c0 > c1 selects the four colour mode, swapping the endpoints mirrors the indices
+  uint16_t c0 = codec.endpoints[0];
+  uint16_t c1 = codec.endpoints[1];
+  bool swapped = c0 < c1;
+  if (swapped) std::swap(c0, c1);
+  uint32_t bits = 0;
+  for (int i = 0; i < 16; i++) {
+    uint32_t index = swapped ? indices[i] ^ 1u : indices[i];
+    bits |= index << (2 * i);
+  }
+  out[0] = static_cast<uint8_t>(c0);
+  out[1] = static_cast<uint8_t>(c0 >> 8);
+  out[2] = static_cast<uint8_t>(c1);
+  out[3] = static_cast<uint8_t>(c1 >> 8);
+  for (int i = 0; i < 4; i++) out[4 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+void writeAlphaBlock(const Alpha8Codec &codec, const uint8_t *indices, uint8_t *out) {
+  // a0 > a1 selects the eight value mode, swapping mirrors index k to 9 - k
+  uint8_t a0 = codec.endpoints[0];
+  uint8_t a1 = codec.endpoints[1];
+  bool swapped = a0 < a1;
+  if (swapped) std::swap(a0, a1);
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; i++) {
+    uint64_t index = indices[i];
+    if (swapped) index = index < 2 ? index ^ 1u : 9 - index;
+    bits |= index << (3 * i);
+  }
+  out[0] = a0;
+  out[1] = a1;
+  for (int i = 0; i < 6; i++) out[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+}
+
+class BitWriter {
+ public:
+  explicit BitWriter(uint8_t *out) : out{out} { memset(out, 0, 16); }
+
+  void write(uint32_t value, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++, position++) {
+      if ((value >> i) & 1) out[position >> 3] |= static_cast<uint8_t>(1u << (position & 7));
+    }
+  }
+
+ private:
+  uint8_t *out;
+  uint32_t position = 0;
+};
+
+void writeBc7Mode6Block(const Bc7Mode6Codec &codec, const uint8_t *indices, uint8_t *out) {
+  // texel 0 only has room for a 3 bit index, mirror everything when it would need the fourth
+  bool swapped = indices[0] >= 8;
+  int first = swapped ? 1 : 0;
+  BitWriter writer{out};
+  writer.write(1u << 6, 7);
+  for (int c = 0; c < 4; c++) {
+    writer.write(codec.endpoints[first][c], 7);
+    writer.write(codec.endpoints[1 - first][c], 7);
+  }
+  writer.write(codec.pbits[first], 1);
+  writer.write(codec.pbits[1 - first], 1);
+  for (int i = 0; i < 16; i++) {
+    uint32_t index = swapped ? 15u - indices[i] : indices[i];
+    writer.write(index, i == 0 ? 3 : 4);
+  }
+}
+
+void encodeChannelBlock(const BlockTexels &block, int channel, BcQuality quality, uint8_t *out) {
+  float weights[4] = {};
+  weights[channel] = 1.f;
+  Alpha8Codec codec{channel};
+  uint8_t indices[16];
+  float e0[4], e1[4];
+  encodeEndpoints(block, weights, quality, codec, indices, e0, e1);
+  writeAlphaBlock(codec, indices, out);
+}
+
+void encodeColorBlock(const BlockTexels &block, BcQuality quality, uint8_t *out) {
+  Color565Codec codec;
+  uint8_t indices[16];
+  float e0[4], e1[4];
+  encodeEndpoints(block, RGB_WEIGHTS, quality, codec, indices, e0, e1);
+  writeColorBlock(codec, indices, out);
+}
+
+using BlockEncoder = void (*)(const uint8_t *, uint8_t *, BcQuality);
+
+BlockEncoder blockEncoderFor(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      return encodeBC1Block;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      return encodeBC3Block;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+      return encodeBC4Block;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+      return encodeBC5Block;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      return encodeBC7Block;
+    default:
+      throw std::runtime_error("unsupported format for block compression!");
+  }
+}
+
+uint32_t storedChannels(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC4_UNORM_BLOCK: return 1;
+    case VK_FORMAT_BC5_UNORM_BLOCK: return 2;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK: return 4;
+    default: return 3;
+  }
+}
+
+}  // namespace
+
+double BcEncodeStats::psnr() const {
+  if (texels == 0 || channels == 0) return 0.0;
+  double meanSquaredError = squaredError / (static_cast<double>(texels) * channels);
+  if (meanSquaredError == 0.0) return std::numeric_limits<double>::infinity();
+  return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
+
+double BcEncodeStats::megapixelsPerSecond() const {
+  return seconds > 0.0 ? static_cast<double>(texels) / 1e6 / seconds : 0.0;
+}
+
+BcEncodeStats &BcEncodeStats::operator+=(const BcEncodeStats &other) {
+  texels += other.texels;
+  channels = std::max(channels, other.channels);
+  squaredError += other.squaredError;
+  seconds += other.seconds;
+  return *this;
+}
+
+void encodeBC1Block(const uint8_t *texels, uint8_t *out, BcQuality quality) {
+  encodeColorBlock(loadBlock(texels), quality, out);
+}
+
+void encodeBC3Block(const uint8_t *texels, uint8_t *out, BcQuality quality) {
+  BlockTexels block = loadBlock(texels);
+  encodeChannelBlock(block, 3, quality, out);
+  encodeColorBlock(block, quality, out + 8);
+}
+
+void encodeBC4Block(const uint8_t *texels, uint8_t *out, BcQuality quality) {
+  encodeChannelBlock(loadBlock(texels), 0, quality, out);
+}
+
+void encodeBC5Block(const uint8_t *texels, uint8_t *out, BcQuality quality) {
+  BlockTexels block = loadBlock(texels);
+  encodeChannelBlock(block, 0, quality, out);
+  encodeChannelBlock(block, 1, quality, out + 8);
+}
+
+void encodeBC7Block(const uint8_t *texels, uint8_t *out, BcQuality quality) {
+  BlockTexels block = loadBlock(texels);
+  Bc7Mode6Codec codec;
+  uint8_t indices[16];
+  float e0[4], e1[4];
+  float error = encodeEndpoints(block, RGBA_WEIGHTS, quality, codec, indices, e0, e1);
+
+  if (quality == BcQuality::High && error > 0.f) {
+    // the low bits are picked per endpoint, a different pair can still win for the whole block
+    Bc7Mode6Codec candidate;
+    uint8_t candidateIndices[16];
+    for (int pbits = 0; pbits < 4; pbits++) {
+      candidate.forcedPbits = pbits;
+      candidate.quantize(e0, e1);
+      float candidateError =
+          selectIndices(block, candidate.palette, 16, RGBA_WEIGHTS, candidateIndices);
+      if (candidateError < error) {
+        error = candidateError;
+        codec = candidate;
+        memcpy(indices, candidateIndices, sizeof(indices));
+      }
+    }
+  }
+  writeBc7Mode6Block(codec, indices, out);
+}
+
+std::vector<uint8_t> encodeBlockCompressedImage(
+    VkFormat format,
+    const uint8_t *pixels,
+    uint32_t width,
+    uint32_t height,
+    BcQuality quality,
+    LveThreadPool *pool,
+    BcEncodeStats *stats) {
+  BlockEncoder encodeBlock = blockEncoderFor(format);
+  uint32_t blockSize = formatBlockSize(format);
+  uint32_t blocksX = (width + 3) / 4;
+  uint32_t blocksY = (height + 3) / 4;
+  std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * blockSize);
+
+  // every task takes whole rows of blocks, partial blocks on the edge repeat the last texel
+  auto encodeRows = [&](uint32_t begin, uint32_t end) {
+    uint8_t texels[64];
+    for (uint32_t by = begin; by < end; by++) {
+      for (uint32_t bx = 0; bx < blocksX; bx++) {
+        for (uint32_t y = 0; y < 4; y++) {
+          uint32_t sy = std::min(by * 4 + y, height - 1);
+          for (uint32_t x = 0; x < 4; x++) {
+            uint32_t sx = std::min(bx * 4 + x, width - 1);
+            memcpy(texels + 4 * (4 * y + x), pixels + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+          }
+        }
+        encodeBlock(texels, blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * blockSize, quality);
+      }
+    }
+  };
+
+  auto start = std::chrono::high_resolution_clock::now();
+  if (pool != nullptr) {
+    uint32_t grainSize = std::max(blocksY / (4 * (pool->threadCount() + 1)), 1u);
+    pool->parallelFor(blocksY, encodeRows, grainSize);
+  } else {
+    encodeRows(0, blocksY);
+  }
+  auto end = std::chrono::high_resolution_clock::now();
+
+  if (stats != nullptr) {
+    *stats = BcEncodeStats{};
+    stats->texels = static_cast<uint64_t>(width) * height;
+    stats->channels = storedChannels(format);
+    stats->seconds = std::chrono::duration<double, std::chrono::seconds::period>(end - start).count();
+    auto decoded = decodeBlockCompressedImage(format, blocks.data(), width, height);
+    for (size_t i = 0; i < stats->texels; i++) {
+      for (uint32_t c = 0; c < stats->channels; c++) {
+        double diff = static_cast<double>(decoded[4 * i + c]) - pixels[4 * i + c];
+        stats->squaredError += diff * diff;
+      }
+    }
+  }
+  return blocks;
+}
+
+const char *bcEncoderKernelName() {
+#if defined(LVE_BC_AVX2)
+  return "AVX2";
+#elif defined(LVE_BC_SSE2)
+  return "SSE2";
+#else
+  return "scalar";
+#endif
+}
+
+}  // namespace lve
@@ -0,0 +1,113 @@
+#include "lve_bindless_textures.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveBindlessTextures::LveBindlessTextures(
+    LveDevice &device, std::shared_ptr<LveTexture> defaultTexture, uint32_t capacity)
+    : lveDevice{device}, capacity_{std::min(capacity, device.maxBindlessTextures())} {
+  if (capacity_ == 0) {
+    throw std::runtime_error("device does not support bindless textures!");
+  }
+
+  // Unused slots stay unwritten (partially bound), new textures are written while the set is
+  // bound by frames in flight (update after bind, unused while pending), and the array is sized
+  // at allocation time.
+  setLayout = LveDescriptorSetLayout::Builder(lveDevice)
+                  .addBinding(
+                      0,
+                      VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                      VK_SHADER_STAGE_FRAGMENT_BIT,
+                      capacity_)
+                  .setBindingFlags(
+                      0,
+                      VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+                          VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT |
+                          VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT_EXT)
+                  .setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT)
+                  .build();
+
+  pool = LveDescriptorPool::Builder(lveDevice)
+             .setMaxSets(1)
+             .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT)
+             .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, capacity_)
+             .build();
+
+  if (!pool->allocateDescriptor(setLayout->getDescriptorSetLayout(), descriptorSet, capacity_)) {
+    throw std::runtime_error("failed to allocate bindless texture set!");
+  }
+
+  uint32_t slot = registerTexture(std::move(defaultTexture));
+  assert(slot == DEFAULT_SLOT && "Default texture must take the first slot");
+  (void)slot;
+}
+
+LveBindlessTextures::~LveBindlessTextures() {}
+
+uint32_t LveBindlessTextures::registerTexture(std::shared_ptr<LveTexture> texture) {
+  assert(texture != nullptr && "Cannot register a null texture");
+  if (texture->bindlessSlot_ != LveTexture::NO_BINDLESS_SLOT) {
+    assert(
+        texture->bindlessSlot_ < textures.size() && textures[texture->bindlessSlot_] == texture &&
+        "Texture is registered in another table");
+    return texture->bindlessSlot_;
+  }
+
+  uint32_t slot = allocateSlot();
+  writeSlot(slot, *texture);
+  texture->bindlessSlot_ = slot;
+  textures[slot] = std::move(texture);
+  registeredCount++;
+  return slot;
+}
+
+void LveBindlessTextures::unregisterTexture(LveTexture &texture) {
+  uint32_t slot = texture.bindlessSlot_;
+  if (slot == LveTexture::NO_BINDLESS_SLOT) return;
+  assert(slot != DEFAULT_SLOT && "Cannot unregister the default texture");
+  // the stale descriptor stays in place, partially bound sets only need the slots that are used
+  texture.bindlessSlot_ = LveTexture::NO_BINDLESS_SLOT;
+  textures[slot].reset();
+  freeSlots.push_back(slot);
+  registeredCount--;
+}
+
+uint32_t LveBindlessTextures::rebindTexture(LveTexture &texture) {
+  uint32_t oldSlot = texture.bindlessSlot_;
+  assert(oldSlot != LveTexture::NO_BINDLESS_SLOT && "Cannot rebind an unregistered texture");
+  uint32_t slot = allocateSlot();
+  writeSlot(slot, texture);
+  texture.bindlessSlot_ = slot;
+  textures[slot] = std::move(textures[oldSlot]);
+  return oldSlot;
+}
+
+void LveBindlessTextures::releaseSlot(uint32_t slot) {
+  assert(textures[slot] == nullptr && "Slot still holds a texture");
+  freeSlots.push_back(slot);
+}
+
+uint32_t LveBindlessTextures::allocateSlot() {
+  if (!freeSlots.empty()) {
+    uint32_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    return slot;
+  }
+  if (textures.size() >= capacity_) {
+    throw std::runtime_error("bindless texture table is full!");
+  }
+  textures.emplace_back();
+  return static_cast<uint32_t>(textures.size() - 1);
+}
+
+void LveBindlessTextures::writeSlot(uint32_t slot, const LveTexture &texture) {
+  auto imageInfo = texture.descriptorInfo();
+  LveDescriptorWriter(*setLayout, *pool).writeImage(0, &imageInfo, slot).overwrite(descriptorSet);
+}
+
+}  // namespace lve
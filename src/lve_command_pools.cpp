@@ -0,0 +1,71 @@
+#include "lve_command_pools.hpp"
+
+// std
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveFrameCommandPools::LveFrameCommandPools(LveDevice &device, int framesInFlight, uint32_t laneCount)
+    : lveDevice{device}, laneCount_{laneCount} {
+  assert(framesInFlight > 0 && laneCount > 0 && "Need at least one frame slot and lane");
+  pools.resize(static_cast<size_t>(framesInFlight) * laneCount);
+
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+  // buffers live for one frame and are only ever reset together
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  for (auto &lane : pools) {
+    if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &lane.commandPool) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create frame command pool!");
+    }
+  }
+}
+
+LveFrameCommandPools::~LveFrameCommandPools() {
+  // destroying a pool frees its buffers
+  for (auto &lane : pools) {
+    vkDestroyCommandPool(lveDevice.device(), lane.commandPool, nullptr);
+  }
+}
+
+void LveFrameCommandPools::reset(int frameIndex) {
+  for (uint32_t i = 0; i < laneCount_; i++) {
+    LanePool &lane = lanePool(frameIndex, i);
+    if (lane.primaryUsed == 0 && lane.secondaryUsed == 0) continue;
+    vkResetCommandPool(lveDevice.device(), lane.commandPool, 0);
+    lane.primaryUsed = 0;
+    lane.secondaryUsed = 0;
+  }
+}
+
+VkCommandBuffer LveFrameCommandPools::allocate(
+    int frameIndex, uint32_t lane, VkCommandBufferLevel level) {
+  LanePool &pool = lanePool(frameIndex, lane);
+  bool primary = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  auto &buffers = primary ? pool.primary : pool.secondary;
+  size_t &used = primary ? pool.primaryUsed : pool.secondaryUsed;
+  if (used == buffers.size()) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = level;
+    allocInfo.commandPool = pool.commandPool;
+    allocInfo.commandBufferCount = 1;
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate command buffers!");
+    }
+    buffers.push_back(commandBuffer);
+  }
+  return buffers[used++];
+}
+
+LveFrameCommandPools::LanePool &LveFrameCommandPools::lanePool(int frameIndex, uint32_t lane) {
+  assert(lane < laneCount_ && "Lane out of range");
+  size_t index = static_cast<size_t>(frameIndex) * laneCount_ + lane;
+  assert(index < pools.size() && "Frame index out of range");
+  return pools[index];
+}
+
+}  // namespace lve
@@ -1,11 +1,26 @@
 #include "lve_descriptors.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cstring>
+#include <functional>
 #include <stdexcept>
 
 namespace lve {
 
+namespace {
+
+// handles are pointers on 64 bit builds and uint64_t elsewhere
+template <typename T>
+uint64_t handleBits(T handle) {
+  uint64_t bits = 0;
+  std::memcpy(&bits, &handle, sizeof(handle));
+  return bits;
+}
+
+}  // namespace
+
 // *************** Descriptor Set Layout Builder *********************
 
 LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
@@ -23,25 +38,59 @@ LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::addBinding(
   return *this;
 }
 
+LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::setBindingFlags(
+  uint32_t binding, VkDescriptorBindingFlagsEXT flags) {
+  assert(bindings.count(binding) == 1 && "Binding flags set for unknown binding");
+  bindingFlags[binding] = flags;
+  return *this;
+}
+
+LveDescriptorSetLayout::Builder &LveDescriptorSetLayout::Builder::setLayoutFlags(
+  VkDescriptorSetLayoutCreateFlags flags) {
+  layoutFlags = flags;
+  return *this;
+}
+
 std::unique_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build() const {
-  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings);
+  return std::make_unique<LveDescriptorSetLayout>(lveDevice, bindings, bindingFlags, layoutFlags);
+}
+
+std::shared_ptr<LveDescriptorSetLayout> LveDescriptorSetLayout::Builder::build(
+  LveDescriptorLayoutCache &cache) const {
+  return cache.getLayout(*this);
 }
 
 // *************** Descriptor Set Layout *********************
 
 LveDescriptorSetLayout::LveDescriptorSetLayout(
-  LveDevice &lveDevice, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings)
+  LveDevice &lveDevice,
+  std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+  const std::unordered_map<uint32_t, VkDescriptorBindingFlagsEXT> &bindingFlags,
+  VkDescriptorSetLayoutCreateFlags layoutFlags)
   : lveDevice{ lveDevice }, bindings{ bindings } {
   std::vector<VkDescriptorSetLayoutBinding> setLayoutBindings{};
+  std::vector<VkDescriptorBindingFlagsEXT> setLayoutBindingFlags{};
   for (auto kv : bindings) {
     setLayoutBindings.push_back(kv.second);
+    auto flags = bindingFlags.find(kv.first);
+    setLayoutBindingFlags.push_back(flags != bindingFlags.end() ? flags->second : 0);
   }
 
   VkDescriptorSetLayoutCreateInfo descriptorSetLayoutInfo{};
   descriptorSetLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+  descriptorSetLayoutInfo.flags = layoutFlags;
   descriptorSetLayoutInfo.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
   descriptorSetLayoutInfo.pBindings = setLayoutBindings.data();
 
+  // only chained when used, so layouts without them work without descriptor indexing
+  VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+  if (!bindingFlags.empty()) {
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = static_cast<uint32_t>(setLayoutBindingFlags.size());
+    bindingFlagsInfo.pBindingFlags = setLayoutBindingFlags.data();
+    descriptorSetLayoutInfo.pNext = &bindingFlagsInfo;
+  }
+
   if (vkCreateDescriptorSetLayout(
     lveDevice.device(),
     &descriptorSetLayoutInfo,
@@ -103,19 +152,34 @@ LveDescriptorPool::~LveDescriptorPool() {
 }
 
 bool LveDescriptorPool::allocateDescriptor(
-  const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet &descriptor) const {
+  const VkDescriptorSetLayout descriptorSetLayout,
+  VkDescriptorSet &descriptor,
+  uint32_t variableDescriptorCount) const {
+  return tryAllocateDescriptor(descriptorSetLayout, descriptor, variableDescriptorCount) ==
+    VK_SUCCESS;
+}
+
+VkResult LveDescriptorPool::tryAllocateDescriptor(
+  const VkDescriptorSetLayout descriptorSetLayout,
+  VkDescriptorSet &descriptor,
+  uint32_t variableDescriptorCount) const {
   VkDescriptorSetAllocateInfo allocInfo{};
   allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
   allocInfo.descriptorPool = descriptorPool;
   allocInfo.pSetLayouts = &descriptorSetLayout;
   allocInfo.descriptorSetCount = 1;
 
-  // Might want to create a "DescriptorPoolManager" class that handles this case, and builds
-  // a new pool whenever an old pool fills up. But this is beyond our current scope
-  if (vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &descriptor) != VK_SUCCESS) {
-    return false;
+  VkDescriptorSetVariableDescriptorCountAllocateInfoEXT variableCountInfo{};
+  if (variableDescriptorCount > 0) {
+    variableCountInfo.sType =
+      VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO_EXT;
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &variableDescriptorCount;
+    allocInfo.pNext = &variableCountInfo;
   }
-  return true;
+
+  // a pool that fills up is LveDescriptorAllocator's business
+  return vkAllocateDescriptorSets(lveDevice.device(), &allocInfo, &descriptor);
 }
 
 void LveDescriptorPool::freeDescriptors(std::vector<VkDescriptorSet> &descriptors) const {
@@ -130,10 +194,176 @@ void LveDescriptorPool::resetPool() {
   vkResetDescriptorPool(lveDevice.device(), descriptorPool, 0);
 }
 
+// *************** Descriptor Allocator *********************
+
+LveDescriptorAllocator::LveDescriptorAllocator(
+  LveDevice &lveDevice,
+  uint32_t initialSetsPerPool,
+  VkDescriptorPoolCreateFlags poolFlags)
+  : lveDevice{ lveDevice },
+    initialSetsPerPool{ std::max(initialSetsPerPool, 1u) },
+    poolFlags{ poolFlags } {}
+
+bool LveDescriptorAllocator::allocateDescriptor(
+  const LveDescriptorSetLayout &setLayout,
+  VkDescriptorSet &descriptor,
+  uint32_t variableDescriptorCount) {
+  auto &layoutPools = getLayoutPools(setLayout);
+  if (layoutPools.usedPools.empty()) {
+    nextPool(layoutPools);
+  }
+
+  VkResult result = layoutPools.usedPools.back()->tryAllocateDescriptor(
+    setLayout.getDescriptorSetLayout(), descriptor, variableDescriptorCount);
+  if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL) {
+    // the full pool stays in usedPools until the next reset, its sets are still alive
+    nextPool(layoutPools);
+    result = layoutPools.usedPools.back()->tryAllocateDescriptor(
+      setLayout.getDescriptorSetLayout(), descriptor, variableDescriptorCount);
+  }
+  return result == VK_SUCCESS;
+}
+
+void LveDescriptorAllocator::resetPools() {
+  for (auto &kv : layouts) {
+    auto &layoutPools = kv.second;
+    for (auto &pool : layoutPools.usedPools) {
+      pool->resetPool();
+      layoutPools.freePools.push_back(std::move(pool));
+    }
+    layoutPools.usedPools.clear();
+  }
+}
+
+LveDescriptorAllocator::LayoutPools &LveDescriptorAllocator::getLayoutPools(
+  const LveDescriptorSetLayout &setLayout) {
+  auto found = layouts.find(setLayout.getDescriptorSetLayout());
+  if (found != layouts.end()) {
+    return found->second;
+  }
+
+  LayoutPools layoutPools{};
+  layoutPools.nextSetsPerPool = initialSetsPerPool;
+  for (auto &kv : setLayout.bindings) {
+    auto &binding = kv.second;
+    if (binding.descriptorCount == 0) continue;
+    auto size = std::find_if(
+      layoutPools.setSizes.begin(),
+      layoutPools.setSizes.end(),
+      [&](const VkDescriptorPoolSize &s) { return s.type == binding.descriptorType; });
+    if (size != layoutPools.setSizes.end()) {
+      size->descriptorCount += binding.descriptorCount;
+    } else {
+      layoutPools.setSizes.push_back({ binding.descriptorType, binding.descriptorCount });
+    }
+  }
+  return layouts.emplace(setLayout.getDescriptorSetLayout(), std::move(layoutPools)).first->second;
+}
+
+void LveDescriptorAllocator::nextPool(LayoutPools &layoutPools) {
+  if (!layoutPools.freePools.empty()) {
+    layoutPools.usedPools.push_back(std::move(layoutPools.freePools.back()));
+    layoutPools.freePools.pop_back();
+    return;
+  }
+
+  uint32_t maxSets = layoutPools.nextSetsPerPool;
+  LveDescriptorPool::Builder builder{ lveDevice };
+  builder.setMaxSets(maxSets).setPoolFlags(poolFlags);
+  for (auto &size : layoutPools.setSizes) {
+    builder.addPoolSize(size.type, size.descriptorCount * maxSets);
+  }
+  layoutPools.usedPools.push_back(builder.build());
+  layoutPools.nextSetsPerPool = maxSets * 2 < MAX_SETS_PER_POOL ? maxSets * 2 : MAX_SETS_PER_POOL;
+}
+
+// *************** Descriptor Cache Key *********************
+
+size_t LveDescriptorKeyHash::operator()(const std::vector<uint64_t> &key) const {
+  size_t seed = key.size();
+  for (uint64_t word : key) {
+    seed ^= std::hash<uint64_t>{}(word) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+  }
+  return seed;
+}
+
+// *************** Descriptor Layout Cache *********************
+
+std::shared_ptr<LveDescriptorSetLayout> LveDescriptorLayoutCache::getLayout(
+  const LveDescriptorSetLayout::Builder &builder) {
+  // unordered_map order differs between equal builders, so the key walks the bindings sorted
+  std::vector<uint32_t> bindingNumbers;
+  for (auto &kv : builder.bindings) {
+    bindingNumbers.push_back(kv.first);
+  }
+  std::sort(bindingNumbers.begin(), bindingNumbers.end());
+
+  std::vector<uint64_t> key;
+  key.reserve(1 + bindingNumbers.size() * 5);
+  key.push_back(builder.layoutFlags);
+  for (uint32_t number : bindingNumbers) {
+    auto &binding = builder.bindings.at(number);
+    auto flags = builder.bindingFlags.find(number);
+    key.push_back(binding.binding);
+    key.push_back(static_cast<uint64_t>(binding.descriptorType));
+    key.push_back(binding.descriptorCount);
+    key.push_back(binding.stageFlags);
+    key.push_back(flags != builder.bindingFlags.end() ? flags->second : 0);
+  }
+
+  auto found = layouts.find(key);
+  if (found != layouts.end()) {
+    return found->second;
+  }
+  std::shared_ptr<LveDescriptorSetLayout> layout = builder.build();
+  layouts.emplace(std::move(key), layout);
+  return layout;
+}
+
+// *************** Descriptor Update Batch *********************
+
+LveDescriptorUpdateBatch::~LveDescriptorUpdateBatch() { flush(); }
+
+void LveDescriptorUpdateBatch::add(
+  VkDescriptorSet set, const std::vector<VkWriteDescriptorSet> &setWrites) {
+  for (auto write : setWrites) {
+    write.dstSet = set;
+    if (write.pBufferInfo) {
+      auto first = bufferInfos.size();
+      bufferInfos.insert(
+        bufferInfos.end(), write.pBufferInfo, write.pBufferInfo + write.descriptorCount);
+      write.pBufferInfo = &bufferInfos[first];
+    }
+    if (write.pImageInfo) {
+      auto first = imageInfos.size();
+      imageInfos.insert(
+        imageInfos.end(), write.pImageInfo, write.pImageInfo + write.descriptorCount);
+      write.pImageInfo = &imageInfos[first];
+    }
+    writes.push_back(write);
+  }
+}
+
+void LveDescriptorUpdateBatch::flush() {
+  if (writes.empty()) return;
+  vkUpdateDescriptorSets(
+    lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+  writes.clear();
+  bufferInfos.clear();
+  imageInfos.clear();
+}
+
 // *************** Descriptor Writer *********************
 
 LveDescriptorWriter::LveDescriptorWriter(LveDescriptorSetLayout &setLayout, LveDescriptorPool &pool)
-  : setLayout{ setLayout }, pool{ pool } {}
+  : setLayout{ setLayout }, pool{ &pool } {}
+
+LveDescriptorWriter::LveDescriptorWriter(
+  LveDescriptorSetLayout &setLayout, LveDescriptorAllocator &allocator)
+  : setLayout{ setLayout }, allocator{ &allocator } {}
+
+LveDescriptorWriter::LveDescriptorWriter(LveDescriptorSetLayout &setLayout)
+  : setLayout{ setLayout } {}
 
 LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
   uint32_t binding, VkDescriptorBufferInfo *bufferInfo) {
@@ -157,19 +387,20 @@ LveDescriptorWriter &LveDescriptorWriter::writeBuffer(
 }
 
 LveDescriptorWriter &LveDescriptorWriter::writeImage(
-  uint32_t binding, VkDescriptorImageInfo *imageInfo) {
+  uint32_t binding, VkDescriptorImageInfo *imageInfo, uint32_t arrayElement) {
   assert(setLayout.bindings.count(binding) == 1 && "Layout does not contain specified binding");
 
   auto &bindingDescription = setLayout.bindings[binding];
 
   assert(
-    bindingDescription.descriptorCount == 1 &&
-    "Binding single descriptor info, but binding expects multiple");
+    arrayElement < bindingDescription.descriptorCount &&
+    "Array element is outside of the binding");
 
   VkWriteDescriptorSet write{};
   write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
   write.descriptorType = bindingDescription.descriptorType;
   write.dstBinding = binding;
+  write.dstArrayElement = arrayElement;
   write.pImageInfo = imageInfo;
   write.descriptorCount = 1;
 
@@ -178,8 +409,7 @@ LveDescriptorWriter &LveDescriptorWriter::writeImage(
 }
 
 bool LveDescriptorWriter::build(VkDescriptorSet &set) {
-  bool success = pool.allocateDescriptor(setLayout.getDescriptorSetLayout(), set);
-  if (!success) {
+  if (!allocate(set)) {
     return false;
   }
   overwrite(set);
@@ -190,7 +420,98 @@ void LveDescriptorWriter::overwrite(VkDescriptorSet &set) {
   for (auto &write : writes) {
     write.dstSet = set;
   }
-  vkUpdateDescriptorSets(pool.lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+  vkUpdateDescriptorSets(setLayout.lveDevice.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+bool LveDescriptorWriter::build(VkDescriptorSet &set, LveDescriptorUpdateBatch &batch) {
+  if (!allocate(set)) {
+    return false;
+  }
+  overwrite(set, batch);
+  return true;
+}
+
+void LveDescriptorWriter::overwrite(VkDescriptorSet &set, LveDescriptorUpdateBatch &batch) {
+  batch.add(set, writes);
+}
+
+bool LveDescriptorWriter::allocate(VkDescriptorSet &set) {
+  assert((pool || allocator) && "Writer was created without a pool to build from");
+  return pool ? pool->allocateDescriptor(setLayout.getDescriptorSetLayout(), set)
+              : allocator->allocateDescriptor(setLayout, set);
+}
+
+// *************** Descriptor Set Cache *********************
+
+bool LveDescriptorSetCache::getDescriptor(
+  const LveDescriptorWriter &writer, VkDescriptorSet &set, LveDescriptorUpdateBatch *batch) {
+  std::vector<uint64_t> key;
+  std::vector<uint64_t> resources;
+  key.push_back(handleBits(writer.setLayout.getDescriptorSetLayout()));
+  for (auto &write : writer.writes) {
+    key.push_back(write.dstBinding);
+    key.push_back(write.dstArrayElement);
+    key.push_back(static_cast<uint64_t>(write.descriptorType));
+    for (uint32_t i = 0; i < write.descriptorCount; i++) {
+      if (write.pBufferInfo) {
+        key.push_back(handleBits(write.pBufferInfo[i].buffer));
+        resources.push_back(handleBits(write.pBufferInfo[i].buffer));
+        key.push_back(write.pBufferInfo[i].offset);
+        key.push_back(write.pBufferInfo[i].range);
+      }
+      if (write.pImageInfo) {
+        key.push_back(handleBits(write.pImageInfo[i].sampler));
+        key.push_back(handleBits(write.pImageInfo[i].imageView));
+        resources.push_back(handleBits(write.pImageInfo[i].imageView));
+        key.push_back(static_cast<uint64_t>(write.pImageInfo[i].imageLayout));
+      }
+    }
+  }
+
+  auto found = sets.find(key);
+  if (found != sets.end()) {
+    set = found->second.set;
+    hits_++;
+    return true;
+  }
+
+  if (!allocator.allocateDescriptor(writer.setLayout, set)) {
+    return false;
+  }
+  if (batch) {
+    batch->add(set, writer.writes);
+  } else {
+    std::vector<VkWriteDescriptorSet> setWrites = writer.writes;
+    for (auto &write : setWrites) {
+      write.dstSet = set;
+    }
+    vkUpdateDescriptorSets(
+      writer.setLayout.lveDevice.device(),
+      static_cast<uint32_t>(setWrites.size()),
+      setWrites.data(),
+      0,
+      nullptr);
+  }
+  sets.emplace(std::move(key), Entry{set, std::move(resources)});
+  return true;
+}
+
+void LveDescriptorSetCache::releaseBuffer(VkBuffer buffer) { release(handleBits(buffer)); }
+
+void LveDescriptorSetCache::releaseImageView(VkImageView imageView) {
+  release(handleBits(imageView));
+}
+
+void LveDescriptorSetCache::release(uint64_t resource) {
+  auto entry = sets.begin();
+  while (entry != sets.end()) {
+    const std::vector<uint64_t> &resources = entry->second.resources;
+    if (std::find(resources.begin(), resources.end(), resource) != resources.end()) {
+      entry = sets.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
 }
 
 }  // namespace lve
\ No newline at end of file
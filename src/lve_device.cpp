@@ -1,6 +1,8 @@
 #include "lve_device.hpp"
+#include "lve_pipeline_registry.hpp"
 
 // std headers
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <set>
@@ -55,9 +57,13 @@ LveDevice::LveDevice(LveWindow &window) : window{ window } {
     pickPhysicalDevice(); //ѡӦóõ豸,豸
     createLogicalDevice(); //߼豸,ʾʹ豸Щ
     createCommandPool(); //
+    samplerCache_ = std::make_unique<LveSamplerCache>(device_);
+    pipelineRegistry_ = std::make_unique<LvePipelineRegistry>(*this);
 }
 
 LveDevice::~LveDevice() {
+    pipelineRegistry_.reset(); // shader modules and samplers must go before the device
+    samplerCache_.reset();
     vkDestroyCommandPool(device_, commandPool, nullptr);
     vkDestroyDevice(device_, nullptr);
 
@@ -80,7 +86,7 @@ void LveDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_1;
 
     VkInstanceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -132,6 +138,18 @@ void LveDevice::pickPhysicalDevice() {
 
     vkGetPhysicalDeviceProperties(physicalDevice, &properties);
     std::cout << "physical device: " << properties.deviceName << std::endl;
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 properties2{};
+    properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    properties2.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+    maxBindlessTextures_ = std::min(
+        {indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages,
+         indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+         indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+         indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers});
 }
 
 void LveDevice::createLogicalDevice() {
@@ -150,18 +168,178 @@ void LveDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
+    // optional, textures fall back to CPU decoding of BC data without it
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+    deviceFeatures.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+
+    // bindless texture table, see LveBindlessTextures
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+    // optional, per frame bindings fall back to cached descriptor sets without it
+    std::vector<const char*> extensions = deviceExtensions;
+    bool pushDescriptors = hasDeviceExtension(physicalDevice, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if (pushDescriptors) {
+        extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    }
+
+    // optional, pipelines are compiled whole without it, see LvePipelineRegistry. Only used
+    // when linking is fast, otherwise libraries gain nothing over a monolithic compile.
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT libraryFeatures{};
+    libraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    if (hasDeviceExtension(physicalDevice, VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT libraryProperties{};
+        libraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &libraryProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &libraryFeatures;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+
+        graphicsPipelineLibrary_ = libraryFeatures.graphicsPipelineLibrary == VK_TRUE &&
+            libraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+    }
+    // optional feature structs are put in front of indexingFeatures
+    void* featureChain = nullptr;
+    if (graphicsPipelineLibrary_) {
+        extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+        libraryFeatures.pNext = featureChain;
+        featureChain = &libraryFeatures;
+    }
+
+    // optional, the state is baked into the pipelines without it, see LveDynamicStateTracker
+    VkPhysicalDeviceExtendedDynamicStateFeaturesEXT dynamicStateFeatures{};
+    dynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState2FeaturesEXT dynamicState2Features{};
+    dynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+    VkPhysicalDeviceExtendedDynamicState3FeaturesEXT dynamicState3Features{};
+    dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+    auto queryFeatures = [this](void* features) {
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = features;
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    };
+    bool dynamicState = false;
+    bool dynamicState2 = false;
+    bool dynamicPolygonMode = false;
+    if (hasDeviceExtension(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME)) {
+        queryFeatures(&dynamicStateFeatures);
+        dynamicState = dynamicStateFeatures.extendedDynamicState == VK_TRUE;
+    }
+    // the later extensions only add to the first
+    if (dynamicState && hasDeviceExtension(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME)) {
+        queryFeatures(&dynamicState2Features);
+        dynamicState2 = dynamicState2Features.extendedDynamicState2 == VK_TRUE;
+    }
+    // only the polygon mode of extension 3, which is useless without wireframe support
+    if (dynamicState && supportedFeatures.fillModeNonSolid &&
+        hasDeviceExtension(physicalDevice, VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME)) {
+        queryFeatures(&dynamicState3Features);
+        dynamicPolygonMode = dynamicState3Features.extendedDynamicState3PolygonMode == VK_TRUE;
+    }
+    if (dynamicState) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_EXTENSION_NAME);
+        dynamicStateFeatures = {};
+        dynamicStateFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_FEATURES_EXT;
+        dynamicStateFeatures.extendedDynamicState = VK_TRUE;
+        dynamicStateFeatures.pNext = featureChain;
+        featureChain = &dynamicStateFeatures;
+    }
+    if (dynamicState2) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_2_EXTENSION_NAME);
+        dynamicState2Features = {};
+        dynamicState2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_2_FEATURES_EXT;
+        dynamicState2Features.extendedDynamicState2 = VK_TRUE;
+        dynamicState2Features.pNext = featureChain;
+        featureChain = &dynamicState2Features;
+    }
+    if (dynamicPolygonMode) {
+        extensions.push_back(VK_EXT_EXTENDED_DYNAMIC_STATE_3_EXTENSION_NAME);
+        deviceFeatures.fillModeNonSolid = VK_TRUE;
+        dynamicState3Features = {};
+        dynamicState3Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTENDED_DYNAMIC_STATE_3_FEATURES_EXT;
+        dynamicState3Features.extendedDynamicState3PolygonMode = VK_TRUE;
+        dynamicState3Features.pNext = featureChain;
+        featureChain = &dynamicState3Features;
+    }
+
+    // optional, LveRenderer falls back to render passes and framebuffers without it. On 1.1 it
+    // also needs the two extensions it is built on.
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    bool dynamicRendering = false;
+    if (hasDeviceExtension(physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME)) {
+        queryFeatures(&dynamicRenderingFeatures);
+        dynamicRendering = dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+    }
+    if (dynamicRendering) {
+        extensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+        dynamicRenderingFeatures = {};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        dynamicRenderingFeatures.pNext = featureChain;
+        featureChain = &dynamicRenderingFeatures;
+    }
+
+    // optional, LveSwapChain paces frames to its latency budget with it
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    bool presentWait = false;
+    if (hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasDeviceExtension(physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        queryFeatures(&presentIdFeatures);
+        queryFeatures(&presentWaitFeatures);
+        presentWait = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+    }
+    if (presentWait) {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        presentIdFeatures = {};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.presentId = VK_TRUE;
+        presentIdFeatures.pNext = featureChain;
+        featureChain = &presentIdFeatures;
+        presentWaitFeatures = {};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        presentWaitFeatures.presentWait = VK_TRUE;
+        presentWaitFeatures.pNext = featureChain;
+        featureChain = &presentWaitFeatures;
+    }
+    indexingFeatures.pNext = featureChain;
 
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &indexingFeatures;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -176,6 +354,56 @@ void LveDevice::createLogicalDevice() {
         throw std::runtime_error("failed to create logical device!");
     }
 
+    enabledFeatures = deviceFeatures;
+
+    if (pushDescriptors) {
+        VkPhysicalDevicePushDescriptorPropertiesKHR pushProperties{};
+        pushProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PUSH_DESCRIPTOR_PROPERTIES_KHR;
+        VkPhysicalDeviceProperties2 properties2{};
+        properties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext = &pushProperties;
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+        maxPushDescriptors_ = pushProperties.maxPushDescriptors;
+        // device level entry point of the extension, not exported by the loader
+        vkCmdPushDescriptorSetWithTemplateKHR_ = reinterpret_cast<PFN_vkCmdPushDescriptorSetWithTemplateKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdPushDescriptorSetWithTemplateKHR"));
+    }
+
+    // device level entry points of the extensions, not exported by the loader
+    if (dynamicState) {
+        dynamicStateFunctions_.cmdSetCullMode = reinterpret_cast<PFN_vkCmdSetCullModeEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetCullModeEXT"));
+        dynamicStateFunctions_.cmdSetFrontFace = reinterpret_cast<PFN_vkCmdSetFrontFaceEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetFrontFaceEXT"));
+        dynamicStateFunctions_.cmdSetPrimitiveTopology = reinterpret_cast<PFN_vkCmdSetPrimitiveTopologyEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetPrimitiveTopologyEXT"));
+        dynamicStateFunctions_.cmdSetDepthTestEnable = reinterpret_cast<PFN_vkCmdSetDepthTestEnableEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetDepthTestEnableEXT"));
+        dynamicStateFunctions_.cmdSetDepthWriteEnable = reinterpret_cast<PFN_vkCmdSetDepthWriteEnableEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetDepthWriteEnableEXT"));
+        dynamicStateFunctions_.cmdSetDepthCompareOp = reinterpret_cast<PFN_vkCmdSetDepthCompareOpEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetDepthCompareOpEXT"));
+    }
+    if (dynamicState2) {
+        dynamicStateFunctions_.cmdSetDepthBiasEnable = reinterpret_cast<PFN_vkCmdSetDepthBiasEnableEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetDepthBiasEnableEXT"));
+    }
+    if (dynamicPolygonMode) {
+        dynamicStateFunctions_.cmdSetPolygonMode = reinterpret_cast<PFN_vkCmdSetPolygonModeEXT>(
+            vkGetDeviceProcAddr(device_, "vkCmdSetPolygonModeEXT"));
+    }
+
+    if (dynamicRendering) {
+        vkCmdBeginRenderingKHR_ = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdBeginRenderingKHR"));
+        vkCmdEndRenderingKHR_ = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+            vkGetDeviceProcAddr(device_, "vkCmdEndRenderingKHR"));
+    }
+    if (presentWait) {
+        vkWaitForPresentKHR_ = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(device_, "vkWaitForPresentKHR"));
+    }
+
     vkGetDeviceQueue(device_, indices.graphicsFamily, 0, &graphicsQueue_);
     vkGetDeviceQueue(device_, indices.presentFamily, 0, &presentQueue_);
 }
@@ -211,7 +439,30 @@ bool LveDevice::isDeviceSuitable(VkPhysicalDevice device) {
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
     return indices.isComplete() && extensionsSupported && swapChainAdequate &&
-        supportedFeatures.samplerAnisotropy;
+        supportedFeatures.samplerAnisotropy &&
+        supportedFeatures.shaderSampledImageArrayDynamicIndexing &&
+        checkDescriptorIndexingSupport(device);
+}
+
+bool LveDevice::checkDescriptorIndexingSupport(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_1) {
+        return false;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &indexingFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    return indexingFeatures.runtimeDescriptorArray &&
+        indexingFeatures.descriptorBindingPartiallyBound &&
+        indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+        indexingFeatures.descriptorBindingVariableDescriptorCount &&
+        indexingFeatures.descriptorBindingUpdateUnusedWhilePending;
 }
 
 void LveDevice::populateDebugMessengerCreateInfo(
@@ -298,6 +549,25 @@ void LveDevice::hasGflwRequiredInstanceExtensions() {
     }
 }
 
+bool LveDevice::hasDeviceExtension(VkPhysicalDevice device, const char *extensionName) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(
+        device,
+        nullptr,
+        &extensionCount,
+        availableExtensions.data());
+
+    for (const auto &extension : availableExtensions) {
+        if (std::strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool LveDevice::checkDeviceExtensionSupport(VkPhysicalDevice device) {
     uint32_t extensionCount;
     vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
@@ -481,7 +751,8 @@ void LveDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize
 
 void LveDevice::transitionImageLayout(VkImage image, VkFormat format,
                                       VkImageLayout oldLayout,
-                                      VkImageLayout newLayout, uint32_t layerCount) {
+                                      VkImageLayout newLayout, uint32_t layerCount,
+                                      uint32_t mipLevels) {
   VkCommandBuffer commandBuffer = beginSingleTimeCommands();
   
 
@@ -494,7 +765,7 @@ void LveDevice::transitionImageLayout(VkImage image, VkFormat format,
   barrier.image = image;
   barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   barrier.subresourceRange.baseMipLevel = 0;
-  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.levelCount = mipLevels;
   barrier.subresourceRange.baseArrayLayer = 0;
   barrier.subresourceRange.layerCount = layerCount;
   barrier.srcAccessMask = 0;
@@ -558,6 +829,25 @@ void LveDevice::copyBufferToImage(
     endSingleTimeCommands(commandBuffer);
 }
 
+void LveDevice::copyBufferToImage(
+    VkBuffer buffer, VkImage image, const std::vector<VkBufferImageCopy> &regions) {
+    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        buffer,
+        image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+    endSingleTimeCommands(commandBuffer);
+}
+
+VkFormatProperties LveDevice::getFormatProperties(VkFormat format) {
+    VkFormatProperties props;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &props);
+    return props;
+}
+
 void LveDevice::createImageWithInfo(
     const VkImageCreateInfo &imageInfo,
     VkMemoryPropertyFlags properties,
@@ -584,7 +874,8 @@ void LveDevice::createImageWithInfo(
     }
 }
 
-VkImageView LveDevice::createImageView(VkImage image, VkImageViewType viewType, VkFormat format) {
+VkImageView LveDevice::createImageView(VkImage image, VkImageViewType viewType, VkFormat format,
+                                       uint32_t layerCount, uint32_t mipLevels) {
   VkImageViewCreateInfo viewInfo{};
   viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
   viewInfo.image = image;
@@ -592,9 +883,9 @@ VkImageView LveDevice::createImageView(VkImage image, VkImageViewType viewType,
   viewInfo.format = format;
   viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
   viewInfo.subresourceRange.baseMipLevel = 0;
-  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.levelCount = mipLevels;
   viewInfo.subresourceRange.baseArrayLayer = 0;
-  viewInfo.subresourceRange.layerCount = 1;
+  viewInfo.subresourceRange.layerCount = layerCount;
   VkImageView imageView;
   if (vkCreateImageView(device_, &viewInfo, nullptr, &imageView) !=
       VK_SUCCESS) {
@@ -606,14 +897,15 @@ VkImageView LveDevice::createImageView(VkImage image, VkImageViewType viewType,
 void LveDevice::createImage(uint32_t width, uint32_t height, uint32_t arrayLayers, VkFormat format,
                             VkImageTiling tiling, VkImageUsageFlags usage,
                             VkMemoryPropertyFlags properties, VkImage &image,
-                            VkDeviceMemory &imageMemory, uint32_t flags) {
+                            VkDeviceMemory &imageMemory, uint32_t flags,
+                            uint32_t mipLevels) {
   VkImageCreateInfo imageInfo{};
   imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
   imageInfo.imageType = VK_IMAGE_TYPE_2D;
   imageInfo.extent.width = width;
   imageInfo.extent.height = height;
   imageInfo.extent.depth = 1;
-  imageInfo.mipLevels = 1;
+  imageInfo.mipLevels = mipLevels;
   imageInfo.arrayLayers = arrayLayers;
   imageInfo.format = format;
   imageInfo.tiling = tiling;
@@ -0,0 +1,67 @@
+#include "lve_dynamic_state.hpp"
+
+namespace lve {
+
+void LveRasterState::applyTo(PipelineConfigInfo &configInfo) const {
+  configInfo.inputAssemblyInfo.topology = topology;
+  configInfo.rasterizationInfo.polygonMode = polygonMode;
+  configInfo.rasterizationInfo.cullMode = cullMode;
+  configInfo.rasterizationInfo.frontFace = frontFace;
+  configInfo.rasterizationInfo.depthBiasEnable = depthBiasEnable;
+  configInfo.depthStencilInfo.depthTestEnable = depthTestEnable;
+  configInfo.depthStencilInfo.depthWriteEnable = depthWriteEnable;
+  configInfo.depthStencilInfo.depthCompareOp = depthCompareOp;
+}
+
+LveDynamicStateTracker::LveDynamicStateTracker(LveDevice &device, VkCommandBuffer commandBuffer)
+    : functions{device.extendedDynamicState()}, commandBuffer{commandBuffer} {}
+
+void LveDynamicStateTracker::bindPipeline(LvePipeline &pipeline) {
+  if (pipeline.getPipeline() == boundPipeline) return;
+  pipeline.bind(commandBuffer);
+  boundPipeline = pipeline.getPipeline();
+  if (!pipeline.usesExtendedDynamicState()) {
+    currentValid = false;
+  }
+}
+
+void LveDynamicStateTracker::setRasterState(const LveRasterState &state) {
+  if (functions.cmdSetCullMode == nullptr) return;  // baked into the pipelines
+
+  bool all = !currentValid;
+  if (all || state.topology != current.topology) {
+    functions.cmdSetPrimitiveTopology(commandBuffer, state.topology);
+  }
+  if (all || state.cullMode != current.cullMode) {
+    functions.cmdSetCullMode(commandBuffer, state.cullMode);
+  }
+  if (all || state.frontFace != current.frontFace) {
+    functions.cmdSetFrontFace(commandBuffer, state.frontFace);
+  }
+  if (all || state.depthTestEnable != current.depthTestEnable) {
+    functions.cmdSetDepthTestEnable(commandBuffer, state.depthTestEnable);
+  }
+  if (all || state.depthWriteEnable != current.depthWriteEnable) {
+    functions.cmdSetDepthWriteEnable(commandBuffer, state.depthWriteEnable);
+  }
+  if (all || state.depthCompareOp != current.depthCompareOp) {
+    functions.cmdSetDepthCompareOp(commandBuffer, state.depthCompareOp);
+  }
+  if (functions.cmdSetDepthBiasEnable != nullptr &&
+      (all || state.depthBiasEnable != current.depthBiasEnable)) {
+    functions.cmdSetDepthBiasEnable(commandBuffer, state.depthBiasEnable);
+  }
+  if (functions.cmdSetPolygonMode != nullptr &&
+      (all || state.polygonMode != current.polygonMode)) {
+    functions.cmdSetPolygonMode(commandBuffer, state.polygonMode);
+  }
+  current = state;
+  currentValid = true;
+}
+
+void LveDynamicStateTracker::invalidate() {
+  boundPipeline = VK_NULL_HANDLE;
+  currentValid = false;
+}
+
+}  // namespace lve
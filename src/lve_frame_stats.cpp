@@ -0,0 +1,185 @@
+#include "lve_frame_stats.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace lve {
+
+LveFrameStats::LveFrameStats() {
+  window.reserve(WINDOW_FRAMES);
+  stuttered.reserve(WINDOW_FRAMES);
+  for (auto &histogram : histograms) {
+    histogram.assign(BUCKET_COUNT, 0);
+  }
+}
+
+void LveFrameStats::add(const LveFrameTimings &timings) {
+  bool stutter = false;
+  if (window.size() >= MIN_STUTTER_FRAMES) {
+    double medianMs = percentile(FRAME, 0.5, summary(FRAME).maxMs);
+    stutter = timings.frameMs > STUTTER_FACTOR * medianMs;
+  }
+
+  if (window.size() < WINDOW_FRAMES) {
+    window.push_back(timings);
+    stuttered.push_back(stutter);
+  } else {
+    // the oldest frame leaves the histograms
+    for (int metric = 0; metric < METRIC_COUNT; metric++) {
+      histograms[metric][bucket(value(window[head], static_cast<Metric>(metric)))]--;
+    }
+    if (stuttered[head]) recentStutters--;
+    window[head] = timings;
+    stuttered[head] = stutter;
+    head = (head + 1) % WINDOW_FRAMES;
+  }
+  for (int metric = 0; metric < METRIC_COUNT; metric++) {
+    histograms[metric][bucket(value(timings, static_cast<Metric>(metric)))]++;
+  }
+  frames++;
+  if (stutter) {
+    stutters++;
+    recentStutters++;
+  }
+}
+
+void LveFrameStats::reset() {
+  window.clear();
+  stuttered.clear();
+  head = 0;
+  for (auto &histogram : histograms) {
+    std::fill(histogram.begin(), histogram.end(), 0);
+  }
+  frames = 0;
+  stutters = 0;
+  recentStutters = 0;
+}
+
+LveFrameStats::Summary LveFrameStats::summary(Metric metric) const {
+  Summary result{};
+  result.samples = static_cast<uint32_t>(window.size());
+  if (window.empty()) return result;
+  double total = 0.0;
+  for (auto &timings : window) {
+    double ms = value(timings, metric);
+    total += ms;
+    result.maxMs = std::max(result.maxMs, ms);
+  }
+  result.meanMs = total / static_cast<double>(window.size());
+  result.p50Ms = percentile(metric, 0.50, result.maxMs);
+  result.p95Ms = percentile(metric, 0.95, result.maxMs);
+  result.p99Ms = percentile(metric, 0.99, result.maxMs);
+  return result;
+}
+
+LveFrameStats::Bottleneck LveFrameStats::bottleneck() const {
+  double frameMs = summary(FRAME).meanMs;
+  if (!(frameMs > 0.0)) return Bottleneck::Unknown;
+  double gpuWaitMs = summary(FRAME_FENCE_WAIT).meanMs + summary(IMAGE_FENCE_WAIT).meanMs;
+  double presentWaitMs =
+      summary(PRESENT_WAIT).meanMs + summary(ACQUIRE).meanMs + summary(PRESENT).meanMs;
+  if (gpuWaitMs + presentWaitMs < WAIT_BOUND_SHARE * frameMs) return Bottleneck::Cpu;
+  return gpuWaitMs >= presentWaitMs ? Bottleneck::Gpu : Bottleneck::Present;
+}
+
+const LveFrameTimings &LveFrameStats::last() const {
+  assert(!window.empty() && "No frame added yet");
+  if (window.size() < WINDOW_FRAMES) return window.back();
+  return window[(head + WINDOW_FRAMES - 1) % WINDOW_FRAMES];
+}
+
+std::string LveFrameStats::report() const {
+  Summary frame = summary(FRAME);
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(2) << "frame p50 " << frame.p50Ms << " p95 " << frame.p95Ms
+      << " p99 " << frame.p99Ms << " max " << frame.maxMs << " ms, record p50 "
+      << summary(RECORD).p50Ms << " ms, " << recentStutters << " stutters in the last "
+      << frame.samples << " frames (" << stutters << " total), " << bottleneckName(bottleneck());
+  return out.str();
+}
+
+const char *LveFrameStats::metricName(Metric metric) {
+  switch (metric) {
+    case FRAME:
+      return "frame";
+    case RECORD:
+      return "record";
+    case PRESENT_WAIT:
+      return "present wait";
+    case FRAME_FENCE_WAIT:
+      return "frame fence wait";
+    case ACQUIRE:
+      return "acquire";
+    case IMAGE_FENCE_WAIT:
+      return "image fence wait";
+    case SUBMIT:
+      return "submit";
+    case PRESENT:
+      return "present";
+    default:
+      return "unknown";
+  }
+}
+
+const char *LveFrameStats::bottleneckName(Bottleneck bottleneck) {
+  switch (bottleneck) {
+    case Bottleneck::Cpu:
+      return "cpu-bound";
+    case Bottleneck::Gpu:
+      return "gpu-bound";
+    case Bottleneck::Present:
+      return "present-bound";
+    default:
+      return "unknown";
+  }
+}
+
+double LveFrameStats::value(const LveFrameTimings &timings, Metric metric) {
+  switch (metric) {
+    case FRAME:
+      return timings.frameMs;
+    case RECORD:
+      return timings.recordMs;
+    case PRESENT_WAIT:
+      return timings.presentWaitMs;
+    case FRAME_FENCE_WAIT:
+      return timings.frameFenceWaitMs;
+    case ACQUIRE:
+      return timings.acquireMs;
+    case IMAGE_FENCE_WAIT:
+      return timings.imageFenceWaitMs;
+    case SUBMIT:
+      return timings.submitMs;
+    case PRESENT:
+      return timings.presentMs;
+    default:
+      return 0.0;
+  }
+}
+
+uint32_t LveFrameStats::bucket(double ms) {
+  if (!(ms > 0.0)) return 0;
+  double index = std::floor(ms / BUCKET_MS);
+  uint32_t last = BUCKET_COUNT - 1;
+  return index >= static_cast<double>(last) ? last : static_cast<uint32_t>(index);
+}
+
+// the upper edge of the bucket holding the sample at this fraction of the window
+double LveFrameStats::percentile(Metric metric, double fraction, double maxMs) const {
+  if (window.empty()) return 0.0;
+  uint32_t rank = static_cast<uint32_t>(std::ceil(fraction * static_cast<double>(window.size())));
+  rank = std::max(rank, 1u);
+  const std::vector<uint32_t> &histogram = histograms[metric];
+  uint32_t seen = 0;
+  for (uint32_t i = 0; i + 1 < BUCKET_COUNT; i++) {
+    seen += histogram[i];
+    if (seen >= rank) return std::min((i + 1) * BUCKET_MS, maxMs);
+  }
+  return maxMs;
+}
+
+}  // namespace lve
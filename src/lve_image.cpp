@@ -0,0 +1,140 @@
+#include "lve_image.hpp"
+
+#include "lve_qoi.hpp"
+#include "lve_thread_pool.hpp"
+
+// stb_image keeps its flip setting in a global, it is never changed here so decoding stays
+// thread safe. Only the failure reason string is shared between threads.
+#define STB_IMAGE_IMPLEMENTATION
+#include "third_party/stb/stb_image.h"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+std::vector<uint8_t> readFile(const std::string &filepath, size_t maxBytes = SIZE_MAX) {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  size_t fileSize = std::min(static_cast<size_t>(file.tellg()), maxBytes);
+  std::vector<uint8_t> bytes(fileSize);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(bytes.data()), fileSize);
+  return bytes;
+}
+
+bool fileExists(const std::string &filepath) {
+  std::ifstream file{filepath, std::ios::binary};
+  return file.is_open();
+}
+
+}  // namespace
+
+std::string existingSibling(const std::string &filepath, const std::string &extension) {
+  auto dot = filepath.find_last_of('.');
+  auto slash = filepath.find_last_of("/\\");
+  std::string sibling = dot == std::string::npos || (slash != std::string::npos && dot < slash)
+                            ? filepath + extension
+                            : filepath.substr(0, dot) + extension;
+  return sibling != filepath && fileExists(sibling) ? sibling : std::string{};
+}
+
+std::string resolveImageFile(const std::string &filepath) {
+  if (isQoiFile(filepath)) return filepath;
+  std::string qoi = existingSibling(filepath, ".qoi");
+  return qoi.empty() ? filepath : qoi;
+}
+
+bool isQoiFile(const std::string &filepath) {
+  if (filepath.size() < 4) return false;
+  std::string extension = filepath.substr(filepath.size() - 4);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension == ".qoi";
+}
+
+void probeImage(const std::string &filepath, uint32_t &width, uint32_t &height) {
+  if (isQoiFile(filepath)) {
+    auto header = readFile(filepath, 14);
+    QoiHeader info = readQoiHeader(header.data(), header.size());
+    width = info.width;
+    height = info.height;
+    return;
+  }
+  int x, y, channels;
+  if (!stbi_info(filepath.c_str(), &x, &y, &channels)) {
+    throw std::runtime_error("failed to load texture image: " + filepath);
+  }
+  width = static_cast<uint32_t>(x);
+  height = static_cast<uint32_t>(y);
+}
+
+void decodeImageRGBA8(
+    const std::string &filepath, bool flipVertically, uint8_t *dst, uint32_t width, uint32_t height) {
+  if (isQoiFile(filepath)) {
+    auto bytes = readFile(filepath);
+    QoiHeader header = readQoiHeader(bytes.data(), bytes.size());
+    if (header.width != width || header.height != height) {
+      throw std::runtime_error("unexpected image size: " + filepath);
+    }
+    decodeQoiInto(bytes.data(), bytes.size(), flipVertically, dst);
+    return;
+  }
+
+  int x, y, channels;
+  stbi_uc *pixels = stbi_load(filepath.c_str(), &x, &y, &channels, STBI_rgb_alpha);
+  if (!pixels) {
+    throw std::runtime_error("failed to load texture image: " + filepath);
+  }
+  if (static_cast<uint32_t>(x) != width || static_cast<uint32_t>(y) != height) {
+    stbi_image_free(pixels);
+    throw std::runtime_error("unexpected image size: " + filepath);
+  }
+  // stb only decodes top down, the flip happens while copying the rows out
+  size_t rowBytes = static_cast<size_t>(width) * 4;
+  for (uint32_t row = 0; row < height; row++) {
+    uint32_t target = flipVertically ? height - 1 - row : row;
+    memcpy(dst + target * rowBytes, pixels + row * rowBytes, rowBytes);
+  }
+  stbi_image_free(pixels);
+}
+
+void decodeImagesRGBA8(
+    const std::vector<std::string> &filepaths,
+    bool flipVertically,
+    uint8_t *dst,
+    uint32_t width,
+    uint32_t height,
+    LveThreadPool *pool) {
+  size_t imageSize = static_cast<size_t>(width) * height * 4;
+  auto decodeRange = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      decodeImageRGBA8(filepaths[i], flipVertically, dst + i * imageSize, width, height);
+    }
+  };
+  uint32_t count = static_cast<uint32_t>(filepaths.size());
+  if (pool != nullptr && count > 1) {
+    pool->parallelFor(count, decodeRange);
+  } else {
+    decodeRange(0, count);
+  }
+}
+
+ImageMipLevel loadImageRGBA8(const std::string &filepath, bool flipVertically) {
+  ImageMipLevel image{};
+  probeImage(filepath, image.width, image.height);
+  image.pixels.resize(static_cast<size_t>(image.width) * image.height * 4);
+  decodeImageRGBA8(filepath, flipVertically, image.pixels.data(), image.width, image.height);
+  return image;
+}
+
+}  // namespace lve
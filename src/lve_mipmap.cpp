@@ -0,0 +1,194 @@
+#include "lve_mipmap.hpp"
+
+// std
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LVE_MIPMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace lve {
+
+namespace {
+
+constexpr int LINEAR_TO_SRGB_STEPS = 4096;
+
+struct SrgbTables {
+  std::array<float, 256> toLinear;
+  std::array<uint8_t, LINEAR_TO_SRGB_STEPS + 1> toSrgb;
+
+  SrgbTables() {
+    for (int i = 0; i < 256; i++) {
+      float c = i / 255.f;
+      toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+    for (int i = 0; i <= LINEAR_TO_SRGB_STEPS; i++) {
+      float l = static_cast<float>(i) / LINEAR_TO_SRGB_STEPS;
+      float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.f / 2.4f) - 0.055f;
+      toSrgb[i] = static_cast<uint8_t>(std::min(std::max(c * 255.f + 0.5f, 0.f), 255.f));
+    }
+  }
+};
+
+const SrgbTables &srgbTables() {
+  static const SrgbTables tables{};
+  return tables;
+}
+
+inline uint8_t linearToSrgb(const SrgbTables &tables, float linear) {
+  int index = static_cast<int>(linear * LINEAR_TO_SRGB_STEPS + 0.5f);
+  return tables.toSrgb[std::min(std::max(index, 0), LINEAR_TO_SRGB_STEPS)];
+}
+
+// The source texels and weights along one axis of output texel i. Even sizes average a pair. An
+// odd size 2n + 1 spreads over n outputs with three taps weighted (n - i, n, i + 1) / (2n + 1), so
+// every source texel adds up to the same total weight and the last one is not dropped.
+struct AxisTaps {
+  uint32_t first;
+  uint32_t count;
+  float weights[3];
+};
+
+AxisTaps axisTaps(uint32_t srcSize, uint32_t i) {
+  if (srcSize == 1) return {0, 1, {1.f, 0.f, 0.f}};
+  if (srcSize % 2 == 0) return {2 * i, 2, {0.5f, 0.5f, 0.f}};
+  float n = static_cast<float>(srcSize / 2);
+  float scale = 1.f / static_cast<float>(srcSize);
+  return {2 * i, 3, {(n - i) * scale, n * scale, (i + 1) * scale}};
+}
+
+// generic path, the only one for odd source sizes
+void downsamplePixel(
+    const uint8_t *src,
+    uint32_t srcWidth,
+    uint32_t srcHeight,
+    uint32_t x,
+    uint32_t y,
+    uint8_t *out,
+    bool srgb) {
+  AxisTaps tapsX = axisTaps(srcWidth, x);
+  AxisTaps tapsY = axisTaps(srcHeight, y);
+  const auto &tables = srgbTables();
+  float sum[4] = {0.f, 0.f, 0.f, 0.f};
+  for (uint32_t ty = 0; ty < tapsY.count; ty++) {
+    const uint8_t *row = src + static_cast<size_t>(tapsY.first + ty) * srcWidth * 4;
+    for (uint32_t tx = 0; tx < tapsX.count; tx++) {
+      const uint8_t *p = row + static_cast<size_t>(tapsX.first + tx) * 4;
+      float weight = tapsY.weights[ty] * tapsX.weights[tx];
+      for (int c = 0; c < 3; c++) {
+        sum[c] += weight * (srgb ? tables.toLinear[p[c]] : static_cast<float>(p[c]));
+      }
+      sum[3] += weight * static_cast<float>(p[3]);
+    }
+  }
+
+  for (int c = 0; c < 3; c++) {
+    out[c] = srgb ? linearToSrgb(tables, sum[c]) : static_cast<uint8_t>(sum[c] + 0.5f);
+  }
+  out[3] = static_cast<uint8_t>(sum[3] + 0.5f);
+}
+
+#ifdef LVE_MIPMAP_SSE2
+// two output pixels from a 4x2 source block, integer average with rounding
+inline void downsampleUnormSse2(const uint8_t *row0, const uint8_t *row1, uint8_t *out) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row0));
+  __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row1));
+  __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+  __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+  lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+  hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+  __m128i sum = _mm_unpacklo_epi64(lo, hi);
+  sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(out), _mm_packus_epi16(sum, zero));
+}
+
+// one output pixel, the four linearised source pixels are summed as vectors
+inline void downsampleSrgbSse2(
+    const SrgbTables &tables, const uint8_t *row0, const uint8_t *row1, uint8_t *out) {
+  auto load = [&tables](const uint8_t *p) {
+    return _mm_setr_ps(
+        tables.toLinear[p[0]], tables.toLinear[p[1]], tables.toLinear[p[2]], p[3] / 255.f);
+  };
+  __m128 sum = _mm_add_ps(
+      _mm_add_ps(load(row0), load(row0 + 4)), _mm_add_ps(load(row1), load(row1 + 4)));
+  alignas(16) float avg[4];
+  _mm_store_ps(avg, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+  out[0] = linearToSrgb(tables, avg[0]);
+  out[1] = linearToSrgb(tables, avg[1]);
+  out[2] = linearToSrgb(tables, avg[2]);
+  out[3] = static_cast<uint8_t>(avg[3] * 255.f + 0.5f);
+}
+#endif
+
+}  // namespace
+
+uint32_t calculateMipLevels(uint32_t width, uint32_t height) {
+  uint32_t levels = 1;
+  uint32_t size = std::max(width, height);
+  while (size > 1) {
+    size >>= 1;
+    levels++;
+  }
+  return levels;
+}
+
+void downsampleRGBA8(
+    const uint8_t *src, uint32_t srcWidth, uint32_t srcHeight, uint8_t *dst, bool srgb) {
+  uint32_t dstWidth = std::max(srcWidth / 2, 1u);
+  uint32_t dstHeight = std::max(srcHeight / 2, 1u);
+
+  for (uint32_t y = 0; y < dstHeight; y++) {
+    uint8_t *out = dst + static_cast<size_t>(y) * dstWidth * 4;
+    uint32_t x = 0;
+#ifdef LVE_MIPMAP_SSE2
+    // the vector paths average 2x2 blocks, odd sizes need the three tap weights
+    if (srcWidth % 2 == 0 && srcHeight % 2 == 0) {
+      const uint8_t *row0 = src + static_cast<size_t>(2 * y) * srcWidth * 4;
+      const uint8_t *row1 = row0 + static_cast<size_t>(srcWidth) * 4;
+      if (srgb) {
+        const auto &tables = srgbTables();
+        for (; 2 * x + 1 < srcWidth; x++) {
+          downsampleSrgbSse2(tables, row0 + 8 * x, row1 + 8 * x, out + 4 * x);
+        }
+      } else {
+        for (; 2 * x + 3 < srcWidth && x + 1 < dstWidth; x += 2) {
+          downsampleUnormSse2(row0 + 8 * x, row1 + 8 * x, out + 4 * x);
+        }
+      }
+    }
+#endif
+    for (; x < dstWidth; x++) {
+      downsamplePixel(src, srcWidth, srcHeight, x, y, out + 4 * x, srgb);
+    }
+  }
+}
+
+std::vector<ImageMipLevel> generateMipChainRGBA8(
+    const uint8_t *pixels, uint32_t width, uint32_t height, bool srgb) {
+  uint32_t levelCount = calculateMipLevels(width, height);
+  std::vector<ImageMipLevel> levels;
+  levels.reserve(levelCount - 1);
+
+  const uint8_t *src = pixels;
+  uint32_t srcWidth = width;
+  uint32_t srcHeight = height;
+  for (uint32_t i = 1; i < levelCount; i++) {
+    ImageMipLevel level{};
+    level.width = std::max(srcWidth / 2, 1u);
+    level.height = std::max(srcHeight / 2, 1u);
+    level.pixels.resize(static_cast<size_t>(level.width) * level.height * 4);
+    downsampleRGBA8(src, srcWidth, srcHeight, level.pixels.data(), srgb);
+    levels.push_back(std::move(level));
+
+    src = levels.back().pixels.data();
+    srcWidth = levels.back().width;
+    srcHeight = levels.back().height;
+  }
+  return levels;
+}
+
+}  // namespace lve
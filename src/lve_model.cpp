@@ -11,8 +11,11 @@
 #include "third_party/cgltf/cgltf.h"
 
 // std
+#include <algorithm>
 #include <cassert>
+#include <cmath>
 #include <cstring>
+#include <limits>
 #include <unordered_map>
 #include <iostream>
 
@@ -33,10 +36,48 @@ namespace lve {
 LveModel::LveModel(LveDevice &device, const LveModel::Builder &builder) : lveDevice{ device } {
   createVertexBuffers(builder.vertices);
   createIndexBuffers(builder.indices);
+  computeBounds(builder);
+  vertexColors = std::any_of(
+      builder.vertices.begin(), builder.vertices.end(), [](const Vertex &vertex) {
+        return vertex.color != glm::vec3{1.f};
+      });
 }
 
 LveModel::~LveModel() {}
 
+void LveModel::computeBounds(const Builder &builder) {
+  const auto &vertices = builder.vertices;
+  glm::vec3 minPos{std::numeric_limits<float>::max()};
+  glm::vec3 maxPos{std::numeric_limits<float>::lowest()};
+  for (const auto &vertex : vertices) {
+    minPos = glm::min(minPos, vertex.position);
+    maxPos = glm::max(maxPos, vertex.position);
+  }
+  boundingCenter = (minPos + maxPos) * 0.5f;
+  for (const auto &vertex : vertices) {
+    boundingRadius = std::max(boundingRadius, glm::length(vertex.position - boundingCenter));
+  }
+
+  // ratio of the summed triangle areas in UV space and in model space
+  size_t triangleCount = builder.indices.empty() ? vertices.size() / 3 : builder.indices.size() / 3;
+  auto corner = [&](size_t triangle, size_t i) -> const Vertex & {
+    size_t index = 3 * triangle + i;
+    return vertices[builder.indices.empty() ? index : builder.indices[index]];
+  };
+  float uvArea = 0.f;
+  float surfaceArea = 0.f;
+  for (size_t t = 0; t < triangleCount; t++) {
+    const Vertex &v0 = corner(t, 0);
+    const Vertex &v1 = corner(t, 1);
+    const Vertex &v2 = corner(t, 2);
+    surfaceArea += 0.5f * glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+    glm::vec2 e1 = v1.uv - v0.uv;
+    glm::vec2 e2 = v2.uv - v0.uv;
+    uvArea += 0.5f * std::abs(e1.x * e2.y - e1.y * e2.x);
+  }
+  uvDensity = surfaceArea > 0.f ? std::sqrt(uvArea / surfaceArea) : 0.f;
+}
+
 void LveModel::createVertexBuffers(const std::vector<Vertex> &vertices) {
   vertexCount = static_cast<uint32_t>(vertices.size());
   assert(vertexCount >= 3 && "Vertex count must be at least 3");
@@ -3,6 +3,7 @@
 #include "lve_model.hpp"
 
 // std
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -10,18 +11,93 @@
 
 namespace lve {
 
+  void LveSpecializationConstants::set(uint32_t constantID, uint32_t value) {
+    for (auto& entry : mapEntries) {
+      if (entry.constantID == constantID) {
+        data[entry.offset / sizeof(uint32_t)] = value;
+        return;
+      }
+    }
+    VkSpecializationMapEntry entry{};
+    entry.constantID = constantID;
+    entry.offset = static_cast<uint32_t>(data.size() * sizeof(uint32_t));
+    entry.size = sizeof(uint32_t);
+    mapEntries.push_back(entry);
+    data.push_back(value);
+  }
+
+  VkSpecializationInfo LveSpecializationConstants::info() const {
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = static_cast<uint32_t>(mapEntries.size());
+    specializationInfo.pMapEntries = mapEntries.data();
+    specializationInfo.dataSize = data.size() * sizeof(uint32_t);
+    specializationInfo.pData = data.data();
+    return specializationInfo;
+  }
+
+  void LveRenderTargetFormat::applyTo(PipelineConfigInfo& configInfo) const {
+    configInfo.renderPass = renderPass;
+    configInfo.subpass = subpass;
+    configInfo.colorAttachmentFormats = colorFormats;
+    configInfo.depthAttachmentFormat = depthFormat;
+  }
+
   LvePipeline::LvePipeline(
     LveDevice& device,
     const std::string& vertFilepath,
     const std::string& fragFilepath,
     const PipelineConfigInfo& configInfo)
     : lveDevice{ device } {
-    createGraphicsPipeline(vertFilepath, fragFilepath, configInfo);
+    VkShaderModule vertShaderModule;
+    VkShaderModule fragShaderModule;
+    createShaderModule(readFile(vertFilepath), &vertShaderModule);
+    createShaderModule(readFile(fragFilepath), &fragShaderModule);
+    extendedDynamicState = hasDynamicState(configInfo, VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    // the pipeline keeps what it needs, the modules are only inputs
+    try {
+      createGraphicsPipeline(vertShaderModule, fragShaderModule, configInfo, VK_NULL_HANDLE);
+    } catch (...) {
+      vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
+      vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
+      throw;
+    }
+    vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
+    vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
+  }
+
+  LvePipeline::LvePipeline(
+    LveDevice& device,
+    VkShaderModule vertShaderModule,
+    VkShaderModule fragShaderModule,
+    const PipelineConfigInfo& configInfo,
+    VkPipelineCache pipelineCache)
+    : lveDevice{ device } {
+    extendedDynamicState = hasDynamicState(configInfo, VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    createGraphicsPipeline(vertShaderModule, fragShaderModule, configInfo, pipelineCache);
+  }
+
+  LvePipeline::LvePipeline(
+    LveDevice& device,
+    VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+    VkShaderModule shaderModule,
+    const PipelineConfigInfo& configInfo,
+    VkPipelineCache pipelineCache)
+    : lveDevice{ device } {
+    createPipelineLibrary(libraryPart, shaderModule, configInfo, pipelineCache);
+  }
+
+  LvePipeline::LvePipeline(
+    LveDevice& device,
+    const std::vector<VkPipeline>& libraries,
+    const PipelineConfigInfo& configInfo,
+    bool linkTimeOptimization,
+    VkPipelineCache pipelineCache)
+    : lveDevice{ device } {
+    extendedDynamicState = hasDynamicState(configInfo, VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    linkPipelineLibraries(libraries, configInfo, linkTimeOptimization, pipelineCache);
   }
 
   LvePipeline::~LvePipeline() {
-    vkDestroyShaderModule(lveDevice.device(), vertShaderModule, nullptr);
-    vkDestroyShaderModule(lveDevice.device(), fragShaderModule, nullptr);
     vkDestroyPipeline(lveDevice.device(), graphicsPipeline, nullptr);
   }
 
@@ -42,22 +118,32 @@ namespace lve {
     return buffer;
   }
 
+  VkPipelineRenderingCreateInfoKHR LvePipeline::renderingCreateInfo(const PipelineConfigInfo& configInfo) {
+    VkPipelineRenderingCreateInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(configInfo.colorAttachmentFormats.size());
+    renderingInfo.pColorAttachmentFormats = configInfo.colorAttachmentFormats.data();
+    renderingInfo.depthAttachmentFormat = configInfo.depthAttachmentFormat;
+    // LveRenderingPass never binds a stencil attachment
+    renderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+    return renderingInfo;
+  }
+
   void LvePipeline::createGraphicsPipeline(
-    const std::string& vertFilepath,
-    const std::string& fragFilepath,
-    const PipelineConfigInfo& configInfo) {
+    VkShaderModule vertShaderModule,
+    VkShaderModule fragShaderModule,
+    const PipelineConfigInfo& configInfo,
+    VkPipelineCache pipelineCache) {
     assert(
       configInfo.pipelineLayout != VK_NULL_HANDLE &&
       "Cannot create graphics pipeline: no pipelineLayout provided in configInfo");
     assert(
-      configInfo.renderPass != VK_NULL_HANDLE &&
-      "Cannot create graphics pipeline: no renderPass provided in configInfo");
-
-    auto vertCode = readFile(vertFilepath);
-    auto fragCode = readFile(fragFilepath);
+      (configInfo.renderPass != VK_NULL_HANDLE || !configInfo.colorAttachmentFormats.empty() ||
+       configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+      "Cannot create graphics pipeline: no renderPass or attachment formats provided in configInfo");
 
-    createShaderModule(vertCode, &vertShaderModule);
-    createShaderModule(fragCode, &fragShaderModule);
+    VkSpecializationInfo vertSpecializationInfo = configInfo.vertSpecialization.info();
+    VkSpecializationInfo fragSpecializationInfo = configInfo.fragSpecialization.info();
 
     VkPipelineShaderStageCreateInfo shaderStages[2];
     shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -66,14 +152,16 @@ namespace lve {
     shaderStages[0].pName = "main";
     shaderStages[0].flags = 0;
     shaderStages[0].pNext = nullptr;
-    shaderStages[0].pSpecializationInfo = nullptr;
+    shaderStages[0].pSpecializationInfo =
+      configInfo.vertSpecialization.empty() ? nullptr : &vertSpecializationInfo;
     shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
     shaderStages[1].module = fragShaderModule;
     shaderStages[1].pName = "main";
     shaderStages[1].flags = 0;
     shaderStages[1].pNext = nullptr;
-    shaderStages[1].pSpecializationInfo = nullptr;
+    shaderStages[1].pSpecializationInfo =
+      configInfo.fragSpecialization.empty() ? nullptr : &fragSpecializationInfo;
 
     auto bindingDescriptions = configInfo.bindingDescriptions;
     auto attributeDescriptions = configInfo.attributeDescriptions;
@@ -85,8 +173,11 @@ namespace lve {
     vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
     vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
 
+    VkPipelineRenderingCreateInfoKHR renderingInfo = renderingCreateInfo(configInfo);
+
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = configInfo.renderPass == VK_NULL_HANDLE ? &renderingInfo : nullptr;
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
     pipelineInfo.pVertexInputState = &vertexInputInfo;
@@ -107,7 +198,7 @@ namespace lve {
 
     if (vkCreateGraphicsPipelines(
       lveDevice.device(),
-      VK_NULL_HANDLE,
+      pipelineCache,
       1,
       &pipelineInfo,
       nullptr,
@@ -116,6 +207,131 @@ namespace lve {
     }
   }
 
+  void LvePipeline::createPipelineLibrary(
+    VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+    VkShaderModule shaderModule,
+    const PipelineConfigInfo& configInfo,
+    VkPipelineCache pipelineCache) {
+    assert(
+      configInfo.pipelineLayout != VK_NULL_HANDLE &&
+      "Cannot create pipeline library: no pipelineLayout provided in configInfo");
+    assert(
+      (configInfo.renderPass != VK_NULL_HANDLE || !configInfo.colorAttachmentFormats.empty() ||
+       configInfo.depthAttachmentFormat != VK_FORMAT_UNDEFINED) &&
+      "Cannot create pipeline library: no renderPass or attachment formats provided in configInfo");
+
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = libraryPart;
+    // every part takes the formats it needs from the same struct
+    VkPipelineRenderingCreateInfoKHR renderingInfo = renderingCreateInfo(configInfo);
+    if (configInfo.renderPass == VK_NULL_HANDLE) {
+      libraryInfo.pNext = &renderingInfo;
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &libraryInfo;
+    // keeps what the optimized link of linkPipelineLibraries needs
+    pipelineInfo.flags =
+      VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    pipelineInfo.pDynamicState = &configInfo.dynamicStateInfo;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    auto bindingDescriptions = configInfo.bindingDescriptions;
+    auto attributeDescriptions = configInfo.attributeDescriptions;
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexAttributeDescriptionCount =
+      static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+
+    VkSpecializationInfo specializationInfo{};
+    VkPipelineShaderStageCreateInfo shaderStage{};
+    shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStage.module = shaderModule;
+    shaderStage.pName = "main";
+
+    switch (libraryPart) {
+      case VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT:
+        pipelineInfo.pVertexInputState = &vertexInputInfo;
+        pipelineInfo.pInputAssemblyState = &configInfo.inputAssemblyInfo;
+        break;
+      case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        specializationInfo = configInfo.vertSpecialization.info();
+        shaderStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+        shaderStage.pSpecializationInfo =
+          configInfo.vertSpecialization.empty() ? nullptr : &specializationInfo;
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &shaderStage;
+        pipelineInfo.pViewportState = &configInfo.viewportInfo;
+        pipelineInfo.pRasterizationState = &configInfo.rasterizationInfo;
+        pipelineInfo.layout = configInfo.pipelineLayout;
+        break;
+      case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        specializationInfo = configInfo.fragSpecialization.info();
+        shaderStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+        shaderStage.pSpecializationInfo =
+          configInfo.fragSpecialization.empty() ? nullptr : &specializationInfo;
+        pipelineInfo.stageCount = 1;
+        pipelineInfo.pStages = &shaderStage;
+        pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+        pipelineInfo.pDepthStencilState = &configInfo.depthStencilInfo;
+        pipelineInfo.layout = configInfo.pipelineLayout;
+        break;
+      case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT:
+        pipelineInfo.pMultisampleState = &configInfo.multisampleInfo;
+        pipelineInfo.pColorBlendState = &configInfo.colorBlendInfo;
+        break;
+      default:
+        throw std::runtime_error("failed to create pipeline library: unknown library part!");
+    }
+    pipelineInfo.renderPass = configInfo.renderPass;
+    pipelineInfo.subpass = configInfo.subpass;
+
+    if (vkCreateGraphicsPipelines(
+      lveDevice.device(),
+      pipelineCache,
+      1,
+      &pipelineInfo,
+      nullptr,
+      &graphicsPipeline) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create pipeline library");
+    }
+  }
+
+  void LvePipeline::linkPipelineLibraries(
+    const std::vector<VkPipeline>& libraries,
+    const PipelineConfigInfo& configInfo,
+    bool linkTimeOptimization,
+    VkPipelineCache pipelineCache) {
+    VkPipelineLibraryCreateInfoKHR linkInfo{};
+    linkInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    linkInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    linkInfo.pLibraries = libraries.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.pNext = &linkInfo;
+    pipelineInfo.flags = linkTimeOptimization ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    pipelineInfo.layout = configInfo.pipelineLayout;
+    pipelineInfo.basePipelineIndex = -1;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    if (vkCreateGraphicsPipelines(
+      lveDevice.device(),
+      pipelineCache,
+      1,
+      &pipelineInfo,
+      nullptr,
+      &graphicsPipeline) != VK_SUCCESS) {
+      throw std::runtime_error("failed to link graphics pipeline");
+    }
+  }
+
   void LvePipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shaderModule) {
     VkShaderModuleCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -207,6 +423,42 @@ namespace lve {
     configInfo.attributeDescriptions = LveModel::Vertex::getAttributeDescriptions();
   }
 
+  void LvePipeline::enableExtendedDynamicState(PipelineConfigInfo& configInfo, const LveDevice& device) {
+    auto& functions = device.extendedDynamicState();
+    if (functions.cmdSetCullMode == nullptr) return;
+
+    assert(
+      configInfo.dynamicStateInfo.pDynamicStates == configInfo.dynamicStateEnables.data() &&
+      "Dynamic states are expected in dynamicStateEnables");
+    auto& states = configInfo.dynamicStateEnables;
+    auto enable = [&states](VkDynamicState state) {
+      if (std::find(states.begin(), states.end(), state) == states.end()) states.push_back(state);
+    };
+    enable(VK_DYNAMIC_STATE_CULL_MODE_EXT);
+    enable(VK_DYNAMIC_STATE_FRONT_FACE_EXT);
+    // within the topology class of inputAssemblyInfo.topology
+    enable(VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT);
+    enable(VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT);
+    enable(VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT);
+    enable(VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT);
+    if (functions.cmdSetDepthBiasEnable != nullptr) {
+      enable(VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT);
+    }
+    if (functions.cmdSetPolygonMode != nullptr) {
+      enable(VK_DYNAMIC_STATE_POLYGON_MODE_EXT);
+    }
+    configInfo.dynamicStateInfo.pDynamicStates = configInfo.dynamicStateEnables.data();
+    configInfo.dynamicStateInfo.dynamicStateCount =
+      static_cast<uint32_t>(configInfo.dynamicStateEnables.size());
+  }
+
+  bool LvePipeline::hasDynamicState(const PipelineConfigInfo& configInfo, VkDynamicState state) {
+    for (uint32_t i = 0; i < configInfo.dynamicStateInfo.dynamicStateCount; i++) {
+      if (configInfo.dynamicStateInfo.pDynamicStates[i] == state) return true;
+    }
+    return false;
+  }
+
   void LvePipeline::enableAlphaBlending(PipelineConfigInfo& configInfo) {
     configInfo.colorBlendAttachment.blendEnable = VK_TRUE;
     configInfo.colorBlendAttachment.colorWriteMask =
@@ -0,0 +1,65 @@
+#include "lve_pipeline_permutations.hpp"
+
+// std
+#include <utility>
+
+namespace lve {
+
+LvePipelinePermutations::LvePipelinePermutations(
+    LvePipelineRegistry &registry,
+    std::string vertFilepath,
+    std::string fragFilepath,
+    uint32_t fullPermutation,
+    ConfigureFn configure,
+    LveThreadPool *threadPool)
+    : registry{registry},
+      vertFilepath{std::move(vertFilepath)},
+      fragFilepath{std::move(fragFilepath)},
+      fullPermutation{fullPermutation},
+      configure{std::move(configure)},
+      threadPool{threadPool} {
+  std::lock_guard<std::mutex> lock{mutex};
+  request(fullPermutation);
+}
+
+LvePipelinePermutations::~LvePipelinePermutations() { wait(); }
+
+void LvePipelinePermutations::prepare(uint32_t permutation) {
+  std::lock_guard<std::mutex> lock{mutex};
+  request(permutation);
+}
+
+LvePipeline *LvePipelinePermutations::get(uint32_t permutation) {
+  std::lock_guard<std::mutex> lock{mutex};
+  return request(permutation).get();
+}
+
+void LvePipelinePermutations::wait() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  for (auto &kv : handles) {
+    kv.second.wait();
+  }
+}
+
+size_t LvePipelinePermutations::size() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  return handles.size();
+}
+
+const LvePipelineHandle &LvePipelinePermutations::request(uint32_t permutation) {
+  auto found = handles.find(permutation);
+  if (found != handles.end()) {
+    return found->second;
+  }
+
+  PipelineConfigInfo pipelineConfig{};
+  configure(permutation, pipelineConfig);
+  LvePipelineHandle handle =
+      registry.requestPipeline(vertFilepath, fragFilepath, pipelineConfig, threadPool);
+  if (permutation != fullPermutation) {
+    handle.setFallback(handles.at(fullPermutation));
+  }
+  return handles.emplace(permutation, std::move(handle)).first->second;
+}
+
+}  // namespace lve
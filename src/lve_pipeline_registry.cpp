@@ -0,0 +1,604 @@
+#include "lve_pipeline_registry.hpp"
+
+// std
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+uint64_t fnv1a(const char *data, size_t size) {
+  uint64_t hash = 14695981039346656037ull;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<uint8_t>(data[i]);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+template <typename T>
+uint64_t bits(T value) {
+  static_assert(sizeof(T) <= sizeof(uint64_t), "value does not fit a key word");
+  uint64_t word = 0;
+  std::memcpy(&word, &value, sizeof(value));
+  return word;
+}
+
+void appendStencil(std::vector<uint64_t> &key, const VkStencilOpState &state) {
+  key.push_back(state.failOp);
+  key.push_back(state.passOp);
+  key.push_back(state.depthFailOp);
+  key.push_back(state.compareOp);
+  key.push_back(state.compareMask);
+  key.push_back(state.writeMask);
+  key.push_back(state.reference);
+}
+
+// state set per draw does not tell pipelines apart
+uint64_t unlessDynamic(const PipelineConfigInfo &config, VkDynamicState state, uint64_t value) {
+  return LvePipeline::hasDynamicState(config, state) ? ~0ull : value;
+}
+
+// dynamic topology stays within the class the pipeline was made with
+uint64_t topologyClass(VkPrimitiveTopology topology) {
+  switch (topology) {
+    case VK_PRIMITIVE_TOPOLOGY_POINT_LIST:
+      return 0;
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_LIST_WITH_ADJACENCY:
+    case VK_PRIMITIVE_TOPOLOGY_LINE_STRIP_WITH_ADJACENCY:
+      return 1;
+    case VK_PRIMITIVE_TOPOLOGY_PATCH_LIST:
+      return 3;
+    default:
+      return 2;
+  }
+}
+
+void appendSpecialization(std::vector<uint64_t> &key, const LveSpecializationConstants &constants) {
+  key.push_back(constants.mapEntries.size());
+  for (auto &entry : constants.mapEntries) {
+    key.push_back(entry.constantID);
+    key.push_back(constants.data[entry.offset / sizeof(uint32_t)]);
+  }
+}
+
+// The fields of each graphics pipeline library part, see LvePipeline::createPipelineLibrary.
+// Pointers are followed, not compared.
+void appendVertexInput(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  key.push_back(config.bindingDescriptions.size());
+  for (auto &binding : config.bindingDescriptions) {
+    key.push_back(binding.binding);
+    key.push_back(binding.stride);
+    key.push_back(binding.inputRate);
+  }
+  key.push_back(config.attributeDescriptions.size());
+  for (auto &attribute : config.attributeDescriptions) {
+    key.push_back(attribute.location);
+    key.push_back(attribute.binding);
+    key.push_back(attribute.format);
+    key.push_back(attribute.offset);
+  }
+
+  key.push_back(
+      LvePipeline::hasDynamicState(config, VK_DYNAMIC_STATE_PRIMITIVE_TOPOLOGY_EXT)
+          ? topologyClass(config.inputAssemblyInfo.topology)
+          : config.inputAssemblyInfo.topology);
+  key.push_back(config.inputAssemblyInfo.primitiveRestartEnable);
+}
+
+void appendPreRasterization(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  key.push_back(config.viewportInfo.viewportCount);
+  key.push_back(config.viewportInfo.scissorCount);
+
+  auto &raster = config.rasterizationInfo;
+  key.push_back(raster.depthClampEnable);
+  key.push_back(raster.rasterizerDiscardEnable);
+  key.push_back(unlessDynamic(config, VK_DYNAMIC_STATE_POLYGON_MODE_EXT, raster.polygonMode));
+  key.push_back(unlessDynamic(config, VK_DYNAMIC_STATE_CULL_MODE_EXT, raster.cullMode));
+  key.push_back(unlessDynamic(config, VK_DYNAMIC_STATE_FRONT_FACE_EXT, raster.frontFace));
+  key.push_back(
+      unlessDynamic(config, VK_DYNAMIC_STATE_DEPTH_BIAS_ENABLE_EXT, raster.depthBiasEnable));
+  key.push_back(bits(raster.depthBiasConstantFactor));
+  key.push_back(bits(raster.depthBiasClamp));
+  key.push_back(bits(raster.depthBiasSlopeFactor));
+  key.push_back(bits(raster.lineWidth));
+
+  appendSpecialization(key, config.vertSpecialization);
+}
+
+void appendMultisample(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  auto &multisample = config.multisampleInfo;
+  key.push_back(multisample.rasterizationSamples);
+  key.push_back(multisample.sampleShadingEnable);
+  key.push_back(bits(multisample.minSampleShading));
+  key.push_back(multisample.pSampleMask ? multisample.pSampleMask[0] : ~0ull);
+  key.push_back(multisample.alphaToCoverageEnable);
+  key.push_back(multisample.alphaToOneEnable);
+}
+
+void appendFragmentShader(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  appendMultisample(key, config);
+
+  auto &depth = config.depthStencilInfo;
+  key.push_back(
+      unlessDynamic(config, VK_DYNAMIC_STATE_DEPTH_TEST_ENABLE_EXT, depth.depthTestEnable));
+  key.push_back(
+      unlessDynamic(config, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT, depth.depthWriteEnable));
+  key.push_back(
+      unlessDynamic(config, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT, depth.depthCompareOp));
+  key.push_back(depth.depthBoundsTestEnable);
+  key.push_back(depth.stencilTestEnable);
+  appendStencil(key, depth.front);
+  appendStencil(key, depth.back);
+  key.push_back(bits(depth.minDepthBounds));
+  key.push_back(bits(depth.maxDepthBounds));
+
+  appendSpecialization(key, config.fragSpecialization);
+}
+
+void appendFragmentOutput(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  appendMultisample(key, config);
+
+  auto &blend = config.colorBlendInfo;
+  key.push_back(blend.logicOpEnable);
+  key.push_back(blend.logicOp);
+  key.push_back(blend.attachmentCount);
+  for (uint32_t i = 0; i < blend.attachmentCount; i++) {
+    auto &attachment = blend.pAttachments[i];
+    key.push_back(attachment.blendEnable);
+    key.push_back(attachment.srcColorBlendFactor);
+    key.push_back(attachment.dstColorBlendFactor);
+    key.push_back(attachment.colorBlendOp);
+    key.push_back(attachment.srcAlphaBlendFactor);
+    key.push_back(attachment.dstAlphaBlendFactor);
+    key.push_back(attachment.alphaBlendOp);
+    key.push_back(attachment.colorWriteMask);
+  }
+  for (float constant : blend.blendConstants) {
+    key.push_back(bits(constant));
+  }
+}
+
+// what every part shares
+void appendCommon(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  auto &dynamic = config.dynamicStateInfo;
+  key.push_back(dynamic.dynamicStateCount);
+  for (uint32_t i = 0; i < dynamic.dynamicStateCount; i++) {
+    key.push_back(dynamic.pDynamicStates[i]);
+  }
+
+  key.push_back(bits(config.pipelineLayout));
+  key.push_back(bits(config.renderPass));
+  key.push_back(config.subpass);
+  key.push_back(config.colorAttachmentFormats.size());
+  for (VkFormat format : config.colorAttachmentFormats) {
+    key.push_back(format);
+  }
+  key.push_back(config.depthAttachmentFormat);
+}
+
+// every field that ends up in the pipeline
+void appendConfig(std::vector<uint64_t> &key, const PipelineConfigInfo &config) {
+  appendVertexInput(key, config);
+  appendPreRasterization(key, config);
+  appendFragmentShader(key, config);
+  appendFragmentOutput(key, config);
+  appendCommon(key, config);
+}
+
+// PipelineConfigInfo is not copyable and points into itself, a compile job needs its own
+std::shared_ptr<PipelineConfigInfo> copyConfig(const PipelineConfigInfo &config) {
+  auto copy = std::make_shared<PipelineConfigInfo>();
+  copy->bindingDescriptions = config.bindingDescriptions;
+  copy->attributeDescriptions = config.attributeDescriptions;
+  copy->viewportInfo = config.viewportInfo;
+  copy->inputAssemblyInfo = config.inputAssemblyInfo;
+  copy->rasterizationInfo = config.rasterizationInfo;
+  copy->multisampleInfo = config.multisampleInfo;
+  copy->colorBlendAttachment = config.colorBlendAttachment;
+  copy->colorBlendInfo = config.colorBlendInfo;
+  copy->depthStencilInfo = config.depthStencilInfo;
+  copy->dynamicStateEnables = config.dynamicStateEnables;
+  copy->dynamicStateInfo = config.dynamicStateInfo;
+  copy->pipelineLayout = config.pipelineLayout;
+  copy->renderPass = config.renderPass;
+  copy->subpass = config.subpass;
+  copy->colorAttachmentFormats = config.colorAttachmentFormats;
+  copy->depthAttachmentFormat = config.depthAttachmentFormat;
+  copy->vertSpecialization = config.vertSpecialization;
+  copy->fragSpecialization = config.fragSpecialization;
+
+  assert(
+      (config.colorBlendInfo.attachmentCount == 0 ||
+       config.colorBlendInfo.pAttachments == &config.colorBlendAttachment) &&
+      "Only the config's own blend attachment can be copied");
+  copy->colorBlendInfo.pAttachments =
+      config.colorBlendInfo.attachmentCount > 0 ? &copy->colorBlendAttachment : nullptr;
+  assert(
+      (config.dynamicStateInfo.dynamicStateCount == 0 ||
+       config.dynamicStateInfo.pDynamicStates == config.dynamicStateEnables.data()) &&
+      "Only the config's own dynamic states can be copied");
+  copy->dynamicStateInfo.pDynamicStates = copy->dynamicStateEnables.data();
+  return copy;
+}
+
+std::shared_future<std::shared_ptr<LvePipeline>> readyFuture(
+    std::shared_ptr<LvePipeline> pipeline) {
+  std::promise<std::shared_ptr<LvePipeline>> promise;
+  promise.set_value(std::move(pipeline));
+  return promise.get_future().share();
+}
+
+bool isReady(const std::shared_future<std::shared_ptr<LvePipeline>> &pipeline) {
+  return pipeline.valid() &&
+         pipeline.wait_for(std::chrono::seconds{0}) == std::future_status::ready;
+}
+
+// The saved cache data, or nothing when the file is missing or was written by another device or
+// driver version. Drivers check the header themselves, but not all of them reliably.
+std::vector<char> readPipelineCache(
+    const std::string &filepath, const VkPhysicalDeviceProperties &properties) {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) return {};
+  std::vector<char> data(static_cast<size_t>(file.tellg()));
+  file.seekg(0);
+  file.read(data.data(), static_cast<std::streamsize>(data.size()));
+  if (!file || data.size() < sizeof(VkPipelineCacheHeaderVersionOne)) return {};
+
+  VkPipelineCacheHeaderVersionOne header;
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.headerSize < sizeof(header) ||
+      header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+      header.vendorID != properties.vendorID || header.deviceID != properties.deviceID ||
+      std::memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+    return {};
+  }
+  return data;
+}
+
+// first word of a key, library parts use their VkGraphicsPipelineLibraryFlagBitsEXT
+constexpr uint64_t COMPLETE_PIPELINE = 0;
+
+}  // namespace
+
+bool LvePipelineHandle::ready() const { return slot && isReady(slot->pipeline); }
+
+LvePipeline *LvePipelineHandle::get() const {
+  if (slot && isReady(slot->optimized)) {
+    return slot->optimized.get().get();
+  }
+  if (ready()) {
+    return slot->pipeline.get().get();
+  }
+  if (fallback && isReady(fallback->optimized)) {
+    return fallback->optimized.get().get();
+  }
+  if (fallback && isReady(fallback->pipeline)) {
+    return fallback->pipeline.get().get();
+  }
+  return nullptr;
+}
+
+void LvePipelineHandle::wait() const {
+  if (!slot) return;
+  slot->pipeline.wait();
+  if (slot->optimized.valid()) {
+    slot->optimized.wait();
+  }
+}
+
+size_t LvePipelineRegistry::KeyHash::operator()(const std::vector<uint64_t> &key) const {
+  return static_cast<size_t>(
+      fnv1a(reinterpret_cast<const char *>(key.data()), key.size() * sizeof(uint64_t)));
+}
+
+template <typename F>
+std::shared_future<std::shared_ptr<LvePipeline>> LvePipelineRegistry::submitCompile(
+    LveThreadPool &threadPool, F compile) {
+  pendingCompiles++;
+  return threadPool
+      .submit([this, compile]() {
+        struct Finish {
+          LvePipelineRegistry *registry;
+          ~Finish() { registry->finishCompile(); }
+        } finish{this};
+        return compile();
+      })
+      .share();
+}
+
+LvePipelineRegistry::LvePipelineRegistry(LveDevice &lveDevice, const std::string &cacheFilepath)
+    : lveDevice{lveDevice}, cacheFilepath{cacheFilepath} {
+  std::vector<char> initialData = readPipelineCache(cacheFilepath, lveDevice.properties);
+  VkPipelineCacheCreateInfo cacheInfo{};
+  cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  cacheInfo.initialDataSize = initialData.size();
+  cacheInfo.pInitialData = initialData.data();
+  VkResult result = vkCreatePipelineCache(lveDevice.device(), &cacheInfo, nullptr, &pipelineCache);
+  if (result != VK_SUCCESS && !initialData.empty()) {
+    // a damaged file only costs the warm start
+    cacheInfo.initialDataSize = 0;
+    cacheInfo.pInitialData = nullptr;
+    result = vkCreatePipelineCache(lveDevice.device(), &cacheInfo, nullptr, &pipelineCache);
+  }
+  if (result != VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline cache!");
+  }
+}
+
+LvePipelineRegistry::~LvePipelineRegistry() {
+  std::unique_lock<std::mutex> lock{mutex};
+  compileDone.wait(lock, [this]() { return pendingCompiles == 0; });
+  destroyShaderModules();
+  savePipelineCache();
+  vkDestroyPipelineCache(lveDevice.device(), pipelineCache, nullptr);
+}
+
+void LvePipelineRegistry::savePipelineCache() const {
+  size_t size = 0;
+  if (vkGetPipelineCacheData(lveDevice.device(), pipelineCache, &size, nullptr) != VK_SUCCESS ||
+      size == 0) {
+    return;
+  }
+  std::vector<char> data(size);
+  if (vkGetPipelineCacheData(lveDevice.device(), pipelineCache, &size, data.data()) !=
+      VK_SUCCESS) {
+    return;
+  }
+
+  // written aside and renamed, so an interrupted write leaves the previous cache intact
+  std::string tempFilepath = cacheFilepath + ".tmp";
+  {
+    std::ofstream file{tempFilepath, std::ios::binary | std::ios::trunc};
+    file.write(data.data(), static_cast<std::streamsize>(size));
+    if (!file) return;
+  }
+  std::remove(cacheFilepath.c_str());
+  std::rename(tempFilepath.c_str(), cacheFilepath.c_str());
+}
+
+LvePipelineHandle LvePipelineRegistry::requestPipeline(
+    const std::string &vertFilepath,
+    const std::string &fragFilepath,
+    const PipelineConfigInfo &configInfo,
+    LveThreadPool *threadPool) {
+  std::lock_guard<std::mutex> lock{mutex};
+
+  std::vector<uint64_t> key{COMPLETE_PIPELINE};
+  key.push_back(getShaderFile(vertFilepath).contentHash);
+  key.push_back(getShaderFile(fragFilepath).contentHash);
+  appendConfig(key, configInfo);
+
+  LvePipelineHandle handle{};
+  auto found = pipelines.find(key);
+  if (found != pipelines.end()) {
+    // also catches a pipeline that is still compiling for someone else
+    if ((handle.slot = found->second.lock())) {
+      pipelineHits++;
+      return handle;
+    }
+  }
+
+  VkShaderModule vertShaderModule = getShaderModule(vertFilepath);
+  VkShaderModule fragShaderModule = getShaderModule(fragFilepath);
+  // a file that changed on disk since it was first hashed was just re-read
+  key[1] = getShaderFile(vertFilepath).contentHash;
+  key[2] = getShaderFile(fragFilepath).contentHash;
+
+  handle.slot = std::make_shared<LvePipelineHandle::Slot>();
+  if (lveDevice.supportsGraphicsPipelineLibrary()) {
+    linkPipeline(
+        *handle.slot, key[1], vertShaderModule, key[2], fragShaderModule, configInfo, threadPool);
+  } else if (threadPool) {
+    auto config = copyConfig(configInfo);
+    handle.slot->pipeline =
+        submitCompile(*threadPool, [this, config, vertShaderModule, fragShaderModule]() {
+          return std::make_shared<LvePipeline>(
+              lveDevice, vertShaderModule, fragShaderModule, *config, pipelineCache);
+        });
+  } else {
+    handle.slot->pipeline = readyFuture(std::make_shared<LvePipeline>(
+        lveDevice, vertShaderModule, fragShaderModule, configInfo, pipelineCache));
+  }
+  pipelines[key] = handle.slot;
+  pipelinesCreated++;
+
+  // forget users that are gone so stale layouts and render passes cannot match later
+  for (auto it = pipelines.begin(); it != pipelines.end();) {
+    it = it->second.expired() ? pipelines.erase(it) : std::next(it);
+  }
+  return handle;
+}
+
+void LvePipelineRegistry::releaseShaderModules() {
+  std::lock_guard<std::mutex> lock{mutex};
+  if (pendingCompiles > 0) {
+    releaseModulesWhenIdle = true;
+    return;
+  }
+  destroyShaderModules();
+}
+
+LvePipelineRegistry::Stats LvePipelineRegistry::getStats() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  Stats stats{};
+  stats.pipelinesCreated = pipelinesCreated;
+  stats.pipelinesPending = pendingCompiles;
+  stats.pipelineHits = pipelineHits;
+  stats.librariesCreated = librariesCreated;
+  stats.shaderModules = static_cast<uint32_t>(shaderModules.size());
+  stats.shaderFilesRead = shaderFilesRead;
+  return stats;
+}
+
+void LvePipelineRegistry::linkPipeline(
+    LvePipelineHandle::Slot &slot,
+    uint64_t vertHash,
+    VkShaderModule vertShaderModule,
+    uint64_t fragHash,
+    VkShaderModule fragShaderModule,
+    const PipelineConfigInfo &configInfo,
+    LveThreadPool *threadPool) {
+  auto config = copyConfig(configInfo);
+
+  std::vector<uint64_t> vertexInputKey{
+      VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT};
+  appendVertexInput(vertexInputKey, configInfo);
+  appendCommon(vertexInputKey, configInfo);
+  std::vector<uint64_t> preRasterizationKey{
+      VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT, vertHash};
+  appendPreRasterization(preRasterizationKey, configInfo);
+  appendCommon(preRasterizationKey, configInfo);
+  std::vector<uint64_t> fragmentShaderKey{
+      VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT, fragHash};
+  appendFragmentShader(fragmentShaderKey, configInfo);
+  appendCommon(fragmentShaderKey, configInfo);
+  std::vector<uint64_t> fragmentOutputKey{
+      VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT};
+  appendFragmentOutput(fragmentOutputKey, configInfo);
+  appendCommon(fragmentOutputKey, configInfo);
+
+  slot.libraries = {
+      getLibrary(
+          VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+          vertexInputKey,
+          VK_NULL_HANDLE,
+          config,
+          threadPool),
+      getLibrary(
+          VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+          preRasterizationKey,
+          vertShaderModule,
+          config,
+          threadPool),
+      getLibrary(
+          VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+          fragmentShaderKey,
+          fragShaderModule,
+          config,
+          threadPool),
+      getLibrary(
+          VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+          fragmentOutputKey,
+          VK_NULL_HANDLE,
+          config,
+          threadPool)};
+
+  auto libraries = slot.libraries;
+  auto link = [this, config, libraries](bool linkTimeOptimization) {
+    std::vector<VkPipeline> libraryPipelines;
+    for (auto &library : libraries) {
+      // rethrows a failed library compile
+      libraryPipelines.push_back(library->pipeline.get()->getPipeline());
+    }
+    return std::make_shared<LvePipeline>(
+        lveDevice, libraryPipelines, *config, linkTimeOptimization, pipelineCache);
+  };
+  if (threadPool) {
+    // The pool runs jobs in submission order, so the library jobs these wait for have already
+    // started. The quick link is ready to draw with long before the optimized one replaces it.
+    slot.pipeline = submitCompile(*threadPool, [link]() { return link(false); });
+    slot.optimized = submitCompile(*threadPool, [link]() { return link(true); });
+  } else {
+    slot.pipeline = readyFuture(link(true));
+  }
+}
+
+std::shared_ptr<LvePipelineHandle::Slot> LvePipelineRegistry::getLibrary(
+    VkGraphicsPipelineLibraryFlagBitsEXT libraryPart,
+    const std::vector<uint64_t> &key,
+    VkShaderModule shaderModule,
+    const std::shared_ptr<PipelineConfigInfo> &config,
+    LveThreadPool *threadPool) {
+  auto found = pipelines.find(key);
+  if (found != pipelines.end()) {
+    if (auto library = found->second.lock()) {
+      return library;
+    }
+  }
+
+  auto library = std::make_shared<LvePipelineHandle::Slot>();
+  auto create = [this, libraryPart, shaderModule, config]() {
+    return std::make_shared<LvePipeline>(
+        lveDevice, libraryPart, shaderModule, *config, pipelineCache);
+  };
+  library->pipeline = threadPool ? submitCompile(*threadPool, create) : readyFuture(create());
+  pipelines[key] = library;
+  librariesCreated++;
+  return library;
+}
+
+const LvePipelineRegistry::ShaderFile &LvePipelineRegistry::getShaderFile(
+    const std::string &filepath) {
+  auto found = shaderFiles.find(filepath);
+  if (found != shaderFiles.end()) {
+    return found->second;
+  }
+  ShaderFile file{};
+  file.code = LvePipeline::readFile(filepath);
+  file.contentHash = fnv1a(file.code.data(), file.code.size());
+  shaderFilesRead++;
+  return shaderFiles.emplace(filepath, std::move(file)).first->second;
+}
+
+VkShaderModule LvePipelineRegistry::getShaderModule(const std::string &filepath) {
+  auto &file = shaderFiles.at(filepath);
+  auto found = shaderModules.find(file.contentHash);
+  if (found != shaderModules.end()) {
+    return found->second;
+  }
+  if (file.code.empty()) {
+    file.code = LvePipeline::readFile(filepath);
+    file.contentHash = fnv1a(file.code.data(), file.code.size());
+    shaderFilesRead++;
+    found = shaderModules.find(file.contentHash);
+    if (found != shaderModules.end()) {
+      return found->second;
+    }
+  }
+
+  VkShaderModuleCreateInfo createInfo{};
+  createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+  createInfo.codeSize = file.code.size();
+  createInfo.pCode = reinterpret_cast<const uint32_t *>(file.code.data());
+  VkShaderModule shaderModule;
+  if (vkCreateShaderModule(lveDevice.device(), &createInfo, nullptr, &shaderModule) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create shader module");
+  }
+  shaderModules.emplace(file.contentHash, shaderModule);
+  return shaderModule;
+}
+
+void LvePipelineRegistry::destroyShaderModules() {
+  for (auto &kv : shaderModules) {
+    vkDestroyShaderModule(lveDevice.device(), kv.second, nullptr);
+  }
+  shaderModules.clear();
+  for (auto &kv : shaderFiles) {
+    kv.second.code.clear();
+    kv.second.code.shrink_to_fit();
+  }
+  releaseModulesWhenIdle = false;
+}
+
+void LvePipelineRegistry::finishCompile() {
+  std::lock_guard<std::mutex> lock{mutex};
+  pendingCompiles--;
+  if (pendingCompiles == 0) {
+    if (releaseModulesWhenIdle) {
+      destroyShaderModules();
+    }
+    compileDone.notify_all();
+  }
+}
+
+}  // namespace lve
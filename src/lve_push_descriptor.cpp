@@ -0,0 +1,143 @@
+#include "lve_push_descriptor.hpp"
+
+// std
+#include <cassert>
+#include <cstddef>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+bool isBufferDescriptor(VkDescriptorType type) {
+  return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+}
+
+}  // namespace
+
+LvePushDescriptorSet::LvePushDescriptorSet(
+    LveDevice &lveDevice,
+    const std::vector<VkDescriptorType> &bindingTypes,
+    VkShaderStageFlags stageFlags,
+    LveDescriptorLayoutCache &layoutCache,
+    LveDescriptorSetCache &setCache)
+    : lveDevice{lveDevice}, setCache{setCache}, bindingTypes{bindingTypes} {
+  usePushDescriptors = lveDevice.supportsPushDescriptors() &&
+                       bindingTypes.size() <= lveDevice.maxPushDescriptors();
+
+  LveDescriptorSetLayout::Builder builder{lveDevice};
+  for (uint32_t i = 0; i < bindingTypes.size(); i++) {
+    assert(
+        (isBufferDescriptor(bindingTypes[i]) ||
+         bindingTypes[i] == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER ||
+         bindingTypes[i] == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE ||
+         bindingTypes[i] == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) &&
+        "Push descriptor sets take plain buffers and images only");
+    builder.addBinding(i, bindingTypes[i], stageFlags);
+  }
+  if (usePushDescriptors) {
+    builder.setLayoutFlags(VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR);
+  }
+  setLayout = builder.build(layoutCache);
+}
+
+LvePushDescriptorSet::~LvePushDescriptorSet() {
+  for (auto &entry : templates) {
+    vkDestroyDescriptorUpdateTemplate(lveDevice.device(), entry.updateTemplate, nullptr);
+  }
+}
+
+void LvePushDescriptorSet::setResources(const std::vector<LveDescriptorResource> &newResources) {
+  assert(newResources.size() == bindingTypes.size() && "One resource per binding expected");
+  resources = newResources;
+  if (usePushDescriptors) return;
+
+  // the writer points into resources, which stays put until the next call
+  LveDescriptorWriter writer{*setLayout};
+  for (uint32_t i = 0; i < resources.size(); i++) {
+    if (isBufferDescriptor(bindingTypes[i])) {
+      writer.writeBuffer(i, &resources[i].buffer);
+    } else {
+      writer.writeImage(i, &resources[i].image);
+    }
+  }
+  if (!setCache.getDescriptor(writer, descriptorSet)) {
+    throw std::runtime_error("failed to allocate descriptor set!");
+  }
+}
+
+void LvePushDescriptorSet::bind(
+    VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t setIndex) {
+  assert(!resources.empty() && "setResources was not called");
+  if (usePushDescriptors) {
+    lveDevice.cmdPushDescriptorSetWithTemplate(
+        commandBuffer,
+        getTemplate(pipelineLayout, setIndex),
+        pipelineLayout,
+        setIndex,
+        resources.data());
+    return;
+  }
+  vkCmdBindDescriptorSets(
+      commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      setIndex,
+      1,
+      &descriptorSet,
+      0,
+      nullptr);
+}
+
+void LvePushDescriptorSet::releasePipelineLayout(VkPipelineLayout pipelineLayout) {
+  std::lock_guard<std::mutex> lock{templateMutex};
+  auto entry = templates.begin();
+  while (entry != templates.end()) {
+    if (entry->pipelineLayout == pipelineLayout) {
+      vkDestroyDescriptorUpdateTemplate(lveDevice.device(), entry->updateTemplate, nullptr);
+      entry = templates.erase(entry);
+    } else {
+      ++entry;
+    }
+  }
+}
+
+VkDescriptorUpdateTemplate LvePushDescriptorSet::getTemplate(
+    VkPipelineLayout pipelineLayout, uint32_t setIndex) {
+  std::lock_guard<std::mutex> lock{templateMutex};
+  for (auto &entry : templates) {
+    if (entry.pipelineLayout == pipelineLayout && entry.setIndex == setIndex) {
+      return entry.updateTemplate;
+    }
+  }
+
+  std::vector<VkDescriptorUpdateTemplateEntry> entries(bindingTypes.size());
+  for (uint32_t i = 0; i < entries.size(); i++) {
+    entries[i].dstBinding = i;
+    entries[i].dstArrayElement = 0;
+    entries[i].descriptorCount = 1;
+    entries[i].descriptorType = bindingTypes[i];
+    entries[i].offset = i * sizeof(LveDescriptorResource);
+    entries[i].stride = sizeof(LveDescriptorResource);
+  }
+
+  VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+  templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+  templateInfo.descriptorUpdateEntryCount = static_cast<uint32_t>(entries.size());
+  templateInfo.pDescriptorUpdateEntries = entries.data();
+  templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_PUSH_DESCRIPTORS_KHR;
+  templateInfo.descriptorSetLayout = setLayout->getDescriptorSetLayout();
+  templateInfo.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  templateInfo.pipelineLayout = pipelineLayout;
+  templateInfo.set = setIndex;
+
+  VkDescriptorUpdateTemplate updateTemplate;
+  if (vkCreateDescriptorUpdateTemplate(
+          lveDevice.device(), &templateInfo, nullptr, &updateTemplate) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create descriptor update template!");
+  }
+  templates.push_back({pipelineLayout, setIndex, updateTemplate});
+  return updateTemplate;
+}
+
+}  // namespace lve
@@ -0,0 +1,219 @@
+#include "lve_qoi.hpp"
+
+// std
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr uint8_t QOI_OP_INDEX = 0x00;
+constexpr uint8_t QOI_OP_DIFF = 0x40;
+constexpr uint8_t QOI_OP_LUMA = 0x80;
+constexpr uint8_t QOI_OP_RUN = 0xc0;
+constexpr uint8_t QOI_OP_RGB = 0xfe;
+constexpr uint8_t QOI_OP_RGBA = 0xff;
+constexpr uint8_t QOI_MASK_2 = 0xc0;
+
+constexpr size_t QOI_HEADER_SIZE = 14;
+const uint8_t QOI_PADDING[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+// guards against headers that would make us allocate absurd amounts of memory
+constexpr uint64_t QOI_MAX_PIXELS = 400000000;
+
+struct Rgba {
+  uint8_t r, g, b, a;
+};
+
+inline uint32_t hashIndex(const Rgba &px) { return (px.r * 3u + px.g * 5u + px.b * 7u + px.a * 11u) % 64u; }
+
+inline uint32_t readBigEndian(const uint8_t *bytes) {
+  return (static_cast<uint32_t>(bytes[0]) << 24) | (static_cast<uint32_t>(bytes[1]) << 16) |
+         (static_cast<uint32_t>(bytes[2]) << 8) | bytes[3];
+}
+
+inline void writeBigEndian(std::vector<uint8_t> &bytes, uint32_t value) {
+  bytes.push_back(static_cast<uint8_t>(value >> 24));
+  bytes.push_back(static_cast<uint8_t>(value >> 16));
+  bytes.push_back(static_cast<uint8_t>(value >> 8));
+  bytes.push_back(static_cast<uint8_t>(value));
+}
+
+void validateHeader(const QoiHeader &header) {
+  if (header.width == 0 || header.height == 0 || header.channels < 3 || header.channels > 4 ||
+      header.colorspace > 1 || static_cast<uint64_t>(header.width) * header.height > QOI_MAX_PIXELS) {
+    throw std::runtime_error("invalid QOI header!");
+  }
+}
+
+}  // namespace
+
+QoiHeader readQoiHeader(const uint8_t *data, size_t size) {
+  if (size < QOI_HEADER_SIZE || memcmp(data, "qoif", 4) != 0) {
+    throw std::runtime_error("not a QOI image!");
+  }
+  QoiHeader header{};
+  header.width = readBigEndian(data + 4);
+  header.height = readBigEndian(data + 8);
+  header.channels = data[12];
+  header.colorspace = data[13];
+  validateHeader(header);
+  return header;
+}
+
+ImageMipLevel decodeQoi(const uint8_t *data, size_t size, bool flipVertically, QoiHeader *header) {
+  QoiHeader info = readQoiHeader(data, size);
+  if (header != nullptr) *header = info;
+  ImageMipLevel image{info.width, info.height, {}};
+  image.pixels.resize(static_cast<size_t>(info.width) * info.height * 4);
+  decodeQoiInto(data, size, flipVertically, image.pixels.data());
+  return image;
+}
+
+void decodeQoiInto(const uint8_t *data, size_t size, bool flipVertically, uint8_t *dst) {
+  QoiHeader info = readQoiHeader(data, size);
+  if (size < QOI_HEADER_SIZE + sizeof(QOI_PADDING)) {
+    throw std::runtime_error("truncated QOI image!");
+  }
+
+  Rgba index[64] = {};
+  Rgba px{0, 0, 0, 255};
+  uint32_t run = 0;
+  size_t p = QOI_HEADER_SIZE;
+  size_t chunksEnd = size - sizeof(QOI_PADDING);
+  size_t rowBytes = static_cast<size_t>(info.width) * 4;
+
+  for (uint32_t y = 0; y < info.height; y++) {
+    uint32_t row = flipVertically ? info.height - 1 - y : y;
+    uint8_t *out = dst + row * rowBytes;
+    for (uint32_t x = 0; x < info.width; x++, out += 4) {
+      if (run > 0) {
+        run--;
+      } else if (p < chunksEnd) {
+        uint8_t b1 = data[p++];
+        if (b1 == QOI_OP_RGB) {
+          if (p + 3 > chunksEnd) throw std::runtime_error("truncated QOI image!");
+          px.r = data[p];
+          px.g = data[p + 1];
+          px.b = data[p + 2];
+          p += 3;
+        } else if (b1 == QOI_OP_RGBA) {
+          if (p + 4 > chunksEnd) throw std::runtime_error("truncated QOI image!");
+          px.r = data[p];
+          px.g = data[p + 1];
+          px.b = data[p + 2];
+          px.a = data[p + 3];
+          p += 4;
+        } else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+          px = index[b1];
+        } else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+          px.r = static_cast<uint8_t>(px.r + ((b1 >> 4) & 3) - 2);
+          px.g = static_cast<uint8_t>(px.g + ((b1 >> 2) & 3) - 2);
+          px.b = static_cast<uint8_t>(px.b + (b1 & 3) - 2);
+        } else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+          if (p + 1 > chunksEnd) throw std::runtime_error("truncated QOI image!");
+          uint8_t b2 = data[p++];
+          int vg = (b1 & 0x3f) - 32;
+          px.r = static_cast<uint8_t>(px.r + vg - 8 + ((b2 >> 4) & 0x0f));
+          px.g = static_cast<uint8_t>(px.g + vg);
+          px.b = static_cast<uint8_t>(px.b + vg - 8 + (b2 & 0x0f));
+        } else {
+          run = b1 & 0x3f;
+        }
+        index[hashIndex(px)] = px;
+      }
+      memcpy(out, &px, 4);
+    }
+  }
+}
+
+std::vector<uint8_t> encodeQoi(const uint8_t *pixels, const QoiHeader &header) {
+  validateHeader(header);
+  size_t pixelCount = static_cast<size_t>(header.width) * header.height;
+  std::vector<uint8_t> bytes;
+  // worst case is one RGBA op per pixel
+  bytes.reserve(QOI_HEADER_SIZE + pixelCount * (header.channels + 1) + sizeof(QOI_PADDING));
+  bytes.insert(bytes.end(), {'q', 'o', 'i', 'f'});
+  writeBigEndian(bytes, header.width);
+  writeBigEndian(bytes, header.height);
+  bytes.push_back(header.channels);
+  bytes.push_back(header.colorspace);
+
+  Rgba index[64] = {};
+  Rgba prev{0, 0, 0, 255};
+  uint32_t run = 0;
+  for (size_t i = 0; i < pixelCount; i++) {
+    Rgba px;
+    memcpy(&px, pixels + 4 * i, 4);
+    // RGB files carry no alpha, keep it opaque so the decoder reproduces the same pixels
+    if (header.channels == 3) px.a = prev.a;
+
+    if (memcmp(&px, &prev, 4) == 0) {
+      run++;
+      if (run == 62 || i + 1 == pixelCount) {
+        bytes.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      bytes.push_back(static_cast<uint8_t>(QOI_OP_RUN | (run - 1)));
+      run = 0;
+    }
+
+    uint32_t hash = hashIndex(px);
+    if (memcmp(&index[hash], &px, 4) == 0) {
+      bytes.push_back(static_cast<uint8_t>(QOI_OP_INDEX | hash));
+    } else {
+      index[hash] = px;
+      if (px.a == prev.a) {
+        int8_t vr = static_cast<int8_t>(px.r - prev.r);
+        int8_t vg = static_cast<int8_t>(px.g - prev.g);
+        int8_t vb = static_cast<int8_t>(px.b - prev.b);
+        int8_t vgr = static_cast<int8_t>(vr - vg);
+        int8_t vgb = static_cast<int8_t>(vb - vg);
+        if (vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+          bytes.push_back(static_cast<uint8_t>(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2)));
+        } else if (vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+          bytes.push_back(static_cast<uint8_t>(QOI_OP_LUMA | (vg + 32)));
+          bytes.push_back(static_cast<uint8_t>((vgr + 8) << 4 | (vgb + 8)));
+        } else {
+          bytes.insert(bytes.end(), {QOI_OP_RGB, px.r, px.g, px.b});
+        }
+      } else {
+        bytes.insert(bytes.end(), {QOI_OP_RGBA, px.r, px.g, px.b, px.a});
+      }
+    }
+    prev = px;
+  }
+  bytes.insert(bytes.end(), QOI_PADDING, QOI_PADDING + sizeof(QOI_PADDING));
+  return bytes;
+}
+
+ImageMipLevel loadQoi(const std::string &filepath, bool flipVertically) {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  size_t fileSize = static_cast<size_t>(file.tellg());
+  std::vector<uint8_t> bytes(fileSize);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(bytes.data()), fileSize);
+  return decodeQoi(bytes.data(), bytes.size(), flipVertically);
+}
+
+size_t saveQoi(const std::string &filepath, const uint8_t *pixels, const QoiHeader &header) {
+  auto bytes = encodeQoi(pixels, header);
+  std::ofstream file{filepath, std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file for writing: " + filepath);
+  }
+  file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    throw std::runtime_error("failed to write file: " + filepath);
+  }
+  return bytes.size();
+}
+
+}  // namespace lve
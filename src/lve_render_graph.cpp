@@ -0,0 +1,783 @@
+#include "lve_render_graph.hpp"
+
+#include "lve_image_layouts.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+constexpr VkAccessFlags WRITE_ACCESS =
+    VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+}  // namespace
+
+LveRenderGraph::LveRenderGraph(LveDevice &device, uint32_t framesInFlight)
+    : lveDevice{device}, framesInFlight{framesInFlight} {}
+
+LveRenderGraph::~LveRenderGraph() {
+  retireFramebuffers();
+  retireTransientImages();
+  releaseRetired(true);
+  for (auto &kv : renderPasses) {
+    vkDestroyRenderPass(lveDevice.device(), kv.second, nullptr);
+  }
+}
+
+LveRenderGraph::ResourceHandle LveRenderGraph::importImage(
+    const std::string &name, VkFormat format, VkImageLayout initialLayout, VkImageLayout finalLayout) {
+  Resource resource{};
+  resource.name = name;
+  resource.format = format;
+  resource.imported = true;
+  resource.initialLayout = initialLayout;
+  resource.finalLayout = finalLayout;
+  resources.push_back(resource);
+  dirty = true;
+  return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+LveRenderGraph::ResourceHandle LveRenderGraph::createImage(
+    const std::string &name, VkFormat format, float extentScale) {
+  Resource resource{};
+  resource.name = name;
+  resource.format = format;
+  resource.imported = false;
+  resource.extentScale = extentScale;
+  resources.push_back(resource);
+  dirty = true;
+  return static_cast<ResourceHandle>(resources.size() - 1);
+}
+
+LveRenderGraph::PassHandle LveRenderGraph::addPass(const std::string &name, RecordFn record) {
+  Pass pass{};
+  pass.name = name;
+  pass.record = std::move(record);
+  passes.push_back(std::move(pass));
+  dirty = true;
+  return static_cast<PassHandle>(passes.size() - 1);
+}
+
+void LveRenderGraph::setRecord(PassHandle pass, RecordFn record) {
+  assert(pass < passes.size() && "Unknown pass");
+  passes[pass].record = std::move(record);
+}
+
+void LveRenderGraph::setSecondaryContents(PassHandle pass) {
+  assert(pass < passes.size() && "Unknown pass");
+  passes[pass].secondaryContents = true;
+}
+
+void LveRenderGraph::setSideEffects(PassHandle pass) {
+  assert(pass < passes.size() && "Unknown pass");
+  passes[pass].sideEffects = true;
+  dirty = true;
+}
+
+void LveRenderGraph::writeColor(PassHandle pass, ResourceHandle image) {
+  addUse(pass, image, Access::ColorWrite, false, VkClearValue{});
+}
+
+void LveRenderGraph::clearColor(PassHandle pass, ResourceHandle image, VkClearColorValue clearValue) {
+  VkClearValue value{};
+  value.color = clearValue;
+  addUse(pass, image, Access::ColorWrite, true, value);
+}
+
+void LveRenderGraph::writeDepth(PassHandle pass, ResourceHandle image) {
+  addUse(pass, image, Access::DepthWrite, false, VkClearValue{});
+}
+
+void LveRenderGraph::clearDepth(
+    PassHandle pass, ResourceHandle image, VkClearDepthStencilValue clearValue) {
+  VkClearValue value{};
+  value.depthStencil = clearValue;
+  addUse(pass, image, Access::DepthWrite, true, value);
+}
+
+void LveRenderGraph::readDepth(PassHandle pass, ResourceHandle image) {
+  addUse(pass, image, Access::DepthRead, false, VkClearValue{});
+}
+
+void LveRenderGraph::readTexture(PassHandle pass, ResourceHandle image) {
+  addUse(pass, image, Access::Texture, false, VkClearValue{});
+}
+
+void LveRenderGraph::addUse(
+    PassHandle pass, ResourceHandle image, Access access, bool clear, VkClearValue clearValue) {
+  assert(pass < passes.size() && image < resources.size() && "Unknown pass or image");
+  auto &uses = passes[pass].uses;
+  assert(
+      std::none_of(uses.begin(), uses.end(), [image](const Use &use) { return use.resource == image; }) &&
+      "An image may only be used once per pass");
+  assert(
+      (access == Access::Texture || isDepthFormat(resources[image].format) ==
+                                        (access != Access::ColorWrite)) &&
+      "Depth attachments need a depth format, colour attachments a colour format");
+  Use use{};
+  use.resource = image;
+  use.access = access;
+  use.clear = clear;
+  use.clearValue = clearValue;
+  // until compile knows better, enough for a compatible render pass
+  use.loadOp = clear ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+  use.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  uses.push_back(use);
+  dirty = true;
+}
+
+void LveRenderGraph::describe(
+    Access access, VkImageLayout &layout, VkPipelineStageFlags &stages, VkAccessFlags &accessMask) {
+  switch (access) {
+    case Access::ColorWrite:
+      layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+      stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+      accessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+      return;
+    case Access::DepthWrite:
+      layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+      stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+      accessMask =
+          VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+      return;
+    case Access::DepthRead:
+      layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+      stages = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+      accessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+      return;
+    case Access::Texture:
+      layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+      stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+      accessMask = VK_ACCESS_SHADER_READ_BIT;
+      return;
+  }
+}
+
+std::vector<const LveRenderGraph::Use *> LveRenderGraph::attachments(const Pass &pass) {
+  std::vector<const Use *> result;
+  for (auto &use : pass.uses) {
+    if (use.access == Access::ColorWrite) result.push_back(&use);
+  }
+  for (auto &use : pass.uses) {
+    if (use.access == Access::DepthWrite || use.access == Access::DepthRead) result.push_back(&use);
+  }
+  return result;
+}
+
+void LveRenderGraph::compile(VkExtent2D extent) {
+  if (!dirty && extent.width == compiledExtent.width && extent.height == compiledExtent.height) {
+    return;
+  }
+  // earlier frames may still render into the images and framebuffers
+  retireFramebuffers();
+  retireTransientImages();
+  compiledExtent = extent;
+
+  cullPasses();
+  computeLifetimes();
+  createTransientImages();
+  planBarriers();
+  for (PassHandle handle : order) {
+    Pass &pass = passes[handle];
+    auto passAttachments = attachments(pass);
+    pass.extent = passAttachments.empty() ? extent : resources[passAttachments[0]->resource].extent;
+    for (const Use *use : passAttachments) {
+      const VkExtent2D &attachmentExtent = resources[use->resource].extent;
+      if (attachmentExtent.width != pass.extent.width ||
+          attachmentExtent.height != pass.extent.height) {
+        throw std::runtime_error("render graph pass " + pass.name + " mixes attachment sizes!");
+      }
+    }
+    pass.renderPass = passAttachments.empty() || lveDevice.supportsDynamicRendering()
+                          ? VK_NULL_HANDLE
+                          : getRenderPass(pass);
+  }
+  dirty = false;
+}
+
+// Walks back from the imported images: a pass lives if it writes something a later live pass
+// (or the outside) still needs. Clearing an image makes the writes before it unneeded.
+void LveRenderGraph::cullPasses() {
+  std::vector<bool> needed(resources.size());
+  for (size_t i = 0; i < resources.size(); i++) {
+    needed[i] = resources[i].imported;
+  }
+  for (size_t i = passes.size(); i-- > 0;) {
+    Pass &pass = passes[i];
+    bool live = pass.sideEffects;
+    for (auto &use : pass.uses) {
+      if (isWrite(use.access) && needed[use.resource]) live = true;
+    }
+    pass.culled = !live;
+    if (!live) continue;
+    for (auto &use : pass.uses) {
+      needed[use.resource] = !use.clear;
+    }
+  }
+
+  order.clear();
+  for (size_t i = 0; i < passes.size(); i++) {
+    if (!passes[i].culled) order.push_back(static_cast<PassHandle>(i));
+  }
+}
+
+void LveRenderGraph::computeLifetimes() {
+  for (auto &resource : resources) {
+    resource.firstPass = -1;
+    resource.lastPass = -1;
+  }
+  for (size_t i = 0; i < order.size(); i++) {
+    for (auto &use : passes[order[i]].uses) {
+      Resource &resource = resources[use.resource];
+      if (resource.firstPass < 0) resource.firstPass = static_cast<int>(i);
+      resource.lastPass = static_cast<int>(i);
+    }
+  }
+  for (auto &resource : resources) {
+    resource.extent = compiledExtent;
+    if (resource.imported) continue;
+    resource.extent.width = std::max(
+        static_cast<uint32_t>(static_cast<float>(compiledExtent.width) * resource.extentScale), 1u);
+    resource.extent.height = std::max(
+        static_cast<uint32_t>(static_cast<float>(compiledExtent.height) * resource.extentScale), 1u);
+  }
+}
+
+// Every transient image used by a live pass gets a VkImage. They are placed first-use first into
+// memory blocks, sharing one with images whose lifetimes end before theirs begins.
+void LveRenderGraph::createTransientImages() {
+  std::vector<ResourceHandle> transients;
+  for (size_t i = 0; i < resources.size(); i++) {
+    if (!resources[i].imported && resources[i].firstPass >= 0) {
+      transients.push_back(static_cast<ResourceHandle>(i));
+    }
+  }
+  std::stable_sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+    return resources[a].firstPass < resources[b].firstPass;
+  });
+
+  for (ResourceHandle handle : transients) {
+    Resource &resource = resources[handle];
+    VkImageUsageFlags usage = 0;
+    for (PassHandle passHandle : order) {
+      for (auto &use : passes[passHandle].uses) {
+        if (use.resource != handle) continue;
+        usage |= use.access == Access::ColorWrite ? VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+                 : use.access == Access::Texture  ? VK_IMAGE_USAGE_SAMPLED_BIT
+                                                  : VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+      }
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = resource.extent.width;
+    imageInfo.extent.height = resource.extent.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = resource.format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateImage(lveDevice.device(), &imageInfo, nullptr, &resource.image) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create render graph image " + resource.name + "!");
+    }
+
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(lveDevice.device(), resource.image, &requirements);
+    auto overlaps = [this, &resource](ResourceHandle other) {
+      return resources[other].firstPass <= resource.lastPass &&
+             resource.firstPass <= resources[other].lastPass;
+    };
+    auto block = std::find_if(memoryBlocks.begin(), memoryBlocks.end(), [&](const MemoryBlock &b) {
+      return (requirements.memoryTypeBits & (1u << b.memoryTypeIndex)) != 0 &&
+             std::none_of(b.residents.begin(), b.residents.end(), overlaps);
+    });
+    if (block == memoryBlocks.end()) {
+      MemoryBlock newBlock{};
+      newBlock.memoryTypeIndex =
+          lveDevice.findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+      memoryBlocks.push_back(newBlock);
+      block = memoryBlocks.end() - 1;
+    }
+    // every resident is bound at offset 0, so the block is as large as its largest one
+    block->size = std::max(block->size, requirements.size);
+    block->residents.push_back(handle);
+    resource.memoryBlock = static_cast<uint32_t>(block - memoryBlocks.begin());
+  }
+
+  for (auto &block : memoryBlocks) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = block.size;
+    allocInfo.memoryTypeIndex = block.memoryTypeIndex;
+    if (vkAllocateMemory(lveDevice.device(), &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+      throw std::runtime_error("failed to allocate render graph memory!");
+    }
+  }
+
+  for (ResourceHandle handle : transients) {
+    Resource &resource = resources[handle];
+    if (vkBindImageMemory(
+            lveDevice.device(), resource.image, memoryBlocks[resource.memoryBlock].memory, 0) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to bind render graph image memory!");
+    }
+    if (!isDepthFormat(resource.format)) {
+      resource.view =
+          lveDevice.createImageView(resource.image, VK_IMAGE_VIEW_TYPE_2D, resource.format);
+      continue;
+    }
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = resource.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = resource.format;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+    viewInfo.subresourceRange.baseMipLevel = 0;
+    viewInfo.subresourceRange.levelCount = 1;
+    viewInfo.subresourceRange.baseArrayLayer = 0;
+    viewInfo.subresourceRange.layerCount = 1;
+    if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &resource.view) != VK_SUCCESS) {
+      throw std::runtime_error("failed to create render graph depth view!");
+    }
+  }
+}
+
+// Follows every image through the live passes. A barrier goes in front of a use only when the
+// layout changes or a write is involved (read after write, write after write, write after read);
+// reads following reads in the same layout share the earlier barrier. Load and store ops drop
+// contents nobody reads.
+void LveRenderGraph::planBarriers() {
+  struct State {
+    VkImageLayout layout;
+    VkPipelineStageFlags writeStages;
+    VkAccessFlags writeAccess;
+    VkPipelineStageFlags readStages;  // since the last write
+    bool used;
+  };
+  std::vector<State> states(resources.size());
+  for (size_t i = 0; i < resources.size(); i++) {
+    states[i] = State{resources[i].imported ? resources[i].initialLayout : VK_IMAGE_LAYOUT_UNDEFINED,
+                      0, 0, 0, false};
+  }
+  // first uses of transient images, their sources are known once every image's last use is
+  std::vector<std::pair<BarrierBatch *, size_t>> transientStarts;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    Pass &pass = passes[order[i]];
+    pass.barriers = BarrierBatch{};
+    for (auto &use : pass.uses) {
+      Resource &resource = resources[use.resource];
+      State &state = states[use.resource];
+      VkImageLayout layout;
+      VkPipelineStageFlags stages;
+      VkAccessFlags access;
+      describe(use.access, layout, stages, access);
+      bool write = isWrite(use.access);
+
+      bool hasContents = state.used || (resource.imported && resource.initialLayout != VK_IMAGE_LAYOUT_UNDEFINED);
+      use.loadOp = use.clear    ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                   : hasContents ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                 : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+      use.storeOp = resource.imported || resource.lastPass > static_cast<int>(i)
+                        ? VK_ATTACHMENT_STORE_OP_STORE
+                        : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+
+      bool hazard = state.writeAccess != 0 || (write && state.readStages != 0);
+      if (!state.used || state.layout != layout || hazard) {
+        PlannedBarrier barrier{};
+        barrier.resource = use.resource;
+        barrier.oldLayout = state.used ? state.layout
+                            : resource.imported ? resource.initialLayout
+                                                : VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = layout;
+        barrier.srcAccess = state.writeAccess;
+        barrier.dstAccess = access;
+        pass.barriers.srcStages |= state.writeStages | state.readStages;
+        pass.barriers.dstStages |= stages;
+        if (!state.used) {
+          // imported: chains to whatever made the image available, e.g. the swap chain's image
+          // available semaphore waiting at the colour output stage
+          pass.barriers.srcStages |= stages;
+          if (!resource.imported) transientStarts.emplace_back(&pass.barriers, pass.barriers.barriers.size());
+        }
+        pass.barriers.barriers.push_back(barrier);
+        state.writeStages = 0;
+        state.writeAccess = 0;
+        state.readStages = 0;
+      }
+      if (write) {
+        state.writeStages = stages;
+        state.writeAccess = access & WRITE_ACCESS;
+        state.readStages = 0;
+      } else {
+        state.readStages |= stages;
+      }
+      state.layout = layout;
+      state.used = true;
+    }
+  }
+
+  for (size_t i = 0; i < resources.size(); i++) {
+    resources[i].lastStages = states[i].writeStages | states[i].readStages;
+    resources[i].lastWrites = states[i].writeAccess;
+  }
+  // A transient image starts after everything else in its memory block is done with it: earlier
+  // residents in this frame, and all of them in the previous frame, which shares the images.
+  for (auto &start : transientStarts) {
+    PlannedBarrier &barrier = start.first->barriers[start.second];
+    for (ResourceHandle resident : memoryBlocks[resources[barrier.resource].memoryBlock].residents) {
+      start.first->srcStages |= resources[resident].lastStages;
+      barrier.srcAccess |= resources[resident].lastWrites;
+    }
+  }
+
+  finalBarriers = BarrierBatch{};
+  for (size_t i = 0; i < resources.size(); i++) {
+    Resource &resource = resources[i];
+    State &state = states[i];
+    if (!resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ||
+        state.layout == resource.finalLayout) {
+      continue;
+    }
+    VkPipelineStageFlags dstStages;
+    VkAccessFlags dstAccess;
+    nextUse(resource.finalLayout, dstStages, dstAccess);
+    PlannedBarrier barrier{};
+    barrier.resource = static_cast<ResourceHandle>(i);
+    barrier.oldLayout = state.layout;
+    barrier.newLayout = resource.finalLayout;
+    barrier.srcAccess = state.writeAccess;
+    barrier.dstAccess = dstAccess;
+    VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+    finalBarriers.srcStages |= srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    finalBarriers.dstStages |= dstStages;
+    finalBarriers.barriers.push_back(barrier);
+  }
+}
+
+void LveRenderGraph::retireTransientImages() {
+  Retired entry{};
+  entry.frame = frameCounter;
+  for (auto &resource : resources) {
+    if (resource.imported) continue;
+    if (resource.view != VK_NULL_HANDLE) entry.views.push_back(resource.view);
+    if (resource.image != VK_NULL_HANDLE) entry.images.push_back(resource.image);
+    resource.view = VK_NULL_HANDLE;
+    resource.image = VK_NULL_HANDLE;
+  }
+  for (auto &block : memoryBlocks) {
+    entry.memory.push_back(block.memory);
+  }
+  memoryBlocks.clear();
+  if (!entry.views.empty() || !entry.images.empty() || !entry.memory.empty()) {
+    retired.push_back(std::move(entry));
+  }
+}
+
+void LveRenderGraph::retireFramebuffers() {
+  Retired entry{};
+  entry.frame = frameCounter;
+  for (auto &pass : passes) {
+    for (auto &kv : pass.framebuffers) {
+      entry.framebuffers.push_back(kv.second);
+    }
+    pass.framebuffers.clear();
+  }
+  if (!entry.framebuffers.empty()) retired.push_back(std::move(entry));
+}
+
+// Objects retired while recording frame N are only used by the frames before N still in flight.
+// frameCounter counts executes, one per frame, so those have all finished once framesInFlight more
+// executes have happened.
+void LveRenderGraph::releaseRetired(bool all) {
+  auto keep = std::partition(retired.begin(), retired.end(), [&](const Retired &entry) {
+    return !all && frameCounter - entry.frame <= framesInFlight;
+  });
+  for (auto it = keep; it != retired.end(); ++it) {
+    for (VkFramebuffer framebuffer : it->framebuffers) {
+      vkDestroyFramebuffer(lveDevice.device(), framebuffer, nullptr);
+    }
+    for (VkImageView view : it->views) {
+      vkDestroyImageView(lveDevice.device(), view, nullptr);
+    }
+    for (VkImage image : it->images) {
+      vkDestroyImage(lveDevice.device(), image, nullptr);
+    }
+    for (VkDeviceMemory memory : it->memory) {
+      vkFreeMemory(lveDevice.device(), memory, nullptr);
+    }
+  }
+  retired.erase(keep, retired.end());
+}
+
+// Attachments stay in the layout the pass uses them in, the graph's barriers do the transitions.
+// Render passes only differing in load and store ops are compatible, pipelines made for one work
+// with the others.
+VkRenderPass LveRenderGraph::getRenderPass(const Pass &pass) {
+  auto passAttachments = attachments(pass);
+  std::vector<uint32_t> key;
+  for (const Use *use : passAttachments) {
+    key.push_back(static_cast<uint32_t>(use->access));
+    key.push_back(static_cast<uint32_t>(resources[use->resource].format));
+    key.push_back(static_cast<uint32_t>(use->loadOp));
+    key.push_back(static_cast<uint32_t>(use->storeOp));
+  }
+  auto found = renderPasses.find(key);
+  if (found != renderPasses.end()) return found->second;
+
+  std::vector<VkAttachmentDescription> descriptions;
+  std::vector<VkAttachmentReference> colorRefs;
+  VkAttachmentReference depthRef{};
+  bool hasDepth = false;
+  for (const Use *use : passAttachments) {
+    VkImageLayout layout;
+    VkPipelineStageFlags stages;
+    VkAccessFlags access;
+    describe(use->access, layout, stages, access);
+    VkAttachmentDescription description{};
+    description.format = resources[use->resource].format;
+    description.samples = VK_SAMPLE_COUNT_1_BIT;
+    description.loadOp = use->loadOp;
+    description.storeOp = use->storeOp;
+    description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    description.initialLayout = layout;
+    description.finalLayout = layout;
+    VkAttachmentReference ref{static_cast<uint32_t>(descriptions.size()), layout};
+    if (use->access == Access::ColorWrite) {
+      colorRefs.push_back(ref);
+    } else {
+      depthRef = ref;
+      hasDepth = true;
+    }
+    descriptions.push_back(description);
+  }
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+  subpass.pColorAttachments = colorRefs.data();
+  subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+  renderPassInfo.pAttachments = descriptions.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  VkRenderPass renderPass;
+  if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render graph render pass!");
+  }
+  renderPasses.emplace(key, renderPass);
+  return renderPass;
+}
+
+VkFramebuffer LveRenderGraph::getFramebuffer(Pass &pass) {
+  std::vector<VkImageView> views;
+  for (const Use *use : attachments(pass)) {
+    views.push_back(resources[use->resource].view);
+  }
+  auto found = pass.framebuffers.find(views);
+  if (found != pass.framebuffers.end()) return found->second;
+
+  VkFramebufferCreateInfo framebufferInfo{};
+  framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+  framebufferInfo.renderPass = pass.renderPass;
+  framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+  framebufferInfo.pAttachments = views.data();
+  framebufferInfo.width = pass.extent.width;
+  framebufferInfo.height = pass.extent.height;
+  framebufferInfo.layers = 1;
+  VkFramebuffer framebuffer;
+  if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create render graph framebuffer!");
+  }
+  pass.framebuffers.emplace(views, framebuffer);
+  return framebuffer;
+}
+
+void LveRenderGraph::bindImage(
+    ResourceHandle image, VkImage vkImage, VkImageView view, uint32_t generation) {
+  assert(image < resources.size() && resources[image].imported && "Only imported images are bound");
+  Resource &resource = resources[image];
+  if (resource.generation != generation) {
+    retireFramebuffers();
+    resource.generation = generation;
+  }
+  resource.image = vkImage;
+  resource.view = view;
+}
+
+void LveRenderGraph::execute(FrameInfo &frameInfo) {
+  assert(!dirty && "Compile the render graph before executing it");
+  frameCounter++;
+  releaseRetired(false);
+  VkCommandBuffer commandBuffer = frameInfo.commandBuffer;
+  for (PassHandle handle : order) {
+    Pass &pass = passes[handle];
+    recordBarriers(pass.barriers, commandBuffer);
+    LveSecondaryInheritance inheritance = beginPass(pass, commandBuffer);
+    if (pass.record) pass.record(frameInfo, inheritance);
+    endPass(pass, commandBuffer);
+  }
+  recordBarriers(finalBarriers, commandBuffer);
+}
+
+void LveRenderGraph::recordBarriers(const BarrierBatch &batch, VkCommandBuffer commandBuffer) {
+  if (batch.barriers.empty()) return;
+  std::vector<VkImageMemoryBarrier> barriers;
+  barriers.reserve(batch.barriers.size());
+  for (auto &planned : batch.barriers) {
+    const Resource &resource = resources[planned.resource];
+    assert(resource.image != VK_NULL_HANDLE && "Imported image not bound");
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = planned.srcAccess;
+    barrier.dstAccessMask = planned.dstAccess;
+    barrier.oldLayout = planned.oldLayout;
+    barrier.newLayout = planned.newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = resource.image;
+    barrier.subresourceRange.aspectMask = barrierAspect(resource.format);
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    barriers.push_back(barrier);
+  }
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      batch.srcStages,
+      batch.dstStages,
+      0, 0, nullptr, 0, nullptr,
+      static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+LveSecondaryInheritance LveRenderGraph::beginPass(Pass &pass, VkCommandBuffer commandBuffer) {
+  LveSecondaryInheritance inheritance{};
+  inheritance.extent = pass.extent;
+  auto passAttachments = attachments(pass);
+  if (passAttachments.empty()) return inheritance;
+  inheritance.targetFormat = getTargetFormat(static_cast<PassHandle>(&pass - passes.data()));
+
+  if (pass.renderPass == VK_NULL_HANDLE) {
+    std::vector<VkRenderingAttachmentInfoKHR> colorInfos;
+    VkRenderingAttachmentInfoKHR depthInfo{};
+    bool hasDepth = false;
+    for (const Use *use : passAttachments) {
+      VkImageLayout layout;
+      VkPipelineStageFlags stages;
+      VkAccessFlags access;
+      describe(use->access, layout, stages, access);
+      VkRenderingAttachmentInfoKHR info{};
+      info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+      info.imageView = resources[use->resource].view;
+      info.imageLayout = layout;
+      info.resolveMode = VK_RESOLVE_MODE_NONE;
+      info.loadOp = use->loadOp;
+      info.storeOp = use->storeOp;
+      info.clearValue = use->clearValue;
+      if (use->access == Access::ColorWrite) {
+        colorInfos.push_back(info);
+      } else {
+        depthInfo = info;
+        hasDepth = true;
+      }
+    }
+    VkRenderingInfoKHR renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+    renderingInfo.flags =
+        pass.secondaryContents ? VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR : 0;
+    renderingInfo.renderArea.offset = {0, 0};
+    renderingInfo.renderArea.extent = pass.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorInfos.size());
+    renderingInfo.pColorAttachments = colorInfos.data();
+    renderingInfo.pDepthAttachment = hasDepth ? &depthInfo : nullptr;
+    lveDevice.cmdBeginRendering(commandBuffer, &renderingInfo);
+  } else {
+    std::vector<VkClearValue> clearValues;
+    for (const Use *use : passAttachments) {
+      clearValues.push_back(use->clearValue);
+    }
+    inheritance.framebuffer = getFramebuffer(pass);
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = pass.renderPass;
+    renderPassInfo.framebuffer = inheritance.framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = pass.extent;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+    vkCmdBeginRenderPass(
+        commandBuffer,
+        &renderPassInfo,
+        pass.secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                               : VK_SUBPASS_CONTENTS_INLINE);
+  }
+  // secondary command buffers set their own, the primary may record nothing else in the pass
+  if (pass.secondaryContents) return inheritance;
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(pass.extent.width);
+  viewport.height = static_cast<float>(pass.extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, pass.extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+  return inheritance;
+}
+
+void LveRenderGraph::endPass(const Pass &pass, VkCommandBuffer commandBuffer) {
+  if (attachments(pass).empty()) return;
+  if (pass.renderPass == VK_NULL_HANDLE) {
+    lveDevice.cmdEndRendering(commandBuffer);
+  } else {
+    vkCmdEndRenderPass(commandBuffer);
+  }
+}
+
+LveRenderTargetFormat LveRenderGraph::getTargetFormat(PassHandle pass) {
+  assert(pass < passes.size() && "Unknown pass");
+  LveRenderTargetFormat targetFormat{};
+  const Pass &graphPass = passes[pass];
+  if (!lveDevice.supportsDynamicRendering()) {
+    targetFormat.renderPass =
+        graphPass.renderPass != VK_NULL_HANDLE ? graphPass.renderPass : getRenderPass(graphPass);
+    return targetFormat;
+  }
+  for (const Use *use : attachments(graphPass)) {
+    if (use->access == Access::ColorWrite) {
+      targetFormat.colorFormats.push_back(resources[use->resource].format);
+    } else {
+      targetFormat.depthFormat = resources[use->resource].format;
+    }
+  }
+  return targetFormat;
+}
+
+VkImageView LveRenderGraph::getImageView(ResourceHandle image) const {
+  assert(image < resources.size() && "Unknown image");
+  return resources[image].view;
+}
+
+bool LveRenderGraph::isCulled(PassHandle pass) const {
+  assert(pass < passes.size() && "Unknown pass");
+  return passes[pass].culled;
+}
+
+}  // namespace lve
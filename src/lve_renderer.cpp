@@ -1,18 +1,25 @@
 #include "lve_renderer.hpp"
 
 // std
-#include <array>
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace lve {
-  LveRenderer::LveRenderer(LveWindow& window, LveDevice& device) : lveWindow{ window }, lveDevice{ device } {
+  LveRenderer::LveRenderer(
+    LveWindow& window, LveDevice& device, const LveSwapChainConfig& config, uint32_t recordingLanes)
+    : lveWindow{ window },
+    lveDevice{ device },
+    swapChainConfig{ config },
+    framePools{ device, config.framesInFlight, recordingLanes } {
     
     recreateSwapChain();
-    createCommandBuffers();
   }
 
-  LveRenderer::~LveRenderer() { freeCommandBuffers(); }
+  // the frame pools free the command buffers
+  LveRenderer::~LveRenderer() {
+    releaseRetiredSwapChains(true);
+  }
 
   void LveRenderer::recreateSwapChain() {
     auto extent = lveWindow.getExtent();
@@ -20,45 +27,41 @@ namespace lve {
       extent = lveWindow.getExtent();
       glfwWaitEvents();
     }
-    vkDeviceWaitIdle(lveDevice.device());
     if (lveSwapChain == nullptr) {
-      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent);
+      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, swapChainConfig);
     }
     else {
+      // no device idle: frames in flight finish on the old swap chain, which is retired below
       std::shared_ptr<LveSwapChain> oldSwapChain = std::move(lveSwapChain);
-      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, oldSwapChain);
+      lveSwapChain = std::make_unique<LveSwapChain>(lveDevice, extent, swapChainConfig, oldSwapChain);
 
       if(!oldSwapChain->compareSwapFormats(*lveSwapChain.get())){
         throw std::runtime_error("Swap Chain image(or depth) format changed!");
       }
+      retiredSwapChains.push_back({ std::move(oldSwapChain), frameCounter });
     }
+    swapChainGeneration++;
   }
 
-  void LveRenderer::createCommandBuffers()
-  {
-      commandBuffers.resize(LveSwapChain::MAX_FRAMES_IN_FLIGHT);
-      
-      VkCommandBufferAllocateInfo allocInfo{};
-      allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-      allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-      allocInfo.commandPool = lveDevice.getCommandPool();
-      allocInfo.commandBufferCount = static_cast<uint32_t>(commandBuffers.size());
-
-      if (vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, commandBuffers.data()) !=
-          VK_SUCCESS)
-      {
-          throw std::runtime_error("failed to allocate command buffers!");
-      }
+  // Frames up to the one recording when a swap chain was retired used its images. Beginning frame
+  // N waited for frame N - framesInFlight, so framesInFlight frames later they have all finished
+  // on the GPU; one more covers their presentation, which no fence tracks.
+  void LveRenderer::releaseRetiredSwapChains(bool all) {
+    auto framesInFlight = static_cast<uint64_t>(swapChainConfig.framesInFlight);
+    retiredSwapChains.erase(
+      std::remove_if(retiredSwapChains.begin(), retiredSwapChains.end(),
+        [&](const RetiredSwapChain& entry) { return all || frameCounter - entry.frame > framesInFlight; }),
+      retiredSwapChains.end());
   }
 
-  void LveRenderer::freeCommandBuffers()
-  {
-    vkFreeCommandBuffers(
-      lveDevice.device(),
-      lveDevice.getCommandPool(), 
-      static_cast<uint32_t>(commandBuffers.size()),
-      commandBuffers.data());
-      commandBuffers.clear();
+  VkCommandBuffer LveRenderer::allocateCommandBuffer(VkCommandBufferLevel level, uint32_t lane) {
+    assert(isFrameStarted && "Cannot allocate frame command buffers when frame not in progress");
+    VkCommandBuffer commandBuffer = framePools.allocate(currentFrameIndex, lane, level);
+    if (level == VK_COMMAND_BUFFER_LEVEL_PRIMARY) {
+      assert(lane == 0 && "Primary command buffers are only handed out on lane 0");
+      passCommandBuffers.push_back(commandBuffer);
+    }
+    return commandBuffer;
   }
 
   VkCommandBuffer LveRenderer::beginFrame(){
@@ -75,15 +78,25 @@ namespace lve {
     }
 
     isFrameStarted = true;
+    frameCounter++;
+    releaseRetiredSwapChains(false);
+    // acquireNextImage waited for this slot's previous submission, so its buffers are free to
+    // reuse: one pool reset instead of resetting or allocating buffers one by one
+    framePools.reset(currentFrameIndex);
+    passCommandBuffers.clear();
+    currentCommandBuffer =
+      framePools.allocate(currentFrameIndex, 0, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 
     auto commandBuffer = getCurrentCommandBuffer();
 
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
     if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
       throw std::runtime_error("failed to begin recording command buffer!");
     }
+    recordStart = std::chrono::steady_clock::now();
     return commandBuffer;
   }
 
@@ -93,8 +106,15 @@ namespace lve {
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
       throw std::runtime_error("failed to record command buffer!");
     }
-
-    auto result = lveSwapChain->submitCommandBuffers(&commandBuffer, &currentImageIndex);
+    double recordMs =
+      std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+
+    passCommandBuffers.push_back(commandBuffer);
+    auto result = lveSwapChain->submitCommandBuffers(
+      passCommandBuffers.data(), static_cast<uint32_t>(passCommandBuffers.size()), &currentImageIndex);
+    // before a recreation replaces the swap chain holding them
+    LveFrameTimings timings = lveSwapChain->getFrameTimings();
+    timings.recordMs = recordMs;
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR ||
       lveWindow.wasWindowResized()) {
       lveWindow.resetWindowResizedFlag();
@@ -104,44 +124,14 @@ namespace lve {
       throw std::runtime_error("failed to present swap chain image!");
     }
     isFrameStarted = false;
-    currentFrameIndex = (currentFrameIndex + 1) % LveSwapChain::MAX_FRAMES_IN_FLIGHT;
-  }
-
-  void LveRenderer::beginSwapChainRenderPass(VkCommandBuffer commandBuffer){
-    assert(isFrameStarted && "Can't call beginSwapChainRenderPass if frame is not in progress");
-    assert(commandBuffer == getCurrentCommandBuffer() && "Can't begin render pass on command buffer from a different frame");
-
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = lveSwapChain->getRenderPass();
-    renderPassInfo.framebuffer = lveSwapChain->getFrameBuffer(currentImageIndex);
-
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = lveSwapChain->getSwapChainExtent();
-
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = { 0.01f, 0.01f, 0.01f, 1.0f };
-    clearValues[1].depthStencil = { 1.0f, 0 };
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
-
-    vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(lveSwapChain->getSwapChainExtent().width);
-    viewport.height = static_cast<float>(lveSwapChain->getSwapChainExtent().height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    VkRect2D scissor{ {0,0}, lveSwapChain->getSwapChainExtent()};
-    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
-    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
-  }
+    currentFrameIndex = (currentFrameIndex + 1) % swapChainConfig.framesInFlight;
 
-  void LveRenderer::endSwapChainRenderPass(VkCommandBuffer commandBuffer){
-    assert(isFrameStarted && "Can't call endSwapChainRenderPass if frame is not in progress");
-    assert(commandBuffer == getCurrentCommandBuffer() && "Can't end render pass on command buffer from a different frame");
-    vkCmdEndRenderPass(commandBuffer);
+    auto frameEnd = std::chrono::steady_clock::now();
+    if (hasFrameEnd) {
+      timings.frameMs = std::chrono::duration<double, std::milli>(frameEnd - lastFrameEnd).count();
+      frameStats.add(timings);
+    }
+    lastFrameEnd = frameEnd;
+    hasFrameEnd = true;
   }
 }  // namespace lve
\ No newline at end of file
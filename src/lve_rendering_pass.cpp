@@ -0,0 +1,174 @@
+#include "lve_rendering_pass.hpp"
+
+#include "lve_image_layouts.hpp"
+
+// std
+#include <cassert>
+
+namespace lve {
+
+namespace {
+
+VkImageMemoryBarrier imageBarrier(
+    VkImage image,
+    VkImageAspectFlags aspect,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkAccessFlags srcAccess,
+    VkAccessFlags dstAccess) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = image;
+  barrier.subresourceRange.aspectMask = aspect;
+  barrier.subresourceRange.baseMipLevel = 0;
+  barrier.subresourceRange.levelCount = 1;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = 1;
+  return barrier;
+}
+
+VkRenderingAttachmentInfoKHR attachmentInfo(const LveRenderingAttachment &attachment,
+                                            VkImageLayout layout) {
+  VkRenderingAttachmentInfoKHR info{};
+  info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+  info.imageView = attachment.view;
+  info.imageLayout = layout;
+  info.resolveMode = VK_RESOLVE_MODE_NONE;
+  info.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  info.storeOp = attachment.store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  info.clearValue = attachment.clearValue;
+  return info;
+}
+
+}  // namespace
+
+void LveRenderingPass::begin(
+    VkCommandBuffer commandBuffer,
+    VkExtent2D extent,
+    const std::vector<LveRenderingAttachment> &colorAttachments,
+    const LveRenderingAttachment *depthAttachment,
+    VkRenderingFlagsKHR flags) {
+  assert(!inProgress && "Can't begin a rendering pass that is already in progress");
+  assert(lveDevice.supportsDynamicRendering() && "Dynamic rendering is not enabled on the device");
+  colors = colorAttachments;
+  hasDepth = depthAttachment != nullptr;
+  depth = hasDepth ? *depthAttachment : LveRenderingAttachment{};
+  inProgress = true;
+
+  // UNDEFINED drops the old contents, they are cleared anyway. Waiting on the attachment stages
+  // chains the colour transition to the swap chain's image available semaphore, and keeps the
+  // depth clear behind the previous pass that wrote the same image.
+  std::vector<VkImageMemoryBarrier> colorBarriers;
+  colorBarriers.reserve(colors.size());
+  for (auto &color : colors) {
+    colorBarriers.push_back(imageBarrier(
+        color.image,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        0,
+        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT));
+  }
+  if (!colorBarriers.empty()) {
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        0, 0, nullptr, 0, nullptr,
+        static_cast<uint32_t>(colorBarriers.size()), colorBarriers.data());
+  }
+  if (hasDepth) {
+    VkImageMemoryBarrier depthBarrier = imageBarrier(
+        depth.image,
+        barrierAspect(depth.format),
+        VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    VkPipelineStageFlags fragmentTests =
+        VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    vkCmdPipelineBarrier(
+        commandBuffer, fragmentTests, fragmentTests, 0, 0, nullptr, 0, nullptr, 1, &depthBarrier);
+  }
+
+  std::vector<VkRenderingAttachmentInfoKHR> colorInfos;
+  colorInfos.reserve(colors.size());
+  for (auto &color : colors) {
+    colorInfos.push_back(attachmentInfo(color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL));
+  }
+  VkRenderingAttachmentInfoKHR depthInfo =
+      attachmentInfo(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+
+  VkRenderingInfoKHR renderingInfo{};
+  renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+  renderingInfo.flags = flags;
+  renderingInfo.renderArea.offset = {0, 0};
+  renderingInfo.renderArea.extent = extent;
+  renderingInfo.layerCount = 1;
+  renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorInfos.size());
+  renderingInfo.pColorAttachments = colorInfos.data();
+  renderingInfo.pDepthAttachment = hasDepth ? &depthInfo : nullptr;
+  lveDevice.cmdBeginRendering(commandBuffer, &renderingInfo);
+  if (flags & VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR) return;
+
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(extent.width);
+  viewport.height = static_cast<float>(extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+
+void LveRenderingPass::end(VkCommandBuffer commandBuffer) {
+  assert(inProgress && "Can't end a rendering pass that is not in progress");
+  lveDevice.cmdEndRendering(commandBuffer);
+  inProgress = false;
+
+  for (auto &color : colors) {
+    if (color.finalLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) continue;
+    VkPipelineStageFlags dstStage;
+    VkAccessFlags dstAccess;
+    nextUse(color.finalLayout, dstStage, dstAccess);
+    VkImageMemoryBarrier barrier = imageBarrier(
+        color.image,
+        VK_IMAGE_ASPECT_COLOR_BIT,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+        color.finalLayout,
+        VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        dstAccess);
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        dstStage,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+  if (hasDepth && depth.finalLayout != VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
+    VkPipelineStageFlags dstStage;
+    VkAccessFlags dstAccess;
+    nextUse(depth.finalLayout, dstStage, dstAccess);
+    VkImageMemoryBarrier barrier = imageBarrier(
+        depth.image,
+        barrierAspect(depth.format),
+        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        depth.finalLayout,
+        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        dstAccess);
+    vkCmdPipelineBarrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+        dstStage,
+        0, 0, nullptr, 0, nullptr, 1, &barrier);
+  }
+}
+
+}  // namespace lve
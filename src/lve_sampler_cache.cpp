@@ -0,0 +1,136 @@
+#include "lve_sampler_cache.hpp"
+
+// std
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+template <typename T>
+void hashCombine(size_t &seed, const T &value) {
+  seed ^= std::hash<T>{}(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+}
+
+}  // namespace
+
+LveSamplerKey LveSamplerKey::fromCreateInfo(const VkSamplerCreateInfo &info) {
+  assert(info.pNext == nullptr && "Sampler keys do not cover extension structures");
+  LveSamplerKey key{};
+  key.flags = info.flags;
+  key.magFilter = info.magFilter;
+  key.minFilter = info.minFilter;
+  key.mipmapMode = info.mipmapMode;
+  key.addressModeU = info.addressModeU;
+  key.addressModeV = info.addressModeV;
+  key.addressModeW = info.addressModeW;
+  key.mipLodBias = info.mipLodBias;
+  key.anisotropyEnable = info.anisotropyEnable;
+  key.maxAnisotropy = info.maxAnisotropy;
+  key.compareEnable = info.compareEnable;
+  key.compareOp = info.compareOp;
+  key.minLod = info.minLod;
+  key.maxLod = info.maxLod;
+  key.borderColor = info.borderColor;
+  key.unnormalizedCoordinates = info.unnormalizedCoordinates;
+  return key;
+}
+
+VkSamplerCreateInfo LveSamplerKey::createInfo() const {
+  VkSamplerCreateInfo info{};
+  info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  info.flags = flags;
+  info.magFilter = magFilter;
+  info.minFilter = minFilter;
+  info.mipmapMode = mipmapMode;
+  info.addressModeU = addressModeU;
+  info.addressModeV = addressModeV;
+  info.addressModeW = addressModeW;
+  info.mipLodBias = mipLodBias;
+  info.anisotropyEnable = anisotropyEnable;
+  info.maxAnisotropy = maxAnisotropy;
+  info.compareEnable = compareEnable;
+  info.compareOp = compareOp;
+  info.minLod = minLod;
+  info.maxLod = maxLod;
+  info.borderColor = borderColor;
+  info.unnormalizedCoordinates = unnormalizedCoordinates;
+  return info;
+}
+
+bool LveSamplerKey::operator==(const LveSamplerKey &other) const {
+  return flags == other.flags && magFilter == other.magFilter && minFilter == other.minFilter &&
+         mipmapMode == other.mipmapMode && addressModeU == other.addressModeU &&
+         addressModeV == other.addressModeV && addressModeW == other.addressModeW &&
+         mipLodBias == other.mipLodBias && anisotropyEnable == other.anisotropyEnable &&
+         maxAnisotropy == other.maxAnisotropy && compareEnable == other.compareEnable &&
+         compareOp == other.compareOp && minLod == other.minLod && maxLod == other.maxLod &&
+         borderColor == other.borderColor && unnormalizedCoordinates == other.unnormalizedCoordinates;
+}
+
+size_t LveSamplerKeyHash::operator()(const LveSamplerKey &key) const {
+  size_t seed = 0;
+  hashCombine(seed, static_cast<uint32_t>(key.flags));
+  hashCombine(seed, static_cast<int>(key.magFilter));
+  hashCombine(seed, static_cast<int>(key.minFilter));
+  hashCombine(seed, static_cast<int>(key.mipmapMode));
+  hashCombine(seed, static_cast<int>(key.addressModeU));
+  hashCombine(seed, static_cast<int>(key.addressModeV));
+  hashCombine(seed, static_cast<int>(key.addressModeW));
+  hashCombine(seed, key.mipLodBias);
+  hashCombine(seed, static_cast<uint32_t>(key.anisotropyEnable));
+  hashCombine(seed, key.maxAnisotropy);
+  hashCombine(seed, static_cast<uint32_t>(key.compareEnable));
+  hashCombine(seed, static_cast<int>(key.compareOp));
+  hashCombine(seed, key.minLod);
+  hashCombine(seed, key.maxLod);
+  hashCombine(seed, static_cast<int>(key.borderColor));
+  hashCombine(seed, static_cast<uint32_t>(key.unnormalizedCoordinates));
+  return seed;
+}
+
+LveSamplerCache::LveSamplerCache(VkDevice device) : device{device} {}
+
+LveSamplerCache::~LveSamplerCache() {
+  for (auto &kv : samplers) {
+    vkDestroySampler(device, kv.second.sampler, nullptr);
+  }
+}
+
+VkSampler LveSamplerCache::acquire(const LveSamplerKey &key) {
+  std::lock_guard<std::mutex> lock{mutex};
+  auto found = samplers.find(key);
+  if (found != samplers.end()) {
+    found->second.users++;
+    return found->second.sampler;
+  }
+
+  VkSamplerCreateInfo samplerInfo = key.createInfo();
+  VkSampler sampler;
+  if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture sampler!");
+  }
+  samplers.emplace(key, Entry{sampler, 1});
+  return sampler;
+}
+
+void LveSamplerCache::release(const LveSamplerKey &key) {
+  std::lock_guard<std::mutex> lock{mutex};
+  auto found = samplers.find(key);
+  assert(found != samplers.end() && "Releasing a sampler that was never acquired");
+  if (found == samplers.end()) return;
+  if (--found->second.users == 0) {
+    vkDestroySampler(device, found->second.sampler, nullptr);
+    samplers.erase(found);
+  }
+}
+
+size_t LveSamplerCache::size() const {
+  std::lock_guard<std::mutex> lock{mutex};
+  return samplers.size();
+}
+
+}  // namespace lve
@@ -0,0 +1,98 @@
+#include "lve_secondary_commands.hpp"
+
+// std
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+LveSecondaryCommands::LveSecondaryCommands(
+    LveDevice &device,
+    LveFrameCommandPools &pools,
+    int frameIndex,
+    const LveSecondaryInheritance &inheritance)
+    : lveDevice{device}, pools{pools}, frameIndex{frameIndex}, inheritance{inheritance} {}
+
+uint32_t LveSecondaryCommands::reserve(uint32_t count) {
+  uint32_t first = static_cast<uint32_t>(slots.size());
+  slots.resize(slots.size() + count, VkCommandBuffer{});
+  return first;
+}
+
+void LveSecondaryCommands::record(
+    uint32_t slot, uint32_t lane, const FrameInfo &frameInfo, const RecordFn &fn) {
+  assert(slot < slots.size() && slots[slot] == VK_NULL_HANDLE && "Slot not reserved or already recorded");
+  VkCommandBuffer commandBuffer =
+      pools.allocate(frameIndex, lane, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+
+  const LveRenderTargetFormat &target = inheritance.targetFormat;
+  VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{};
+  renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+  renderingInheritance.colorAttachmentCount = static_cast<uint32_t>(target.colorFormats.size());
+  renderingInheritance.pColorAttachmentFormats = target.colorFormats.data();
+  renderingInheritance.depthAttachmentFormat = target.depthFormat;
+  renderingInheritance.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+  renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+  VkCommandBufferInheritanceInfo inheritanceInfo{};
+  inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+  if (target.renderPass != VK_NULL_HANDLE) {
+    inheritanceInfo.renderPass = target.renderPass;
+    inheritanceInfo.subpass = target.subpass;
+    inheritanceInfo.framebuffer = inheritance.framebuffer;
+  } else {
+    inheritanceInfo.pNext = &renderingInheritance;
+  }
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags =
+      VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  beginInfo.pInheritanceInfo = &inheritanceInfo;
+  if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+    throw std::runtime_error("failed to begin recording secondary command buffer!");
+  }
+
+  // dynamic state is not inherited from the primary
+  VkViewport viewport{};
+  viewport.x = 0.0f;
+  viewport.y = 0.0f;
+  viewport.width = static_cast<float>(inheritance.extent.width);
+  viewport.height = static_cast<float>(inheritance.extent.height);
+  viewport.minDepth = 0.0f;
+  viewport.maxDepth = 1.0f;
+  VkRect2D scissor{{0, 0}, inheritance.extent};
+  vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+  vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+
+  LveDynamicStateTracker dynamicState{lveDevice, commandBuffer};
+  FrameInfo secondaryInfo{
+      frameInfo.frameIndex,
+      frameInfo.frameTime,
+      commandBuffer,
+      frameInfo.camera,
+      frameInfo.globalDescriptor,
+      frameInfo.gameObjects,
+      dynamicState};
+  fn(secondaryInfo);
+
+  if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+    throw std::runtime_error("failed to record secondary command buffer!");
+  }
+  slots[slot] = commandBuffer;
+}
+
+void LveSecondaryCommands::record(const FrameInfo &frameInfo, const RecordFn &fn) {
+  record(reserve(1), 0, frameInfo, fn);
+}
+
+void LveSecondaryCommands::execute(VkCommandBuffer primaryCommandBuffer) {
+  assert(
+      std::none_of(slots.begin(), slots.end(), [](VkCommandBuffer slot) { return slot == VK_NULL_HANDLE; }) &&
+      "Every reserved slot has to be recorded before execute");
+  if (slots.empty()) return;
+  vkCmdExecuteCommands(primaryCommandBuffer, static_cast<uint32_t>(slots.size()), slots.data());
+}
+
+}  // namespace lve
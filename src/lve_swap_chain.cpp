@@ -1,37 +1,104 @@
 #include "lve_swap_chain.hpp"
 
 // std
-#include <array>
+#include <algorithm>
+#include <cassert>
 #include <cstdlib>
 #include <cstring>
-#include <iostream>
 #include <limits>
 #include <set>
+#include <sstream>
 #include <stdexcept>
 
 namespace lve {
 
-  LveSwapChain::LveSwapChain(LveDevice& deviceRef, VkExtent2D extent)
-    : device{ deviceRef }, windowExtent{ extent } {
+  namespace {
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+      return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    const char* presentModeName(VkPresentModeKHR presentMode) {
+      switch (presentMode) {
+      case VK_PRESENT_MODE_IMMEDIATE_KHR: return "immediate";
+      case VK_PRESENT_MODE_MAILBOX_KHR: return "mailbox";
+      case VK_PRESENT_MODE_FIFO_KHR: return "fifo";
+      case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "fifo_relaxed";
+      default: return "unknown";
+      }
+    }
+
+    VkPresentModeKHR parsePresentMode(const std::string& name) {
+      for (VkPresentModeKHR presentMode : { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+             VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR }) {
+        if (name == presentModeName(presentMode)) {
+          return presentMode;
+        }
+      }
+      throw std::runtime_error("unknown present mode in LVE_PRESENT_MODES: " + name);
+    }
+
+  }  // namespace
+
+  LveSwapChainConfig LveSwapChainConfig::fromEnvironment() {
+    LveSwapChainConfig config{};
+    if (const char* frames = std::getenv("LVE_FRAMES_IN_FLIGHT")) {
+      config.framesInFlight = std::atoi(frames);
+      if (config.framesInFlight < MIN_FRAMES_IN_FLIGHT || config.framesInFlight > MAX_FRAMES_IN_FLIGHT) {
+        throw std::runtime_error("LVE_FRAMES_IN_FLIGHT must be between 1 and 4!");
+      }
+    }
+    if (const char* modes = std::getenv("LVE_PRESENT_MODES")) {
+      config.presentModes.clear();
+      std::istringstream list{ modes };
+      std::string name;
+      while (std::getline(list, name, ',')) {
+        if (!name.empty()) {
+          config.presentModes.push_back(parsePresentMode(name));
+        }
+      }
+    }
+    if (const char* budget = std::getenv("LVE_LATENCY_BUDGET_MS")) {
+      config.latencyBudgetMs = static_cast<float>(std::atof(budget));
+      if (config.latencyBudgetMs < 0.0f) {
+        throw std::runtime_error("LVE_LATENCY_BUDGET_MS must not be negative!");
+      }
+    }
+    return config;
+  }
+
+  LveSwapChain::LveSwapChain(LveDevice& deviceRef, VkExtent2D extent, const LveSwapChainConfig& config)
+    : device{ deviceRef }, windowExtent{ extent }, config{ config } {
     init();
   }
 
   LveSwapChain::LveSwapChain(
-    LveDevice& deviceRef, VkExtent2D extent, std::shared_ptr<LveSwapChain> previous)
-    : device{ deviceRef }, windowExtent{ extent }, oldSwapChain{ previous } {
+    LveDevice& deviceRef,
+    VkExtent2D extent,
+    const LveSwapChainConfig& config,
+    std::shared_ptr<LveSwapChain> previous)
+    : device{ deviceRef }, windowExtent{ extent }, config{ config }, oldSwapChain{ previous } {
     init();
 
-    // clean up old swap chain since it's no longer needed
+    // the caller keeps the old swap chain alive until its frames in flight are done
     oldSwapChain = nullptr;
   }
 
   void LveSwapChain::init() {
+    assert(
+      config.framesInFlight >= LveSwapChainConfig::MIN_FRAMES_IN_FLIGHT &&
+      config.framesInFlight <= LveSwapChainConfig::MAX_FRAMES_IN_FLIGHT &&
+      "framesInFlight out of range");
+    presentPacing = config.latencyBudgetMs > 0.0f && device.supportsPresentWait();
     createSwapChain();
     createImageViews();
-    createRenderPass();
-    createDepthResources();
-    createFramebuffers();
-    createSyncObjects();
+    // the render graph creates the depth buffer and whatever render passes it draws with
+    swapChainDepthFormat = findDepthFormat();
+    if (oldSwapChain != nullptr) {
+      takeSyncObjects(*oldSwapChain);
+    } else {
+      createSyncObjects();
+    }
   }
 
   LveSwapChain::~LveSwapChain() {
@@ -45,20 +112,8 @@ namespace lve {
       swapChain = nullptr;
     }
 
-    for (int i = 0; i < depthImages.size(); i++) {
-      vkDestroyImageView(device.device(), depthImageViews[i], nullptr);
-      vkDestroyImage(device.device(), depthImages[i], nullptr);
-      vkFreeMemory(device.device(), depthImageMemorys[i], nullptr);
-    }
-
-    for (auto framebuffer : swapChainFramebuffers) {
-      vkDestroyFramebuffer(device.device(), framebuffer, nullptr);
-    }
-
-    vkDestroyRenderPass(device.device(), renderPass, nullptr);
-
-    // cleanup synchronization objects
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    // cleanup synchronization objects, unless a newer swap chain took them over
+    for (size_t i = 0; i < inFlightFences.size(); i++) {
       vkDestroySemaphore(device.device(), renderFinishedSemaphores[i], nullptr);
       vkDestroySemaphore(device.device(), imageAvailableSemaphores[i], nullptr);
       vkDestroyFence(device.device(), inFlightFences[i], nullptr);
@@ -66,13 +121,22 @@ namespace lve {
   }
 
   VkResult LveSwapChain::acquireNextImage(uint32_t* imageIndex) {
+    frameTimings = {};
+    auto start = std::chrono::steady_clock::now();
+    if (presentPacing) {
+      waitForPresentLatency();
+      frameTimings.presentWaitMs = millisecondsSince(start);
+      start = std::chrono::steady_clock::now();
+    }
     vkWaitForFences(
       device.device(),
       1,
       &inFlightFences[currentFrame],
       VK_TRUE,
       std::numeric_limits<uint64_t>::max());
+    frameTimings.frameFenceWaitMs = millisecondsSince(start);
 
+    start = std::chrono::steady_clock::now();
     VkResult result = vkAcquireNextImageKHR(
       device.device(),
       swapChain,
@@ -80,13 +144,17 @@ namespace lve {
       imageAvailableSemaphores[currentFrame],  // must be a not signaled semaphore
       VK_NULL_HANDLE,
       imageIndex);
+    frameTimings.acquireMs = millisecondsSince(start);
 
     return result;
   }
 
-  VkResult LveSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
+  VkResult LveSwapChain::submitCommandBuffers(
+    const VkCommandBuffer* buffers, uint32_t bufferCount, uint32_t* imageIndex) {
     if (imagesInFlight[*imageIndex] != VK_NULL_HANDLE) {
+      auto start = std::chrono::steady_clock::now();
       vkWaitForFences(device.device(), 1, &imagesInFlight[*imageIndex], VK_TRUE, UINT64_MAX);
+      frameTimings.imageFenceWaitMs = millisecondsSince(start);
     }
     imagesInFlight[*imageIndex] = inFlightFences[currentFrame];
 
@@ -99,7 +167,7 @@ namespace lve {
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
 
-    submitInfo.commandBufferCount = 1;
+    submitInfo.commandBufferCount = bufferCount;
     submitInfo.pCommandBuffers = buffers;
 
     VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
@@ -107,10 +175,12 @@ namespace lve {
     submitInfo.pSignalSemaphores = signalSemaphores;
 
     vkResetFences(device.device(), 1, &inFlightFences[currentFrame]);
+    auto submitStart = std::chrono::steady_clock::now();
     if (vkQueueSubmit(device.graphicsQueue(), 1, &submitInfo, inFlightFences[currentFrame]) !=
       VK_SUCCESS) {
       throw std::runtime_error("failed to submit draw command buffer!");
     }
+    frameTimings.submitMs = millisecondsSince(submitStart);
 
     VkPresentInfoKHR presentInfo = {};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -124,9 +194,23 @@ namespace lve {
 
     presentInfo.pImageIndices = imageIndex;
 
+    VkPresentIdKHR presentId{};
+    presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+    presentId.swapchainCount = 1;
+    uint64_t id = presentCount + 1;
+    presentId.pPresentIds = &id;
+    if (presentPacing) {
+      presentInfo.pNext = &presentId;
+    }
+
+    auto presentStart = std::chrono::steady_clock::now();
     auto result = vkQueuePresentKHR(device.presentQueue(), &presentInfo);
+    frameTimings.presentMs = millisecondsSince(presentStart);
+    if (presentPacing) {
+      presentCount = id;
+    }
 
-    currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    currentFrame = (currentFrame + 1) % config.framesInFlight;
 
     return result;
   }
@@ -135,7 +219,7 @@ namespace lve {
     SwapChainSupportDetails swapChainSupport = device.getSwapChainSupport();
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
@@ -214,143 +298,10 @@ namespace lve {
     }
   }
 
-  void LveSwapChain::createRenderPass() {
-    VkAttachmentDescription depthAttachment{};
-    depthAttachment.format = findDepthFormat();
-    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentReference depthAttachmentRef{};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = getSwapChainImageFormat();
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    VkSubpassDescription subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-
-    VkSubpassDependency dependency = {};
-
-    dependency.dstSubpass = 0;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.srcAccessMask = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-
-    std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-    renderPassInfo.pAttachments = attachments.data();
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subpass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-
-    if (vkCreateRenderPass(device.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
-      throw std::runtime_error("failed to create render pass!");
-    }
-  }
-
-  void LveSwapChain::createFramebuffers() {
-    swapChainFramebuffers.resize(imageCount());
-    for (size_t i = 0; i < imageCount(); i++) {
-      std::array<VkImageView, 2> attachments = { swapChainImageViews[i], depthImageViews[i] };
-
-      VkExtent2D swapChainExtent = getSwapChainExtent();
-      VkFramebufferCreateInfo framebufferInfo = {};
-      framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-      framebufferInfo.renderPass = renderPass;
-      framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
-      framebufferInfo.pAttachments = attachments.data();
-      framebufferInfo.width = swapChainExtent.width;
-      framebufferInfo.height = swapChainExtent.height;
-      framebufferInfo.layers = 1;
-
-      if (vkCreateFramebuffer(
-        device.device(),
-        &framebufferInfo,
-        nullptr,
-        &swapChainFramebuffers[i]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create framebuffer!");
-      }
-    }
-  }
-
-  void LveSwapChain::createDepthResources() {
-    VkFormat depthFormat = findDepthFormat();
-    swapChainDepthFormat = depthFormat;
-    VkExtent2D swapChainExtent = getSwapChainExtent();
-
-    depthImages.resize(imageCount());
-    depthImageMemorys.resize(imageCount());
-    depthImageViews.resize(imageCount());
-
-    for (int i = 0; i < depthImages.size(); i++) {
-      VkImageCreateInfo imageInfo{};
-      imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-      imageInfo.imageType = VK_IMAGE_TYPE_2D;
-      imageInfo.extent.width = swapChainExtent.width;
-      imageInfo.extent.height = swapChainExtent.height;
-      imageInfo.extent.depth = 1;
-      imageInfo.mipLevels = 1;
-      imageInfo.arrayLayers = 1;
-      imageInfo.format = depthFormat;
-      imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-      imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-      imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-      imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-      imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-      imageInfo.flags = 0;
-
-      device.createImageWithInfo(
-        imageInfo,
-        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-        depthImages[i],
-        depthImageMemorys[i]);
-
-      VkImageViewCreateInfo viewInfo{};
-      viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-      viewInfo.image = depthImages[i];
-      viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-      viewInfo.format = depthFormat;
-      viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-      viewInfo.subresourceRange.baseMipLevel = 0;
-      viewInfo.subresourceRange.levelCount = 1;
-      viewInfo.subresourceRange.baseArrayLayer = 0;
-      viewInfo.subresourceRange.layerCount = 1;
-
-      if (vkCreateImageView(device.device(), &viewInfo, nullptr, &depthImageViews[i]) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create texture image view!");
-      }
-    }
-  }
-
   void LveSwapChain::createSyncObjects() {
-    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    imageAvailableSemaphores.resize(config.framesInFlight);
+    renderFinishedSemaphores.resize(config.framesInFlight);
+    inFlightFences.resize(config.framesInFlight);
     imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
 
     VkSemaphoreCreateInfo semaphoreInfo = {};
@@ -360,7 +311,7 @@ namespace lve {
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+    for (size_t i = 0; i < inFlightFences.size(); i++) {
       if (vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) !=
         VK_SUCCESS ||
         vkCreateSemaphore(device.device(), &semaphoreInfo, nullptr, &renderFinishedSemaphores[i]) !=
@@ -371,6 +322,23 @@ namespace lve {
     }
   }
 
+  // Frames still in flight on the previous swap chain signal its fences, so the new one has to wait
+  // on the same ones, in the same frame slot order, before reusing a slot.
+  void LveSwapChain::takeSyncObjects(LveSwapChain& previous) {
+    assert(
+      previous.inFlightFences.size() == static_cast<size_t>(config.framesInFlight) &&
+      "framesInFlight changed between swap chains");
+    imageAvailableSemaphores = std::move(previous.imageAvailableSemaphores);
+    renderFinishedSemaphores = std::move(previous.renderFinishedSemaphores);
+    inFlightFences = std::move(previous.inFlightFences);
+    previous.imageAvailableSemaphores.clear();
+    previous.renderFinishedSemaphores.clear();
+    previous.inFlightFences.clear();
+    currentFrame = previous.currentFrame;
+    // the new images have not been rendered to yet
+    imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+  }
+
   VkSurfaceFormatKHR LveSwapChain::chooseSwapSurfaceFormat(
     const std::vector<VkSurfaceFormatKHR>& availableFormats) {
     for (const auto& availableFormat : availableFormats) {
@@ -385,24 +353,44 @@ namespace lve {
 
   VkPresentModeKHR LveSwapChain::chooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (const auto& availablePresentMode : availablePresentModes) {
-      if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-        std::cout << "Present mode: Mailbox" << std::endl;
-        return availablePresentMode;
+    for (VkPresentModeKHR preferred : config.presentModes) {
+      if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferred) !=
+        availablePresentModes.end()) {
+        return preferred;
       }
     }
 
-    // for (const auto &availablePresentMode : availablePresentModes) {
-    //   if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-    //     std::cout << "Present mode: Immediate" << std::endl;
-    //     return availablePresentMode;
-    //   }
-    // }
-
-    std::cout << "Present mode: V-Sync" << std::endl;
+    // the only mode every surface supports
     return VK_PRESENT_MODE_FIFO_KHR;
   }
 
+  // Waits until few enough presents are queued that the next frame would be displayed within the
+  // latency budget. How many fit is estimated from the measured time between presents, at least
+  // one is always allowed so the GPU never idles waiting for the CPU.
+  void LveSwapChain::waitForPresentLatency() {
+    uint64_t allowed = 1;
+    if (displayIntervalNs > 0.0) {
+      double budgetNs = static_cast<double>(config.latencyBudgetMs) * 1000000.0;
+      allowed = std::max<uint64_t>(static_cast<uint64_t>(budgetNs / displayIntervalNs), 1);
+    }
+    allowed = std::min<uint64_t>(allowed, static_cast<uint64_t>(config.framesInFlight));
+    if (presentCount < allowed) return;
+    uint64_t waitId = presentCount + 1 - allowed;
+    if (waitId <= lastWaitedPresent) return;
+
+    if (device.waitForPresent(swapChain, waitId, PRESENT_WAIT_TIMEOUT_NS) != VK_SUCCESS) {
+      return;  // timed out or out of date, the fence wait still bounds the frames in flight
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (lastWaitedPresent != 0) {
+      double interval = std::chrono::duration<double, std::nano>(now - lastWaitedTime).count() /
+        static_cast<double>(waitId - lastWaitedPresent);
+      displayIntervalNs = displayIntervalNs > 0.0 ? displayIntervalNs * 0.9 + interval * 0.1 : interval;
+    }
+    lastWaitedPresent = waitId;
+    lastWaitedTime = now;
+  }
+
   VkExtent2D LveSwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
       return capabilities.currentExtent;
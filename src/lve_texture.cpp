@@ -1,82 +1,202 @@
 #include "lve_texture.hpp"
-#define STB_IMAGE_IMPLEMENTATION
-#include "third_party/stb/stb_image.h"
+#include "lve_bc_decoder.hpp"
+#include "lve_image.hpp"
+#include "lve_mipmap.hpp"
 
+#include <algorithm>
 #include <array>
+#include <cstring>
 #include <stdexcept>
 
 namespace lve {
-LveTexture::LveTexture(LveDevice& device, const std::string& filepath) : device_{device} {
-		stbi_set_flip_vertically_on_load(true);
-    createTextureImage(filepath);
+LveTexture::LveTexture(LveDevice& device, const std::string& filepath, LveThreadPool* threadPool)
+    : device_{device}, threadPool_{threadPool} {
+    // a cooked KTX2 or converted QOI next to the image is loaded instead of it
+    std::string resolved = resolveTextureFile(filepath);
+    if (isTextureContainerFile(resolved)) {
+      createTextureFromData(loadTextureData(resolved));
+    } else {
+      createTextureImage(resolved);
+    }
     createTextureImageView();
     createTextureSampler();
 }
 
-LveTexture::LveTexture(LveDevice& device, const std::array<std::string, 6>& faces) : device_{device} {
-		stbi_set_flip_vertically_on_load(true);
+LveTexture::LveTexture(LveDevice& device, const std::array<std::string, 6>& faces,
+                       LveThreadPool* threadPool)
+    : device_{device}, threadPool_{threadPool} {
     isCubemap_ = true;
     createCubemapImage(faces);
     createTextureImageView();
     createTextureSampler();
 }
 
+LveTexture::LveTexture(LveDevice& device, TextureData data, LveThreadPool* threadPool)
+    : device_{device}, threadPool_{threadPool} {
+    createTextureFromData(std::move(data));
+    createTextureImageView();
+    createTextureSampler();
+}
+
+LveTexture::LveTexture(LveDevice& device, uint32_t width, uint32_t height, VkFormat format,
+                       uint32_t mipLevels, VkFilter filter)
+    : device_{device}, textureFormat_{format}, mipLevels_{mipLevels}, clampToEdge_{true},
+      filter_{filter} {
+	device_.createImage(
+			width, height, 1, textureFormat_, VK_IMAGE_TILING_OPTIMAL,
+			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, 0, mipLevels_);
+	device_.transitionImageLayout(textureImage, textureFormat_, VK_IMAGE_LAYOUT_UNDEFINED,
+																VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, mipLevels_);
+	device_.transitionImageLayout(textureImage, textureFormat_, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+																VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1, mipLevels_);
+	createTextureImageView();
+	createTextureSampler();
+}
+
+std::vector<std::shared_ptr<LveTexture>> LveTexture::loadTextures(
+    LveDevice& device, const std::vector<std::string>& filepaths, LveThreadPool& threadPool) {
+	std::vector<TextureData> decoded(filepaths.size());
+	threadPool.parallelFor(static_cast<uint32_t>(filepaths.size()), [&](uint32_t begin, uint32_t end) {
+		for (uint32_t i = begin; i < end; ++i) {
+			decoded[i] = loadTextureFile(resolveTextureFile(filepaths[i]));
+		}
+	});
+
+	std::vector<std::shared_ptr<LveTexture>> textures;
+	for (auto& data : decoded) {
+		textures.push_back(std::make_shared<LveTexture>(device, std::move(data), &threadPool));
+	}
+	return textures;
+}
+
+LveTexture::ImageResources LveTexture::replaceImage(VkImage image, VkDeviceMemory memory,
+                                                    uint32_t mipLevels) {
+	ImageResources previous{textureImage, textureImageMemory, textureImageView};
+	textureImage = image;
+	textureImageMemory = memory;
+	mipLevels_ = mipLevels;
+	createTextureImageView();
+	return previous;
+}
+
 LveTexture::~LveTexture() {
-    vkDestroySampler(device_.device(), textureSampler, nullptr);
+    device_.samplerCache().release(samplerKey_);
     vkDestroyImageView(device_.device(), textureImageView, nullptr);
     vkDestroyImage(device_.device(), textureImage, nullptr);
     vkFreeMemory(device_.device(), textureImageMemory, nullptr);
 }
 
+// PNG / JPG go through stb_image, .qoi files through the much faster QOI decoder. The size is
+// probed first so the pixels can be decoded straight into the staging buffer.
 void LveTexture::createTextureImage(const std::string& filepath){
-	int texWidth, texHeight, texChannels;
-	stbi_uc *pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-	VkDeviceSize imageSize = texWidth * texHeight * 4; // Assuming 4 channels (RGBA)
-	if (!pixels) {
-			throw std::runtime_error("failed to load texture image!");
+	uint32_t width, height;
+	probeImage(filepath, width, height);
+	uploadImage(1, width, height, 0, [&](uint8_t* dst) {
+		decodeImageRGBA8(filepath, true, dst, width, height);
+	});
+}
+
+// the six faces decode in parallel, each into its own layer of the one staging buffer; faces with
+// a converted .qoi next to them decode from that
+void LveTexture::createCubemapImage(const std::array<std::string, 6>& faces) {
+	std::vector<std::string> files;
+	for (const auto& face : faces) {
+		files.push_back(resolveImageFile(face));
 	}
+	uint32_t width, height;
+	probeImage(files[0], width, height);
+	uploadImage(6, width, height, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, [&](uint8_t* dst) {
+		decodeImagesRGBA8(files, true, dst, width, height, threadPool_);
+	});
+}
+
+// Precompressed data is uploaded block for block with the mips stored in the file. When the device
+// cannot sample the format the levels are decoded to RGBA8 on the CPU first.
+void LveTexture::createTextureFromData(TextureData data) {
+	isCubemap_ = data.isCubemap;
+	VkImageCreateFlags flags = data.isCubemap ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0;
+
+	if (isBlockCompressedFormat(data.format) && !supportsSampledFormat(data.format)) {
+		for (uint32_t level = 0; level < data.mipLevels(); ++level) {
+			uint32_t levelWidth = std::max(data.width >> level, 1u);
+			uint32_t levelHeight = std::max(data.height >> level, 1u);
+			VkDeviceSize layerSize = formatLevelSize(data.format, levelWidth, levelHeight);
+			std::vector<uint8_t> decoded;
+			for (uint32_t layer = 0; layer < data.layerCount; ++layer) {
+				auto pixels = decodeBlockCompressedImage(
+						data.format, data.levels[level].data() + layer * layerSize, levelWidth, levelHeight);
+				decoded.insert(decoded.end(), pixels.begin(), pixels.end());
+			}
+			data.levels[level] = std::move(decoded);
+		}
+		data.format = decodedTextureFormat(data.format);
+	}
+	textureFormat_ = data.format;
+
+	// a lone uncompressed level still gets a generated chain
+	if (!isBlockCompressedFormat(data.format) && data.mipLevels() == 1) {
+		uploadImage(data.layerCount, data.width, data.height, flags, [&](uint8_t* dst) {
+			memcpy(dst, data.levels[0].data(), data.levels[0].size());
+		});
+		return;
+	}
+
+	layerCount_ = data.layerCount;
+	mipLevels_ = data.mipLevels();
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize totalSize = 0;
+	for (uint32_t level = 0; level < mipLevels_; ++level) {
+		regions.push_back(bufferImageCopy(totalSize, level, std::max(data.width >> level, 1u),
+																			std::max(data.height >> level, 1u)));
+		totalSize += data.levels[level].size();
+	}
+
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
-	device_.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+	device_.createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
 												VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
 														VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
 												stagingBuffer, stagingBufferMemory);
-	void *data;
-	vkMapMemory(device_.device(), stagingBufferMemory, 0, imageSize, 0, &data);
-	memcpy(data, pixels, static_cast<size_t>(imageSize));
+	void *mapped;
+	vkMapMemory(device_.device(), stagingBufferMemory, 0, totalSize, 0, &mapped);
+	for (uint32_t level = 0; level < mipLevels_; ++level) {
+		memcpy(static_cast<uint8_t*>(mapped) + regions[level].bufferOffset, data.levels[level].data(),
+					 data.levels[level].size());
+	}
 	vkUnmapMemory(device_.device(), stagingBufferMemory);
-	stbi_image_free(pixels);
 
-	device_.createImage(
-			texWidth, texHeight, 1, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory);
-	device_.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-												VK_IMAGE_LAYOUT_UNDEFINED,
-												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	device_.copyBufferToImage(stagingBuffer, textureImage,
-										static_cast<uint32_t>(texWidth),
-										static_cast<uint32_t>(texHeight), 1);
-	device_.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-												VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	createImageFromStaging(stagingBuffer, regions, data.width, data.height, flags, false);
 	vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
 	vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
 }
 
-void LveTexture::createCubemapImage(const std::array<std::string, 6>& faces) {
-	int texWidth, texHeight, texChannels;
-	std::vector<stbi_uc*> pixels(6);
-	for (size_t i = 0; i < faces.size(); ++i) {
-			pixels[i] = stbi_load(faces[i].c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-			if (!pixels[i]) {
-					for (size_t j = 0; j < i; ++j) stbi_image_free(pixels[j]);
-					throw std::runtime_error("failed to load cubemap face: " + faces[i]);
-			}
+// Uploads level 0 of every layer and fills the rest of the mip chain, with blits when the format
+// supports linear blitting and on the CPU otherwise. writeLevel0 fills every layer of level 0
+// back to back, directly in the mapped staging buffer.
+void LveTexture::uploadImage(uint32_t layerCount, uint32_t width, uint32_t height,
+														 VkImageCreateFlags flags,
+														 const std::function<void(uint8_t*)>& writeLevel0) {
+	layerCount_ = layerCount;
+	mipLevels_ = calculateMipLevels(width, height);
+	bool blitMipmaps = supportsLinearBlit(textureFormat_);
+	if (!blitMipmaps && textureFormat_ == VK_FORMAT_R8G8B8A8_SNORM) {
+		// the CPU filter only understands unsigned data
+		mipLevels_ = 1;
+	}
+	bool cpuMipmaps = !blitMipmaps && mipLevels_ > 1;
+
+	// staging layout is level-major: every layer of level 0, then every layer of level 1, ...
+	std::vector<VkBufferImageCopy> regions;
+	VkDeviceSize layerSize = static_cast<VkDeviceSize>(width) * height * 4;
+	VkDeviceSize totalSize = 0;
+	for (uint32_t level = 0; level < (cpuMipmaps ? mipLevels_ : 1); ++level) {
+		uint32_t levelWidth = std::max(width >> level, 1u);
+		uint32_t levelHeight = std::max(height >> level, 1u);
+		regions.push_back(bufferImageCopy(totalSize, level, levelWidth, levelHeight));
+		totalSize += static_cast<VkDeviceSize>(levelWidth) * levelHeight * 4 * layerCount_;
 	}
-	VkDeviceSize faceSize = texWidth * texHeight * 4;
-	VkDeviceSize totalSize = faceSize * 6;
-	
+
 	VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
 	device_.createBuffer(totalSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
@@ -85,59 +205,199 @@ void LveTexture::createCubemapImage(const std::array<std::string, 6>& faces) {
 												stagingBuffer, stagingBufferMemory);
 	void *data;
 	vkMapMemory(device_.device(), stagingBufferMemory, 0, totalSize, 0, &data);
-	for (size_t i = 0; i < faces.size(); ++i) {
-		memcpy(static_cast<uint8_t*>(data) + i * faceSize, pixels[i], static_cast<size_t>(faceSize));
-		stbi_image_free(pixels[i]);
+	auto dst = static_cast<uint8_t*>(data);
+	try {
+		writeLevel0(dst);
+		if (cpuMipmaps) {
+			auto buildChains = [&](uint32_t begin, uint32_t end) {
+				for (uint32_t layer = begin; layer < end; ++layer) {
+					auto chain = generateMipChainRGBA8(dst + layer * layerSize, width, height,
+																						 textureFormat_ == VK_FORMAT_R8G8B8A8_SRGB);
+					for (size_t level = 1; level < regions.size(); ++level) {
+						const auto& mip = chain[level - 1];
+						memcpy(dst + regions[level].bufferOffset + layer * mip.pixels.size(), mip.pixels.data(),
+									 mip.pixels.size());
+					}
+				}
+			};
+			if (threadPool_) {
+				threadPool_->parallelFor(layerCount_, buildChains);
+			} else {
+				buildChains(0, layerCount_);
+			}
+		}
+	} catch (...) {
+		vkUnmapMemory(device_.device(), stagingBufferMemory);
+		vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
+		vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
+		throw;
 	}
 	vkUnmapMemory(device_.device(), stagingBufferMemory);
 
-	device_.createImage(
-			texWidth, texHeight, 6, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL,
-			VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT);
-	device_.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-												VK_IMAGE_LAYOUT_UNDEFINED,
-												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,6);
-	device_.copyBufferToImage(stagingBuffer, textureImage,
-														static_cast<uint32_t>(texWidth),
-														static_cast<uint32_t>(texHeight),
-														6);
-	device_.transitionImageLayout(textureImage, VK_FORMAT_R8G8B8A8_SRGB,
-																VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-																VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-																6);
+	createImageFromStaging(stagingBuffer, regions, width, height, flags, blitMipmaps && mipLevels_ > 1);
 	vkDestroyBuffer(device_.device(), stagingBuffer, nullptr);
 	vkFreeMemory(device_.device(), stagingBufferMemory, nullptr);
 }
 
+void LveTexture::createImageFromStaging(VkBuffer stagingBuffer,
+																				const std::vector<VkBufferImageCopy>& regions, uint32_t width,
+																				uint32_t height, VkImageCreateFlags flags, bool blitMipmaps) {
+	// also a transfer source for the mip blits and for LveTextureStreamer copying levels out
+	VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+	                          VK_IMAGE_USAGE_SAMPLED_BIT;
+	device_.createImage(
+			width, height, layerCount_, textureFormat_, VK_IMAGE_TILING_OPTIMAL, usage,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, textureImage, textureImageMemory, flags, mipLevels_);
+	device_.transitionImageLayout(textureImage, textureFormat_,
+												VK_IMAGE_LAYOUT_UNDEFINED,
+												VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+												layerCount_, mipLevels_);
+	device_.copyBufferToImage(stagingBuffer, textureImage, regions);
+	if (blitMipmaps) {
+		generateMipmaps(static_cast<int32_t>(width), static_cast<int32_t>(height));
+	} else {
+		device_.transitionImageLayout(textureImage, textureFormat_,
+													VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+													VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+													layerCount_, mipLevels_);
+	}
+}
+
+VkBufferImageCopy LveTexture::bufferImageCopy(VkDeviceSize offset, uint32_t mipLevel,
+																							uint32_t width, uint32_t height) const {
+	VkBufferImageCopy region{};
+	region.bufferOffset = offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = mipLevel;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layerCount_;
+	region.imageOffset = {0, 0, 0};
+	region.imageExtent = {width, height, 1};
+	return region;
+}
+
+bool LveTexture::supportsSampledFormat(VkFormat format) {
+	if (isBlockCompressedFormat(format) && !device_.supportsTextureCompressionBC()) {
+		return false;
+	}
+	try {
+		device_.findSupportedFormat({format}, VK_IMAGE_TILING_OPTIMAL,
+																VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT |
+																		VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+	} catch (const std::runtime_error&) {
+		return false;
+	}
+	return true;
+}
+
+bool LveTexture::supportsLinearBlit(VkFormat format) {
+	VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+																	VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (device_.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
+
+// Each level is blitted from the previous one, then moved to SHADER_READ_ONLY as soon as it has
+// been read, so every level goes DST -> SRC -> SHADER_READ exactly once.
+void LveTexture::generateMipmaps(int32_t texWidth, int32_t texHeight) {
+	VkCommandBuffer commandBuffer = device_.beginSingleTimeCommands();
+
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.image = textureImage;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = layerCount_;
+	barrier.subresourceRange.levelCount = 1;
+
+	int32_t mipWidth = texWidth;
+	int32_t mipHeight = texHeight;
+	for (uint32_t i = 1; i < mipLevels_; i++) {
+		barrier.subresourceRange.baseMipLevel = i - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+												 VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		int32_t nextWidth = mipWidth > 1 ? mipWidth / 2 : 1;
+		int32_t nextHeight = mipHeight > 1 ? mipHeight / 2 : 1;
+		VkImageBlit blit{};
+		blit.srcOffsets[0] = {0, 0, 0};
+		blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+		blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.srcSubresource.mipLevel = i - 1;
+		blit.srcSubresource.baseArrayLayer = 0;
+		blit.srcSubresource.layerCount = layerCount_;
+		blit.dstOffsets[0] = {0, 0, 0};
+		blit.dstOffsets[1] = {nextWidth, nextHeight, 1};
+		blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		blit.dstSubresource.mipLevel = i;
+		blit.dstSubresource.baseArrayLayer = 0;
+		blit.dstSubresource.layerCount = layerCount_;
+		vkCmdBlitImage(commandBuffer, textureImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+									 textureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit,
+									 VK_FILTER_LINEAR);
+
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+												 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1,
+												 &barrier);
+
+		mipWidth = nextWidth;
+		mipHeight = nextHeight;
+	}
+
+	// the last level was only ever written
+	barrier.subresourceRange.baseMipLevel = mipLevels_ - 1;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+											 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	device_.endSingleTimeCommands(commandBuffer);
+}
+
 void LveTexture::createTextureImageView() {
 	if (isCubemap_) {
-		textureImageView = device_.createImageView(textureImage, VK_IMAGE_VIEW_TYPE_CUBE, VK_FORMAT_R8G8B8A8_SRGB);
+		textureImageView = device_.createImageView(textureImage, VK_IMAGE_VIEW_TYPE_CUBE, textureFormat_,
+																							 layerCount_, mipLevels_);
 	}else{
-		textureImageView = device_.createImageView(textureImage, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB);
+		textureImageView = device_.createImageView(textureImage, VK_IMAGE_VIEW_TYPE_2D, textureFormat_,
+																							 1, mipLevels_);
 	}
 }
 
+// Textures with the same filtering and addressing share one sampler from the device's cache.
 void LveTexture::createTextureSampler() {
-	VkSamplerCreateInfo samplerInfo ={};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = isCubemap_ ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = isCubemap_ ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = isCubemap_ ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE : VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = 16;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
-	if (vkCreateSampler(device_.device(), &samplerInfo, nullptr, &textureSampler) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create texture sampler!");
-	}
+	bool linear = filter_ == VK_FILTER_LINEAR;
+	VkSamplerAddressMode addressMode = (isCubemap_ || clampToEdge_) ? VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE
+																																	: VK_SAMPLER_ADDRESS_MODE_REPEAT;
+	LveSamplerKey key{};
+	key.magFilter = filter_;
+	key.minFilter = filter_;
+	key.mipmapMode = linear ? VK_SAMPLER_MIPMAP_MODE_LINEAR : VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	key.addressModeU = addressMode;
+	key.addressModeV = addressMode;
+	key.addressModeW = addressMode;
+	key.anisotropyEnable = linear ? VK_TRUE : VK_FALSE;
+	key.maxAnisotropy = linear ? 16.0f : 1.0f;
+	key.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	key.minLod = 0.0f;
+	// unclamped, the view limits the levels and stays correct when streaming swaps the image; it
+	// also keeps the mip count out of the key so textures of any size share the sampler
+	key.maxLod = VK_LOD_CLAMP_NONE;
+	textureSampler = device_.samplerCache().acquire(key);
+	samplerKey_ = key;
 }
 
-}
\ No newline at end of file
+}
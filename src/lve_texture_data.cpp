@@ -0,0 +1,538 @@
+#include "lve_texture_data.hpp"
+
+#include "lve_image.hpp"
+
+// std
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+namespace lve {
+
+namespace {
+
+const uint8_t KTX2_IDENTIFIER[12] = {
+    0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A};
+
+constexpr uint32_t fourCC(char a, char b, char c, char d) {
+  return static_cast<uint32_t>(a) | (static_cast<uint32_t>(b) << 8) |
+         (static_cast<uint32_t>(c) << 16) | (static_cast<uint32_t>(d) << 24);
+}
+
+// DDS header flags
+constexpr uint32_t DDPF_FOURCC = 0x4;
+constexpr uint32_t DDPF_RGB = 0x40;
+constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+constexpr uint32_t DDS_RESOURCE_MISC_TEXTURECUBE = 0x4;
+
+// KTX2 data format descriptor colour models and sample flags
+constexpr uint8_t KHR_DF_MODEL_RGBSDA = 1;
+constexpr uint8_t KHR_DF_MODEL_BC1A = 128;
+constexpr uint8_t KHR_DF_MODEL_BC3 = 130;
+constexpr uint8_t KHR_DF_MODEL_BC4 = 131;
+constexpr uint8_t KHR_DF_MODEL_BC5 = 132;
+constexpr uint8_t KHR_DF_MODEL_BC7 = 134;
+constexpr uint8_t KHR_DF_CHANNEL_ALPHA = 15;
+constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+constexpr uint8_t KHR_DF_SAMPLE_DATATYPE_SIGNED = 0x40;
+
+std::vector<uint8_t> readBinaryFile(const std::string &filepath) {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  size_t fileSize = static_cast<size_t>(file.tellg());
+  std::vector<uint8_t> buffer(fileSize);
+  file.seekg(0);
+  file.read(reinterpret_cast<char *>(buffer.data()), fileSize);
+  return buffer;
+}
+
+template <typename T>
+T readValue(const std::vector<uint8_t> &bytes, size_t offset, const std::string &filepath) {
+  if (offset + sizeof(T) > bytes.size()) {
+    throw std::runtime_error("truncated texture file: " + filepath);
+  }
+  T value;
+  memcpy(&value, bytes.data() + offset, sizeof(T));
+  return value;
+}
+
+VkFormat formatFromDxgi(uint32_t dxgiFormat) {
+  switch (dxgiFormat) {
+    case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+  }
+}
+
+// legacy DDS files carry no colour space, colour data is treated as sRGB like the PNG path
+VkFormat formatFromFourCC(uint32_t code) {
+  switch (code) {
+    case fourCC('D', 'X', 'T', '1'): return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case fourCC('D', 'X', 'T', '5'): return VK_FORMAT_BC3_SRGB_BLOCK;
+    case fourCC('A', 'T', 'I', '1'):
+    case fourCC('B', 'C', '4', 'U'): return VK_FORMAT_BC4_UNORM_BLOCK;
+    case fourCC('B', 'C', '4', 'S'): return VK_FORMAT_BC4_SNORM_BLOCK;
+    case fourCC('A', 'T', 'I', '2'):
+    case fourCC('B', 'C', '5', 'U'): return VK_FORMAT_BC5_UNORM_BLOCK;
+    case fourCC('B', 'C', '5', 'S'): return VK_FORMAT_BC5_SNORM_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+  }
+}
+
+std::string lowercaseExtension(const std::string &filepath) {
+  auto dot = filepath.find_last_of('.');
+  std::string extension = dot == std::string::npos ? "" : filepath.substr(dot + 1);
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension;
+}
+
+// The KTXorientation value, "rd" when the key is missing like the specification says. The first
+// letter is the column order, the second the row order.
+std::string ktx2Orientation(
+    const std::vector<uint8_t> &bytes, uint32_t kvdOffset, uint32_t kvdLength, const std::string &filepath) {
+  static const char key[] = "KTXorientation";
+  size_t end = static_cast<size_t>(kvdOffset) + kvdLength;
+  if (end > bytes.size()) {
+    throw std::runtime_error("corrupt KTX2 key/value data in: " + filepath);
+  }
+  size_t offset = kvdOffset;
+  while (offset + 4 <= end) {
+    uint32_t length = readValue<uint32_t>(bytes, offset, filepath);
+    size_t entry = offset + 4;
+    if (length > end - entry) {
+      throw std::runtime_error("corrupt KTX2 key/value data in: " + filepath);
+    }
+    const char *text = reinterpret_cast<const char *>(bytes.data() + entry);
+    if (length >= sizeof(key) + 2 && memcmp(text, key, sizeof(key)) == 0) {
+      return std::string(text + sizeof(key), 2);
+    }
+    offset = entry + ((length + 3) & ~3u);
+  }
+  return "rd";
+}
+
+// turns top down rows of every layer of one uncompressed level bottom up
+void flipLevelRows(std::vector<uint8_t> &level, uint32_t width, uint32_t height, uint32_t layerCount,
+                   uint32_t texelSize) {
+  size_t rowBytes = static_cast<size_t>(width) * texelSize;
+  std::vector<uint8_t> row(rowBytes);
+  for (uint32_t layer = 0; layer < layerCount; layer++) {
+    uint8_t *base = level.data() + static_cast<size_t>(layer) * rowBytes * height;
+    for (uint32_t y = 0; y < height / 2; y++) {
+      uint8_t *top = base + y * rowBytes;
+      uint8_t *bottom = base + (height - 1 - y) * rowBytes;
+      memcpy(row.data(), top, rowBytes);
+      memcpy(top, bottom, rowBytes);
+      memcpy(bottom, row.data(), rowBytes);
+    }
+  }
+}
+
+bool isSupportedContainerFormat(VkFormat format) {
+  return format == VK_FORMAT_R8G8B8A8_UNORM || format == VK_FORMAT_R8G8B8A8_SRGB ||
+         isBlockCompressedFormat(format);
+}
+
+template <typename T>
+void appendValue(std::vector<uint8_t> &bytes, T value) {
+  const uint8_t *raw = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+struct DfdSample {
+  uint16_t bitOffset;
+  uint8_t bitLength;  // minus one, as the descriptor stores it
+  uint8_t channelType;
+};
+
+// basic data format descriptor block, tools reading the file rely on it to identify the format
+std::vector<uint8_t> buildDataFormatDescriptor(VkFormat format) {
+  bool srgb = decodedTextureFormat(format) == VK_FORMAT_R8G8B8A8_SRGB;
+  bool isSigned = format == VK_FORMAT_BC4_SNORM_BLOCK || format == VK_FORMAT_BC5_SNORM_BLOCK;
+  uint8_t model = KHR_DF_MODEL_RGBSDA;
+  std::vector<DfdSample> samples;
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+      model = KHR_DF_MODEL_BC1A;
+      samples = {{0, 63, 0}};
+      break;
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+      model = KHR_DF_MODEL_BC1A;
+      samples = {{0, 63, 1}};
+      break;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+      model = KHR_DF_MODEL_BC3;
+      samples = {{0, 63, KHR_DF_CHANNEL_ALPHA}, {64, 63, 0}};
+      break;
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+      model = KHR_DF_MODEL_BC4;
+      samples = {{0, 63, 0}};
+      break;
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+      model = KHR_DF_MODEL_BC5;
+      samples = {{0, 63, 0}, {64, 63, 1}};
+      break;
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      model = KHR_DF_MODEL_BC7;
+      samples = {{0, 127, 0}};
+      break;
+    default:
+      // alpha stays linear in sRGB formats
+      samples = {
+          {0, 7, 0},
+          {8, 7, 1},
+          {16, 7, 2},
+          {24, 7, static_cast<uint8_t>(KHR_DF_CHANNEL_ALPHA | (srgb ? KHR_DF_SAMPLE_DATATYPE_LINEAR : 0))}};
+      break;
+  }
+
+  bool compressed = isBlockCompressedFormat(format);
+  uint32_t blockByteSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+  std::vector<uint8_t> dfd;
+  appendValue<uint32_t>(dfd, 4 + blockByteSize);
+  appendValue<uint32_t>(dfd, 0);  // Khronos vendor, basic descriptor type
+  appendValue<uint16_t>(dfd, 2);  // version
+  appendValue<uint16_t>(dfd, static_cast<uint16_t>(blockByteSize));
+  appendValue<uint8_t>(dfd, model);
+  appendValue<uint8_t>(dfd, 1);  // BT.709 primaries
+  appendValue<uint8_t>(dfd, srgb ? 2 : 1);
+  appendValue<uint8_t>(dfd, 0);  // straight alpha
+  for (int i = 0; i < 4; i++) appendValue<uint8_t>(dfd, compressed && i < 2 ? 3 : 0);
+  appendValue<uint8_t>(dfd, static_cast<uint8_t>(formatBlockSize(format)));
+  for (int i = 0; i < 7; i++) appendValue<uint8_t>(dfd, 0);
+  for (const auto &sample : samples) {
+    appendValue<uint16_t>(dfd, sample.bitOffset);
+    appendValue<uint8_t>(dfd, sample.bitLength);
+    appendValue<uint8_t>(dfd, isSigned ? sample.channelType | KHR_DF_SAMPLE_DATATYPE_SIGNED : sample.channelType);
+    appendValue<uint32_t>(dfd, 0);  // sample position
+    if (!compressed) {
+      appendValue<uint32_t>(dfd, 0);
+      appendValue<uint32_t>(dfd, 255);
+    } else if (isSigned) {
+      appendValue<uint32_t>(dfd, 0x80000000u);
+      appendValue<uint32_t>(dfd, 0x7fffffffu);
+    } else {
+      appendValue<uint32_t>(dfd, 0);
+      appendValue<uint32_t>(dfd, 0xffffffffu);
+    }
+  }
+  return dfd;
+}
+
+}  // namespace
+
+bool isBlockCompressedFormat(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      return true;
+    default:
+      return false;
+  }
+}
+
+uint32_t formatBlockSize(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+      return 8;
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+      return 16;
+    default:
+      return 4;
+  }
+}
+
+VkDeviceSize formatLevelSize(VkFormat format, uint32_t width, uint32_t height) {
+  if (isBlockCompressedFormat(format)) {
+    return static_cast<VkDeviceSize>((width + 3) / 4) * ((height + 3) / 4) * formatBlockSize(format);
+  }
+  return static_cast<VkDeviceSize>(width) * height * formatBlockSize(format);
+}
+
+VkFormat decodedTextureFormat(VkFormat format) {
+  switch (format) {
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+      return VK_FORMAT_R8G8B8A8_SRGB;
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+      return VK_FORMAT_R8G8B8A8_SNORM;
+    default:
+      return VK_FORMAT_R8G8B8A8_UNORM;
+  }
+}
+
+bool isTextureContainerFile(const std::string &filepath) {
+  std::string extension = lowercaseExtension(filepath);
+  return extension == "ktx2" || extension == "dds";
+}
+
+std::string resolveTextureFile(const std::string &filepath) {
+  if (isTextureContainerFile(filepath)) return filepath;
+  std::string cooked = existingSibling(filepath, ".ktx2");
+  return cooked.empty() ? resolveImageFile(filepath) : cooked;
+}
+
+TextureData loadTextureData(const std::string &filepath) {
+  std::string extension = lowercaseExtension(filepath);
+  if (extension == "ktx2") return loadKtx2(filepath);
+  if (extension == "dds") return loadDds(filepath);
+  throw std::runtime_error("unknown texture container: " + filepath);
+}
+
+TextureData loadTextureFile(const std::string &filepath) {
+  if (isTextureContainerFile(filepath)) {
+    return loadTextureData(filepath);
+  }
+  ImageMipLevel image = loadImageRGBA8(filepath, true);
+  TextureData texture{};
+  texture.format = VK_FORMAT_R8G8B8A8_SRGB;
+  texture.width = image.width;
+  texture.height = image.height;
+  texture.levels.push_back(std::move(image.pixels));
+  return texture;
+}
+
+TextureData loadKtx2(const std::string &filepath) {
+  auto bytes = readBinaryFile(filepath);
+  if (bytes.size() < 80 || memcmp(bytes.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) != 0) {
+    throw std::runtime_error("not a KTX2 file: " + filepath);
+  }
+
+  TextureData texture{};
+  texture.format = static_cast<VkFormat>(readValue<uint32_t>(bytes, 12, filepath));
+  texture.width = readValue<uint32_t>(bytes, 20, filepath);
+  texture.height = std::max(readValue<uint32_t>(bytes, 24, filepath), 1u);
+  uint32_t depth = readValue<uint32_t>(bytes, 28, filepath);
+  uint32_t arrayLayers = readValue<uint32_t>(bytes, 32, filepath);
+  uint32_t faceCount = readValue<uint32_t>(bytes, 36, filepath);
+  uint32_t levelCount = std::max(readValue<uint32_t>(bytes, 40, filepath), 1u);
+  uint32_t supercompression = readValue<uint32_t>(bytes, 44, filepath);
+  uint32_t kvdOffset = readValue<uint32_t>(bytes, 56, filepath);
+  uint32_t kvdLength = readValue<uint32_t>(bytes, 60, filepath);
+
+  if (!isSupportedContainerFormat(texture.format)) {
+    throw std::runtime_error("unsupported KTX2 format in: " + filepath);
+  }
+  if (supercompression != 0) {
+    throw std::runtime_error("supercompressed KTX2 files are not supported: " + filepath);
+  }
+  if (depth > 1 || arrayLayers > 1 || (faceCount != 1 && faceCount != 6)) {
+    throw std::runtime_error("only 2D textures and cubemaps are supported: " + filepath);
+  }
+  texture.isCubemap = faceCount == 6;
+  texture.layerCount = faceCount;
+
+  // the engine uploads rows bottom up, top down rows are flipped here. BC blocks would have to be
+  // re-encoded for that, so those files have to be written bottom up like saveKtx2 does.
+  std::string orientation = ktx2Orientation(bytes, kvdOffset, kvdLength, filepath);
+  if (orientation[0] != 'r' || (orientation[1] != 'u' && orientation[1] != 'd')) {
+    throw std::runtime_error("unsupported KTX2 orientation \"" + orientation + "\" in: " + filepath);
+  }
+  bool flipRows = orientation[1] == 'd';
+  if (flipRows && isBlockCompressedFormat(texture.format)) {
+    throw std::runtime_error(
+        "block compressed KTX2 data must be stored bottom up (KTXorientation ru): " + filepath);
+  }
+
+  // the level index starts right after the fixed size header
+  for (uint32_t level = 0; level < levelCount; level++) {
+    size_t entry = 80 + static_cast<size_t>(level) * 24;
+    uint64_t offset = readValue<uint64_t>(bytes, entry, filepath);
+    uint64_t length = readValue<uint64_t>(bytes, entry + 8, filepath);
+    uint32_t levelWidth = std::max(texture.width >> level, 1u);
+    uint32_t levelHeight = std::max(texture.height >> level, 1u);
+    VkDeviceSize expected = formatLevelSize(texture.format, levelWidth, levelHeight) * texture.layerCount;
+    if (length < expected || offset + expected > bytes.size()) {
+      throw std::runtime_error("corrupt KTX2 level data in: " + filepath);
+    }
+    texture.levels.emplace_back(bytes.begin() + offset, bytes.begin() + offset + expected);
+    if (flipRows) {
+      flipLevelRows(texture.levels.back(), levelWidth, levelHeight, texture.layerCount,
+                    formatBlockSize(texture.format));
+    }
+  }
+  return texture;
+}
+
+TextureData loadDds(const std::string &filepath) {
+  auto bytes = readBinaryFile(filepath);
+  if (bytes.size() < 128 || readValue<uint32_t>(bytes, 0, filepath) != fourCC('D', 'D', 'S', ' ')) {
+    throw std::runtime_error("not a DDS file: " + filepath);
+  }
+
+  TextureData texture{};
+  texture.height = readValue<uint32_t>(bytes, 12, filepath);
+  texture.width = readValue<uint32_t>(bytes, 16, filepath);
+  uint32_t levelCount = std::max(readValue<uint32_t>(bytes, 28, filepath), 1u);
+  uint32_t pixelFormatFlags = readValue<uint32_t>(bytes, 80, filepath);
+  uint32_t code = readValue<uint32_t>(bytes, 84, filepath);
+  uint32_t caps2 = readValue<uint32_t>(bytes, 112, filepath);
+  size_t dataOffset = 128;
+
+  uint32_t arraySize = 1;
+  texture.isCubemap = (caps2 & DDSCAPS2_CUBEMAP) != 0;
+  if ((pixelFormatFlags & DDPF_FOURCC) && code == fourCC('D', 'X', '1', '0')) {
+    texture.format = formatFromDxgi(readValue<uint32_t>(bytes, 128, filepath));
+    texture.isCubemap = (readValue<uint32_t>(bytes, 136, filepath) & DDS_RESOURCE_MISC_TEXTURECUBE) != 0;
+    arraySize = std::max(readValue<uint32_t>(bytes, 140, filepath), 1u);
+    dataOffset += 20;
+  } else if (pixelFormatFlags & DDPF_FOURCC) {
+    texture.format = formatFromFourCC(code);
+  } else if (
+      (pixelFormatFlags & DDPF_RGB) && readValue<uint32_t>(bytes, 88, filepath) == 32 &&
+      readValue<uint32_t>(bytes, 92, filepath) == 0x000000ff &&
+      readValue<uint32_t>(bytes, 96, filepath) == 0x0000ff00 &&
+      readValue<uint32_t>(bytes, 100, filepath) == 0x00ff0000) {
+    texture.format = VK_FORMAT_R8G8B8A8_UNORM;
+  }
+
+  if (texture.format == VK_FORMAT_UNDEFINED) {
+    throw std::runtime_error("unsupported DDS format in: " + filepath);
+  }
+  if (arraySize > 1) {
+    throw std::runtime_error("only 2D textures and cubemaps are supported: " + filepath);
+  }
+  texture.layerCount = texture.isCubemap ? 6 : 1;
+
+  // DDS stores every mip of a face before the next face, regroup it level-major
+  texture.levels.resize(levelCount);
+  size_t offset = dataOffset;
+  for (uint32_t layer = 0; layer < texture.layerCount; layer++) {
+    for (uint32_t level = 0; level < levelCount; level++) {
+      uint32_t levelWidth = std::max(texture.width >> level, 1u);
+      uint32_t levelHeight = std::max(texture.height >> level, 1u);
+      size_t size = static_cast<size_t>(formatLevelSize(texture.format, levelWidth, levelHeight));
+      if (offset + size > bytes.size()) {
+        throw std::runtime_error("truncated DDS file: " + filepath);
+      }
+      auto &levelData = texture.levels[level];
+      levelData.insert(levelData.end(), bytes.begin() + offset, bytes.begin() + offset + size);
+      offset += size;
+    }
+  }
+  return texture;
+}
+
+void saveKtx2(const std::string &filepath, const TextureData &texture) {
+  if (!isSupportedContainerFormat(texture.format)) {
+    throw std::runtime_error("unsupported KTX2 format for: " + filepath);
+  }
+  uint32_t levelCount = texture.mipLevels();
+  if (levelCount == 0) {
+    throw std::runtime_error("texture has no levels to write to: " + filepath);
+  }
+  for (uint32_t level = 0; level < levelCount; level++) {
+    uint32_t levelWidth = std::max(texture.width >> level, 1u);
+    uint32_t levelHeight = std::max(texture.height >> level, 1u);
+    VkDeviceSize expected = formatLevelSize(texture.format, levelWidth, levelHeight) * texture.layerCount;
+    if (texture.levels[level].size() != expected) {
+      throw std::runtime_error("texture level size does not match its format for: " + filepath);
+    }
+  }
+
+  auto dfd = buildDataFormatDescriptor(texture.format);
+  std::vector<uint8_t> kvd;
+  const char orientation[] = "KTXorientation\0ru";
+  appendValue<uint32_t>(kvd, sizeof(orientation));
+  kvd.insert(kvd.end(), orientation, orientation + sizeof(orientation));
+  kvd.resize((kvd.size() + 3) & ~size_t{3}, 0);
+
+  uint32_t dfdOffset = 80 + 24 * levelCount;
+  uint32_t kvdOffset = dfdOffset + static_cast<uint32_t>(dfd.size());
+  // level data is stored smallest mip first, each level aligned to the texel block size
+  size_t alignment = formatBlockSize(texture.format);
+  std::vector<uint64_t> levelOffsets(levelCount);
+  size_t offset = kvdOffset + kvd.size();
+  for (uint32_t level = levelCount; level-- > 0;) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    levelOffsets[level] = offset;
+    offset += texture.levels[level].size();
+  }
+
+  std::vector<uint8_t> bytes(KTX2_IDENTIFIER, KTX2_IDENTIFIER + sizeof(KTX2_IDENTIFIER));
+  bytes.reserve(offset);
+  appendValue<uint32_t>(bytes, static_cast<uint32_t>(texture.format));
+  appendValue<uint32_t>(bytes, 1);  // typeSize
+  appendValue<uint32_t>(bytes, texture.width);
+  appendValue<uint32_t>(bytes, texture.height);
+  appendValue<uint32_t>(bytes, 0);  // depth
+  appendValue<uint32_t>(bytes, 0);  // array layers
+  appendValue<uint32_t>(bytes, texture.isCubemap ? 6 : 1);
+  appendValue<uint32_t>(bytes, levelCount);
+  appendValue<uint32_t>(bytes, 0);  // supercompression
+  appendValue<uint32_t>(bytes, dfdOffset);
+  appendValue<uint32_t>(bytes, static_cast<uint32_t>(dfd.size()));
+  appendValue<uint32_t>(bytes, kvdOffset);
+  appendValue<uint32_t>(bytes, static_cast<uint32_t>(kvd.size()));
+  appendValue<uint64_t>(bytes, 0);  // supercompression global data
+  appendValue<uint64_t>(bytes, 0);
+  for (uint32_t level = 0; level < levelCount; level++) {
+    appendValue<uint64_t>(bytes, levelOffsets[level]);
+    appendValue<uint64_t>(bytes, texture.levels[level].size());
+    appendValue<uint64_t>(bytes, texture.levels[level].size());
+  }
+  bytes.insert(bytes.end(), dfd.begin(), dfd.end());
+  bytes.insert(bytes.end(), kvd.begin(), kvd.end());
+  for (uint32_t level = levelCount; level-- > 0;) {
+    bytes.resize(levelOffsets[level], 0);
+    bytes.insert(bytes.end(), texture.levels[level].begin(), texture.levels[level].end());
+  }
+
+  std::ofstream file{filepath, std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file for writing: " + filepath);
+  }
+  file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    throw std::runtime_error("failed to write file: " + filepath);
+  }
+}
+
+}  // namespace lve
@@ -0,0 +1,559 @@
+#include "lve_texture_streamer.hpp"
+
+#include "lve_bc_decoder.hpp"
+#include "lve_mipmap.hpp"
+
+// libs
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace lve {
+
+namespace {
+
+constexpr uint32_t NOT_VISIBLE = UINT32_MAX;
+// objects closer than this are treated as touching the near plane
+constexpr float MIN_DISTANCE = 0.1f;
+
+TextureData levelsFrom(const TextureData &source, uint32_t baseLevel) {
+  TextureData data{};
+  data.format = source.format;
+  data.width = std::max(source.width >> baseLevel, 1u);
+  data.height = std::max(source.height >> baseLevel, 1u);
+  data.layerCount = source.layerCount;
+  data.isCubemap = source.isCubemap;
+  data.levels.assign(source.levels.begin() + baseLevel, source.levels.end());
+  return data;
+}
+
+VkImageMemoryBarrier levelsBarrier(
+    VkImage image,
+    uint32_t baseLevel,
+    uint32_t levelCount,
+    uint32_t layerCount,
+    VkImageLayout oldLayout,
+    VkImageLayout newLayout,
+    VkAccessFlags srcAccess,
+    VkAccessFlags dstAccess) {
+  VkImageMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.image = image;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  barrier.subresourceRange.baseMipLevel = baseLevel;
+  barrier.subresourceRange.levelCount = levelCount;
+  barrier.subresourceRange.baseArrayLayer = 0;
+  barrier.subresourceRange.layerCount = layerCount;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.srcAccessMask = srcAccess;
+  barrier.dstAccessMask = dstAccess;
+  return barrier;
+}
+
+bool isReady(const std::future<TextureData> &future) {
+  return future.valid() && future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+}  // namespace
+
+LveTextureStreamer::LveTextureStreamer(
+    LveDevice &device,
+    LveBindlessTextures &bindlessTextures,
+    uint32_t framesInFlight,
+    VkDeviceSize budgetBytes,
+    LveThreadPool *threadPool)
+    : lveDevice{device},
+      bindlessTextures{bindlessTextures},
+      threadPool{threadPool},
+      framesInFlight{framesInFlight},
+      budgetBytes_{budgetBytes} {
+  VkCommandPoolCreateInfo poolInfo{};
+  poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  poolInfo.queueFamilyIndex = lveDevice.findPhysicalQueueFamilies().graphicsFamily;
+  if (vkCreateCommandPool(lveDevice.device(), &poolInfo, nullptr, &commandPool) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture upload command pool!");
+  }
+}
+
+LveTextureStreamer::~LveTextureStreamer() {
+  for (auto &streamed : textures) {
+    // the read holds on to this streamer
+    if (streamed->reload.valid()) streamed->reload.wait();
+    if (!streamed->upload) continue;
+    Upload &upload = *streamed->upload;
+    vkWaitForFences(lveDevice.device(), 1, &upload.fence, VK_TRUE, UINT64_MAX);
+    vkDestroyImage(lveDevice.device(), upload.image, nullptr);
+    vkFreeMemory(lveDevice.device(), upload.memory, nullptr);
+    destroyStaging(upload);
+  }
+  releaseRetired(true);
+  vkDestroyCommandPool(lveDevice.device(), commandPool, nullptr);
+}
+
+std::vector<std::shared_ptr<LveTexture>> LveTextureStreamer::loadTextures(
+    const std::vector<std::string> &filepaths) {
+  std::vector<TextureData> decoded(filepaths.size());
+  auto load = [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++) {
+      decoded[i] = loadTextureFile(resolveTextureFile(filepaths[i]));
+      prepareSource(decoded[i]);
+    }
+  };
+  uint32_t count = static_cast<uint32_t>(filepaths.size());
+  if (threadPool) {
+    threadPool->parallelFor(count, load);
+  } else {
+    load(0, count);
+  }
+
+  std::vector<std::shared_ptr<LveTexture>> loaded;
+  for (uint32_t i = 0; i < count; i++) {
+    loaded.push_back(addPrepared(std::move(decoded[i]), filepaths[i]));
+  }
+  return loaded;
+}
+
+std::shared_ptr<LveTexture> LveTextureStreamer::addTexture(TextureData data) {
+  prepareSource(data);
+  return addPrepared(std::move(data), "");
+}
+
+// Brings the data into the shape every upload uses: BC levels decoded when the device cannot
+// sample them, and a full chain for single level RGBA8 images.
+void LveTextureStreamer::prepareSource(TextureData &data) const {
+  if (isBlockCompressedFormat(data.format) && !lveDevice.supportsTextureCompressionBC()) {
+    for (uint32_t level = 0; level < data.mipLevels(); level++) {
+      uint32_t levelWidth = std::max(data.width >> level, 1u);
+      uint32_t levelHeight = std::max(data.height >> level, 1u);
+      VkDeviceSize layerSize = formatLevelSize(data.format, levelWidth, levelHeight);
+      std::vector<uint8_t> decoded;
+      for (uint32_t layer = 0; layer < data.layerCount; layer++) {
+        auto pixels = decodeBlockCompressedImage(
+            data.format, data.levels[level].data() + layer * layerSize, levelWidth, levelHeight);
+        decoded.insert(decoded.end(), pixels.begin(), pixels.end());
+      }
+      data.levels[level] = std::move(decoded);
+    }
+    data.format = decodedTextureFormat(data.format);
+  }
+
+  bool rgba8 = data.format == VK_FORMAT_R8G8B8A8_SRGB || data.format == VK_FORMAT_R8G8B8A8_UNORM;
+  if (rgba8 && data.layerCount == 1 && data.mipLevels() == 1) {
+    auto chain = generateMipChainRGBA8(
+        data.levels[0].data(), data.width, data.height, data.format == VK_FORMAT_R8G8B8A8_SRGB);
+    for (auto &mip : chain) {
+      data.levels.push_back(std::move(mip.pixels));
+    }
+  }
+}
+
+std::shared_ptr<LveTexture> LveTextureStreamer::addPrepared(
+    TextureData data, const std::string &filepath) {
+  auto streamed = std::make_unique<StreamedTexture>();
+  uint32_t levelCount = data.mipLevels();
+
+  // cubemaps and arrays stay fully resident, only 2D textures stream
+  uint32_t minBase = 0;
+  if (data.layerCount == 1) {
+    minBase = levelCount - 1;
+    for (uint32_t level = 0; level < levelCount; level++) {
+      if ((data.width >> level) <= MIN_RESIDENT_SIZE && (data.height >> level) <= MIN_RESIDENT_SIZE) {
+        minBase = level;
+        break;
+      }
+    }
+  }
+
+  streamed->texture = std::make_shared<LveTexture>(lveDevice, levelsFrom(data, minBase), threadPool);
+  for (auto &level : data.levels) {
+    streamed->levelBytes.push_back(level.size());
+  }
+  // minBase and below never leave the GPU, later images copy them from there
+  data.levels.resize(minBase);
+  streamed->filepath = filepath;
+  streamed->source = std::move(data);
+  streamed->residentBase = minBase;
+  streamed->minResidentBase = minBase;
+  streamed->requestedBase = minBase;
+  bindlessTextures.registerTexture(streamed->texture);
+
+  auto texture = streamed->texture;
+  byTexture[texture.get()] = streamed.get();
+  textures.push_back(std::move(streamed));
+  return texture;
+}
+
+void LveTextureStreamer::update(FrameInfo &frameInfo, VkExtent2D extent) {
+  frameCounter++;
+  releaseRetired(false);
+
+  for (auto &streamed : textures) {
+    if (streamed->upload &&
+        vkGetFenceStatus(lveDevice.device(), streamed->upload->fence) == VK_SUCCESS) {
+      finishUpload(*streamed);
+    }
+    if (isReady(streamed->reload)) {
+      finishReload(*streamed);
+    }
+    streamed->requestedBase = streamed->minResidentBase;
+  }
+
+  for (auto &kv : frameInfo.gameObjects) {
+    auto &obj = kv.second;
+    if (obj.model == nullptr || obj.material == nullptr) continue;
+    auto found = byTexture.find(obj.material->GetTexture().get());
+    if (found == byTexture.end()) continue;
+    StreamedTexture &streamed = *found->second;
+    uint32_t level = neededBaseLevel(streamed, obj, frameInfo.camera, extent);
+    if (level == NOT_VISIBLE) continue;
+    streamed.requestedBase = std::min(streamed.requestedBase, level);
+    streamed.lastUsedFrame = frameCounter;
+  }
+
+  VkDeviceSize committed = 0;
+  requestedBytes = 0;
+  for (auto &streamed : textures) {
+    committed += committedBytes(*streamed);
+    requestedBytes += bytesFrom(*streamed, streamed->requestedBase);
+  }
+
+  // drops the least recently used texture that holds more levels than it was asked for
+  auto evictOne = [&](const StreamedTexture *keep) {
+    StreamedTexture *victim = nullptr;
+    for (auto &streamed : textures) {
+      if (streamed.get() == keep || streamed->upload || streamed->residentBase >= streamed->requestedBase) {
+        continue;
+      }
+      if (victim == nullptr || streamed->lastUsedFrame < victim->lastUsedFrame) {
+        victim = streamed.get();
+      }
+    }
+    if (victim == nullptr || uploadsInFlight >= MAX_UPLOADS_IN_FLIGHT) return false;
+    committed -= bytesFrom(*victim, victim->residentBase) - bytesFrom(*victim, victim->requestedBase);
+    startUpload(*victim, victim->requestedBase);
+    return true;
+  };
+
+  while (committed > budgetBytes_ && evictOne(nullptr)) {
+  }
+
+  // the largest shortfall first, recently used textures break ties
+  std::vector<StreamedTexture *> wanting;
+  for (auto &streamed : textures) {
+    if (!streamed->upload && streamed->requestedBase < streamed->residentBase) {
+      wanting.push_back(streamed.get());
+    }
+  }
+  std::sort(wanting.begin(), wanting.end(), [](const StreamedTexture *a, const StreamedTexture *b) {
+    uint32_t shortfallA = a->residentBase - a->requestedBase;
+    uint32_t shortfallB = b->residentBase - b->requestedBase;
+    if (shortfallA != shortfallB) return shortfallA > shortfallB;
+    return a->lastUsedFrame > b->lastUsedFrame;
+  });
+
+  for (StreamedTexture *streamed : wanting) {
+    if (uploadsInFlight >= MAX_UPLOADS_IN_FLIGHT) break;
+    if (!streamed->sourceLoaded) {
+      startReload(*streamed);  // asks again in a later update once the levels are back
+      continue;
+    }
+    uint32_t target = streamed->requestedBase;
+    VkDeviceSize current = bytesFrom(*streamed, streamed->residentBase);
+    // make room, or settle for fewer levels when nothing else can give any up
+    while (target < streamed->residentBase &&
+           committed + bytesFrom(*streamed, target) - current > budgetBytes_) {
+      if (!evictOne(streamed)) target++;
+    }
+    if (target >= streamed->residentBase || uploadsInFlight >= MAX_UPLOADS_IN_FLIGHT) continue;
+    committed += bytesFrom(*streamed, target) - current;
+    startUpload(*streamed, target);
+  }
+}
+
+TextureStreamingStats LveTextureStreamer::getStats() const {
+  TextureStreamingStats stats{};
+  stats.budgetBytes = budgetBytes_;
+  stats.requestedBytes = requestedBytes;
+  stats.textureCount = static_cast<uint32_t>(textures.size());
+  stats.streamedIn = streamedIn;
+  stats.evicted = evicted;
+  for (auto &streamed : textures) {
+    stats.residentBytes += bytesFrom(*streamed, streamed->residentBase);
+    if (streamed->upload) {
+      stats.pendingBytes += bytesFrom(*streamed, streamed->upload->baseLevel);
+      stats.pendingUploads++;
+    }
+  }
+  return stats;
+}
+
+// The level whose texel size matches the object's pixel size: texels per world unit come from the
+// mesh's UV density, pixels per world unit from the projection at the object's nearest point.
+uint32_t LveTextureStreamer::neededBaseLevel(
+    const StreamedTexture &streamed, LveGameObject &obj, const LveCamera &camera, VkExtent2D extent) const {
+  const glm::vec3 &scale = obj.transform.scale;
+  float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+  glm::vec4 center = obj.transform.mat4() * glm::vec4(obj.model->getBoundingCenter(), 1.f);
+  glm::vec3 viewCenter = glm::vec3(camera.getView() * center);
+  float radius = obj.model->getBoundingRadius() * maxScale;
+  if (viewCenter.z + radius <= 0.f) return NOT_VISIBLE;  // behind the camera
+
+  uint32_t lastLevel = streamed.mipLevels() - 1;
+  float texelsPerUnit = obj.model->getUvDensity() / maxScale *
+                        static_cast<float>(std::max(streamed.source.width, streamed.source.height));
+  if (!(texelsPerUnit > 0.f)) return lastLevel;
+
+  float distance = std::max(glm::length(viewCenter) - radius, MIN_DISTANCE);
+  float pixelsPerUnit = camera.getProjectionMatrix()[1][1] * 0.5f * extent.height / distance;
+  float lod = std::floor(std::log2(texelsPerUnit / pixelsPerUnit));
+  if (lod <= 0.f) return 0;
+  return std::min(static_cast<uint32_t>(lod), lastLevel);
+}
+
+VkDeviceSize LveTextureStreamer::bytesFrom(const StreamedTexture &streamed, uint32_t baseLevel) const {
+  VkDeviceSize bytes = 0;
+  for (uint32_t level = baseLevel; level < streamed.mipLevels(); level++) {
+    bytes += streamed.levelBytes[level];
+  }
+  return bytes;
+}
+
+VkDeviceSize LveTextureStreamer::committedBytes(const StreamedTexture &streamed) const {
+  return bytesFrom(streamed, streamed.upload ? streamed.upload->baseLevel : streamed.residentBase);
+}
+
+// Reads the file again on the pool, into the same shape prepareSource gave it the first time
+void LveTextureStreamer::startReload(StreamedTexture &streamed) {
+  if (streamed.reload.valid()) return;
+  std::string filepath = streamed.filepath;
+  auto read = [this, filepath]() {
+    TextureData data = loadTextureFile(resolveTextureFile(filepath));
+    prepareSource(data);
+    return data;
+  };
+  if (threadPool) {
+    streamed.reload = threadPool->submit(read);
+  } else {
+    std::promise<TextureData> promise;
+    promise.set_value(read());
+    streamed.reload = promise.get_future();
+  }
+}
+
+void LveTextureStreamer::finishReload(StreamedTexture &streamed) {
+  TextureData data = streamed.reload.get();  // rethrows read errors
+  if (data.format != streamed.source.format || data.mipLevels() != streamed.mipLevels()) {
+    throw std::runtime_error("texture changed on disk while streaming: " + streamed.filepath);
+  }
+  data.levels.resize(streamed.minResidentBase);
+  streamed.source.levels = std::move(data.levels);
+  streamed.sourceLoaded = true;
+}
+
+// Builds a new image holding baseLevel and everything below it. Levels that are not resident yet
+// come from a staging buffer, the others are copied from the current image, which frames keep
+// sampling meanwhile. The commands run on the graphics queue behind a fence, so they are ordered
+// after the frames already submitted; update() swaps the image in once the fence has signalled.
+void LveTextureStreamer::startUpload(StreamedTexture &streamed, uint32_t baseLevel) {
+  const TextureData &source = streamed.source;
+  uint32_t mipLevels = streamed.mipLevels();
+  uint32_t levelCount = mipLevels - baseLevel;
+  uint32_t width = std::max(source.width >> baseLevel, 1u);
+  uint32_t height = std::max(source.height >> baseLevel, 1u);
+  uint32_t residentBase = streamed.residentBase;
+  uint32_t copiedBase = std::max(baseLevel, residentBase);  // first level copied on the GPU
+  VkImage current = streamed.texture->getImage();
+  auto upload = std::make_unique<Upload>();
+  upload->baseLevel = baseLevel;
+
+  std::vector<VkBufferImageCopy> regions;
+  if (baseLevel < residentBase) {
+    VkDeviceSize stagingSize = bytesFrom(streamed, baseLevel) - bytesFrom(streamed, residentBase);
+    lveDevice.createBuffer(
+        stagingSize,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        upload->stagingBuffer,
+        upload->stagingMemory);
+    void *mapped;
+    vkMapMemory(lveDevice.device(), upload->stagingMemory, 0, stagingSize, 0, &mapped);
+    VkDeviceSize offset = 0;
+    for (uint32_t level = baseLevel; level < residentBase; level++) {
+      const auto &pixels = source.levels[level];
+      memcpy(static_cast<uint8_t *>(mapped) + offset, pixels.data(), pixels.size());
+      VkBufferImageCopy region{};
+      region.bufferOffset = offset;
+      region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+      region.imageSubresource.mipLevel = level - baseLevel;
+      region.imageSubresource.baseArrayLayer = 0;
+      region.imageSubresource.layerCount = source.layerCount;
+      region.imageExtent = {std::max(source.width >> level, 1u), std::max(source.height >> level, 1u), 1};
+      regions.push_back(region);
+      offset += pixels.size();
+    }
+    vkUnmapMemory(lveDevice.device(), upload->stagingMemory);
+  }
+
+  std::vector<VkImageCopy> copies;
+  for (uint32_t level = copiedBase; level < mipLevels; level++) {
+    VkImageCopy copy{};
+    copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - residentBase, 0, source.layerCount};
+    copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - baseLevel, 0, source.layerCount};
+    copy.extent = {std::max(source.width >> level, 1u), std::max(source.height >> level, 1u), 1};
+    copies.push_back(copy);
+  }
+
+  lveDevice.createImage(
+      width,
+      height,
+      source.layerCount,
+      source.format,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      upload->image,
+      upload->memory,
+      0,
+      levelCount);
+
+  VkCommandBufferAllocateInfo allocInfo{};
+  allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  allocInfo.commandPool = commandPool;
+  allocInfo.commandBufferCount = 1;
+  vkAllocateCommandBuffers(lveDevice.device(), &allocInfo, &upload->commandBuffer);
+
+  VkCommandBufferBeginInfo beginInfo{};
+  beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  vkBeginCommandBuffer(upload->commandBuffer, &beginInfo);
+
+  // the copied levels of the current image only need the earlier frames' sampling to finish
+  uint32_t copiedCount = mipLevels - copiedBase;
+  VkImageMemoryBarrier before[2] = {
+      levelsBarrier(
+          upload->image, 0, levelCount, source.layerCount, VK_IMAGE_LAYOUT_UNDEFINED,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+      levelsBarrier(
+          current, copiedBase - residentBase, copiedCount, source.layerCount,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, 0,
+          VK_ACCESS_TRANSFER_READ_BIT)};
+  vkCmdPipelineBarrier(
+      upload->commandBuffer,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 0, nullptr, 0, nullptr, 2, before);
+
+  if (!regions.empty()) {
+    vkCmdCopyBufferToImage(
+        upload->commandBuffer,
+        upload->stagingBuffer,
+        upload->image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(regions.size()),
+        regions.data());
+  }
+  vkCmdCopyImage(
+      upload->commandBuffer,
+      current,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      upload->image,
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(copies.size()),
+      copies.data());
+
+  // the current image goes back to being sampled by the frames recorded until the swap
+  VkImageMemoryBarrier after[2] = {
+      levelsBarrier(
+          upload->image, 0, levelCount, source.layerCount, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT,
+          VK_ACCESS_SHADER_READ_BIT),
+      levelsBarrier(
+          current, copiedBase - residentBase, copiedCount, source.layerCount,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0,
+          VK_ACCESS_SHADER_READ_BIT)};
+  vkCmdPipelineBarrier(
+      upload->commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0, 0, nullptr, 0, nullptr, 2, after);
+  vkEndCommandBuffer(upload->commandBuffer);
+
+  VkFenceCreateInfo fenceInfo{};
+  fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  if (vkCreateFence(lveDevice.device(), &fenceInfo, nullptr, &upload->fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create texture upload fence!");
+  }
+
+  VkSubmitInfo submitInfo{};
+  submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submitInfo.commandBufferCount = 1;
+  submitInfo.pCommandBuffers = &upload->commandBuffer;
+  if (vkQueueSubmit(lveDevice.graphicsQueue(), 1, &submitInfo, upload->fence) != VK_SUCCESS) {
+    throw std::runtime_error("failed to submit texture upload!");
+  }
+
+  streamed.upload = std::move(upload);
+  uploadsInFlight++;
+}
+
+void LveTextureStreamer::finishUpload(StreamedTexture &streamed) {
+  Upload &upload = *streamed.upload;
+  if (upload.baseLevel < streamed.residentBase) {
+    streamedIn++;
+  } else {
+    evicted++;
+  }
+
+  uint32_t levelCount = streamed.mipLevels() - upload.baseLevel;
+  auto previous = streamed.texture->replaceImage(upload.image, upload.memory, levelCount);
+  uint32_t previousSlot = bindlessTextures.rebindTexture(*streamed.texture);
+  retired.push_back({previous, previousSlot, frameCounter});
+  streamed.residentBase = upload.baseLevel;
+
+  // every level is on the GPU now, the file is read again if some are dropped later
+  if (streamed.residentBase == 0 && !streamed.filepath.empty() && streamed.minResidentBase > 0) {
+    std::vector<std::vector<uint8_t>>().swap(streamed.source.levels);
+    streamed.sourceLoaded = false;
+  }
+
+  destroyStaging(upload);
+  streamed.upload.reset();
+  uploadsInFlight--;
+}
+
+void LveTextureStreamer::destroyStaging(Upload &upload) {
+  vkDestroyFence(lveDevice.device(), upload.fence, nullptr);
+  vkFreeCommandBuffers(lveDevice.device(), commandPool, 1, &upload.commandBuffer);
+  if (upload.stagingBuffer != VK_NULL_HANDLE) {
+    vkDestroyBuffer(lveDevice.device(), upload.stagingBuffer, nullptr);
+    vkFreeMemory(lveDevice.device(), upload.stagingMemory, nullptr);
+  }
+}
+
+// A swap made while recording frame N is only sampled by frames before N, all of which have
+// finished once framesInFlight more frames have begun.
+void LveTextureStreamer::releaseRetired(bool all) {
+  auto keep = std::partition(retired.begin(), retired.end(), [&](const Retired &entry) {
+    return !all && frameCounter - entry.frame <= framesInFlight;
+  });
+  for (auto it = keep; it != retired.end(); ++it) {
+    vkDestroyImageView(lveDevice.device(), it->resources.view, nullptr);
+    vkDestroyImage(lveDevice.device(), it->resources.image, nullptr);
+    vkFreeMemory(lveDevice.device(), it->resources.memory, nullptr);
+    bindlessTextures.releaseSlot(it->slot);
+  }
+  retired.erase(keep, retired.end());
+}
+
+}  // namespace lve
@@ -0,0 +1,98 @@
+#include "lve_thread_pool.hpp"
+
+// std
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace lve {
+
+LveThreadPool::LveThreadPool(uint32_t threadCount) {
+  if (threadCount == 0) {
+    uint32_t hardwareThreads = std::thread::hardware_concurrency();
+    threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+  }
+  workers.reserve(threadCount);
+  for (uint32_t i = 0; i < threadCount; i++) {
+    workers.emplace_back([this]() { workerLoop(); });
+  }
+}
+
+LveThreadPool::~LveThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+}
+
+void LveThreadPool::enqueue(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock{mutex};
+    tasks.push_back(std::move(task));
+  }
+  condition.notify_one();
+}
+
+void LveThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock{mutex};
+      condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+      if (stopping && tasks.empty()) return;
+      task = std::move(tasks.front());
+      tasks.pop_front();
+    }
+    task();
+  }
+}
+
+void LveThreadPool::parallelFor(
+    uint32_t count, const std::function<void(uint32_t, uint32_t)> &fn, uint32_t grainSize) {
+  if (count == 0) return;
+  grainSize = std::max(grainSize, 1u);
+  uint32_t chunkCount = (count + grainSize - 1) / grainSize;
+
+  struct SharedState {
+    std::atomic<uint32_t> nextChunk{0};
+    std::atomic<uint32_t> finishedChunks{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+  };
+  auto state = std::make_shared<SharedState>();
+
+  // chunks are claimed rather than assigned, helpers that start late simply find nothing left
+  auto runChunks = [state, chunkCount, count, grainSize, &fn]() {
+    uint32_t chunk;
+    while ((chunk = state->nextChunk.fetch_add(1)) < chunkCount) {
+      uint32_t begin = chunk * grainSize;
+      try {
+        fn(begin, std::min(begin + grainSize, count));
+      } catch (...) {
+        std::lock_guard<std::mutex> lock{state->mutex};
+        if (!state->error) state->error = std::current_exception();
+      }
+      if (state->finishedChunks.fetch_add(1) + 1 == chunkCount) {
+        std::lock_guard<std::mutex> lock{state->mutex};
+        state->done.notify_all();
+      }
+    }
+  };
+
+  uint32_t helpers = std::min(threadCount(), chunkCount - 1);
+  for (uint32_t i = 0; i < helpers; i++) {
+    enqueue(runChunks);
+  }
+  runChunks();
+
+  std::unique_lock<std::mutex> lock{state->mutex};
+  state->done.wait(lock, [&]() { return state->finishedChunks.load() == chunkCount; });
+  if (state->error) std::rethrow_exception(state->error);
+}
+
+}  // namespace lve
@@ -0,0 +1,376 @@
+#include "lve_virtual_texture.hpp"
+
+
+// std
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+uint32_t nextPowerOfTwo(uint32_t value) {
+  uint32_t power = 1;
+  while (power < value) power <<= 1;
+  return power;
+}
+
+}  // namespace
+
+LveVirtualTexture::LveVirtualTexture(
+    LveDevice &device,
+    LveBindlessTextures &bindlessTextures,
+    uint32_t framesInFlight,
+    const std::string &filepath,
+    LveThreadPool &threadPool,
+    uint32_t atlasPages)
+    : lveDevice{device}, threadPool{threadPool}, file{filepath}, atlasPages{atlasPages} {
+  // the indirection texels store atlas coordinates in 8 bits
+  if (atlasPages < 2 || atlasPages > 256) {
+    throw std::runtime_error("virtual texture atlas must be 2 to 256 pages wide!");
+  }
+  const VirtualTextureInfo &info = file.info();
+  uint32_t atlasSize = atlasPages * info.tileSize();
+  atlas = std::make_shared<LveTexture>(
+      lveDevice,
+      atlasSize,
+      atlasSize,
+      info.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM,
+      1,
+      VK_FILTER_LINEAR);
+
+  indirectionWidth = nextPowerOfTwo(info.pagesX(0));
+  indirectionHeight = nextPowerOfTwo(info.pagesY(0));
+  indirection = std::make_shared<LveTexture>(
+      lveDevice,
+      indirectionWidth,
+      indirectionHeight,
+      VK_FORMAT_R8G8B8A8_UNORM,
+      info.mipLevels,
+      VK_FILTER_NEAREST);
+  VkDeviceSize indirectionSize = 0;
+  for (uint32_t level = 0; level < info.mipLevels; level++) {
+    indirectionLevelOffsets.push_back(indirectionSize);
+    indirectionSize +=
+        static_cast<VkDeviceSize>(std::max(indirectionWidth >> level, 1u)) * std::max(indirectionHeight >> level, 1u) * 4;
+  }
+  indirectionTexels.resize(indirectionSize);
+
+  pageTable.assign(info.pageCount(), NO_PAGE);
+  physicalPages.resize(atlasPages * atlasPages);
+  for (uint32_t i = static_cast<uint32_t>(physicalPages.size()); i-- > 0;) {
+    freePhysicalPages.push_back(i);
+  }
+
+  VkDeviceSize tileBytes = static_cast<VkDeviceSize>(info.tileSize()) * info.tileSize() * 4;
+  stagingSize = MAX_UPLOADS_PER_FRAME * tileBytes + indirectionSize;
+  staging.resize(framesInFlight);
+  createStaging(staging[0]);
+
+  // the top level is loaded up front and pinned, so every indirection texel resolves to a page
+  uint32_t topPage = info.pageIndex(info.mipLevels - 1, 0, 0);
+  uint32_t physical = allocatePhysicalPage();
+  physicalPages[physical].virtualPage = topPage;
+  physicalPages[physical].pinned = true;
+  pageTable[topPage] = physical;
+  file.readPage(topPage, staging[0].mapped);
+  buildIndirection();
+  memcpy(staging[0].mapped + tileBytes, indirectionTexels.data(), indirectionTexels.size());
+  VkCommandBuffer commandBuffer = lveDevice.beginSingleTimeCommands();
+  recordCopies(commandBuffer, staging[0].buffer, {atlasRegion(0, physical)}, tileBytes);
+  lveDevice.endSingleTimeCommands(commandBuffer);
+  indirectionDirty = false;
+
+  bindlessTextures.registerTexture(atlas);
+  bindlessTextures.registerTexture(indirection);
+}
+
+LveVirtualTexture::~LveVirtualTexture() {
+  // loads still running read from the file
+  for (auto &kv : loading) {
+    kv.second.wait();
+  }
+  for (auto &frame : staging) {
+    if (frame.buffer == VK_NULL_HANDLE) continue;
+    vkUnmapMemory(lveDevice.device(), frame.memory);
+    vkDestroyBuffer(lveDevice.device(), frame.buffer, nullptr);
+    vkFreeMemory(lveDevice.device(), frame.memory, nullptr);
+  }
+}
+
+void LveVirtualTexture::createStaging(FrameStaging &frame) {
+  lveDevice.createBuffer(
+      stagingSize,
+      VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      frame.buffer,
+      frame.memory);
+  void *mapped;
+  vkMapMemory(lveDevice.device(), frame.memory, 0, stagingSize, 0, &mapped);
+  frame.mapped = static_cast<uint8_t *>(mapped);
+}
+
+void LveVirtualTexture::requestPages(const std::vector<uint32_t> &pageIds) {
+  const VirtualTextureInfo &info = file.info();
+  requestCounter++;
+
+  std::vector<uint32_t> missing;
+  for (uint32_t id : pageIds) {
+    if (id == VIRTUAL_PAGE_NONE) continue;
+    uint32_t level = virtualPageLevel(id);
+    uint32_t x = virtualPageX(id);
+    uint32_t y = virtualPageY(id);
+    if (level >= info.mipLevels || x >= info.pagesX(level) || y >= info.pagesY(level)) continue;
+
+    // resident pages up the chain stay, missing ones are loaded so the fallback gets sharper
+    for (; level < info.mipLevels; level++) {
+      uint32_t page = info.pageIndex(level, x, y);
+      if (pageTable[page] != NO_PAGE) {
+        PhysicalPage &physical = physicalPages[pageTable[page]];
+        if (physical.lastUsed == requestCounter) break;  // so were its ancestors
+        physical.lastUsed = requestCounter;
+      } else if (loading.count(page) == 0) {
+        missing.push_back(page);
+      }
+      if (level + 1 < info.mipLevels) {
+        x = std::min(x / 2, info.pagesX(level + 1) - 1);
+        y = std::min(y / 2, info.pagesY(level + 1) - 1);
+      }
+    }
+  }
+
+  // pages are numbered level by level, so descending order loads coarse levels first
+  std::sort(missing.begin(), missing.end(), std::greater<uint32_t>());
+  missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+  for (uint32_t page : missing) {
+    if (loading.size() >= MAX_PENDING_LOADS) break;
+    startLoad(page);
+  }
+}
+
+void LveVirtualTexture::recordUpdates(VkCommandBuffer commandBuffer, int frameIndex) {
+  const VirtualTextureInfo &info = file.info();
+  FrameStaging &frame = staging[frameIndex];
+  if (frame.buffer == VK_NULL_HANDLE) {
+    createStaging(frame);
+  }
+  VkDeviceSize tileBytes = static_cast<VkDeviceSize>(info.tileSize()) * info.tileSize() * 4;
+
+  std::vector<VkBufferImageCopy> regions;
+  for (auto it = loading.begin(); it != loading.end() && regions.size() < MAX_UPLOADS_PER_FRAME;) {
+    if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+      ++it;
+      continue;
+    }
+    uint32_t virtualPage = it->first;
+    auto pending = std::move(it->second);
+    it = loading.erase(it);
+    std::vector<uint8_t> pixels = pending.get();  // rethrows read errors
+
+    uint32_t physical = allocatePhysicalPage();
+    if (physical == NO_PAGE) continue;  // all in use, the next feedback asks for it again
+    physicalPages[physical].virtualPage = virtualPage;
+    physicalPages[physical].lastUsed = requestCounter;
+    pageTable[virtualPage] = physical;
+
+    VkDeviceSize offset = regions.size() * tileBytes;
+    memcpy(frame.mapped + offset, pixels.data(), tileBytes);
+    regions.push_back(atlasRegion(offset, physical));
+    indirectionDirty = true;
+    pagesUploaded++;
+  }
+  if (!indirectionDirty) return;
+
+  buildIndirection();
+  VkDeviceSize indirectionOffset = MAX_UPLOADS_PER_FRAME * tileBytes;
+  memcpy(frame.mapped + indirectionOffset, indirectionTexels.data(), indirectionTexels.size());
+  recordCopies(commandBuffer, frame.buffer, regions, indirectionOffset);
+  indirectionDirty = false;
+}
+
+VirtualTextureShaderParams LveVirtualTexture::getShaderParams() const {
+  const VirtualTextureInfo &info = file.info();
+  VirtualTextureShaderParams params{};
+  params.indirectionSlot = indirection->getBindlessSlot() + 1;
+  params.atlasSlot = atlas->getBindlessSlot();
+  params.width = static_cast<float>(info.width);
+  params.height = static_cast<float>(info.height);
+  params.borderSize = static_cast<float>(info.borderSize);
+  params.pageSize = static_cast<float>(info.pageSize);
+  return params;
+}
+
+VirtualTextureStats LveVirtualTexture::getStats() const {
+  VirtualTextureStats stats{};
+  stats.physicalPages = static_cast<uint32_t>(physicalPages.size());
+  stats.residentPages = stats.physicalPages - static_cast<uint32_t>(freePhysicalPages.size());
+  stats.pendingLoads = static_cast<uint32_t>(loading.size());
+  stats.pagesUploaded = pagesUploaded;
+  stats.pagesEvicted = pagesEvicted;
+  return stats;
+}
+
+void LveVirtualTexture::startLoad(uint32_t virtualPage) {
+  loading.emplace(virtualPage, threadPool.submit([this, virtualPage]() {
+    uint32_t tileSize = file.info().tileSize();
+    std::vector<uint8_t> pixels(static_cast<size_t>(tileSize) * tileSize * 4);
+    file.readPage(virtualPage, pixels.data());
+    return pixels;
+  }));
+}
+
+// a free page, or the least recently used one the latest feedback did not ask for
+uint32_t LveVirtualTexture::allocatePhysicalPage() {
+  if (!freePhysicalPages.empty()) {
+    uint32_t physical = freePhysicalPages.back();
+    freePhysicalPages.pop_back();
+    return physical;
+  }
+
+  uint32_t victim = NO_PAGE;
+  for (uint32_t i = 0; i < physicalPages.size(); i++) {
+    const PhysicalPage &page = physicalPages[i];
+    if (page.pinned || page.lastUsed == requestCounter) continue;
+    if (victim == NO_PAGE || page.lastUsed < physicalPages[victim].lastUsed) {
+      victim = i;
+    }
+  }
+  if (victim != NO_PAGE) {
+    pageTable[physicalPages[victim].virtualPage] = NO_PAGE;
+    physicalPages[victim] = PhysicalPage{};
+    indirectionDirty = true;
+    pagesEvicted++;
+  }
+  return victim;
+}
+
+// Coarse to fine: a resident page points at itself, a missing one copies its parent's entry.
+// Texels are atlas x, atlas y, level of the page found, 255.
+void LveVirtualTexture::buildIndirection() {
+  const VirtualTextureInfo &info = file.info();
+  for (uint32_t level = info.mipLevels; level-- > 0;) {
+    uint32_t rowTexels = std::max(indirectionWidth >> level, 1u);
+    uint8_t *texels = indirectionTexels.data() + indirectionLevelOffsets[level];
+    uint32_t firstPage = info.pageIndex(level, 0, 0);
+    uint32_t pagesX = info.pagesX(level);
+    for (uint32_t y = 0; y < info.pagesY(level); y++) {
+      for (uint32_t x = 0; x < pagesX; x++) {
+        uint8_t *entry = texels + (static_cast<size_t>(y) * rowTexels + x) * 4;
+        uint32_t physical = pageTable[firstPage + y * pagesX + x];
+        if (physical != NO_PAGE) {
+          entry[0] = static_cast<uint8_t>(physical % atlasPages);
+          entry[1] = static_cast<uint8_t>(physical / atlasPages);
+          entry[2] = static_cast<uint8_t>(level);
+          entry[3] = 255;
+          continue;
+        }
+        // the pinned top level is always resident, so a missing page has a parent level
+        uint32_t parentX = std::min(x / 2, info.pagesX(level + 1) - 1);
+        uint32_t parentY = std::min(y / 2, info.pagesY(level + 1) - 1);
+        uint32_t parentRow = std::max(indirectionWidth >> (level + 1), 1u);
+        const uint8_t *parent = indirectionTexels.data() + indirectionLevelOffsets[level + 1] +
+                                (static_cast<size_t>(parentY) * parentRow + parentX) * 4;
+        memcpy(entry, parent, 4);
+      }
+    }
+  }
+}
+
+void LveVirtualTexture::recordCopies(
+    VkCommandBuffer commandBuffer,
+    VkBuffer stagingBuffer,
+    const std::vector<VkBufferImageCopy> &atlasRegions,
+    VkDeviceSize indirectionOffset) {
+  const VirtualTextureInfo &info = file.info();
+  // SHADER_READ_ONLY as the old layout keeps the pages that are not rewritten
+  std::array<VkImageMemoryBarrier, 2> barriers{};
+  for (auto &barrier : barriers) {
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+  }
+  barriers[0].image = atlas->getImage();
+  barriers[1].image = indirection->getImage();
+  barriers[1].subresourceRange.levelCount = info.mipLevels;
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      0, 0, nullptr, 0, nullptr,
+      static_cast<uint32_t>(barriers.size()),
+      barriers.data());
+
+  if (!atlasRegions.empty()) {
+    vkCmdCopyBufferToImage(
+        commandBuffer,
+        stagingBuffer,
+        atlas->getImage(),
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(atlasRegions.size()),
+        atlasRegions.data());
+  }
+
+  std::vector<VkBufferImageCopy> indirectionRegions;
+  for (uint32_t level = 0; level < info.mipLevels; level++) {
+    VkBufferImageCopy region{};
+    region.bufferOffset = indirectionOffset + indirectionLevelOffsets[level];
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = level;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {std::max(indirectionWidth >> level, 1u), std::max(indirectionHeight >> level, 1u), 1};
+    indirectionRegions.push_back(region);
+  }
+  vkCmdCopyBufferToImage(
+      commandBuffer,
+      stagingBuffer,
+      indirection->getImage(),
+      VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      static_cast<uint32_t>(indirectionRegions.size()),
+      indirectionRegions.data());
+
+  for (auto &barrier : barriers) {
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  }
+  vkCmdPipelineBarrier(
+      commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+      0, 0, nullptr, 0, nullptr,
+      static_cast<uint32_t>(barriers.size()),
+      barriers.data());
+}
+
+VkBufferImageCopy LveVirtualTexture::atlasRegion(VkDeviceSize bufferOffset, uint32_t physicalPage) const {
+  uint32_t tileSize = file.info().tileSize();
+  VkBufferImageCopy region{};
+  region.bufferOffset = bufferOffset;
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageOffset = {
+      static_cast<int32_t>(physicalPage % atlasPages * tileSize),
+      static_cast<int32_t>(physicalPage / atlasPages * tileSize),
+      0};
+  region.imageExtent = {tileSize, tileSize, 1};
+  return region;
+}
+
+}  // namespace lve
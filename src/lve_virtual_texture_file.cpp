@@ -0,0 +1,218 @@
+#include "lve_virtual_texture_file.hpp"
+
+#include "lve_mipmap.hpp"
+#include "lve_qoi.hpp"
+
+// std
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace lve {
+
+namespace {
+
+// "LVT1", then width, height, page size, border size, level count and colour space as uint32,
+// then pageCount + 1 uint64 file offsets and the QOI tiles
+const char LVT_MAGIC[4] = {'L', 'V', 'T', '1'};
+constexpr size_t LVT_HEADER_SIZE = 4 + 6 * sizeof(uint32_t);
+
+template <typename T>
+void appendValue(std::vector<uint8_t> &bytes, T value) {
+  const uint8_t *raw = reinterpret_cast<const uint8_t *>(&value);
+  bytes.insert(bytes.end(), raw, raw + sizeof(T));
+}
+
+void validateInfo(const VirtualTextureInfo &info) {
+  if (info.width == 0 || info.height == 0 || info.pageSize == 0 || info.borderSize > info.pageSize) {
+    throw std::runtime_error("invalid virtual texture size!");
+  }
+  if (info.mipLevels == 0 || info.mipLevels > VIRTUAL_MAX_LEVELS || info.pagesX(0) > VIRTUAL_MAX_PAGES ||
+      info.pagesY(0) > VIRTUAL_MAX_PAGES) {
+    throw std::runtime_error("virtual texture has too many pages!");
+  }
+  if (info.pagesX(info.mipLevels - 1) != 1 || info.pagesY(info.mipLevels - 1) != 1) {
+    throw std::runtime_error("virtual texture must end in a single page level!");
+  }
+}
+
+inline uint32_t wrap(int64_t coord, uint32_t size) {
+  int64_t wrapped = coord % static_cast<int64_t>(size);
+  return static_cast<uint32_t>(wrapped < 0 ? wrapped + size : wrapped);
+}
+
+// copies the page and its border out of one level, wrapping around the edges
+void extractTile(
+    const uint8_t *level, uint32_t levelWidth, uint32_t levelHeight, const VirtualTextureInfo &info,
+    uint32_t pageX, uint32_t pageY, uint8_t *tile) {
+  uint32_t tileSize = info.tileSize();
+  int64_t originX = static_cast<int64_t>(pageX) * info.pageSize - info.borderSize;
+  int64_t originY = static_cast<int64_t>(pageY) * info.pageSize - info.borderSize;
+  for (uint32_t y = 0; y < tileSize; y++) {
+    const uint8_t *row = level + static_cast<size_t>(wrap(originY + y, levelHeight)) * levelWidth * 4;
+    uint8_t *out = tile + static_cast<size_t>(y) * tileSize * 4;
+    for (uint32_t x = 0; x < tileSize; x++) {
+      memcpy(out + x * 4, row + wrap(originX + x, levelWidth) * 4, 4);
+    }
+  }
+}
+
+}  // namespace
+
+uint32_t VirtualTextureInfo::levelWidth(uint32_t level) const { return std::max(width >> level, 1u); }
+
+uint32_t VirtualTextureInfo::levelHeight(uint32_t level) const { return std::max(height >> level, 1u); }
+
+uint32_t VirtualTextureInfo::pagesX(uint32_t level) const {
+  return (levelWidth(level) + pageSize - 1) / pageSize;
+}
+
+uint32_t VirtualTextureInfo::pagesY(uint32_t level) const {
+  return (levelHeight(level) + pageSize - 1) / pageSize;
+}
+
+uint32_t VirtualTextureInfo::pageCount() const { return pageIndex(mipLevels, 0, 0); }
+
+uint32_t VirtualTextureInfo::pageIndex(uint32_t level, uint32_t x, uint32_t y) const {
+  uint32_t index = 0;
+  for (uint32_t i = 0; i < level; i++) {
+    index += pagesX(i) * pagesY(i);
+  }
+  return index + y * pagesX(level) + x;
+}
+
+VirtualTextureInfo makeVirtualTextureInfo(
+    uint32_t width, uint32_t height, uint32_t pageSize, uint32_t borderSize, bool srgb) {
+  VirtualTextureInfo info{};
+  info.width = width;
+  info.height = height;
+  info.pageSize = pageSize;
+  info.borderSize = borderSize;
+  info.srgb = srgb;
+  info.mipLevels = 1;
+  while (pageSize > 0 && (info.pagesX(info.mipLevels - 1) > 1 || info.pagesY(info.mipLevels - 1) > 1)) {
+    info.mipLevels++;
+  }
+  validateInfo(info);
+  return info;
+}
+
+size_t saveVirtualTexture(
+    const std::string &filepath,
+    const uint8_t *pixels,
+    const VirtualTextureInfo &info,
+    LveThreadPool *threadPool) {
+  validateInfo(info);
+  std::vector<ImageMipLevel> chain;
+  if (info.mipLevels > 1) {
+    chain = generateMipChainRGBA8(pixels, info.width, info.height, info.srgb);
+  }
+
+  // every tile is cut and compressed independently
+  uint32_t pageCount = info.pageCount();
+  std::vector<std::vector<uint8_t>> tiles(pageCount);
+  auto encodeTiles = [&](uint32_t begin, uint32_t end) {
+    uint32_t tileSize = info.tileSize();
+    std::vector<uint8_t> tile(static_cast<size_t>(tileSize) * tileSize * 4);
+    QoiHeader header{};
+    header.width = tileSize;
+    header.height = tileSize;
+    header.colorspace = info.srgb ? 0 : 1;
+    for (uint32_t level = 0, first = 0; level < info.mipLevels; level++) {
+      uint32_t pagesX = info.pagesX(level);
+      uint32_t levelPages = pagesX * info.pagesY(level);
+      const uint8_t *levelPixels = level == 0 ? pixels : chain[level - 1].pixels.data();
+      for (uint32_t i = std::max(begin, first); i < std::min(end, first + levelPages); i++) {
+        uint32_t local = i - first;
+        extractTile(
+            levelPixels, info.levelWidth(level), info.levelHeight(level), info, local % pagesX, local / pagesX,
+            tile.data());
+        tiles[i] = encodeQoi(tile.data(), header);
+      }
+      first += levelPages;
+    }
+  };
+  if (threadPool) {
+    threadPool->parallelFor(pageCount, encodeTiles, 16);
+  } else {
+    encodeTiles(0, pageCount);
+  }
+
+  std::vector<uint8_t> bytes(LVT_MAGIC, LVT_MAGIC + sizeof(LVT_MAGIC));
+  appendValue<uint32_t>(bytes, info.width);
+  appendValue<uint32_t>(bytes, info.height);
+  appendValue<uint32_t>(bytes, info.pageSize);
+  appendValue<uint32_t>(bytes, info.borderSize);
+  appendValue<uint32_t>(bytes, info.mipLevels);
+  appendValue<uint32_t>(bytes, info.srgb ? 0 : 1);
+  uint64_t offset = LVT_HEADER_SIZE + (static_cast<uint64_t>(pageCount) + 1) * sizeof(uint64_t);
+  for (const auto &tile : tiles) {
+    appendValue<uint64_t>(bytes, offset);
+    offset += tile.size();
+  }
+  appendValue<uint64_t>(bytes, offset);
+  for (const auto &tile : tiles) {
+    bytes.insert(bytes.end(), tile.begin(), tile.end());
+  }
+
+  std::ofstream file{filepath, std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file for writing: " + filepath);
+  }
+  file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  if (!file) {
+    throw std::runtime_error("failed to write file: " + filepath);
+  }
+  return bytes.size();
+}
+
+LveVirtualTextureFile::LveVirtualTextureFile(const std::string &filepath)
+    : filepath_{filepath}, file{filepath, std::ios::binary} {
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  char magic[sizeof(LVT_MAGIC)];
+  uint32_t fields[6];
+  file.read(magic, sizeof(magic));
+  file.read(reinterpret_cast<char *>(fields), sizeof(fields));
+  if (!file || memcmp(magic, LVT_MAGIC, sizeof(magic)) != 0) {
+    throw std::runtime_error("not a virtual texture file: " + filepath);
+  }
+  info_.width = fields[0];
+  info_.height = fields[1];
+  info_.pageSize = fields[2];
+  info_.borderSize = fields[3];
+  info_.mipLevels = fields[4];
+  info_.srgb = fields[5] == 0;
+  validateInfo(info_);
+
+  pageOffsets.resize(static_cast<size_t>(info_.pageCount()) + 1);
+  file.read(reinterpret_cast<char *>(pageOffsets.data()), pageOffsets.size() * sizeof(uint64_t));
+  if (!file || !std::is_sorted(pageOffsets.begin(), pageOffsets.end())) {
+    throw std::runtime_error("corrupt virtual texture page table: " + filepath);
+  }
+}
+
+void LveVirtualTextureFile::readPage(uint32_t pageIndex, uint8_t *dst) {
+  if (pageIndex >= info_.pageCount()) {
+    throw std::runtime_error("virtual texture page out of range: " + filepath_);
+  }
+  std::vector<uint8_t> bytes(pageOffsets[pageIndex + 1] - pageOffsets[pageIndex]);
+  {
+    std::lock_guard<std::mutex> lock{fileMutex};
+    file.seekg(static_cast<std::streamoff>(pageOffsets[pageIndex]));
+    file.read(reinterpret_cast<char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    if (!file) {
+      file.clear();
+      throw std::runtime_error("truncated virtual texture file: " + filepath_);
+    }
+  }
+
+  QoiHeader header = readQoiHeader(bytes.data(), bytes.size());
+  if (header.width != info_.tileSize() || header.height != info_.tileSize()) {
+    throw std::runtime_error("virtual texture tile has the wrong size: " + filepath_);
+  }
+  decodeQoiInto(bytes.data(), bytes.size(), false, dst);
+}
+
+}  // namespace lve
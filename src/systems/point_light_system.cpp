@@ -1,5 +1,7 @@
 #include "systems/point_light_system.hpp"
 
+#include "lve_pipeline_registry.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -22,13 +24,18 @@ namespace lve {
   };
 
 PointLightSystem::PointLightSystem(
-    LveDevice& device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout)
-    : lveDevice{device} {
-  createPipelineLayout(globalSetLayout);
-  createPipeline(renderPass);
+    LveDevice& device,
+    const LveRenderTargetFormat& targetFormat,
+    LvePushDescriptorSet& globalDescriptor,
+    LveThreadPool* threadPool)
+    : lveDevice{device}, globalDescriptor{globalDescriptor} {
+  createPipelineLayout(globalDescriptor.getDescriptorSetLayout());
+  createPipeline(targetFormat, threadPool);
 }
 
 PointLightSystem::~PointLightSystem() {
+  lvePipeline.wait();
+  globalDescriptor.releasePipelineLayout(pipelineLayout);
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
@@ -52,21 +59,22 @@ void PointLightSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLayou
   }
 }
 
-  void PointLightSystem::createPipeline(VkRenderPass renderPass) {
+  void PointLightSystem::createPipeline(const LveRenderTargetFormat& targetFormat, LveThreadPool* threadPool) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
     PipelineConfigInfo pipelineConfig{};
     LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
     LvePipeline::enableAlphaBlending(pipelineConfig);
+    LvePipeline::enableExtendedDynamicState(pipelineConfig, lveDevice);
     pipelineConfig.bindingDescriptions.clear();
     pipelineConfig.attributeDescriptions.clear();
-    pipelineConfig.renderPass = renderPass;
+    targetFormat.applyTo(pipelineConfig);
     pipelineConfig.pipelineLayout = pipelineLayout;
-    lvePipeline = std::make_unique<LvePipeline>(
-      lveDevice,
+    lvePipeline = lveDevice.pipelineRegistry().requestPipeline(
       "shaders/point_light.vert.spv",
       "shaders/point_light.frag.spv",
-      pipelineConfig);
+      pipelineConfig,
+      threadPool);
 }
 
 void PointLightSystem::update(FrameInfo & frameInfo, GlobalUbo & ubo) {
@@ -110,17 +118,12 @@ void PointLightSystem::render(FrameInfo &frameInfo) {
     float disSquared = glm::dot(offset, offset);
     sorted[disSquared] = obj.GetId();
   }
-  lvePipeline->bind(frameInfo.commandBuffer);
+  LvePipeline* pipeline = lvePipeline.get();
+  if (pipeline == nullptr) return;  // still compiling
+  frameInfo.dynamicState.bindPipeline(*pipeline);
+  frameInfo.dynamicState.setRasterState(LveRasterState{});
 
-  vkCmdBindDescriptorSets(
-      frameInfo.commandBuffer,
-      VK_PIPELINE_BIND_POINT_GRAPHICS,
-      pipelineLayout,
-      0,
-      1,
-      &frameInfo.globalDescriptorSet,
-      0,
-      nullptr);
+  frameInfo.globalDescriptor.bind(frameInfo.commandBuffer, pipelineLayout, 0);
   for (auto it = sorted.rbegin(); it != sorted.rend(); ++it) {
     // use game obj id to find light object
     auto& obj = frameInfo.gameObjects.at(it->second);
@@ -1,5 +1,8 @@
 #include "systems/simple_render_system.hpp"
 
+#include "lve_pipeline_registry.hpp"
+#include "lve_pipeline_permutations.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -7,16 +10,79 @@
 #include <glm/gtc/constants.hpp>
 
 // std
+#include <algorithm>
 #include <array>
 #include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
 #include <stdexcept>
+#include <string>
 
 namespace lve {
 
-struct SimplePushConstantData {
-  glm::mat4 modelMatrix{1.f};
-  glm::mat4 normalMatrix{1.f};
+// Permutation bits of simple_shader.frag. Bits from LIGHT_BUCKET_SHIFT up index LIGHT_BUCKETS,
+// the smallest bucket holding the frame's lights bounds the light loop.
+enum SimpleShaderFeature : uint32_t {
+  SIMPLE_SHADER_TEXTURED = 1u << 0,
+  SIMPLE_SHADER_VERTEX_COLOR = 1u << 1,
 };
+constexpr uint32_t LIGHT_BUCKET_SHIFT = 2;
+constexpr int LIGHT_BUCKETS[] = {0, 1, 2, 4, MAX_LIGHTS};
+constexpr uint32_t LIGHT_BUCKET_COUNT = sizeof(LIGHT_BUCKETS) / sizeof(LIGHT_BUCKETS[0]);
+constexpr uint32_t FULL_PERMUTATION = SIMPLE_SHADER_TEXTURED | SIMPLE_SHADER_VERTEX_COLOR |
+                                      ((LIGHT_BUCKET_COUNT - 1) << LIGHT_BUCKET_SHIFT);
+
+uint32_t lightBucket(int numLights) {
+  uint32_t bucket = 0;
+  while (bucket + 1 < LIGHT_BUCKET_COUNT && LIGHT_BUCKETS[bucket] < numLights) {
+    bucket++;
+  }
+  return bucket;
+}
+
+// Requests every permutation a draw can ask for while the shader modules are still loaded. One
+// first requested after releaseShaderModules would re-read the files mid-frame, under the
+// permutations' lock.
+void prepareAllPermutations(LvePipelinePermutations& permutations) {
+  constexpr uint32_t FEATURE_BITS = SIMPLE_SHADER_TEXTURED | SIMPLE_SHADER_VERTEX_COLOR;
+  for (uint32_t bucket = 0; bucket < LIGHT_BUCKET_COUNT; bucket++) {
+    for (uint32_t features = 0; features <= FEATURE_BITS; features++) {
+      permutations.prepare(features | (bucket << LIGHT_BUCKET_SHIFT));
+    }
+  }
+}
+
+// below this a chunk costs more to hand out than to record
+constexpr uint32_t MIN_DRAWS_PER_CHUNK = 64;
+
+// Auto turns the prepass on above this many screens of estimated overdraw and off again below the
+// lower bound, so a scene hovering around one threshold does not switch every frame
+constexpr float PREPASS_ENABLE_OVERDRAW = 2.0f;
+constexpr float PREPASS_DISABLE_OVERDRAW = 1.5f;
+
+// After the prepass the main pass only shades the fragments that won the depth test
+LveRasterState prepassMainRasterState() {
+  LveRasterState state{};
+  state.depthWriteEnable = VK_FALSE;
+  state.depthCompareOp = VK_COMPARE_OP_EQUAL;
+  return state;
+}
+
+// Fraction of the screen a view space bounding sphere covers, approximated by the ellipse of its
+// projected radius. Counting on the CPU keeps the estimate free of GPU queries, which secondary
+// command buffers could only take part in through inherited queries.
+float screenCoverage(const glm::vec3& viewCenter, float radius, const glm::mat4& projection) {
+  if (radius <= 0.f || viewCenter.z + radius <= 0.f) return 0.f;  // empty or behind the camera
+  if (viewCenter.z <= radius) return 1.f;  // the camera is inside or right at it
+  float rx = radius * projection[0][0] / viewCenter.z;
+  float ry = radius * projection[1][1] / viewCenter.z;
+  float x = std::abs(projection[0][0] * viewCenter.x / viewCenter.z);
+  float y = std::abs(projection[1][1] * viewCenter.y / viewCenter.z);
+  if (x - rx > 1.f || y - ry > 1.f) return 0.f;  // outside the frustum
+  // NDC spans 2x2
+  return std::min(glm::pi<float>() * rx * ry / 4.f, 1.f);
+}
 
 // struct PBRUbo {
 //     glm::vec3 lightPositions[4];   // 最多支持4个点光源
@@ -27,28 +93,37 @@ struct SimplePushConstantData {
 
 
 SimpleRenderSystem::SimpleRenderSystem(LveDevice& device,
-                                       VkRenderPass renderPass,
-                                       VkDescriptorSetLayout globalSetLayout,
-                                       VkDescriptorSetLayout materialSetLayout,
-                                       VkDescriptorSet defaultMaterialSet)
-    : lveDevice{device}, defaultMaterialSet_{defaultMaterialSet} {
-  createPipelineLayout(globalSetLayout, materialSetLayout);
-  createPipeline(renderPass);
+                                       const LveRenderTargetFormat& targetFormat,
+                                       LvePushDescriptorSet& globalDescriptor,
+                                       VkDescriptorSetLayout textureSetLayout,
+                                       VkDescriptorSet textureSet,
+                                       LveThreadPool* threadPool)
+    : lveDevice{device},
+      globalDescriptor{globalDescriptor},
+      mainTargetFormat{targetFormat},
+      textureSet_{textureSet},
+      threadPool_{threadPool} {
+  createPipelineLayout(globalDescriptor.getDescriptorSetLayout(), textureSetLayout);
+  createPipeline(targetFormat, threadPool);
 }
 
 SimpleRenderSystem::~SimpleRenderSystem() {
+  depthPipeline.wait();
+  equalPipelines.reset();
+  pipelines.reset();
+  globalDescriptor.releasePipelineLayout(pipelineLayout);
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
 void SimpleRenderSystem::createPipelineLayout(
     VkDescriptorSetLayout globalSetLayout,
-    VkDescriptorSetLayout materialSetLayout) {
+    VkDescriptorSetLayout textureSetLayout) {
   VkPushConstantRange pushConstantRange{};
   pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
   pushConstantRange.offset = 0;
   pushConstantRange.size = sizeof(SimplePushConstantData);
 
-  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, materialSetLayout };
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{ globalSetLayout, textureSetLayout };
 
   VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
   pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -62,49 +137,234 @@ void SimpleRenderSystem::createPipelineLayout(
   }
 }
 
-  void SimpleRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SimpleRenderSystem::configurePermutation(
+    const LveRenderTargetFormat& targetFormat, uint32_t permutation, PipelineConfigInfo& pipelineConfig) {
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  LvePipeline::enableExtendedDynamicState(pipelineConfig, lveDevice);
+  targetFormat.applyTo(pipelineConfig);
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  uint32_t bucket = permutation >> LIGHT_BUCKET_SHIFT;
+  pipelineConfig.fragSpecialization.set(0, static_cast<uint32_t>(LIGHT_BUCKETS[bucket]));
+  pipelineConfig.fragSpecialization.set(
+      1, (permutation & SIMPLE_SHADER_TEXTURED) ? VK_TRUE : VK_FALSE);
+  pipelineConfig.fragSpecialization.set(
+      2, (permutation & SIMPLE_SHADER_VERTEX_COLOR) ? VK_TRUE : VK_FALSE);
+}
+
+  void SimpleRenderSystem::createPipeline(const LveRenderTargetFormat& targetFormat, LveThreadPool* threadPool) {
     assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
-    PipelineConfigInfo pipelineConfig{};
-    LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
-    pipelineConfig.renderPass = renderPass;
-    pipelineConfig.pipelineLayout = pipelineLayout;
-    lvePipeline = std::make_unique<LvePipeline>(
-      lveDevice,
+    auto configure = [this, targetFormat](uint32_t permutation, PipelineConfigInfo& pipelineConfig) {
+      configurePermutation(targetFormat, permutation, pipelineConfig);
+    };
+    pipelines = std::make_unique<LvePipelinePermutations>(
+      lveDevice.pipelineRegistry(),
       "shaders/simple_shader.vert.spv",
       "shaders/simple_shader.frag.spv",
-      pipelineConfig);
+      FULL_PERMUTATION,
+      configure,
+      threadPool);
+    prepareAllPermutations(*pipelines);
 }
 
-void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
-  lvePipeline->bind(frameInfo.commandBuffer);
+SimpleRenderSystem::DepthPrepassMode SimpleRenderSystem::depthPrepassModeFromEnvironment() {
+  const char* value = std::getenv("LVE_DEPTH_PREPASS");
+  if (value == nullptr) return DepthPrepassMode::Auto;
+  std::string name{value};
+  if (name == "off") return DepthPrepassMode::Off;
+  if (name == "on") return DepthPrepassMode::On;
+  if (name == "auto") return DepthPrepassMode::Auto;
+  throw std::runtime_error("unknown mode in LVE_DEPTH_PREPASS: " + name);
+}
 
+void SimpleRenderSystem::enableDepthPrepass(
+    const LveRenderTargetFormat& prepassTargetFormat, DepthPrepassMode mode) {
+  prepassMode = mode;
+  if (mode == DepthPrepassMode::Off) return;
+  createDepthPipeline(prepassTargetFormat);
+}
+
+void SimpleRenderSystem::createDepthPipeline(const LveRenderTargetFormat& prepassTargetFormat) {
+  PipelineConfigInfo pipelineConfig{};
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  LvePipeline::enableExtendedDynamicState(pipelineConfig, lveDevice);
+  prepassTargetFormat.applyTo(pipelineConfig);
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  // position only, the vertex stride stays the full Vertex
+  pipelineConfig.attributeDescriptions = {
+      {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(LveModel::Vertex, position)}};
+  pipelineConfig.colorBlendInfo.attachmentCount = 0;
+  pipelineConfig.colorBlendInfo.pAttachments = nullptr;
+  depthPipeline = lveDevice.pipelineRegistry().requestPipeline(
+      "shaders/depth_only.vert.spv", "shaders/depth_only.frag.spv", pipelineConfig, threadPool_);
+
+  // the main pass then tests EQUAL without writing; bake that where the command buffer can't set it
+  if (LvePipeline::hasDynamicState(pipelineConfig, VK_DYNAMIC_STATE_DEPTH_COMPARE_OP_EXT) &&
+      LvePipeline::hasDynamicState(pipelineConfig, VK_DYNAMIC_STATE_DEPTH_WRITE_ENABLE_EXT)) {
+    return;
+  }
+  LveRenderTargetFormat targetFormat = mainTargetFormat;
+  auto configure = [this, targetFormat](uint32_t permutation, PipelineConfigInfo& equalConfig) {
+    configurePermutation(targetFormat, permutation, equalConfig);
+    prepassMainRasterState().applyTo(equalConfig);
+  };
+  equalPipelines = std::make_unique<LvePipelinePermutations>(
+      lveDevice.pipelineRegistry(),
+      "shaders/simple_shader.vert.spv",
+      "shaders/simple_shader.frag.spv",
+      FULL_PERMUTATION,
+      configure,
+      threadPool_);
+  prepareAllPermutations(*equalPipelines);
+}
+
+bool SimpleRenderSystem::depthPrepassReady() const {
+  if (depthPipeline.get() == nullptr) return false;
+  return equalPipelines == nullptr || equalPipelines->get(FULL_PERMUTATION) != nullptr;
+}
+
+void SimpleRenderSystem::collectDraws(FrameInfo &frameInfo) {
+  const glm::mat4& view = frameInfo.camera.getView();
+  const glm::mat4& projection = frameInfo.camera.getProjectionMatrix();
+  // same count as PointLightSystem::update writes to the ubo
+  int numLights = 0;
+  float overdraw = 0.f;
+  draws.clear();
+  for (auto& kv : frameInfo.gameObjects) {
+    auto& obj = kv.second;
+    if (obj.pointLight != nullptr) numLights++;
+    if (obj.model == nullptr) continue;
+    if (obj.GetTag() == "skybox") continue;
+    uint32_t permutation = 0;
+    if (obj.material && (obj.material->GetTexture() || obj.material->GetVirtualTexture())) {
+      permutation |= SIMPLE_SHADER_TEXTURED;
+    }
+    if (obj.model->hasVertexColors()) {
+      permutation |= SIMPLE_SHADER_VERTEX_COLOR;
+    }
+
+    const glm::vec3& scale = obj.transform.scale;
+    float maxScale = std::max(std::abs(scale.x), std::max(std::abs(scale.y), std::abs(scale.z)));
+    glm::vec4 center = obj.transform.mat4() * glm::vec4(obj.model->getBoundingCenter(), 1.f);
+    glm::vec3 viewCenter = glm::vec3(view * center);
+    float radius = obj.model->getBoundingRadius() * maxScale;
+    overdraw += screenCoverage(viewCenter, radius, projection);
+    draws.push_back({permutation, viewCenter.z, &obj});
+  }
+  uint32_t bucketBits = lightBucket(numLights) << LIGHT_BUCKET_SHIFT;
+  // one bind per permutation, front to back within one so early depth rejects more
+  std::sort(draws.begin(), draws.end(), [](const Draw& a, const Draw& b) {
+    if (a.permutation != b.permutation) return a.permutation < b.permutation;
+    return a.viewDepth < b.viewDepth;
+  });
+  depthOrder.resize(draws.size());
+  for (uint32_t i = 0; i < depthOrder.size(); i++) {
+    depthOrder[i] = i;
+  }
+  std::sort(depthOrder.begin(), depthOrder.end(), [this](uint32_t a, uint32_t b) {
+    return draws[a].viewDepth < draws[b].viewDepth;
+  });
+
+  estimatedOverdraw = overdraw;
+  switch (prepassMode) {
+    case DepthPrepassMode::Off:
+      prepassWanted = false;
+      break;
+    case DepthPrepassMode::On:
+      prepassWanted = true;
+      break;
+    case DepthPrepassMode::Auto:
+      if (overdraw > PREPASS_ENABLE_OVERDRAW) prepassWanted = true;
+      if (overdraw < PREPASS_DISABLE_OVERDRAW) prepassWanted = false;
+      break;
+  }
+  prepassActive = prepassWanted && !draws.empty() && depthPrepassReady();
+
+  // once per permutation on this thread: get() locks, the recording threads only read the result
+  LvePipelinePermutations& permutations =
+      prepassActive && equalPipelines ? *equalPipelines : *pipelines;
+  for (size_t i = 0; i < draws.size();) {
+    uint32_t permutation = draws[i].permutation;
+    LvePipeline* pipeline = permutations.get(permutation | bucketBits);
+    for (; i < draws.size() && draws[i].permutation == permutation; i++) {
+      draws[i].pipeline = pipeline;
+    }
+  }
+}
+
+void SimpleRenderSystem::renderDepthPrepass(
+    FrameInfo &frameInfo, LveSecondaryCommands *secondaryCommands) {
+  if (!prepassActive) return;
+  recordChunked(frameInfo, secondaryCommands, [this](FrameInfo& chunkInfo, uint32_t begin, uint32_t end) {
+    recordDepthDraws(chunkInfo, begin, end);
+  });
+}
+
+void SimpleRenderSystem::renderGameObjects(
+    FrameInfo &frameInfo, LveSecondaryCommands *secondaryCommands) {
+  recordChunked(frameInfo, secondaryCommands, [this](FrameInfo& chunkInfo, uint32_t begin, uint32_t end) {
+    recordDraws(chunkInfo, begin, end);
+  });
+}
+
+void SimpleRenderSystem::recordChunked(
+    FrameInfo &frameInfo,
+    LveSecondaryCommands *secondaryCommands,
+    const std::function<void(FrameInfo &, uint32_t, uint32_t)> &record) {
+  if (draws.empty()) return;
+  uint32_t drawCount = static_cast<uint32_t>(draws.size());
+  if (secondaryCommands == nullptr) {
+    record(frameInfo, 0, drawCount);
+    return;
+  }
+
+  // Chunk i is recorded on lane i, whichever thread picks it up, so no two threads share a pool.
+  // Slots are reserved up front and keep the sorted order however the chunks finish.
+  uint32_t chunkCount = threadPool_ == nullptr ? 1
+      : std::min(secondaryCommands->laneCount(),
+                 (drawCount + MIN_DRAWS_PER_CHUNK - 1) / MIN_DRAWS_PER_CHUNK);
+  uint32_t drawsPerChunk = (drawCount + chunkCount - 1) / chunkCount;
+  chunkCount = (drawCount + drawsPerChunk - 1) / drawsPerChunk;
+  uint32_t firstSlot = secondaryCommands->reserve(chunkCount);
+  auto recordChunk = [&](uint32_t begin, uint32_t end) {
+    uint32_t chunk = begin / drawsPerChunk;
+    secondaryCommands->record(firstSlot + chunk, chunk, frameInfo, [&](FrameInfo& chunkInfo) {
+      record(chunkInfo, begin, end);
+    });
+  };
+  if (chunkCount == 1) {
+    recordChunk(0, drawCount);
+  } else {
+    threadPool_->parallelFor(drawCount, recordChunk, drawsPerChunk);
+  }
+}
+
+void SimpleRenderSystem::recordDraws(FrameInfo &frameInfo, uint32_t begin, uint32_t end) {
+  frameInfo.globalDescriptor.bind(frameInfo.commandBuffer, pipelineLayout, 0);
   vkCmdBindDescriptorSets(
       frameInfo.commandBuffer,
       VK_PIPELINE_BIND_POINT_GRAPHICS,
       pipelineLayout,
-      0,
       1,
-      &frameInfo.globalDescriptorSet,
+      1,
+      &textureSet_,
       0,
       nullptr);
 
-  for (auto& kv : frameInfo.gameObjects) {
-    auto& obj = kv.second;
-    if (obj.model == nullptr) continue;
-    if (obj.GetTag() == "skybox") continue;
-		//bind material
-		VkDescriptorSet materialSet = defaultMaterialSet_;
-    if (obj.material && obj.material->getDescriptorSet() != VK_NULL_HANDLE) {
-      materialSet = obj.material->getDescriptorSet();
-    }
-    vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                            VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1,
-                            1, &materialSet, 0, nullptr);
+  LveRasterState rasterState = prepassActive ? prepassMainRasterState() : LveRasterState{};
+  for (uint32_t i = begin; i < end; i++) {
+    const Draw& draw = draws[i];
+    if (draw.pipeline == nullptr) continue;  // even the full permutation is still compiling
+    frameInfo.dynamicState.bindPipeline(*draw.pipeline);
+    frameInfo.dynamicState.setRasterState(rasterState);
 
+    auto& obj = *draw.gameObject;
     SimplePushConstantData push{};
     push.modelMatrix = obj.transform.mat4();
-    push.normalMatrix = obj.transform.normalMatrix();
+    if (obj.material) push.textureIndex = obj.material->getTextureIndex();
+    if (obj.material && obj.material->GetVirtualTexture()) {
+      push.virtualTexture = obj.material->GetVirtualTexture()->getShaderParams();
+    }
 
       vkCmdPushConstants(
         frameInfo.commandBuffer, pipelineLayout,
@@ -115,4 +375,23 @@ void SimpleRenderSystem::renderGameObjects(FrameInfo &frameInfo) {
     }
   }
 
-}  // namespace lve
\ No newline at end of file
+void SimpleRenderSystem::recordDepthDraws(FrameInfo &frameInfo, uint32_t begin, uint32_t end) {
+  LvePipeline* pipeline = depthPipeline.get();
+  frameInfo.dynamicState.bindPipeline(*pipeline);
+  frameInfo.dynamicState.setRasterState(LveRasterState{});
+  frameInfo.globalDescriptor.bind(frameInfo.commandBuffer, pipelineLayout, 0);
+
+  for (uint32_t i = begin; i < end; i++) {
+    auto& obj = *draws[depthOrder[i]].gameObject;
+    // depth_only.vert only reads the model matrix
+    glm::mat4 modelMatrix = obj.transform.mat4();
+    vkCmdPushConstants(
+        frameInfo.commandBuffer, pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0,
+        sizeof(glm::mat4), &modelMatrix);
+    obj.model->bind(frameInfo.commandBuffer);
+    obj.model->draw(frameInfo.commandBuffer);
+  }
+}
+
+}  // namespace lve
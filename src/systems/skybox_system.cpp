@@ -1,5 +1,7 @@
 #include "systems/skybox_system.hpp"
 
+#include "lve_pipeline_registry.hpp"
+
 // libs
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -18,14 +20,26 @@ struct SkyboxPushConstantData {
   glm::mat4 normalMatrix{1.f};
 };
 
+// 天空盒特殊设置: 剔除背面, 只做深度测试不写入深度
+LveRasterState skyboxRasterState() {
+  LveRasterState state{};
+  state.cullMode = VK_CULL_MODE_BACK_BIT;
+  state.depthTestEnable = VK_TRUE;
+  state.depthWriteEnable = VK_FALSE;
+  state.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+  return state;
+}
+
 SkyboxRenderSystem::SkyboxRenderSystem(
-  LveDevice &device, VkRenderPass renderPass, VkDescriptorSetLayout globalSetLayout, VkDescriptorSetLayout cubemapSetLayout, VkDescriptorSet skyboxSet)
-  : lveDevice{ device }, skyboxSet_{skyboxSet} {
-  createPipelineLayout(globalSetLayout, cubemapSetLayout);
-  createPipeline(renderPass);
+  LveDevice &device, const LveRenderTargetFormat& targetFormat, LvePushDescriptorSet& globalDescriptor, VkDescriptorSetLayout cubemapSetLayout, VkDescriptorSet skyboxSet, LveThreadPool* threadPool)
+  : lveDevice{ device }, globalDescriptor{ globalDescriptor }, skyboxSet_{skyboxSet} {
+  createPipelineLayout(globalDescriptor.getDescriptorSetLayout(), cubemapSetLayout);
+  createPipeline(targetFormat, threadPool);
 }
 
 SkyboxRenderSystem::~SkyboxRenderSystem() {
+  lvePipeline.wait();
+  globalDescriptor.releasePipelineLayout(pipelineLayout);
   vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
 }
 
@@ -49,33 +63,31 @@ void SkyboxRenderSystem::createPipelineLayout(VkDescriptorSetLayout globalSetLay
   }
 }
 
-void SkyboxRenderSystem::createPipeline(VkRenderPass renderPass) {
+void SkyboxRenderSystem::createPipeline(const LveRenderTargetFormat& targetFormat, LveThreadPool* threadPool) {
   assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
 
   PipelineConfigInfo pipelineConfig{};
   LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  // 支持 extended dynamic state 时这些状态在绘制时设置, 否则烘焙进 pipeline
+  LvePipeline::enableExtendedDynamicState(pipelineConfig, lveDevice);
+  skyboxRasterState().applyTo(pipelineConfig);
 
-  // 天空盒特殊设置
-  pipelineConfig.rasterizationInfo.cullMode = VK_CULL_MODE_BACK_BIT;
-  pipelineConfig.depthStencilInfo.depthTestEnable = VK_TRUE;
-  pipelineConfig.depthStencilInfo.depthWriteEnable = VK_FALSE;  // 不写入深度
-  pipelineConfig.depthStencilInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
-
-  pipelineConfig.renderPass = renderPass;
+  targetFormat.applyTo(pipelineConfig);
   pipelineConfig.pipelineLayout = pipelineLayout;
-  lvePipeline = std::make_unique<LvePipeline>(
-    lveDevice,
+  lvePipeline = lveDevice.pipelineRegistry().requestPipeline(
     "shaders/skybox.vert.spv",
     "shaders/skybox.frag.spv",
-    pipelineConfig);
+    pipelineConfig,
+    threadPool);
 }
 
 void SkyboxRenderSystem::renderSkybox(FrameInfo& frameInfo) {
-lvePipeline->bind(frameInfo.commandBuffer);
+LvePipeline* pipeline = lvePipeline.get();
+if (pipeline == nullptr) return;  // 还在编译
+frameInfo.dynamicState.bindPipeline(*pipeline);
+frameInfo.dynamicState.setRasterState(skyboxRasterState());
 
-vkCmdBindDescriptorSets(frameInfo.commandBuffer,
-                        VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 0, 1,
-                        &frameInfo.globalDescriptorSet, 0, nullptr);
+frameInfo.globalDescriptor.bind(frameInfo.commandBuffer, pipelineLayout, 0);
 
 vkCmdBindDescriptorSets(frameInfo.commandBuffer,
                         VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
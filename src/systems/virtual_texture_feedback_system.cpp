@@ -0,0 +1,388 @@
+#include "systems/virtual_texture_feedback_system.hpp"
+
+#include "lve_pipeline_registry.hpp"
+#include "systems/simple_render_system.hpp"
+
+// libs
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+// std
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <stdexcept>
+
+namespace lve {
+
+VirtualTextureFeedbackSystem::VirtualTextureFeedbackSystem(LveDevice& device,
+                                                           LveVirtualTexture& virtualTexture,
+                                                           uint32_t framesInFlight,
+                                                           LvePushDescriptorSet& globalDescriptor,
+                                                           VkDescriptorSetLayout textureSetLayout,
+                                                           VkDescriptorSet textureSet,
+                                                           LveThreadPool* threadPool)
+    : lveDevice{device},
+      virtualTexture{virtualTexture},
+      globalDescriptor{globalDescriptor},
+      feedbackPass{device},
+      textureSet_{textureSet} {
+  depthFormat = lveDevice.findSupportedFormat(
+      {VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT},
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT);
+  if (!lveDevice.supportsDynamicRendering()) {
+    createRenderPass();
+  }
+  createPipelineLayout(globalDescriptor.getDescriptorSetLayout(), textureSetLayout);
+  createPipeline(threadPool);
+  targets.resize(framesInFlight);
+}
+
+VirtualTextureFeedbackSystem::~VirtualTextureFeedbackSystem() {
+  for (auto& target : targets) {
+    destroyTarget(target);
+  }
+  lvePipeline.wait();
+  globalDescriptor.releasePipelineLayout(pipelineLayout);
+  vkDestroyPipelineLayout(lveDevice.device(), pipelineLayout, nullptr);
+  vkDestroyRenderPass(lveDevice.device(), renderPass, nullptr);
+}
+
+// The colour target ends in TRANSFER_SRC layout for the readback copy, depth only serves the
+// pass itself.
+void VirtualTextureFeedbackSystem::createRenderPass() {
+  VkAttachmentDescription colorAttachment{};
+  colorAttachment.format = VK_FORMAT_R32_UINT;
+  colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+  colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  colorAttachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+  VkAttachmentDescription depthAttachment{};
+  depthAttachment.format = depthFormat;
+  depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+  depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+  depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+  depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+  depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkAttachmentReference colorAttachmentRef{};
+  colorAttachmentRef.attachment = 0;
+  colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+  VkAttachmentReference depthAttachmentRef{};
+  depthAttachmentRef.attachment = 1;
+  depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+  VkSubpassDescription subpass{};
+  subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+  subpass.colorAttachmentCount = 1;
+  subpass.pColorAttachments = &colorAttachmentRef;
+  subpass.pDepthStencilAttachment = &depthAttachmentRef;
+
+  std::array<VkSubpassDependency, 2> dependencies{};
+  dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[0].dstSubpass = 0;
+  dependencies[0].srcStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].srcAccessMask = 0;
+  dependencies[0].dstStageMask =
+      VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+  dependencies[0].dstAccessMask =
+      VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+  // the page ids are copied out right after the pass
+  dependencies[1].srcSubpass = 0;
+  dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+  dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+  dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+  dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+  std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+  VkRenderPassCreateInfo renderPassInfo{};
+  renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+  renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+  renderPassInfo.pAttachments = attachments.data();
+  renderPassInfo.subpassCount = 1;
+  renderPassInfo.pSubpasses = &subpass;
+  renderPassInfo.dependencyCount = static_cast<uint32_t>(dependencies.size());
+  renderPassInfo.pDependencies = dependencies.data();
+  if (vkCreateRenderPass(lveDevice.device(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create feedback render pass!");
+  }
+}
+
+void VirtualTextureFeedbackSystem::createPipelineLayout(
+    VkDescriptorSetLayout globalSetLayout,
+    VkDescriptorSetLayout textureSetLayout) {
+  VkPushConstantRange pushConstantRange{};
+  pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+  pushConstantRange.offset = 0;
+  pushConstantRange.size = sizeof(SimplePushConstantData);
+
+  std::vector<VkDescriptorSetLayout> descriptorSetLayouts{globalSetLayout, textureSetLayout};
+
+  VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+  pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+  pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+  pipelineLayoutInfo.pSetLayouts = descriptorSetLayouts.data();
+  pipelineLayoutInfo.pushConstantRangeCount = 1;
+  pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+  if (vkCreatePipelineLayout(lveDevice.device(), &pipelineLayoutInfo, nullptr, &pipelineLayout) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("failed to create pipeline layout!");
+  }
+}
+
+void VirtualTextureFeedbackSystem::createPipeline(LveThreadPool* threadPool) {
+  assert(pipelineLayout != nullptr && "Cannot create pipeline before pipeline layout");
+
+  PipelineConfigInfo pipelineConfig{};
+  LvePipeline::defaultPipelineConfigInfo(pipelineConfig);
+  LvePipeline::enableExtendedDynamicState(pipelineConfig, lveDevice);
+  LveRenderTargetFormat targetFormat{};
+  if (renderPass != VK_NULL_HANDLE) {
+    targetFormat.renderPass = renderPass;
+  } else {
+    targetFormat.colorFormats = {VK_FORMAT_R32_UINT};
+    targetFormat.depthFormat = depthFormat;
+  }
+  targetFormat.applyTo(pipelineConfig);
+  pipelineConfig.pipelineLayout = pipelineLayout;
+  lvePipeline = lveDevice.pipelineRegistry().requestPipeline(
+      "shaders/simple_shader.vert.spv",
+      "shaders/vt_feedback.frag.spv",
+      pipelineConfig,
+      threadPool);
+}
+
+void VirtualTextureFeedbackSystem::createTarget(FeedbackTarget& target, VkExtent2D extent) {
+  target.extent = extent;
+  lveDevice.createImage(
+      extent.width,
+      extent.height,
+      1,
+      VK_FORMAT_R32_UINT,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      target.colorImage,
+      target.colorMemory);
+  target.colorView =
+      lveDevice.createImageView(target.colorImage, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R32_UINT);
+
+  lveDevice.createImage(
+      extent.width,
+      extent.height,
+      1,
+      depthFormat,
+      VK_IMAGE_TILING_OPTIMAL,
+      VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+      target.depthImage,
+      target.depthMemory);
+  VkImageViewCreateInfo viewInfo{};
+  viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+  viewInfo.image = target.depthImage;
+  viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+  viewInfo.format = depthFormat;
+  viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+  viewInfo.subresourceRange.baseMipLevel = 0;
+  viewInfo.subresourceRange.levelCount = 1;
+  viewInfo.subresourceRange.baseArrayLayer = 0;
+  viewInfo.subresourceRange.layerCount = 1;
+  if (vkCreateImageView(lveDevice.device(), &viewInfo, nullptr, &target.depthView) != VK_SUCCESS) {
+    throw std::runtime_error("failed to create feedback depth view!");
+  }
+
+  if (renderPass != VK_NULL_HANDLE) {
+    std::array<VkImageView, 2> attachments = {target.colorView, target.depthView};
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferInfo.pAttachments = attachments.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+    if (vkCreateFramebuffer(lveDevice.device(), &framebufferInfo, nullptr, &target.framebuffer) !=
+        VK_SUCCESS) {
+      throw std::runtime_error("failed to create feedback framebuffer!");
+    }
+  }
+
+  VkDeviceSize readbackSize = static_cast<VkDeviceSize>(extent.width) * extent.height * sizeof(uint32_t);
+  lveDevice.createBuffer(
+      readbackSize,
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      target.readbackBuffer,
+      target.readbackMemory);
+  void* mapped;
+  vkMapMemory(lveDevice.device(), target.readbackMemory, 0, readbackSize, 0, &mapped);
+  target.readback = static_cast<uint32_t*>(mapped);
+  target.hasResults = false;
+}
+
+void VirtualTextureFeedbackSystem::destroyTarget(FeedbackTarget& target) {
+  if (target.colorImage == VK_NULL_HANDLE) return;
+  vkUnmapMemory(lveDevice.device(), target.readbackMemory);
+  vkDestroyBuffer(lveDevice.device(), target.readbackBuffer, nullptr);
+  vkFreeMemory(lveDevice.device(), target.readbackMemory, nullptr);
+  vkDestroyFramebuffer(lveDevice.device(), target.framebuffer, nullptr);
+  vkDestroyImageView(lveDevice.device(), target.depthView, nullptr);
+  vkDestroyImage(lveDevice.device(), target.depthImage, nullptr);
+  vkFreeMemory(lveDevice.device(), target.depthMemory, nullptr);
+  vkDestroyImageView(lveDevice.device(), target.colorView, nullptr);
+  vkDestroyImage(lveDevice.device(), target.colorImage, nullptr);
+  vkFreeMemory(lveDevice.device(), target.colorMemory, nullptr);
+  target = FeedbackTarget{};
+}
+
+// most pixels repeat their neighbours' page, only the distinct ids go to the virtual texture
+void VirtualTextureFeedbackSystem::collectRequests(FeedbackTarget& target) {
+  size_t pixelCount = static_cast<size_t>(target.extent.width) * target.extent.height;
+  pageIds.assign(target.readback, target.readback + pixelCount);
+  std::sort(pageIds.begin(), pageIds.end());
+  pageIds.erase(std::unique(pageIds.begin(), pageIds.end()), pageIds.end());
+  virtualTexture.requestPages(pageIds);
+  target.hasResults = false;
+}
+
+void VirtualTextureFeedbackSystem::render(FrameInfo& frameInfo, VkExtent2D extent) {
+  // beginFrame waited for this slot's previous frame, its readback is complete
+  FeedbackTarget& target = targets[frameInfo.frameIndex];
+  if (target.hasResults) {
+    collectRequests(target);
+  }
+  // no pass until the pipeline is compiled, the page requests just start a little later
+  LvePipeline* pipeline = lvePipeline.get();
+  if (pipeline == nullptr) return;
+
+  VkExtent2D feedbackExtent{
+      std::max(extent.width / FEEDBACK_SCALE, 1u), std::max(extent.height / FEEDBACK_SCALE, 1u)};
+  if (target.extent.width != feedbackExtent.width || target.extent.height != feedbackExtent.height) {
+    destroyTarget(target);
+    createTarget(target, feedbackExtent);
+  }
+
+  std::array<VkClearValue, 2> clearValues{};
+  clearValues[0].color.uint32[0] = VIRTUAL_PAGE_NONE;
+  clearValues[1].depthStencil = {1.0f, 0};
+  if (renderPass == VK_NULL_HANDLE) {
+    // same layouts as the render pass below leaves the attachments in
+    LveRenderingAttachment color{};
+    color.image = target.colorImage;
+    color.view = target.colorView;
+    color.format = VK_FORMAT_R32_UINT;
+    color.clearValue = clearValues[0];
+    color.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    LveRenderingAttachment depth{};
+    depth.image = target.depthImage;
+    depth.view = target.depthView;
+    depth.format = depthFormat;
+    depth.clearValue = clearValues[1];
+    depth.store = false;
+    depth.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    feedbackPass.begin(frameInfo.commandBuffer, feedbackExtent, {color}, &depth);
+  } else {
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = renderPass;
+    renderPassInfo.framebuffer = target.framebuffer;
+    renderPassInfo.renderArea.offset = {0, 0};
+    renderPassInfo.renderArea.extent = feedbackExtent;
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+    vkCmdBeginRenderPass(frameInfo.commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(feedbackExtent.width);
+    viewport.height = static_cast<float>(feedbackExtent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    VkRect2D scissor{{0, 0}, feedbackExtent};
+    vkCmdSetViewport(frameInfo.commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(frameInfo.commandBuffer, 0, 1, &scissor);
+  }
+
+  frameInfo.dynamicState.bindPipeline(*pipeline);
+  frameInfo.dynamicState.setRasterState(LveRasterState{});
+  frameInfo.globalDescriptor.bind(frameInfo.commandBuffer, pipelineLayout, 0);
+  vkCmdBindDescriptorSets(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_BIND_POINT_GRAPHICS,
+      pipelineLayout,
+      1,
+      1,
+      &textureSet_,
+      0,
+      nullptr);
+
+  // every object is drawn so hidden surfaces do not request pages, only those using this
+  // virtual texture write ids
+  for (auto& kv : frameInfo.gameObjects) {
+    auto& obj = kv.second;
+    if (obj.model == nullptr) continue;
+    if (obj.GetTag() == "skybox") continue;
+    SimplePushConstantData push{};
+    push.modelMatrix = obj.transform.mat4();
+    if (obj.material && obj.material->GetVirtualTexture().get() == &virtualTexture) {
+      push.virtualTexture = virtualTexture.getShaderParams();
+    }
+    vkCmdPushConstants(
+        frameInfo.commandBuffer,
+        pipelineLayout,
+        VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        0,
+        sizeof(SimplePushConstantData),
+        &push);
+    obj.model->bind(frameInfo.commandBuffer);
+    obj.model->draw(frameInfo.commandBuffer);
+  }
+  if (renderPass == VK_NULL_HANDLE) {
+    feedbackPass.end(frameInfo.commandBuffer);
+  } else {
+    vkCmdEndRenderPass(frameInfo.commandBuffer);
+  }
+
+  VkBufferImageCopy region{};
+  region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+  region.imageSubresource.mipLevel = 0;
+  region.imageSubresource.baseArrayLayer = 0;
+  region.imageSubresource.layerCount = 1;
+  region.imageExtent = {feedbackExtent.width, feedbackExtent.height, 1};
+  vkCmdCopyImageToBuffer(
+      frameInfo.commandBuffer,
+      target.colorImage,
+      VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+      target.readbackBuffer,
+      1,
+      &region);
+
+  VkBufferMemoryBarrier barrier{};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.buffer = target.readbackBuffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+  vkCmdPipelineBarrier(
+      frameInfo.commandBuffer,
+      VK_PIPELINE_STAGE_TRANSFER_BIT,
+      VK_PIPELINE_STAGE_HOST_BIT,
+      0, 0, nullptr, 1, &barrier, 0, nullptr);
+  target.hasResults = true;
+}
+
+}  // namespace lve
@@ -0,0 +1,118 @@
+// Texture load benchmark: stb_image PNG vs QOI vs raw cooked RGBA8 KTX2, read from disk and
+// decoded into the bottom up RGBA8 rows LveTexture uploads
+#include "lve_image.hpp"
+#include "lve_qoi.hpp"
+#include "lve_texture_data.hpp"
+
+// std
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr int ITERATIONS = 10;
+
+struct BenchResult {
+  size_t fileSize{0};
+  double milliseconds{0.0};  // median over ITERATIONS loads
+};
+
+size_t fileSize(const std::string &filepath) {
+  std::ifstream file{filepath, std::ios::ate | std::ios::binary};
+  if (!file.is_open()) {
+    throw std::runtime_error("failed to open file: " + filepath);
+  }
+  return static_cast<size_t>(file.tellg());
+}
+
+BenchResult measure(const std::string &filepath, const std::function<void()> &load) {
+  std::vector<double> samples;
+  for (int i = 0; i < ITERATIONS; i++) {
+    auto start = std::chrono::high_resolution_clock::now();
+    load();
+    auto end = std::chrono::high_resolution_clock::now();
+    samples.push_back(std::chrono::duration<double, std::chrono::milliseconds::period>(end - start).count());
+  }
+  std::sort(samples.begin(), samples.end());
+  return BenchResult{fileSize(filepath), samples[samples.size() / 2]};
+}
+
+std::string baseName(const std::string &filepath) {
+  auto slash = filepath.find_last_of("/\\");
+  std::string name = slash == std::string::npos ? filepath : filepath.substr(slash + 1);
+  return name.substr(0, name.find_last_of('.'));
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    std::cerr << "usage: lve_texture_bench <scratch dir> <image.png>...\n";
+    return EXIT_FAILURE;
+  }
+
+  try {
+    std::string scratch = argv[1];
+    BenchResult total[3];
+    std::printf("%-24s %12s %12s %12s %10s %10s %10s\n", "texture", "png ms", "qoi ms", "raw ms",
+                "png KB", "qoi KB", "raw KB");
+
+    for (int i = 2; i < argc; i++) {
+      std::string png = argv[i];
+      std::string qoi = scratch + "/" + baseName(png) + ".qoi";
+      std::string raw = scratch + "/" + baseName(png) + ".ktx2";
+
+      // the converted copies hold exactly what the PNG decodes to
+      lve::ImageMipLevel image = lve::loadImageRGBA8(png, false);
+      lve::QoiHeader header{};
+      header.width = image.width;
+      header.height = image.height;
+      lve::saveQoi(qoi, image.pixels.data(), header);
+
+      lve::TextureData texture{};
+      texture.format = VK_FORMAT_R8G8B8A8_SRGB;
+      texture.width = image.width;
+      texture.height = image.height;
+      texture.levels.push_back(lve::loadImageRGBA8(png, true).pixels);
+      lve::saveKtx2(raw, texture);
+
+      BenchResult results[3] = {
+          measure(png, [&]() { lve::loadImageRGBA8(png, true); }),
+          measure(qoi, [&]() { lve::loadImageRGBA8(qoi, true); }),
+          measure(raw, [&]() { lve::loadTextureData(raw); })};
+      if (lve::loadImageRGBA8(qoi, true).pixels != texture.levels[0]) {
+        throw std::runtime_error("QOI round trip does not match the PNG: " + png);
+      }
+
+      std::printf("%-24s %12.2f %12.2f %12.2f %10.1f %10.1f %10.1f\n", baseName(png).c_str(),
+                  results[0].milliseconds, results[1].milliseconds, results[2].milliseconds,
+                  results[0].fileSize / 1024.0, results[1].fileSize / 1024.0,
+                  results[2].fileSize / 1024.0);
+      for (int r = 0; r < 3; r++) {
+        total[r].milliseconds += results[r].milliseconds;
+        total[r].fileSize += results[r].fileSize;
+      }
+    }
+
+    std::printf("%-24s %12.2f %12.2f %12.2f %10.1f %10.1f %10.1f\n", "total",
+                total[0].milliseconds, total[1].milliseconds, total[2].milliseconds,
+                total[0].fileSize / 1024.0, total[1].fileSize / 1024.0, total[2].fileSize / 1024.0);
+    if (total[1].milliseconds > 0.0 && total[2].milliseconds > 0.0) {
+      std::printf("qoi loads %.1fx faster than png, raw %.1fx faster\n",
+                  total[0].milliseconds / total[1].milliseconds,
+                  total[0].milliseconds / total[2].milliseconds);
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,233 @@
+// Offline texture cooker: PNG (or anything stb_image reads) -> block compressed KTX2 with mips,
+// or a lossless QOI copy that loads several times faster than the PNG, or a tiled virtual texture
+#include "lve_bc_encoder.hpp"
+#include "lve_image.hpp"
+#include "lve_mipmap.hpp"
+#include "lve_qoi.hpp"
+#include "lve_texture_data.hpp"
+#include "lve_thread_pool.hpp"
+#include "lve_virtual_texture_file.hpp"
+
+// std
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct CookOptions {
+  std::string format{"bc7"};
+  lve::BcQuality quality{lve::BcQuality::Normal};
+  bool linear{false};
+  bool mips{true};
+  uint32_t threads{0};
+  uint32_t pageSize{128};
+  std::string output;
+  std::vector<std::string> inputs;  // one image, or six cube faces in +X -X +Y -Y +Z -Z order
+};
+
+void printUsage() {
+  std::cerr
+      << "usage: lve_texture_cook [options] <input.png> <output.ktx2>\n"
+         "       lve_texture_cook [options] --cubemap <output.ktx2> <+x> <-x> <+y> <-y> <+z> <-z>\n"
+         "       lve_texture_cook --format qoi [--linear] <input.png> <output.qoi>\n"
+         "       lve_texture_cook --format vt [--linear] [--page-size N] <input.png> <output.lvt>\n"
+         "options:\n"
+         "  --format bc1|bc3|bc4|bc5|bc7|qoi|vt output format, default bc7\n"
+         "  --quality fast|normal|high          encoder preset, default normal\n"
+         "  --linear                            UNORM instead of sRGB colour, implied by bc4 / bc5\n"
+         "  --no-mips                           only write the top level\n"
+         "  --threads N                         worker threads, default one per core\n"
+         "  --page-size N                       virtual texture page size in texels, default 128\n";
+}
+
+CookOptions parseOptions(int argc, char **argv) {
+  CookOptions options{};
+  bool cubemap = false;
+  std::vector<std::string> positional;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    auto value = [&]() -> std::string {
+      if (i + 1 >= argc) throw std::runtime_error("missing value for " + arg);
+      return argv[++i];
+    };
+    if (arg == "--help") {
+      printUsage();
+      std::exit(EXIT_SUCCESS);
+    } else if (arg == "--format") {
+      options.format = value();
+    } else if (arg == "--quality") {
+      std::string quality = value();
+      if (quality == "fast") {
+        options.quality = lve::BcQuality::Fast;
+      } else if (quality == "normal") {
+        options.quality = lve::BcQuality::Normal;
+      } else if (quality == "high") {
+        options.quality = lve::BcQuality::High;
+      } else {
+        throw std::runtime_error("unknown quality preset: " + quality);
+      }
+    } else if (arg == "--linear") {
+      options.linear = true;
+    } else if (arg == "--no-mips") {
+      options.mips = false;
+    } else if (arg == "--threads") {
+      options.threads = static_cast<uint32_t>(std::stoul(value()));
+    } else if (arg == "--page-size") {
+      options.pageSize = static_cast<uint32_t>(std::stoul(value()));
+    } else if (arg == "--cubemap") {
+      cubemap = true;
+    } else if (arg.compare(0, 2, "--") == 0) {
+      throw std::runtime_error("unknown option: " + arg);
+    } else {
+      positional.push_back(arg);
+    }
+  }
+
+  if (cubemap && positional.size() == 7) {
+    options.output = positional[0];
+    options.inputs.assign(positional.begin() + 1, positional.end());
+  } else if (!cubemap && positional.size() == 2) {
+    options.inputs = {positional[0]};
+    options.output = positional[1];
+  } else {
+    throw std::runtime_error("wrong number of arguments");
+  }
+  if (options.format == "bc4" || options.format == "bc5") options.linear = true;
+  if (options.format == "qoi" && cubemap) throw std::runtime_error("QOI output takes a single image");
+  if (options.format == "vt" && cubemap) throw std::runtime_error("virtual textures take a single image");
+  return options;
+}
+
+VkFormat targetFormat(const CookOptions &options) {
+  bool srgb = !options.linear;
+  if (options.format == "bc1") return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+  if (options.format == "bc3") return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+  if (options.format == "bc4") return VK_FORMAT_BC4_UNORM_BLOCK;
+  if (options.format == "bc5") return VK_FORMAT_BC5_UNORM_BLOCK;
+  if (options.format == "bc7") return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+  throw std::runtime_error("unknown block format: " + options.format);
+}
+
+// QOI keeps the usual top down rows, the loader flips them like it does for PNG
+void convertToQoi(const CookOptions &options) {
+  lve::ImageMipLevel image = lve::loadImageRGBA8(options.inputs[0], false);
+  lve::QoiHeader header{};
+  header.width = image.width;
+  header.height = image.height;
+  header.colorspace = options.linear ? 1 : 0;
+  size_t fileSize = lve::saveQoi(options.output, image.pixels.data(), header);
+  std::printf(
+      "%s: qoi %ux%u, %.1f KB (%.1f%% of raw RGBA8)\n",
+      options.output.c_str(),
+      image.width,
+      image.height,
+      fileSize / 1024.0,
+      100.0 * fileSize / image.pixels.size());
+}
+
+// every page keeps a 4 texel border, enough for bilinear filtering with anisotropy off
+void convertToVirtualTexture(const CookOptions &options) {
+  lve::ImageMipLevel image = lve::loadImageRGBA8(options.inputs[0], true);
+  lve::VirtualTextureInfo info =
+      lve::makeVirtualTextureInfo(image.width, image.height, options.pageSize, 4, !options.linear);
+  lve::LveThreadPool pool{options.threads};
+  size_t fileSize = lve::saveVirtualTexture(options.output, image.pixels.data(), info, &pool);
+  std::printf(
+      "%s: virtual texture %ux%u, %u levels, %u pages of %u texels, %.1f KB\n",
+      options.output.c_str(),
+      info.width,
+      info.height,
+      info.mipLevels,
+      info.pageCount(),
+      info.pageSize,
+      fileSize / 1024.0);
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  CookOptions options{};
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    printUsage();
+    return EXIT_FAILURE;
+  }
+
+  try {
+    if (options.format == "qoi") {
+      convertToQoi(options);
+      return EXIT_SUCCESS;
+    }
+    if (options.format == "vt") {
+      convertToVirtualTexture(options);
+      return EXIT_SUCCESS;
+    }
+
+    VkFormat format = targetFormat(options);
+    lve::LveThreadPool pool{options.threads};
+
+    lve::TextureData texture{};
+    texture.format = format;
+    texture.layerCount = static_cast<uint32_t>(options.inputs.size());
+    texture.isCubemap = texture.layerCount == 6;
+    lve::BcEncodeStats stats{};
+
+    for (const auto &input : options.inputs) {
+      // rows are stored bottom up, the order LveTexture uploads decoded images in
+      lve::ImageMipLevel image = lve::loadImageRGBA8(input, true);
+      if (texture.width == 0) {
+        texture.width = image.width;
+        texture.height = image.height;
+        uint32_t levelCount = options.mips ? lve::calculateMipLevels(image.width, image.height) : 1;
+        texture.levels.resize(levelCount);
+      } else if (image.width != texture.width || image.height != texture.height) {
+        throw std::runtime_error("cubemap faces differ in size: " + input);
+      }
+
+      std::vector<lve::ImageMipLevel> chain;
+      if (texture.levels.size() > 1) {
+        chain = lve::generateMipChainRGBA8(image.pixels.data(), image.width, image.height, !options.linear);
+      }
+      chain.insert(chain.begin(), std::move(image));
+
+      for (size_t level = 0; level < texture.levels.size(); level++) {
+        lve::BcEncodeStats levelStats{};
+        auto blocks = lve::encodeBlockCompressedImage(
+            format,
+            chain[level].pixels.data(),
+            chain[level].width,
+            chain[level].height,
+            options.quality,
+            &pool,
+            &levelStats);
+        stats += levelStats;
+        auto &levelData = texture.levels[level];
+        levelData.insert(levelData.end(), blocks.begin(), blocks.end());
+      }
+    }
+
+    lve::saveKtx2(options.output, texture);
+    std::printf(
+        "%s: %s %s %ux%u, %zu levels, PSNR %.2f dB, %.1f MP/s (%s, %u threads)\n",
+        options.output.c_str(),
+        options.format.c_str(),
+        options.linear ? "linear" : "sRGB",
+        texture.width,
+        texture.height,
+        texture.levels.size(),
+        stats.psnr(),
+        stats.megapixelsPerSecond(),
+        lve::bcEncoderKernelName(),
+        pool.threadCount() + 1);
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << '\n';
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}